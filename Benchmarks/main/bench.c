@@ -0,0 +1,120 @@
+/**
+ * @file bench.c
+ *
+ * Timing harness of the benchmarks.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sdkconfig.h>
+#include "bench.h"
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+#include <time.h>
+#else
+#include <esp_cpu.h>
+#include <esp_rom_sys.h>
+#endif
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+
+typedef uint64_t ticks_t;
+
+static inline ticks_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t to_ns(uint64_t ticks)
+{
+    return ticks;
+}
+
+static uint64_t to_cycles(uint64_t ticks)
+{
+    return 0;
+}
+
+#else
+
+// Differences of the 32 bit counter are right across one wrap
+typedef uint32_t ticks_t;
+
+static inline ticks_t now(void)
+{
+    return esp_cpu_get_cycle_count();
+}
+
+static uint64_t to_ns(uint64_t ticks)
+{
+    return ticks * 1000 / esp_rom_get_cpu_ticks_per_us();
+}
+
+static uint64_t to_cycles(uint64_t ticks)
+{
+    return ticks;
+}
+
+#endif
+
+static int compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t bench_run(const bench_t *bench, bench_fn_t fn, void *ctx, bench_result_t *res)
+{
+    CHECK_ARG(bench && fn && res && bench->iters && bench->runs && bench->runs <= BENCH_MAX_RUNS);
+
+    uint64_t runs[BENCH_MAX_RUNS];
+
+    fn(ctx);
+    for (uint32_t r = 0; r < bench->runs; r++)
+    {
+        ticks_t start = now();
+        for (uint32_t i = 0; i < bench->iters; i++)
+            fn(ctx);
+        runs[r] = (ticks_t)(now() - start);
+    }
+    qsort(runs, bench->runs, sizeof(runs[0]), compare);
+
+    uint64_t median = runs[bench->runs / 2];
+    uint64_t median_ns = to_ns(median);
+    res->ns = median_ns / bench->iters;
+    res->ns_min = to_ns(runs[0]) / bench->iters;
+    res->cycles = to_cycles(median) / bench->iters;
+    res->rate_milli = median_ns ? (uint64_t)bench->per_iter * bench->iters * 1000000000000 / median_ns : 0;
+    res->field_count = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t bench_add_field(bench_result_t *res, const char *key, uint32_t value)
+{
+    CHECK_ARG(res && key);
+    if (res->field_count == BENCH_MAX_FIELDS)
+        return ESP_ERR_NO_MEM;
+
+    res->fields[res->field_count++] = (bench_field_t) { .key = key, .value = value };
+
+    return ESP_OK;
+}
+
+void bench_print(const bench_t *bench, const bench_result_t *res)
+{
+    printf("BENCH {\"name\":\"%s\",\"target\":\"%s\",\"iters\":%" PRIu32 ",\"runs\":%" PRIu32
+           ",\"ns\":%" PRIu64 ",\"ns_min\":%" PRIu64 ",\"cycles\":%" PRIu64 ",\"rate\":%" PRIu64 ".%03" PRIu64 ",\"unit\":\"%s/s\"",
+           bench->name, CONFIG_IDF_TARGET, bench->iters, bench->runs,
+           res->ns, res->ns_min, res->cycles, res->rate_milli / 1000, res->rate_milli % 1000, bench->unit);
+    for (uint32_t i = 0; i < res->field_count; i++)
+        printf(",\"%s\":%" PRIu32, res->fields[i].key, res->fields[i].value);
+    printf("}\n");
+    fflush(stdout);
+}
@@ -0,0 +1,105 @@
+/**
+ * @file bench.h
+ * @defgroup bench bench
+ * @{
+ *
+ * Timing harness of the benchmarks.
+ *
+ * A benchmark is a function doing one iteration of the work. It runs once to
+ * warm the caches, then `runs` times `iters` iterations, and every run is
+ * timed as a whole. The median run is reported, the fastest one as well to
+ * show the noise.
+ *
+ * The clock is the CPU cycle counter on the chip and CLOCK_MONOTONIC on
+ * linux. A run must end within 2^32 cycles, about 17 s at 240 MHz.
+ *
+ * Results are printed as one line each, `BENCH ` followed by a JSON object
+ * with the fields in a fixed order. Values are integers, the rate has three
+ * decimals, so that tools/bench_compare.py can compare the output of two
+ * builds.
+ */
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCH_MAX_RUNS   15      //!< Runs of one benchmark
+#define BENCH_MAX_FIELDS 4       //!< Extra fields of one result
+
+/**
+ * One iteration of a benchmark
+ */
+typedef void (*bench_fn_t)(void *ctx);
+
+/**
+ * Benchmark description
+ */
+typedef struct
+{
+    const char *name;            //!< Name, stable between releases
+    const char *unit;            //!< What the rate counts, e.g. "px"
+    uint32_t per_iter;           //!< Units of work in one iteration
+    uint32_t iters;              //!< Iterations of one run
+    uint32_t runs;               //!< Timed runs, up to `BENCH_MAX_RUNS`
+} bench_t;
+
+/**
+ * Extra value of a result, e.g. bytes sent per iteration
+ */
+typedef struct
+{
+    const char *key;
+    uint32_t value;
+} bench_field_t;
+
+typedef struct
+{
+    uint64_t ns;                 //!< Median run per iteration
+    uint64_t ns_min;             //!< Fastest run per iteration
+    uint64_t cycles;             //!< Median run per iteration, 0 on linux
+    uint64_t rate_milli;         //!< Thousandths of units per second at the median run
+    bench_field_t fields[BENCH_MAX_FIELDS];
+    uint32_t field_count;
+} bench_result_t;
+
+/**
+ * @brief Time a benchmark
+ *
+ * @param bench Benchmark
+ * @param fn One iteration
+ * @param ctx Context passed to `fn`
+ * @param[out] res Result, without extra fields
+ * @return `ESP_OK` on success
+ */
+esp_err_t bench_run(const bench_t *bench, bench_fn_t fn, void *ctx, bench_result_t *res);
+
+/**
+ * @brief Add an extra field to a result
+ *
+ * @param res Result
+ * @param key Name of the field
+ * @param value Value
+ * @return `ESP_OK` on success, `ESP_ERR_NO_MEM` if the result is full
+ */
+esp_err_t bench_add_field(bench_result_t *res, const char *key, uint32_t value);
+
+/**
+ * @brief Print a result line
+ *
+ * @param bench Benchmark
+ * @param res Its result
+ */
+void bench_print(const bench_t *bench, const bench_result_t *res);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,561 @@
+/**
+ * Benchmarks of the display and input paths, on the chip or on the linux
+ * target against the halfake drivers. Prints one `BENCH` line per result,
+ * see bench.h.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "max7219.h"
+#include "keyarray.h"
+#include "WS2812B.h"
+#include "lfring.h"
+#include "asynclog.h"
+#include "ledanim.h"
+// Compiled in, so that the taglog row times the runtime filter
+#define TAGLOG_CEILING ESP_LOG_VERBOSE
+#include "taglog.h"
+#include "bench.h"
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+#include "halfake.h"
+#include "max7219emu.h"
+#include "ledanim_map.h"
+#endif
+
+static const char *TAG = "bench";
+TAGLOG_DEFINE(tag, "bench");
+
+// Scrolled through the display by the scroll benchmark, the first
+// cascade_size characters are shown without scrolling
+static const char SCROLL_TEXT[] = "0123456789AB";
+
+static const uint64_t image = 0x3c4281a5a581423cULL;
+
+typedef struct
+{
+    max7219_t dev;
+    max7219_scroll_t scroll;
+    int32_t counter;
+} display_ctx_t;
+
+#ifndef CONFIG_IDF_TARGET_LINUX
+// The animation of the MAX7219 example, mapped from BENCH_ANIM_FILE on linux
+extern const uint8_t images_lan_start[] asm("_binary_images_lan_start");
+extern const uint8_t images_lan_end[] asm("_binary_images_lan_end");
+#endif
+
+#define ANIM_SIDE 8              // pixels, the sinks below hold one 8x8 frame
+
+typedef struct
+{
+    ledanim_t anim;
+    ledanim_sink_t sink;
+    uint8_t mono[ANIM_SIDE];
+    ws2812b_rgb_t rgb[ANIM_SIDE * ANIM_SIDE];
+} anim_ctx_t;
+
+typedef struct
+{
+    uint64_t values[2];
+    uint8_t rgb[2][64][3];
+} rgb_ctx_t;
+
+// One effect rendering into a framebuffer of the configured strip
+typedef struct
+{
+    ws2812b_fx_t fx;
+    ws2812b_fb_t fb;
+    uint32_t frame;
+    ws2812b_rgb_t pixels[CONFIG_WS2812B_LENGTH];
+    uint8_t heat[CONFIG_WS2812B_LENGTH];
+} fx_ctx_t;
+
+#define LOG_RING_SIZE  16384     // bytes per core of the asynclog rings
+#define LOG_ITERS      20        // calls per run, all runs of a benchmark fit in a ring
+#define DISABLED_CALLS 100       // disabled log calls per iteration
+#define DISABLED_ITERS 1000
+
+#define RING_LEN   64            // messages, as a FreeRTOS queue of the same length
+#define RING_BATCH 256           // messages sent by the producer task per iteration
+
+#if CONFIG_FREERTOS_UNICORE
+#define PRODUCER_CORE tskNO_AFFINITY
+#else
+#define PRODUCER_CORE 1          // the benchmarks run in the main task on core 0
+#endif
+
+/*
+ * Messages of the size of a key event, passed through an lfring or a
+ * FreeRTOS queue, within one task or from a producer task to the main task
+ */
+typedef struct
+{
+    lfring_spsc_t ring;
+    uint64_t buf[RING_LEN];
+    QueueHandle_t queue;
+    TaskHandle_t producer;
+    bool use_queue;
+} ring_ctx_t;
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+// Decodes the MAX7219 stream to count the bytes that changed nothing
+static max7219emu_t emu;
+
+/*
+ * Counts what one iteration sends to the fakes, outside of the timed runs.
+ * The first iteration brings the emulator up to date, the second one is
+ * counted.
+ */
+static void count_outputs(const bench_t *bench, bench_fn_t fn, void *ctx, bench_result_t *res)
+{
+    halfake_stats_t stats;
+    max7219emu_stats_t emu_stats = { 0 };
+    bool emulated = max7219emu_attach(&emu, CONFIG_MAX7219_CS_GPIO) == ESP_OK;
+
+    fn(ctx);
+    halfake_reset();
+    max7219emu_take_stats(&emu, &emu_stats);
+    fn(ctx);
+    halfake_get_stats(&stats);
+    max7219emu_take_stats(&emu, &emu_stats);
+    if (emulated)
+        max7219emu_detach();
+
+    if (stats.spi_bytes)
+    {
+        bench_add_field(res, "spi_bytes", stats.spi_bytes);
+        bench_add_field(res, "spi_transactions", stats.calls[HALFAKE_SPI_TRANSMIT]);
+    }
+    if (emu_stats.bytes)
+        bench_add_field(res, "wasted_bytes", max7219emu_wasted_bytes(&emu_stats));
+    if (stats.calls[HALFAKE_GPIO_LEVEL])
+        bench_add_field(res, "gpio_writes", stats.calls[HALFAKE_GPIO_LEVEL]);
+}
+#else
+static void count_outputs(const bench_t *bench, bench_fn_t fn, void *ctx, bench_result_t *res)
+{
+}
+#endif
+
+static void run(const bench_t *bench, bench_fn_t fn, void *ctx)
+{
+    bench_result_t res;
+
+    ESP_ERROR_CHECK(bench_run(bench, fn, ctx, &res));
+    count_outputs(bench, fn, ctx, &res);
+    bench_print(bench, &res);
+}
+
+static void draw_image(void *ctx)
+{
+    display_ctx_t *d = ctx;
+
+    max7219_draw_image_8x8(&d->dev, 0, &image);
+}
+
+// One image on every chip of the cascade
+static void draw_frame(void *ctx)
+{
+    display_ctx_t *d = ctx;
+
+    for (uint8_t i = 0; i < d->dev.cascade_size; i++)
+        max7219_draw_image_8x8(&d->dev, i * 8, &image);
+}
+
+// One register write to every chip, the send path of the driver alone
+static void write_register(void *ctx)
+{
+    display_ctx_t *d = ctx;
+
+    max7219_set_brightness(&d->dev, d->counter++ & 0x0f);
+}
+
+// Moves the string by one character, 8 steps of one row each
+static void scroll_char(void *ctx)
+{
+    display_ctx_t *d = ctx;
+    bool done;
+
+    for (int i = 0; i < 8; i++)
+        max7219_scroll_step(&d->dev, &d->scroll, &done);
+}
+
+// A counter over all digits, most steps change only the last ones
+static void draw_counter(void *ctx)
+{
+    display_ctx_t *d = ctx;
+
+    max7219_draw_int_7seg(&d->dev, 0, d->dev.digits, d->counter++, 0);
+}
+
+static void scan_keys(void *ctx)
+{
+    scanForSingleKeyOnce('?');
+}
+
+static void to_rgb(void *ctx)
+{
+    rgb_ctx_t *c = ctx;
+
+    uint64ToRGBArray(c->values, c->rgb, 0x20, 0x10, 0x08);
+}
+
+static void render_fx(void *ctx)
+{
+    fx_ctx_t *c = ctx;
+
+    c->fx.render(&c->fx, &c->fb, c->frame++);
+}
+
+static void decode_frame(void *ctx)
+{
+    anim_ctx_t *c = ctx;
+
+    ledanim_next(&c->anim, &c->sink, NULL);
+}
+
+/*
+ * Formats the line as the console would and drops it, so that the log
+ * benchmarks do not time the UART
+ */
+static int log_sink(const char *fmt, va_list args)
+{
+    char line[ASYNCLOG_MAX_LINE];
+
+    return vsnprintf(line, sizeof(line), fmt, args);
+}
+
+static void log_call(void *ctx)
+{
+    uint32_t *frame = ctx;
+
+    ESP_LOGI(TAG, "Frame %" PRIu32 " took %d us on %s", (*frame)++, 1234, "core 0");
+}
+
+static void log_bin_call(void *ctx)
+{
+    uint32_t *frame = ctx;
+
+    ASYNCLOG_LOGI(TAG, "Frame %" PRIu32 " took %d us on %s", (*frame)++, 1234, "core 0");
+}
+
+// Below LOG_LOCAL_LEVEL, removed by the compiler
+static void log_compiled_out(void *ctx)
+{
+    uint32_t *frame = ctx;
+
+    for (int i = 0; i < DISABLED_CALLS; i++)
+        ESP_LOGV(TAG, "Frame %" PRIu32 " took %d us on %s", (*frame)++, 1234, "core 0");
+}
+
+// Compiled in, dropped by the level of the tag in esp_log_write()
+static void log_esp_filtered(void *ctx)
+{
+    uint32_t *frame = ctx;
+
+    for (int i = 0; i < DISABLED_CALLS; i++)
+        ESP_LOG_LEVEL(ESP_LOG_DEBUG, TAG, "Frame %" PRIu32 " took %d us on %s", (*frame)++, 1234, "core 0");
+}
+
+// Compiled in, dropped by the level taglog resolved for the tag
+static void log_taglog_filtered(void *ctx)
+{
+    uint32_t *frame = ctx;
+
+    for (int i = 0; i < DISABLED_CALLS; i++)
+        TAGLOG_LOGD(&tag, "Frame %" PRIu32 " took %d us on %s", (*frame)++, 1234, "core 0");
+}
+
+static void ring_push_pop(void *ctx)
+{
+    ring_ctx_t *c = ctx;
+    uint64_t msg = 0;
+
+    lfring_spsc_push(&c->ring, &msg);
+    lfring_spsc_pop(&c->ring, &msg);
+}
+
+static void queue_push_pop(void *ctx)
+{
+    ring_ctx_t *c = ctx;
+    uint64_t msg = 0;
+
+    xQueueSend(c->queue, &msg, 0);
+    xQueueReceive(c->queue, &msg, 0);
+}
+
+// Sends a batch per notification, yields while the ring is full
+static void producer_task(void *arg)
+{
+    ring_ctx_t *c = arg;
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (uint64_t msg = 0; msg < RING_BATCH; msg++)
+        {
+            if (c->use_queue)
+                xQueueSend(c->queue, &msg, portMAX_DELAY);
+            else
+                while (!lfring_spsc_push(&c->ring, &msg))
+                    taskYIELD();
+        }
+    }
+}
+
+static void ring_batch(void *ctx)
+{
+    ring_ctx_t *c = ctx;
+    uint64_t msg;
+
+    xTaskNotifyGive(c->producer);
+    for (int i = 0; i < RING_BATCH; i++)
+        lfring_spsc_pop_wait(&c->ring, &msg, portMAX_DELAY);
+}
+
+static void queue_batch(void *ctx)
+{
+    ring_ctx_t *c = ctx;
+    uint64_t msg;
+
+    xTaskNotifyGive(c->producer);
+    for (int i = 0; i < RING_BATCH; i++)
+        xQueueReceive(c->queue, &msg, portMAX_DELAY);
+}
+
+static void bench_lfring(void)
+{
+    static ring_ctx_t c;
+
+    ESP_ERROR_CHECK(lfring_spsc_init(&c.ring, c.buf, RING_LEN, sizeof(uint64_t)));
+    c.queue = xQueueCreate(RING_LEN, sizeof(uint64_t));
+    if (!c.queue || xTaskCreatePinnedToCore(producer_task, "producer", 2048, &c, uxTaskPriorityGet(NULL),
+                                            &c.producer, PRODUCER_CORE) != pdPASS)
+    {
+        ESP_LOGE(TAG, "No memory for the ring benchmarks");
+        return;
+    }
+
+    const bench_t ring_bench = { .name = "lfring_spsc_push_pop", .unit = "msg", .per_iter = 1, .iters = 1000, .runs = 9 };
+    run(&ring_bench, ring_push_pop, &c);
+
+    const bench_t queue_bench = { .name = "xQueueSend_Receive", .unit = "msg", .per_iter = 1, .iters = 1000, .runs = 9 };
+    run(&queue_bench, queue_push_pop, &c);
+
+    // From the producer task, on the other core where there is one
+    const bench_t ring_task_bench = { .name = "lfring_spsc_task", .unit = "msg", .per_iter = RING_BATCH, .iters = 20, .runs = 9 };
+    c.use_queue = false;
+    run(&ring_task_bench, ring_batch, &c);
+
+    const bench_t queue_task_bench = { .name = "xQueue_task", .unit = "msg", .per_iter = RING_BATCH, .iters = 20, .runs = 9 };
+    c.use_queue = true;
+    run(&queue_task_bench, queue_batch, &c);
+
+    vTaskDelete(c.producer);
+    vQueueDelete(c.queue);
+}
+
+/*
+ * Starts with empty rings and reports the records asynclog dropped on a
+ * full ring while the benchmark ran
+ */
+static void run_log(const bench_t *bench, bench_fn_t fn, void *ctx)
+{
+    bench_result_t res;
+    asynclog_stats_t before, after;
+
+    asynclog_flush(pdMS_TO_TICKS(1000));
+    asynclog_get_stats(&before);
+    ESP_ERROR_CHECK(bench_run(bench, fn, ctx, &res));
+    asynclog_get_stats(&after);
+    bench_add_field(&res, "dropped", after.dropped - before.dropped);
+    bench_print(bench, &res);
+}
+
+/*
+ * A run decodes the whole animation once, starting at its first frame, and
+ * reports the average size of an encoded frame
+ */
+static void run_anim(const char *name, anim_ctx_t *c)
+{
+    bench_result_t res;
+    const bench_t bench = { .name = name, .unit = "frame", .per_iter = 1, .iters = c->anim.hdr.frame_count, .runs = 9 };
+
+    ledanim_rewind(&c->anim);
+    ESP_ERROR_CHECK(bench_run(&bench, decode_frame, c, &res));
+    bench_add_field(&res, "bytes_per_frame", (c->anim.size - c->anim.first_frame) / c->anim.hdr.frame_count);
+    bench_print(&bench, &res);
+}
+
+static void bench_ledanim(void)
+{
+    static anim_ctx_t c;
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+    // Through the mmap() of ledanim_map_linux.c
+    ledanim_map_t map;
+    if (ledanim_map_open(&map, BENCH_ANIM_FILE) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Cannot map %s", BENCH_ANIM_FILE);
+        return;
+    }
+    ESP_ERROR_CHECK(ledanim_map_anim(&map, &c.anim));
+#else
+    ESP_ERROR_CHECK(ledanim_open(&c.anim, images_lan_start, images_lan_end - images_lan_start));
+#endif
+    if (c.anim.hdr.width != ANIM_SIDE || c.anim.hdr.height != ANIM_SIDE)
+    {
+        ESP_LOGE(TAG, "images.lan is %ux%u, the decode benchmarks need %ux%u",
+                 c.anim.hdr.width, c.anim.hdr.height, ANIM_SIDE, ANIM_SIDE);
+    }
+    else
+    {
+        // As the MAX7219 example draws it, and as a WS2812B matrix would
+        c.sink = (ledanim_sink_t) { .type = LEDANIM_SINK_MONO, .buf = c.mono, .pixels = ANIM_SIDE * ANIM_SIDE };
+        run_anim("ledanim_next_mono", &c);
+
+        c.sink = (ledanim_sink_t) { .type = LEDANIM_SINK_RGB, .buf = c.rgb, .pixels = ANIM_SIDE * ANIM_SIDE };
+        run_anim("ledanim_next_rgb", &c);
+    }
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+    ledanim_map_close(&map);
+#endif
+}
+
+static void bench_asynclog(void)
+{
+    static uint32_t frame;
+    vprintf_like_t console = esp_log_set_vprintf(log_sink);
+
+    // Disabled calls, the cost of leaving debug logs in the code
+    ESP_ERROR_CHECK(taglog_level_set(TAG, ESP_LOG_INFO));
+    const bench_t off_bench = { .name = "log_compiled_out", .unit = "call", .per_iter = DISABLED_CALLS, .iters = DISABLED_ITERS, .runs = 9 };
+    run(&off_bench, log_compiled_out, &frame);
+    const bench_t esp_off_bench = { .name = "esp_log_filtered", .unit = "call", .per_iter = DISABLED_CALLS, .iters = DISABLED_ITERS, .runs = 9 };
+    run(&esp_off_bench, log_esp_filtered, &frame);
+    const bench_t tag_off_bench = { .name = "taglog_filtered", .unit = "call", .per_iter = DISABLED_CALLS, .iters = DISABLED_ITERS, .runs = 9 };
+    run(&tag_off_bench, log_taglog_filtered, &frame);
+
+    // Formatted in the caller
+    const bench_t sync_bench = { .name = "esp_log_sync", .unit = "call", .per_iter = 1, .iters = LOG_ITERS, .runs = 9 };
+    run(&sync_bench, log_call, &frame);
+
+    // Queued, the output task formats them on the other core where there is one
+    asynclog_config_t config = ASYNCLOG_DEFAULT_CONFIG();
+    config.ring_size = LOG_RING_SIZE;
+    config.task_priority = uxTaskPriorityGet(NULL);
+    config.task_core = PRODUCER_CORE;
+    if (asynclog_install(&config) != ESP_OK)
+    {
+        esp_log_set_vprintf(console);
+        ESP_LOGE(TAG, "No memory for the log benchmarks");
+        return;
+    }
+
+    const bench_t async_bench = { .name = "asynclog_call", .unit = "call", .per_iter = 1, .iters = LOG_ITERS, .runs = 9 };
+    run_log(&async_bench, log_call, &frame);
+
+    const bench_t bin_bench = { .name = "asynclog_bin_call", .unit = "call", .per_iter = 1, .iters = LOG_ITERS, .runs = 9 };
+    run_log(&bin_bench, log_bin_call, &frame);
+
+    // asynclog stays installed but out of the chain
+    asynclog_flush(pdMS_TO_TICKS(1000));
+    esp_log_set_vprintf(console);
+}
+
+static void bench_max7219(void)
+{
+    static display_ctx_t d = { .dev = MAX7219_CONFIG_DEFAULT() };
+
+    spi_bus_config_t cfg = {
+        .mosi_io_num = CONFIG_MAX7219_MOSI_GPIO,
+        .miso_io_num = -1,
+        .sclk_io_num = CONFIG_MAX7219_CLK_GPIO,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = 0,
+        .flags = 0,
+    };
+    ESP_ERROR_CHECK(spi_bus_initialize(MAX7219_CONFIG_HOST, &cfg, SPI_DMA_CH_AUTO));
+#ifdef CONFIG_IDF_TARGET_LINUX
+    ESP_ERROR_CHECK(max7219emu_init(&emu, d.dev.cascade_size));
+#endif
+    ESP_ERROR_CHECK(max7219_init_desc(&d.dev, MAX7219_CONFIG_HOST, CONFIG_MAX7219_CLOCK_SPEED_HZ, CONFIG_MAX7219_CS_GPIO));
+    ESP_ERROR_CHECK(max7219_init(&d.dev));
+
+    const bench_t image_bench = { .name = "max7219_draw_image_8x8", .unit = "image", .per_iter = 1, .iters = 200, .runs = 9 };
+    run(&image_bench, draw_image, &d);
+
+    const bench_t frame_bench = { .name = "max7219_frame", .unit = "frame", .per_iter = 1, .iters = 50, .runs = 9 };
+    run(&frame_bench, draw_frame, &d);
+
+    // Compare a build with CONFIG_MAX7219_FIXED_CASCADE against one without
+    const bench_t write_bench = { .name = "max7219_write_register", .unit = "write", .per_iter = 1, .iters = 1000, .runs = 9 };
+    run(&write_bench, write_register, &d);
+    d.counter = 0;
+
+    const bench_t counter_bench = { .name = "max7219_draw_int_7seg", .unit = "number", .per_iter = 1, .iters = 200, .runs = 9 };
+    run(&counter_bench, draw_counter, &d);
+
+    // The drawing of max7219_draw_string_8x8() without its 100 ms pacing,
+    // the string starts again after its last character
+    ESP_ERROR_CHECK(max7219_scroll_init(&d.dev, &d.scroll, SCROLL_TEXT));
+    const bench_t scroll_bench = { .name = "max7219_scroll_8x8", .unit = "char", .per_iter = 1, .iters = 50, .runs = 9 };
+    run(&scroll_bench, scroll_char, &d);
+
+    ESP_ERROR_CHECK(max7219_free_desc(&d.dev));
+    ESP_ERROR_CHECK(spi_bus_free(MAX7219_CONFIG_HOST));
+}
+
+static void bench_keyarray(void)
+{
+    // No key is pressed, every row is driven and every column read
+    keypad_setup_config();
+
+    const bench_t bench = { .name = "scanForSingleKeyOnce", .unit = "scan", .per_iter = 1, .iters = 1000, .runs = 9 };
+    run(&bench, scan_keys, NULL);
+}
+
+static void bench_ws2812b(void)
+{
+    static rgb_ctx_t c = { .values = { 0x3c4281a5a581423cULL, 0xc3bd7e5a5a7ebdc3ULL } };
+
+    const bench_t bench = { .name = "uint64ToRGBArray", .unit = "px", .per_iter = 2 * 64, .iters = 1000, .runs = 9 };
+    run(&bench, to_rgb, &c);
+
+    // Render only, the frames are not committed to the strip
+    static fx_ctx_t fx = { .fb = { .pixels = fx.pixels, .length = CONFIG_WS2812B_LENGTH, .width = CONFIG_WS2812B_MATRIX_WIDTH } };
+
+    ws2812b_fx_rainbow(&fx.fx, 0x0400, 0x0100, 255);
+    const bench_t rainbow_bench = { .name = "ws2812b_fx_rainbow", .unit = "frame", .per_iter = 1, .iters = 200, .runs = 9 };
+    run(&rainbow_bench, render_fx, &fx);
+
+    ws2812b_fx_fire(&fx.fx, fx.heat, 55, 120, 1);
+    fx.frame = 0;
+    const bench_t fire_bench = { .name = "ws2812b_fx_fire", .unit = "frame", .per_iter = 1, .iters = 200, .runs = 9 };
+    run(&fire_bench, render_fx, &fx);
+}
+
+void app_main(void)
+{
+    ESP_LOGI(TAG, "Running on %s", CONFIG_IDF_TARGET);
+
+    bench_max7219();
+    bench_keyarray();
+    bench_ws2812b();
+    bench_ledanim();
+    bench_lfring();
+    bench_asynclog();
+
+    ESP_LOGI(TAG, "Done");
+#ifdef CONFIG_IDF_TARGET_LINUX
+    fflush(stdout);
+    exit(0);
+#endif
+}
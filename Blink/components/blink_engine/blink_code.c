@@ -0,0 +1,122 @@
+/**
+ * @file blink_code.c
+ *
+ * Status code and Morse encoders for the blink pattern engine.
+ */
+#include "blink_code.h"
+
+/*
+ * Morse alphabet, one byte per character: a leading 1 followed by the
+ * symbols, most significant first, 0 for a dot and 1 for a dash.
+ */
+static const uint8_t morse[128] = {
+    ['A'] = 0x05, /* .- */
+    ['B'] = 0x18, /* -... */
+    ['C'] = 0x1a, /* -.-. */
+    ['D'] = 0x0c, /* -.. */
+    ['E'] = 0x02, /* . */
+    ['F'] = 0x12, /* ..-. */
+    ['G'] = 0x0e, /* --. */
+    ['H'] = 0x10, /* .... */
+    ['I'] = 0x04, /* .. */
+    ['J'] = 0x17, /* .--- */
+    ['K'] = 0x0d, /* -.- */
+    ['L'] = 0x14, /* .-.. */
+    ['M'] = 0x07, /* -- */
+    ['N'] = 0x06, /* -. */
+    ['O'] = 0x0f, /* --- */
+    ['P'] = 0x16, /* .--. */
+    ['Q'] = 0x1d, /* --.- */
+    ['R'] = 0x0a, /* .-. */
+    ['S'] = 0x08, /* ... */
+    ['T'] = 0x03, /* - */
+    ['U'] = 0x09, /* ..- */
+    ['V'] = 0x11, /* ...- */
+    ['W'] = 0x0b, /* .-- */
+    ['X'] = 0x19, /* -..- */
+    ['Y'] = 0x1b, /* -.-- */
+    ['Z'] = 0x1c, /* --.. */
+    ['0'] = 0x3f, /* ----- */
+    ['1'] = 0x2f, /* .---- */
+    ['2'] = 0x27, /* ..--- */
+    ['3'] = 0x23, /* ...-- */
+    ['4'] = 0x21, /* ....- */
+    ['5'] = 0x20, /* ..... */
+    ['6'] = 0x30, /* -.... */
+    ['7'] = 0x38, /* --... */
+    ['8'] = 0x3c, /* ---.. */
+    ['9'] = 0x3e, /* ----. */
+};
+
+static size_t flashes(uint8_t n, uint16_t on, uint16_t last, uint16_t *runs)
+{
+    for (uint8_t i = 0; i < n; i++)
+    {
+        runs[2 * i] = on;
+        runs[2 * i + 1] = BLINK_CODE_GAP_MS;
+    }
+    runs[2 * n - 1] = last;
+
+    return 2 * n;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t blink_status_encode(uint8_t code, uint16_t *runs, size_t max)
+{
+    if (!runs || !code || code > 99)
+        return 0;
+
+    uint8_t tens = code / 10;
+    uint8_t units = code % 10;
+    if (!units)
+        units = 10;
+    if (2 * (tens + units) > max)
+        return 0;
+
+    size_t n = 0;
+    if (tens)
+        n = flashes(tens, BLINK_CODE_LONG_MS, BLINK_CODE_DIGIT_GAP_MS, runs);
+
+    return n + flashes(units, BLINK_CODE_SHORT_MS, BLINK_CODE_END_GAP_MS, runs + n);
+}
+
+size_t blink_morse_encode(const char *text, uint16_t unit_ms, uint16_t *runs, size_t max)
+{
+    if (!text || !runs || !unit_ms)
+        return 0;
+
+    size_t n = 0;
+    for (; *text; text++)
+    {
+        char c = *text;
+        if (c == ' ')
+        {
+            if (n)
+                runs[n - 1] = 7 * unit_ms;
+            continue;
+        }
+        if (c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+        uint8_t code = (unsigned char)c < sizeof(morse) ? morse[(unsigned char)c] : 0;
+        if (!code)
+            continue;
+
+        uint8_t bit = 7;
+        while (!(code & (1 << bit)))
+            bit--;
+        if (n + 2 * bit > max || n + 2 * bit > UINT16_MAX)
+            return 0;
+        while (bit--)
+        {
+            runs[n++] = code & (1 << bit) ? 3 * unit_ms : unit_ms;
+            runs[n++] = unit_ms;
+        }
+        runs[n - 1] = 3 * unit_ms;
+    }
+
+    if (n)
+        runs[n - 1] = 7 * unit_ms;
+
+    return n;
+}
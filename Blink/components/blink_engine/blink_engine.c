@@ -0,0 +1,182 @@
+/**
+ * @file blink_engine.c
+ *
+ * Blink pattern engine, many LEDs on one one-shot timer.
+ */
+#include <string.h>
+#include <esp_log.h>
+#include "blink_engine.h"
+
+static const char *TAG = "blink_engine";
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static void set_led(blink_engine_t *engine, uint16_t i, bool on)
+{
+    blink_led_t *led = &engine->leds[i];
+
+    if (led->on == on)
+        return;
+    led->on = on;
+    engine->output(engine->ctx, i, on);
+}
+
+/* Start the run that is due, or finish the pattern */
+static void step(blink_engine_t *engine, uint16_t i)
+{
+    blink_led_t *led = &engine->leds[i];
+    const blink_pattern_t *pattern = led->pattern;
+
+    if (led->run == pattern->count)
+    {
+        if (led->left && !--led->left)
+        {
+            led->pattern = NULL;
+            led->deadline = BLINK_IDLE;
+            set_led(engine, i, false);
+            if (engine->done)
+                engine->done(engine->ctx, i);
+            return;
+        }
+        led->run = 0;
+    }
+
+    // Runs keep their timing relative to the previous deadline, so late
+    // wakeups do not accumulate drift
+    set_led(engine, i, !(led->run & 1));
+    led->deadline += (int64_t)pattern->runs[led->run] * 1000;
+    led->run++;
+}
+
+static void on_timer(void *arg)
+{
+    blink_engine_t *engine = arg;
+
+    xSemaphoreTake(engine->lock, portMAX_DELAY);
+    engine->wakeups++;
+    int64_t next = blink_engine_process(engine, esp_timer_get_time());
+
+    // Armed under the lock, like in blink_engine_set(). Fails if
+    // blink_engine_set() armed the timer after it fired, the wakeup it
+    // asked for processes every LED again.
+    if (next != BLINK_IDLE)
+    {
+        int64_t delay = next - esp_timer_get_time();
+        esp_timer_start_once(engine->timer, delay > 0 ? delay : 0);
+    }
+    xSemaphoreGive(engine->lock);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t blink_engine_init(blink_engine_t *engine, blink_led_t *leds, uint16_t count,
+                            blink_output_t output, blink_done_t done, void *ctx)
+{
+    CHECK_ARG(engine && leds && count && output);
+
+    memset(engine, 0, sizeof(*engine));
+    engine->leds = leds;
+    engine->count = count;
+    engine->output = output;
+    engine->done = done;
+    engine->ctx = ctx;
+    engine->lock = xSemaphoreCreateMutexStatic(&engine->lock_buf);
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        memset(&leds[i], 0, sizeof(blink_led_t));
+        leds[i].deadline = BLINK_IDLE;
+        output(ctx, i, false);
+    }
+
+    esp_timer_create_args_t args = {
+        .callback = on_timer,
+        .arg = engine,
+        .name = "blink_engine",
+    };
+    CHECK(esp_timer_create(&args, &engine->timer));
+
+    ESP_LOGI(TAG, "%d LEDs, %d bytes of state", count, (int)(count * sizeof(blink_led_t)));
+
+    return ESP_OK;
+}
+
+esp_err_t blink_engine_free(blink_engine_t *engine)
+{
+    CHECK_ARG(engine && engine->timer);
+
+    esp_timer_stop(engine->timer);
+    CHECK(esp_timer_delete(engine->timer));
+    engine->timer = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t blink_engine_set(blink_engine_t *engine, uint16_t led, const blink_pattern_t *pattern)
+{
+    CHECK_ARG(engine && led < engine->count);
+    if (pattern)
+    {
+        CHECK_ARG(pattern->runs && pattern->count);
+        uint32_t total = 0;
+        for (uint16_t i = 0; i < pattern->count; i++)
+            total += pattern->runs[i];
+        CHECK_ARG(total);
+    }
+
+    blink_led_t *l = &engine->leds[led];
+    xSemaphoreTake(engine->lock, portMAX_DELAY);
+    l->pattern = pattern;
+    if (pattern)
+    {
+        l->run = 0;
+        l->left = pattern->repeat;
+        l->deadline = esp_timer_get_time();
+    }
+    else
+    {
+        l->deadline = BLINK_IDLE;
+        set_led(engine, led, false);
+    }
+
+    // Wake up now, the next deadline is computed from there. The lock keeps
+    // on_timer() from arming the timer between the stop and the start.
+    esp_err_t err = ESP_OK;
+    if (pattern)
+    {
+        esp_timer_stop(engine->timer);
+        err = esp_timer_start_once(engine->timer, 0);
+    }
+    xSemaphoreGive(engine->lock);
+
+    return err;
+}
+
+bool blink_engine_busy(blink_engine_t *engine, uint16_t led)
+{
+    if (!engine || led >= engine->count)
+        return false;
+
+    xSemaphoreTake(engine->lock, portMAX_DELAY);
+    bool busy = engine->leds[led].pattern != NULL;
+    xSemaphoreGive(engine->lock);
+
+    return busy;
+}
+
+int64_t blink_engine_process(blink_engine_t *engine, int64_t now)
+{
+    int64_t next = BLINK_IDLE;
+
+    for (uint16_t i = 0; i < engine->count; i++)
+    {
+        blink_led_t *led = &engine->leds[i];
+        while (led->deadline <= now)
+            step(engine, i);
+        if (led->deadline < next)
+            next = led->deadline;
+    }
+
+    return next;
+}
@@ -0,0 +1,14 @@
+/**
+ * @file blink_gpio.c
+ *
+ * GPIO output of the blink pattern engine.
+ */
+#include <driver/gpio.h>
+#include "blink_engine.h"
+
+void blink_gpio_output(void *ctx, uint16_t led, bool on)
+{
+    const gpio_num_t *gpios = ctx;
+
+    gpio_set_level(gpios[led], on);
+}
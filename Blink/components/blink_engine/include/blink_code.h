@@ -0,0 +1,98 @@
+/**
+ * @file blink_code.h
+ * @defgroup blink_code blink_code
+ * @{
+ *
+ * Status codes and Morse messages for the blink pattern engine.
+ *
+ * A status code is shown as its tens in long flashes and its units in short
+ * flashes. Codes known at build time are defined with
+ * `BLINK_STATUS_DEFINE()`, which expands to const run tables in flash.
+ * Codes and Morse messages known only at runtime are encoded into caller
+ * provided buffers. Either way the result is an ordinary `blink_pattern_t`
+ * played by the engine, with no task per blink and no heap allocation.
+ */
+#ifndef __BLINK_CODE_H__
+#define __BLINK_CODE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "blink_engine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLINK_CODE_LONG_MS      600  //!< Flash of a tens digit
+#define BLINK_CODE_SHORT_MS     200  //!< Flash of a units digit
+#define BLINK_CODE_GAP_MS       300  //!< Pause between flashes
+#define BLINK_CODE_DIGIT_GAP_MS 1000 //!< Pause between tens and units
+#define BLINK_CODE_END_GAP_MS   3000 //!< Pause before the code repeats
+
+#define BLINK_CODE_MAX_RUNS  (2 * (9 + 10)) //!< Runs of any status code
+#define BLINK_MORSE_RUNS(n)  (2 * 5 * (n))  //!< Runs of a Morse message of n characters at most
+
+/** @cond */
+#define BLINK_FLASHES_1(on, off, last) on, last
+#define BLINK_FLASHES_2(on, off, last) on, off, BLINK_FLASHES_1(on, off, last)
+#define BLINK_FLASHES_3(on, off, last) on, off, BLINK_FLASHES_2(on, off, last)
+#define BLINK_FLASHES_4(on, off, last) on, off, BLINK_FLASHES_3(on, off, last)
+#define BLINK_FLASHES_5(on, off, last) on, off, BLINK_FLASHES_4(on, off, last)
+#define BLINK_FLASHES_6(on, off, last) on, off, BLINK_FLASHES_5(on, off, last)
+#define BLINK_FLASHES_7(on, off, last) on, off, BLINK_FLASHES_6(on, off, last)
+#define BLINK_FLASHES_8(on, off, last) on, off, BLINK_FLASHES_7(on, off, last)
+#define BLINK_FLASHES_9(on, off, last) on, off, BLINK_FLASHES_8(on, off, last)
+#define BLINK_FLASHES(n, on, off, last) BLINK_FLASHES_##n(on, off, last)
+/** @endcond */
+
+/**
+ * Define a const status code pattern at build time
+ *
+ * @param name Name of the `blink_pattern_t`
+ * @param tens Tens digit, 1..9, a literal
+ * @param units Units digit, 1..9, a literal
+ * @param repeat Repeat count, `BLINK_FOREVER` for endless
+ */
+#define BLINK_STATUS_DEFINE(name, tens, units, repeat) \
+    static const uint16_t name##_runs[] = { \
+        BLINK_FLASHES(tens, BLINK_CODE_LONG_MS, BLINK_CODE_GAP_MS, BLINK_CODE_DIGIT_GAP_MS), \
+        BLINK_FLASHES(units, BLINK_CODE_SHORT_MS, BLINK_CODE_GAP_MS, BLINK_CODE_END_GAP_MS), \
+    }; \
+    static const blink_pattern_t name = { name##_runs, sizeof(name##_runs) / sizeof(name##_runs[0]), repeat }
+
+/**
+ * @brief Encode a status code
+ *
+ * A 0 digit is shown as ten flashes, codes below 10 have no tens.
+ * Produces the same runs as `BLINK_STATUS_DEFINE()`.
+ *
+ * @param code Status code, 1..99
+ * @param runs Buffer, `BLINK_CODE_MAX_RUNS` is always enough
+ * @param max Buffer length
+ * @return Number of runs, 0 if the code is out of range or does not fit
+ */
+size_t blink_status_encode(uint8_t code, uint16_t *runs, size_t max);
+
+/**
+ * @brief Encode a Morse message
+ *
+ * Letters, digits and spaces are encoded with standard timing (dash and
+ * letter gap 3 units, word gap 7 units). Other characters are skipped. The
+ * message ends with a word gap so it can repeat.
+ *
+ * @param text Message
+ * @param unit_ms Length of a dot
+ * @param runs Buffer, `BLINK_MORSE_RUNS(strlen(text))` is always enough
+ * @param max Buffer length
+ * @return Number of runs, 0 if the message is empty, does not fit or needs
+ *         more runs than `blink_pattern_t::count` holds
+ */
+size_t blink_morse_encode(const char *text, uint16_t unit_ms, uint16_t *runs, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __BLINK_CODE_H__ */
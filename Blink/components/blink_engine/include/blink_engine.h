@@ -0,0 +1,151 @@
+/**
+ * @file blink_engine.h
+ * @defgroup blink_engine blink_engine
+ * @{
+ *
+ * Blink pattern engine.
+ *
+ * Any number of LEDs play their own run-length encoded patterns from a
+ * single one-shot esp_timer. Each wakeup advances the LEDs that are due and
+ * rearms the timer for the earliest deadline among all LEDs, so there is no
+ * task per LED and no periodic tick. The engine uses caller provided
+ * storage and never allocates after `blink_engine_init()`.
+ */
+#ifndef __BLINK_ENGINE_H__
+#define __BLINK_ENGINE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLINK_FOREVER 0          //!< Repeat count of endless patterns
+#define BLINK_IDLE    INT64_MAX  //!< Deadline of LEDs without a pattern
+
+/**
+ * Blink pattern
+ */
+typedef struct
+{
+    const uint16_t *runs;        //!< Durations in ms, alternately on and off, starting with on
+    uint16_t count;              //!< Number of runs
+    uint16_t repeat;             //!< Times to play the runs, `BLINK_FOREVER` for endless
+} blink_pattern_t;
+
+/**
+ * Sets an LED, called with the engine locked
+ */
+typedef void (*blink_output_t)(void *ctx, uint16_t led, bool on);
+
+/**
+ * Called when an LED has played its pattern, with the engine locked
+ */
+typedef void (*blink_done_t)(void *ctx, uint16_t led);
+
+/**
+ * LED state
+ */
+typedef struct
+{
+    const blink_pattern_t *pattern;
+    int64_t deadline;            //!< Time of the next run in µs, `BLINK_IDLE` if stopped
+    uint16_t left;               //!< Repetitions left, 0 for endless
+    uint16_t run;                //!< Run started at the deadline
+    bool on;
+} blink_led_t;
+
+/**
+ * Engine
+ */
+typedef struct
+{
+    blink_led_t *leds;
+    uint16_t count;
+    blink_output_t output;
+    blink_done_t done;           //!< Optional
+    void *ctx;                   //!< Passed to `output` and `done`
+    esp_timer_handle_t timer;
+    SemaphoreHandle_t lock;
+    StaticSemaphore_t lock_buf;
+    uint32_t wakeups;            //!< Timer callbacks so far
+} blink_engine_t;
+
+/**
+ * @brief Initialize the engine and create its timer
+ *
+ * All LEDs are switched off.
+ *
+ * @param engine Engine
+ * @param leds LED storage
+ * @param count Number of LEDs
+ * @param output LED setter, see `blink_gpio_output()`
+ * @param done Pattern end callback, may be NULL
+ * @param ctx Context of the callbacks
+ * @return `ESP_OK` on success
+ */
+esp_err_t blink_engine_init(blink_engine_t *engine, blink_led_t *leds, uint16_t count,
+                            blink_output_t output, blink_done_t done, void *ctx);
+
+/**
+ * @brief Stop the timer and free it
+ *
+ * @param engine Engine
+ * @return `ESP_OK` on success
+ */
+esp_err_t blink_engine_free(blink_engine_t *engine);
+
+/**
+ * @brief Start a pattern on an LED
+ *
+ * The pattern starts right away and replaces the one that is playing.
+ *
+ * @param engine Engine
+ * @param led LED index
+ * @param pattern Pattern, must stay valid while it plays, NULL switches the LED off
+ * @return `ESP_OK` on success
+ */
+esp_err_t blink_engine_set(blink_engine_t *engine, uint16_t led, const blink_pattern_t *pattern);
+
+/**
+ * @brief Check whether an LED is playing a pattern
+ *
+ * @param engine Engine
+ * @param led LED index
+ * @return true if a pattern is playing
+ */
+bool blink_engine_busy(blink_engine_t *engine, uint16_t led);
+
+/**
+ * @brief Advance all LEDs that are due
+ *
+ * Called by the timer. Does not lock the engine or touch the timer, so it
+ * can also drive the engine from a simulated clock.
+ *
+ * @param engine Engine
+ * @param now Current time in µs
+ * @return Earliest deadline among all LEDs, `BLINK_IDLE` if none is playing
+ */
+int64_t blink_engine_process(blink_engine_t *engine, int64_t now);
+
+/**
+ * @brief Output that drives GPIOs
+ *
+ * @param ctx Array of `gpio_num_t`, indexed by LED
+ * @param led LED index
+ * @param on LED state
+ */
+void blink_gpio_output(void *ctx, uint16_t led, bool on);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __BLINK_ENGINE_H__ */
@@ -1,29 +1,67 @@
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 // to use vTaskDelay,portTICK_PERIOD_MS
 #include "driver/gpio.h"
-//to use gpio_set_level,gpio_reset_pin,gpio_set_direction,GPIO_MODE_OUTPUT
+//to use gpio_reset_pin,gpio_set_direction,GPIO_MODE_OUTPUT
+#include "esp_log.h"
+#include "blink_engine.h"
+#include "blink_code.h"
+//to drive every LED from one timer, and to encode status codes
 
-static uint8_t s_led_state = 0;
-static const uint8_t LED_GPIO = 2;
+#define LED_COUNT (sizeof(LED_GPIOS) / sizeof(LED_GPIOS[0]))
+
+static const char *TAG = "blink";
+static const gpio_num_t LED_GPIOS[] = { GPIO_NUM_2, GPIO_NUM_4, GPIO_NUM_5 };
 static const int DELAY = (int)1000;
 
-static void flip_led_state(void)
-{
-    s_led_state = !s_led_state;
-    gpio_set_level(LED_GPIO, s_led_state);
-}
+// On/off run lengths in ms
+static const uint16_t SLOW_RUNS[] = { 1000, 1000 };
+static const uint16_t HEARTBEAT_RUNS[] = { 80, 120, 80, 720 };
+
+static const blink_pattern_t SLOW = { SLOW_RUNS, 2, BLINK_FOREVER };
+static const blink_pattern_t HEARTBEAT = { HEARTBEAT_RUNS, 4, BLINK_FOREVER };
+
+// Status code 23, built at compile time, shown three times
+BLINK_STATUS_DEFINE(STATUS_23, 2, 3, 3);
+
+#define MORSE_TEXT "SOS"
+#define MORSE_UNIT_ms 150
 
-static void configure_led(void)
+static uint16_t s_morse_runs[BLINK_MORSE_RUNS(sizeof(MORSE_TEXT) - 1)];
+static blink_pattern_t s_morse;
+
+static blink_led_t s_leds[LED_COUNT];
+static blink_engine_t s_engine;
+
+static void configure_leds(void)
 {
-    gpio_reset_pin(LED_GPIO);
-    gpio_set_direction(LED_GPIO, GPIO_MODE_OUTPUT);
+    for (size_t i = 0; i < LED_COUNT; i++) {
+        gpio_reset_pin(LED_GPIOS[i]);
+        gpio_set_direction(LED_GPIOS[i], GPIO_MODE_OUTPUT);
+    }
 }
 
 void app_main(void)
 {
-    configure_led();
+    configure_leds();
+    ESP_ERROR_CHECK(blink_engine_init(&s_engine, s_leds, LED_COUNT, blink_gpio_output, NULL, (void *)LED_GPIOS));
+
+    s_morse.runs = s_morse_runs;
+    s_morse.count = blink_morse_encode(MORSE_TEXT, MORSE_UNIT_ms, s_morse_runs,
+                                       sizeof(s_morse_runs) / sizeof(s_morse_runs[0]));
+    s_morse.repeat = BLINK_FOREVER;
+
+    ESP_ERROR_CHECK(blink_engine_set(&s_engine, 0, &s_morse));
+    ESP_ERROR_CHECK(blink_engine_set(&s_engine, 1, &HEARTBEAT));
+    ESP_ERROR_CHECK(blink_engine_set(&s_engine, 2, &STATUS_23));
+
+    // No task per LED: this loop only falls back to a slow blink once the
+    // status code has been shown
     while (1) {
-        flip_led_state();
-        vTaskDelay(DELAY / portTICK_PERIOD_MS);
+        if (!blink_engine_busy(&s_engine, 2))
+            ESP_ERROR_CHECK(blink_engine_set(&s_engine, 2, &SLOW));
+        vTaskDelay(5 * DELAY / portTICK_PERIOD_MS);
+        ESP_LOGI(TAG, "Timer wakeups: %" PRIu32, s_engine.wakeups);
     }
 }
@@ -0,0 +1,367 @@
+/**
+ * @file fader.c
+ *
+ * Keyframe timeline of the fade orchestrator, independent of the backend.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <esp_log.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "fader.h"
+#include "fader_curves.h"
+#include "fader_wave.h"
+
+static const char *TAG = "fader";
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define FADER_TASK_STACK     3072
+#define FADER_MIN_SEGMENT_MS 20  // eased keyframes are not split below this
+#define FADER_EASE_SHIFT     5   // log2(FADER_EASE_SEGMENTS)
+
+_Static_assert(FADER_EASE_SEGMENTS == 1 << FADER_EASE_SHIFT, "FADER_EASE_SEGMENTS must be 1 << FADER_EASE_SHIFT");
+
+#define ALL_CHANNELS ((1UL << FADER_MAX_CHANNELS) - 1)
+#define TASK_EXIT    (1UL << FADER_MAX_CHANNELS) // notification asking the task to exit
+
+typedef struct
+{
+    fader_keyframe_t queue[FADER_QUEUE_LEN];
+    uint8_t head;
+    uint8_t count;
+    bool busy;                   // fade running or about to be started
+    fader_keyframe_t kf;         // keyframe being played
+    uint32_t from;               // duty at the start of the keyframe
+    uint32_t duty;               // duty at the end of the running fade
+    const uint16_t *curve;       // easing table, NULL for linear
+    bool mirror;                 // walk the table backwards
+    uint8_t shift;               // table points per segment, log2
+    uint8_t seg;
+    uint8_t segs;
+    const fader_wave_t *wave;    // waveform played when the queue is empty
+    uint8_t wave_pos;
+    uint32_t wave_min;
+    uint32_t wave_span;
+    uint32_t wave_period;
+    uint32_t wakeups;            // fades started
+} channel_t;
+
+struct fader
+{
+    fader_backend_t backend;
+    fader_done_cb_t on_done;
+    void *user;
+    channel_t ch[FADER_MAX_CHANNELS];
+    SemaphoreHandle_t lock;
+    EventGroupHandle_t idle;     // one bit per idle channel
+    TaskHandle_t task;
+    TaskHandle_t deleter;        // task in fader_del(), set before TASK_EXIT
+    bool parked;                 // the task is done with the fader
+};
+
+/* Eased keyframes are split in power of two segments that index the tables */
+static uint8_t segment_shift(const fader_keyframe_t *kf)
+{
+    if (kf->easing == FADER_EASE_LINEAR)
+        return FADER_EASE_SHIFT;
+
+    uint8_t shift = 0;
+    while (shift < FADER_EASE_SHIFT && (kf->duration_ms >> (FADER_EASE_SHIFT - shift)) < FADER_MIN_SEGMENT_MS)
+        shift++;
+
+    return shift;
+}
+
+/* Duty at the end of the current segment */
+static uint32_t eased_duty(const channel_t *c)
+{
+    if (c->seg == c->segs || !c->curve)
+        return c->kf.duty;
+
+    uint32_t i = (uint32_t)c->seg << c->shift;
+    uint32_t f = c->mirror ? FADER_CURVE_MAX - c->curve[FADER_EASE_SEGMENTS - i] : c->curve[i];
+    int64_t delta = (int64_t)c->kf.duty - c->from;
+
+    return c->from + delta * f / FADER_CURVE_MAX;
+}
+
+/* Keyframe of the next waveform segment */
+static void wave_keyframe(channel_t *c)
+{
+    const fader_wave_seg_t *seg = &c->wave->segs[c->wave_pos];
+
+    if (++c->wave_pos == c->wave->count)
+        c->wave_pos = 0;
+    c->kf.duty = c->wave_min + (uint64_t)c->wave_span * seg->level / FADER_WAVE_LEVEL_MAX;
+    c->kf.duration_ms = (uint64_t)c->wave_period * seg->time / c->wave->total;
+    c->kf.easing = FADER_EASE_LINEAR;
+}
+
+/* Start the next fade of a channel, called by the task when the previous one ended */
+static void advance(fader_handle_t fader, uint8_t idx)
+{
+    channel_t *c = &fader->ch[idx];
+
+    xSemaphoreTake(fader->lock, portMAX_DELAY);
+    if (c->seg >= c->segs)
+    {
+        if (c->count)
+        {
+            c->kf = c->queue[c->head];
+            c->head = (c->head + 1) % FADER_QUEUE_LEN;
+            c->count--;
+        }
+        else if (c->wave)
+            wave_keyframe(c);
+        else
+        {
+            c->busy = false;
+            xEventGroupSetBits(fader->idle, 1UL << idx);
+            xSemaphoreGive(fader->lock);
+            if (fader->on_done)
+                fader->on_done(fader, idx, fader->user);
+            return;
+        }
+        c->from = c->duty;
+        c->seg = 0;
+        c->shift = segment_shift(&c->kf);
+        c->segs = FADER_EASE_SEGMENTS >> c->shift;
+        c->curve = fader_curve(c->kf.easing);
+        // Brightness curves are mirrored when dimming, so both directions look alike
+        c->mirror = c->kf.duty < c->from
+            && (c->kf.easing == FADER_EASE_GAMMA || c->kf.easing == FADER_EASE_EXP);
+    }
+
+    uint32_t start_ms = c->kf.duration_ms * c->seg / c->segs;
+    c->seg++;
+    uint32_t end_ms = c->kf.duration_ms * c->seg / c->segs;
+    c->duty = eased_duty(c);
+    c->wakeups++;
+    uint32_t duty = c->duty;
+    xSemaphoreGive(fader->lock);
+
+    esp_err_t err = fader->backend.start(fader->backend.ctx, idx, duty, end_ms - start_ms);
+    if (err != ESP_OK)
+    {
+        // Skip the fade rather than stall the channel
+        ESP_LOGE(TAG, "Channel %d: failed to start fade: %s", idx, esp_err_to_name(err));
+        fader_fade_end(fader, idx);
+    }
+}
+
+/* Mark a channel busy, with the lock held. Returns true if it was idle. */
+static bool activate(fader_handle_t fader, uint8_t idx)
+{
+    channel_t *c = &fader->ch[idx];
+    bool idle = !c->busy;
+
+    c->busy = true;
+    xEventGroupClearBits(fader->idle, 1UL << idx);
+
+    return idle;
+}
+
+static void fader_task(void *arg)
+{
+    fader_handle_t fader = arg;
+    uint32_t ended;
+
+    while (1)
+    {
+        xTaskNotifyWait(0, ALL_CHANNELS | TASK_EXIT, &ended, portMAX_DELAY);
+        if (ended & TASK_EXIT)
+            break;
+        while (ended)
+        {
+            uint8_t idx = __builtin_ctz(ended);
+            ended &= ended - 1;
+            advance(fader, idx);
+        }
+    }
+
+    // Backends may notify the task until fader_del() has deleted it, the
+    // fader may be freed as soon as `parked` is set
+    TaskHandle_t deleter = fader->deleter;
+    __atomic_store_n(&fader->parked, true, __ATOMIC_RELEASE);
+    xTaskNotifyGive(deleter);
+    vTaskSuspend(NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t fader_new(const fader_config_t *config, fader_handle_t *fader)
+{
+    CHECK_ARG(config && config->backend && config->backend->start && fader);
+
+    fader_handle_t f = calloc(1, sizeof(struct fader));
+    if (!f)
+        return ESP_ERR_NO_MEM;
+    f->backend = *config->backend;
+    f->on_done = config->on_done;
+    f->user = config->user;
+    f->lock = xSemaphoreCreateMutex();
+    f->idle = xEventGroupCreate();
+    if (!f->lock || !f->idle)
+        goto fail;
+    xEventGroupSetBits(f->idle, ALL_CHANNELS);
+
+    if (f->backend.attach)
+    {
+        esp_err_t err = f->backend.attach(f->backend.ctx, f);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to attach backend: %s", esp_err_to_name(err));
+            goto fail;
+        }
+    }
+
+    if (xTaskCreatePinnedToCore(fader_task, "fader", FADER_TASK_STACK, f,
+                                config->task_priority, &f->task, config->task_core) != pdPASS)
+    {
+        if (f->backend.detach)
+            f->backend.detach(f->backend.ctx);
+        goto fail;
+    }
+
+    *fader = f;
+    return ESP_OK;
+
+fail:
+    if (f->idle)
+        vEventGroupDelete(f->idle);
+    if (f->lock)
+        vSemaphoreDelete(f->lock);
+    free(f);
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t fader_del(fader_handle_t fader)
+{
+    CHECK_ARG(fader);
+
+    // The task exits between two fades, never inside backend.start()
+    fader->deleter = xTaskGetCurrentTaskHandle();
+    xTaskNotify(fader->task, TASK_EXIT, eSetBits);
+    while (!__atomic_load_n(&fader->parked, __ATOMIC_ACQUIRE))
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (fader->backend.detach)
+        fader->backend.detach(fader->backend.ctx);
+    vTaskDelete(fader->task);
+
+    vEventGroupDelete(fader->idle);
+    vSemaphoreDelete(fader->lock);
+    free(fader);
+
+    return ESP_OK;
+}
+
+esp_err_t fader_push(fader_handle_t fader, uint8_t channel, const fader_keyframe_t *kf)
+{
+    CHECK_ARG(fader && kf && channel < FADER_MAX_CHANNELS);
+
+    channel_t *c = &fader->ch[channel];
+    xSemaphoreTake(fader->lock, portMAX_DELAY);
+    if (c->count == FADER_QUEUE_LEN)
+    {
+        xSemaphoreGive(fader->lock);
+        return ESP_ERR_NO_MEM;
+    }
+    c->queue[(c->head + c->count) % FADER_QUEUE_LEN] = *kf;
+    c->count++;
+    bool kick = activate(fader, channel);
+    xSemaphoreGive(fader->lock);
+
+    // An idle channel is started as if its last fade had just ended
+    if (kick)
+        fader_fade_end(fader, channel);
+
+    return ESP_OK;
+}
+
+esp_err_t fader_clear(fader_handle_t fader, uint8_t channel)
+{
+    CHECK_ARG(fader && channel < FADER_MAX_CHANNELS);
+
+    xSemaphoreTake(fader->lock, portMAX_DELAY);
+    fader->ch[channel].count = 0;
+    xSemaphoreGive(fader->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t fader_play_wave(fader_handle_t fader, uint8_t channel, const fader_wave_t *wave,
+                          uint32_t min_duty, uint32_t max_duty, uint32_t period_ms)
+{
+    CHECK_ARG(fader && wave && wave->count && wave->total && channel < FADER_MAX_CHANNELS
+              && min_duty <= max_duty && period_ms);
+
+    channel_t *c = &fader->ch[channel];
+    xSemaphoreTake(fader->lock, portMAX_DELAY);
+    c->wave = wave;
+    c->wave_pos = 0;
+    c->wave_min = min_duty;
+    c->wave_span = max_duty - min_duty;
+    c->wave_period = period_ms;
+    bool kick = activate(fader, channel);
+    xSemaphoreGive(fader->lock);
+
+    if (kick)
+        fader_fade_end(fader, channel);
+
+    return ESP_OK;
+}
+
+esp_err_t fader_stop_wave(fader_handle_t fader, uint8_t channel)
+{
+    CHECK_ARG(fader && channel < FADER_MAX_CHANNELS);
+
+    xSemaphoreTake(fader->lock, portMAX_DELAY);
+    fader->ch[channel].wave = NULL;
+    xSemaphoreGive(fader->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t fader_get_wakeups(fader_handle_t fader, uint8_t channel, uint32_t *count)
+{
+    CHECK_ARG(fader && count && channel < FADER_MAX_CHANNELS);
+
+    xSemaphoreTake(fader->lock, portMAX_DELAY);
+    *count = fader->ch[channel].wakeups;
+    xSemaphoreGive(fader->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t fader_wait(fader_handle_t fader, uint32_t channels, TickType_t timeout)
+{
+    CHECK_ARG(fader && channels && !(channels & ~ALL_CHANNELS));
+
+    EventBits_t bits = xEventGroupWaitBits(fader->idle, channels, pdFALSE, pdTRUE, timeout);
+
+    return (bits & channels) == channels ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+bool fader_idle(fader_handle_t fader, uint8_t channel)
+{
+    if (!fader || channel >= FADER_MAX_CHANNELS)
+        return true;
+
+    return xEventGroupGetBits(fader->idle) & (1UL << channel);
+}
+
+void fader_fade_end(fader_handle_t fader, uint8_t channel)
+{
+    xTaskNotify(fader->task, 1UL << channel, eSetBits);
+}
+
+bool fader_fade_end_from_isr(fader_handle_t fader, uint8_t channel)
+{
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(fader->task, 1UL << channel, eSetBits, &woken);
+
+    return woken == pdTRUE;
+}
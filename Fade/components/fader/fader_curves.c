@@ -0,0 +1,61 @@
+/**
+ * @file fader_curves.c
+ *
+ * Easing tables of the fade orchestrator.
+ * Generated by tools/fader_curves.py, do not edit.
+ */
+#include "fader_curves.h"
+
+/* Quadratic, slow start */
+const uint16_t fader_curve_in[FADER_CURVE_POINTS] = {
+        0,    64,   256,   576,  1024,  1600,  2304,  3136,
+     4096,  5184,  6400,  7744,  9216, 10816, 12544, 14400,
+    16384, 18496, 20736, 23104, 25600, 28224, 30976, 33855,
+    36863, 39999, 43263, 46655, 50175, 53823, 57599, 61503,
+    65535,
+};
+
+/* Quadratic, slow end */
+const uint16_t fader_curve_out[FADER_CURVE_POINTS] = {
+        0,  4032,  7936, 11712, 15360, 18880, 22272, 25536,
+    28672, 31680, 34559, 37311, 39935, 42431, 44799, 47039,
+    49151, 51135, 52991, 54719, 56319, 57791, 59135, 60351,
+    61439, 62399, 63231, 63935, 64511, 64959, 65279, 65471,
+    65535,
+};
+
+/* Quadratic, slow start and end */
+const uint16_t fader_curve_in_out[FADER_CURVE_POINTS] = {
+        0,   128,   512,  1152,  2048,  3200,  4608,  6272,
+     8192, 10368, 12800, 15488, 18432, 21632, 25088, 28800,
+    32768, 36735, 40447, 43903, 47103, 50047, 52735, 55167,
+    57343, 59263, 60927, 62335, 63487, 64383, 65023, 65407,
+    65535,
+};
+
+/* Perceived brightness, gamma 2.2 */
+const uint16_t fader_curve_gamma[FADER_CURVE_POINTS] = {
+        0,    32,   147,   359,   676,  1104,  1648,  2314,
+     3104,  4022,  5072,  6255,  7574,  9033, 10632, 12375,
+    14263, 16298, 18482, 20816, 23303, 25943, 28739, 31692,
+    34802, 38072, 41503, 45097, 48853, 52774, 56860, 61114,
+    65535,
+};
+
+/* Exponential, base 1024 */
+const uint16_t fader_curve_exp[FADER_CURVE_POINTS] = {
+        0,    15,    35,    59,    88,   125,   171,   228,
+      298,   386,   495,   630,   798,  1006,  1265,  1587,
+     1986,  2482,  3097,  3862,  4812,  5991,  7455,  9274,
+    11532, 14337, 17820, 22145, 27517, 34188, 42472, 52759,
+    65535,
+};
+
+/* Raised cosine, half a sine period */
+const uint16_t fader_curve_sine[FADER_CURVE_POINTS] = {
+        0,   158,   630,  1411,  2494,  3869,  5522,  7438,
+     9597, 11980, 14563, 17321, 20228, 23256, 26375, 29556,
+    32767, 35979, 39160, 42279, 45307, 48214, 50972, 53555,
+    55938, 58097, 60013, 61666, 63041, 64124, 64905, 65377,
+    65535,
+};
@@ -0,0 +1,86 @@
+/**
+ * @file fader_fake.c
+ *
+ * Recording fake backend of the fade orchestrator.
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "fader_fake.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static esp_err_t attach(void *ctx, fader_handle_t fader)
+{
+    fader_fake_t *fake = ctx;
+
+    fake->fader = fader;
+
+    return ESP_OK;
+}
+
+// Fades still running are dropped, they end without a fader to tell
+static void detach(void *ctx)
+{
+    fader_fake_t *fake = ctx;
+
+    portENTER_CRITICAL(&fake->lock);
+    fake->running = 0;
+    fake->fader = NULL;
+    portEXIT_CRITICAL(&fake->lock);
+}
+
+static esp_err_t start(void *ctx, uint8_t channel, uint32_t duty, uint32_t duration_ms)
+{
+    fader_fake_t *fake = ctx;
+
+    portENTER_CRITICAL(&fake->lock);
+    fader_fake_fade_t *f = &fake->log[fake->count % FADER_FAKE_LOG_LEN];
+    f->at_ms = fake->now_ms;
+    f->channel = channel;
+    f->duty = duty;
+    f->duration_ms = duration_ms;
+    fake->count++;
+    fake->duty[channel] = duty;
+    fake->end_ms[channel] = fake->now_ms + duration_ms;
+    fake->running |= 1UL << channel;
+    portEXIT_CRITICAL(&fake->lock);
+
+    return ESP_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t fader_fake_init(fader_fake_t *fake, fader_backend_t *backend)
+{
+    CHECK_ARG(fake && backend);
+
+    memset(fake, 0, sizeof(*fake));
+    fake->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    backend->attach = attach;
+    backend->start = start;
+    backend->detach = detach;
+    backend->ctx = fake;
+
+    return ESP_OK;
+}
+
+uint32_t fader_fake_advance(fader_fake_t *fake, uint32_t ms)
+{
+    uint32_t ended = 0;
+
+    portENTER_CRITICAL(&fake->lock);
+    fake->now_ms += ms;
+    for (uint32_t running = fake->running; running; running &= running - 1)
+    {
+        uint8_t ch = __builtin_ctz(running);
+        if ((int32_t)(fake->now_ms - fake->end_ms[ch]) >= 0)
+            ended |= 1UL << ch;
+    }
+    fake->running &= ~ended;
+    portEXIT_CRITICAL(&fake->lock);
+
+    for (uint32_t bits = ended; bits; bits &= bits - 1)
+        fader_fade_end(fake->fader, __builtin_ctz(bits));
+
+    return ended;
+}
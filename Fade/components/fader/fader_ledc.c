@@ -0,0 +1,127 @@
+/**
+ * @file fader_ledc.c
+ *
+ * LEDC backend of the fade orchestrator.
+ */
+#include <string.h>
+#include <esp_log.h>
+#include "fader_ledc.h"
+
+static const char *TAG = "fader_ledc";
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static bool on_fade_end(const ledc_cb_param_t *param, void *arg)
+{
+    fader_ledc_t *ledc = arg;
+
+    if (param->event != LEDC_FADE_END_EVT)
+        return false;
+
+    return fader_fade_end_from_isr(ledc->fader, FADER_LEDC_CHANNEL(param->speed_mode, param->channel));
+}
+
+static void on_hold_end(void *arg)
+{
+    fader_ledc_hold_t *hold = arg;
+
+    fader_fade_end(hold->ledc->fader, hold->channel);
+}
+
+static esp_err_t attach(void *ctx, fader_handle_t fader)
+{
+    fader_ledc_t *ledc = ctx;
+
+    ledc->fader = fader;
+
+    return ESP_OK;
+}
+
+/*
+ * Fades keep running in the LEDC, their end is no longer reported. Holds
+ * are stopped, their timers are deleted so that a new fader can attach.
+ */
+static void detach(void *ctx)
+{
+    fader_ledc_t *ledc = ctx;
+    ledc_cbs_t none = { .fade_cb = NULL };
+
+    for (uint8_t i = 0; i < FADER_MAX_CHANNELS; i++)
+    {
+        if (ledc->registered & (1UL << i))
+            ledc_cb_register(i / LEDC_CHANNEL_MAX, i % LEDC_CHANNEL_MAX, &none, NULL);
+
+        fader_ledc_hold_t *hold = &ledc->hold[i];
+        if (hold->timer)
+        {
+            esp_timer_stop(hold->timer);
+            esp_timer_delete(hold->timer);
+            hold->timer = NULL;
+        }
+    }
+    ledc->registered = 0;
+    ledc->fader = NULL;
+}
+
+static esp_err_t start(void *ctx, uint8_t channel, uint32_t duty, uint32_t duration_ms)
+{
+    fader_ledc_t *ledc = ctx;
+    ledc_mode_t mode = channel / LEDC_CHANNEL_MAX;
+    ledc_channel_t ch = channel % LEDC_CHANNEL_MAX;
+
+    if (!duration_ms)
+    {
+        CHECK(ledc_set_duty_and_update(mode, ch, duty, 0));
+        fader_fade_end(ledc->fader, channel);
+        return ESP_OK;
+    }
+
+    if (ledc_get_duty(mode, ch) == duty)
+    {
+        fader_ledc_hold_t *hold = &ledc->hold[channel];
+        if (!hold->timer)
+        {
+            hold->ledc = ledc;
+            hold->channel = channel;
+            esp_timer_create_args_t args = {
+                .callback = on_hold_end,
+                .arg = hold,
+                .name = "fader_hold",
+            };
+            CHECK(esp_timer_create(&args, &hold->timer));
+        }
+        return esp_timer_start_once(hold->timer, (uint64_t)duration_ms * 1000);
+    }
+
+    if (!(ledc->registered & (1UL << channel)))
+    {
+        ledc_cbs_t cbs = { .fade_cb = on_fade_end };
+        CHECK(ledc_cb_register(mode, ch, &cbs, ledc));
+        ledc->registered |= 1UL << channel;
+    }
+
+    return ledc_set_fade_time_and_start(mode, ch, duty, duration_ms, LEDC_FADE_NO_WAIT);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t fader_ledc_init(fader_ledc_t *ledc, fader_backend_t *backend)
+{
+    CHECK_ARG(ledc && backend);
+
+    esp_err_t err = ledc_fade_func_install(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+    {
+        ESP_LOGE(TAG, "Failed to install fade service: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    memset(ledc, 0, sizeof(*ledc));
+    backend->attach = attach;
+    backend->start = start;
+    backend->detach = detach;
+    backend->ctx = ledc;
+
+    return ESP_OK;
+}
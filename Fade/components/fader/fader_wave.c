@@ -0,0 +1,73 @@
+/**
+ * @file fader_wave.c
+ *
+ * Waveform builders of the fade orchestrator.
+ */
+#include "fader_wave.h"
+#include "fader_curves.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static const fader_wave_seg_t heartbeat[] = {
+    { .level = FADER_WAVE_LEVEL_MAX, .time = 8 },
+    { .level = 0, .time = 10 },
+    { .level = FADER_WAVE_LEVEL_MAX * 3 / 5, .time = 8 },
+    { .level = 0, .time = 14 },
+    { .level = 0, .time = 60 },
+};
+
+const fader_wave_t fader_wave_heartbeat = {
+    .segs = heartbeat,
+    .count = sizeof(heartbeat) / sizeof(heartbeat[0]),
+    .total = 100,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t fader_wave_sine(fader_wave_t *wave, fader_wave_seg_t *segs, uint8_t count)
+{
+    CHECK_ARG(wave && segs);
+    // Each half period must land on table points
+    uint8_t half = count / 2;
+    CHECK_ARG(half && !(half & (half - 1)) && half <= FADER_CURVE_POINTS - 1);
+
+    uint8_t step = (FADER_CURVE_POINTS - 1) / half;
+    for (uint8_t i = 0; i < half; i++)
+    {
+        uint16_t level = fader_curve_sine[(i + 1) * step];
+        segs[i].level = level;
+        segs[i].time = 1;
+        segs[half + i].level = FADER_WAVE_LEVEL_MAX - level;
+        segs[half + i].time = 1;
+    }
+
+    return fader_wave_custom(wave, segs, count);
+}
+
+esp_err_t fader_wave_triangle(fader_wave_t *wave, fader_wave_seg_t *segs, uint16_t rise)
+{
+    CHECK_ARG(wave && segs && rise && rise < FADER_WAVE_LEVEL_MAX);
+
+    segs[0].level = FADER_WAVE_LEVEL_MAX;
+    segs[0].time = rise;
+    segs[1].level = 0;
+    segs[1].time = FADER_WAVE_LEVEL_MAX - rise;
+
+    return fader_wave_custom(wave, segs, 2);
+}
+
+esp_err_t fader_wave_custom(fader_wave_t *wave, const fader_wave_seg_t *segs, uint8_t count)
+{
+    CHECK_ARG(wave && segs && count);
+
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < count; i++)
+        total += segs[i].time;
+    CHECK_ARG(total);
+
+    wave->segs = segs;
+    wave->count = count;
+    wave->total = total;
+
+    return ESP_OK;
+}
@@ -0,0 +1,189 @@
+/**
+ * @file fader.h
+ * @defgroup fader fader
+ * @{
+ *
+ * Multi-channel fade orchestrator.
+ *
+ * Every channel has a queue of keyframes (target duty, duration, easing).
+ * A keyframe is played as one or more linear hardware fades, the next fade
+ * is started as soon as the backend reports the previous one finished, so
+ * no task sleeps for the length of a fade. Eased keyframes step through the
+ * precomputed tables of `fader_curves.h`, one table point per fade. The
+ * timeline logic only talks to a small backend interface; `fader_ledc.h`
+ * provides the LEDC backend.
+ */
+#ifndef __FADER_H__
+#define __FADER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FADER_MAX_CHANNELS   16  //!< 8 high speed + 8 low speed LEDC channels on the ESP32
+#define FADER_QUEUE_LEN      8   //!< Keyframes queued per channel
+#define FADER_EASE_SEGMENTS  32  //!< Linear hardware fades per eased keyframe, one per table step
+
+/**
+ * Easing of a keyframe
+ */
+typedef enum
+{
+    FADER_EASE_LINEAR = 0,
+    FADER_EASE_IN,               //!< Quadratic, slow start
+    FADER_EASE_OUT,              //!< Quadratic, slow end
+    FADER_EASE_IN_OUT,           //!< Quadratic, slow start and end
+    FADER_EASE_GAMMA,            //!< Linear in perceived brightness, gamma 2.2
+    FADER_EASE_EXP,              //!< Exponential, linear in stops of brightness
+    FADER_EASE_SINE,             //!< Raised cosine, half a sine period
+} fader_easing_t;
+
+/**
+ * Keyframe
+ */
+typedef struct
+{
+    uint32_t duty;               //!< Target duty
+    uint32_t duration_ms;        //!< Time to reach it, 0 to jump
+    fader_easing_t easing;
+} fader_keyframe_t;
+
+typedef struct fader *fader_handle_t;
+
+/**
+ * Backend that performs linear fades
+ *
+ * `start` must return quickly. Once the fade is over the backend reports it
+ * with `fader_fade_end()` or `fader_fade_end_from_isr()`, also for fades of
+ * zero length or without a change in duty. `detach` is called by
+ * `fader_del()` before the fader is freed, the backend must not report
+ * anything to it afterwards.
+ */
+typedef struct
+{
+    esp_err_t (*attach)(void *ctx, fader_handle_t fader);
+    esp_err_t (*start)(void *ctx, uint8_t channel, uint32_t duty, uint32_t duration_ms);
+    void (*detach)(void *ctx);   //!< Optional
+    void *ctx;
+} fader_backend_t;
+
+/**
+ * Called from the fader task when a channel has played its last keyframe
+ */
+typedef void (*fader_done_cb_t)(fader_handle_t fader, uint8_t channel, void *user);
+
+/**
+ * Fader configuration
+ */
+typedef struct
+{
+    const fader_backend_t *backend;
+    UBaseType_t task_priority;
+    BaseType_t task_core;        //!< Core to pin the task to, or `tskNO_AFFINITY`
+    fader_done_cb_t on_done;     //!< Optional
+    void *user;
+} fader_config_t;
+
+/**
+ * @brief Create a fader and its task
+ *
+ * @param config Fader configuration
+ * @param[out] fader Fader handle
+ * @return `ESP_OK` on success
+ */
+esp_err_t fader_new(const fader_config_t *config, fader_handle_t *fader);
+
+/**
+ * @brief Delete a fader, running fades are not stopped
+ *
+ * The backend is detached first, fades that end afterwards are not
+ * reported. The stopped task wakes the caller through its task
+ * notification.
+ *
+ * @param fader Fader handle
+ * @return `ESP_OK` on success
+ */
+esp_err_t fader_del(fader_handle_t fader);
+
+/**
+ * @brief Queue a keyframe on a channel
+ *
+ * @param fader Fader handle
+ * @param channel Channel index, 0..FADER_MAX_CHANNELS - 1
+ * @param kf Keyframe, copied
+ * @return `ESP_OK` on success, `ESP_ERR_NO_MEM` if the queue is full
+ */
+esp_err_t fader_push(fader_handle_t fader, uint8_t channel, const fader_keyframe_t *kf);
+
+/**
+ * @brief Drop all keyframes queued on a channel
+ *
+ * The fade that is running finishes, nothing is started after it.
+ *
+ * @param fader Fader handle
+ * @param channel Channel index
+ * @return `ESP_OK` on success
+ */
+esp_err_t fader_clear(fader_handle_t fader, uint8_t channel);
+
+/**
+ * @brief Wait until channels have played all their keyframes
+ *
+ * @param fader Fader handle
+ * @param channels Bit mask of channel indices
+ * @param timeout Ticks to wait
+ * @return `ESP_OK` when all channels are idle, `ESP_ERR_TIMEOUT` otherwise
+ */
+esp_err_t fader_wait(fader_handle_t fader, uint32_t channels, TickType_t timeout);
+
+/**
+ * @brief Check whether a channel is idle
+ *
+ * @param fader Fader handle
+ * @param channel Channel index
+ * @return true if nothing is playing or queued
+ */
+bool fader_idle(fader_handle_t fader, uint8_t channel);
+
+/**
+ * @brief Get the number of fades started on a channel
+ *
+ * Every fade is one wakeup of the fader task, so the rate of this counter
+ * is the CPU cost of a channel.
+ *
+ * @param fader Fader handle
+ * @param channel Channel index
+ * @param[out] count Fades started since the fader was created
+ * @return `ESP_OK` on success
+ */
+esp_err_t fader_get_wakeups(fader_handle_t fader, uint8_t channel, uint32_t *count);
+
+/**
+ * @brief Backend: report the end of a fade from task context
+ *
+ * @param fader Fader handle
+ * @param channel Channel index
+ */
+void fader_fade_end(fader_handle_t fader, uint8_t channel);
+
+/**
+ * @brief Backend: report the end of a fade from an ISR
+ *
+ * @param fader Fader handle
+ * @param channel Channel index
+ * @return true if a higher priority task was woken
+ */
+bool fader_fade_end_from_isr(fader_handle_t fader, uint8_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __FADER_H__ */
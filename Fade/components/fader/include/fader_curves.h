@@ -0,0 +1,66 @@
+/**
+ * @file fader_curves.h
+ * @defgroup fader_curves fader_curves
+ * @{
+ *
+ * Precomputed easing tables of the fade orchestrator.
+ *
+ * Each table maps progress, sampled at FADER_CURVE_POINTS equidistant
+ * points, to a fraction of the duty change in 1/FADER_CURVE_MAX. The
+ * tables are generated and checked against their reference curves by
+ * `tools/fader_curves.py`, so no floating point math is needed at runtime.
+ */
+#ifndef __FADER_CURVES_H__
+#define __FADER_CURVES_H__
+
+#include <stdint.h>
+#include "fader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FADER_CURVE_POINTS (FADER_EASE_SEGMENTS + 1) //!< Table length
+#define FADER_CURVE_MAX    65535                     //!< Fraction of a full duty change
+
+extern const uint16_t fader_curve_in[FADER_CURVE_POINTS];
+extern const uint16_t fader_curve_out[FADER_CURVE_POINTS];
+extern const uint16_t fader_curve_in_out[FADER_CURVE_POINTS];
+extern const uint16_t fader_curve_gamma[FADER_CURVE_POINTS];
+extern const uint16_t fader_curve_exp[FADER_CURVE_POINTS];
+extern const uint16_t fader_curve_sine[FADER_CURVE_POINTS];
+
+/**
+ * @brief Table of an easing
+ *
+ * @param easing Easing
+ * @return Table, NULL for `FADER_EASE_LINEAR`
+ */
+static inline const uint16_t *fader_curve(fader_easing_t easing)
+{
+    switch (easing)
+    {
+        case FADER_EASE_IN:
+            return fader_curve_in;
+        case FADER_EASE_OUT:
+            return fader_curve_out;
+        case FADER_EASE_IN_OUT:
+            return fader_curve_in_out;
+        case FADER_EASE_GAMMA:
+            return fader_curve_gamma;
+        case FADER_EASE_EXP:
+            return fader_curve_exp;
+        case FADER_EASE_SINE:
+            return fader_curve_sine;
+        default:
+            return NULL;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __FADER_CURVES_H__ */
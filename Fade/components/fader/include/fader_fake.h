@@ -0,0 +1,78 @@
+/**
+ * @file fader_fake.h
+ * @defgroup fader_fake fader_fake
+ * @{
+ *
+ * Fake backend of the fade orchestrator for the linux target.
+ *
+ * Fades are recorded instead of being played and complete on a simulated
+ * clock, so a timeline can be checked on a development machine. Advance the
+ * clock in steps no longer than the shortest fade to keep chained fades on
+ * their exact start times.
+ */
+#ifndef __FADER_FAKE_H__
+#define __FADER_FAKE_H__
+
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "fader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FADER_FAKE_LOG_LEN 64    //!< Recorded fades, older entries are overwritten
+
+/**
+ * Recorded fade
+ */
+typedef struct
+{
+    uint32_t at_ms;              //!< Simulated time the fade was started
+    uint8_t channel;
+    uint32_t duty;
+    uint32_t duration_ms;
+} fader_fake_fade_t;
+
+/**
+ * Fake backend state
+ */
+typedef struct
+{
+    fader_handle_t fader;
+    uint32_t now_ms;                         //!< Simulated clock
+    uint32_t running;                        //!< Channels with a fade in progress
+    uint32_t end_ms[FADER_MAX_CHANNELS];     //!< End of the fade in progress
+    uint32_t duty[FADER_MAX_CHANNELS];       //!< Duty at the end of the last fade
+    fader_fake_fade_t log[FADER_FAKE_LOG_LEN];
+    size_t count;                            //!< Fades started since init
+    portMUX_TYPE lock;
+} fader_fake_t;
+
+/**
+ * @brief Initialize the fake backend
+ *
+ * @param fake Backend state, must stay valid while the fader exists
+ * @param[out] backend Backend to pass to `fader_new()`
+ * @return `ESP_OK` on success
+ */
+esp_err_t fader_fake_init(fader_fake_t *fake, fader_backend_t *backend);
+
+/**
+ * @brief Advance the simulated clock
+ *
+ * Fades that end within the step are reported to the fader.
+ *
+ * @param fake Backend state
+ * @param ms Step
+ * @return Bit mask of channels whose fade ended
+ */
+uint32_t fader_fake_advance(fader_fake_t *fake, uint32_t ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __FADER_FAKE_H__ */
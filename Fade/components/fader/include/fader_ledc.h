@@ -0,0 +1,69 @@
+/**
+ * @file fader_ledc.h
+ * @defgroup fader_ledc fader_ledc
+ * @{
+ *
+ * LEDC backend of the fade orchestrator.
+ *
+ * Fades are started with `ledc_set_fade_time_and_start()` and chained from
+ * the LEDC fade end callback. Holds (keyframes that do not change the duty)
+ * are timed with a one-shot esp_timer, since the LEDC finishes them after a
+ * single PWM period. Timers and channels must be configured by the
+ * application, with `intr_type = LEDC_INTR_FADE_END`.
+ */
+#ifndef __FADER_LEDC_H__
+#define __FADER_LEDC_H__
+
+#include <driver/ledc.h>
+#include <esp_timer.h>
+#include "fader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Fader channel index of an LEDC channel
+ */
+#define FADER_LEDC_CHANNEL(mode, channel) ((mode) * LEDC_CHANNEL_MAX + (channel))
+
+typedef struct fader_ledc fader_ledc_t;
+
+/**
+ * Hold timer of a channel
+ */
+typedef struct
+{
+    fader_ledc_t *ledc;
+    uint8_t channel;
+    esp_timer_handle_t timer;
+} fader_ledc_hold_t;
+
+/**
+ * LEDC backend state
+ */
+struct fader_ledc
+{
+    fader_handle_t fader;
+    uint32_t registered;         //!< Channels with the fade end callback registered
+    fader_ledc_hold_t hold[FADER_MAX_CHANNELS];
+};
+
+/**
+ * @brief Initialize the LEDC backend
+ *
+ * Installs the LEDC fade service if it is not installed yet.
+ *
+ * @param ledc Backend state, must stay valid while the fader exists
+ * @param[out] backend Backend to pass to `fader_new()`
+ * @return `ESP_OK` on success
+ */
+esp_err_t fader_ledc_init(fader_ledc_t *ledc, fader_backend_t *backend);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __FADER_LEDC_H__ */
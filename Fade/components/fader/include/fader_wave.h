@@ -0,0 +1,113 @@
+/**
+ * @file fader_wave.h
+ * @defgroup fader_wave fader_wave
+ * @{
+ *
+ * Periodic waveforms for the fade orchestrator.
+ *
+ * A waveform is built once as a short list of segments, each one a target
+ * level and a share of the period. While a channel plays a waveform every
+ * segment is one linear hardware fade, so the CPU only wakes up at segment
+ * boundaries: `count * 1000 / period_ms` times per second.
+ */
+#ifndef __FADER_WAVE_H__
+#define __FADER_WAVE_H__
+
+#include <stdint.h>
+#include "fader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FADER_WAVE_LEVEL_MAX 65535 //!< Level of the maximum duty
+
+/**
+ * Waveform segment, a linear fade from the previous level
+ */
+typedef struct
+{
+    uint16_t level;              //!< Level at the end, 0..FADER_WAVE_LEVEL_MAX
+    uint16_t time;               //!< Share of the period, in any unit
+} fader_wave_seg_t;
+
+/**
+ * Waveform, the last segment leads back to the first
+ */
+typedef struct
+{
+    const fader_wave_seg_t *segs;
+    uint8_t count;
+    uint32_t total;              //!< Sum of the segment times
+} fader_wave_t;
+
+/**
+ * Double beat with a rest, 5 segments
+ */
+extern const fader_wave_t fader_wave_heartbeat;
+
+/**
+ * @brief Build a sine wave
+ *
+ * Points come from the raised cosine table, no floating point math is used.
+ *
+ * @param wave Waveform
+ * @param segs Segment storage, must stay valid while the waveform is used
+ * @param count Segments, 2, 4, 8, ... 2 * (FADER_CURVE_POINTS - 1)
+ * @return `ESP_OK` on success
+ */
+esp_err_t fader_wave_sine(fader_wave_t *wave, fader_wave_seg_t *segs, uint8_t count);
+
+/**
+ * @brief Build a triangle wave
+ *
+ * @param wave Waveform
+ * @param segs Storage for 2 segments, must stay valid while the waveform is used
+ * @param rise Share of the period spent rising, 1..65534 of 65535
+ * @return `ESP_OK` on success
+ */
+esp_err_t fader_wave_triangle(fader_wave_t *wave, fader_wave_seg_t *segs, uint16_t rise);
+
+/**
+ * @brief Build a waveform from custom segments
+ *
+ * @param wave Waveform
+ * @param segs Segments, must stay valid while the waveform is used
+ * @param count Number of segments
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_ARG` if the period is empty
+ */
+esp_err_t fader_wave_custom(fader_wave_t *wave, const fader_wave_seg_t *segs, uint8_t count);
+
+/**
+ * @brief Play a waveform on a channel until it is stopped
+ *
+ * Keyframes pushed meanwhile are played first, the waveform resumes after
+ * them. A channel playing a waveform is never idle.
+ *
+ * @param fader Fader handle
+ * @param channel Channel index
+ * @param wave Waveform, must stay valid while it is played
+ * @param min_duty Duty of level 0
+ * @param max_duty Duty of level FADER_WAVE_LEVEL_MAX
+ * @param period_ms Period
+ * @return `ESP_OK` on success
+ */
+esp_err_t fader_play_wave(fader_handle_t fader, uint8_t channel, const fader_wave_t *wave,
+                          uint32_t min_duty, uint32_t max_duty, uint32_t period_ms);
+
+/**
+ * @brief Stop the waveform of a channel after the current segment
+ *
+ * @param fader Fader handle
+ * @param channel Channel index
+ * @return `ESP_OK` on success
+ */
+esp_err_t fader_stop_wave(fader_handle_t fader, uint8_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __FADER_WAVE_H__ */
@@ -3,14 +3,45 @@
 #include "freertos/task.h"
 #include "driver/ledc.h"
 #include "esp_err.h"
+#include "esp_log.h"
+#include "fader.h"
+#include "fader_ledc.h"
+#include "fader_wave.h"
 
 #define LED_PIN 2
+#define LED2_PIN 4
 #define LEDC_TIMER LEDC_TIMER_0
 #define LEDC_MODE LEDC_HIGH_SPEED_MODE
 #define LEDC_CHANNEL LEDC_CHANNEL_0
+#define LEDC_CHANNEL2 LEDC_CHANNEL_1
 #define LEDC_DUTY_RES LEDC_TIMER_13_BIT // Set duty resolution to 13 bits
+#define LEDC_DUTY_MAX 8191 // 100% duty cycle for 13-bit resolution
 #define LEDC_FREQUENCY 5000 // Frequency in Hertz. Set frequency at 5 kHz
 #define DUTY_CYCE_ms 2000
+#define HEARTBEAT_ms 1200
+#define SINE_SEGMENTS 16
+#define STATS_PERIOD_ms 10000
+
+#define FADE_CH FADER_LEDC_CHANNEL(LEDC_MODE, LEDC_CHANNEL)
+#define FADE_CH2 FADER_LEDC_CHANNEL(LEDC_MODE, LEDC_CHANNEL2)
+
+static const char *TAG = "fade";
+
+static fader_ledc_t fader_ledc;
+
+static void channel_config(ledc_channel_t channel, int gpio)
+{
+    ledc_channel_config_t ledc_channel = {
+        .speed_mode = LEDC_MODE,
+        .channel = channel,
+        .timer_sel = LEDC_TIMER,
+        .intr_type = LEDC_INTR_FADE_END,
+        .gpio_num = gpio,
+        .duty = 0, // Set duty to 0%
+        .hpoint = 0
+    };
+    ESP_ERROR_CHECK(ledc_channel_config(&ledc_channel));
+}
 
 void app_main(void)
 {
@@ -22,32 +53,65 @@ void app_main(void)
         .freq_hz = LEDC_FREQUENCY,
         .clk_cfg = LEDC_AUTO_CLK
     };
-    ledc_timer_config(&ledc_timer);
+    ESP_ERROR_CHECK(ledc_timer_config(&ledc_timer));
 
-    // Configure the channel
-    ledc_channel_config_t ledc_channel = {
-        .speed_mode = LEDC_MODE,
-        .channel = LEDC_CHANNEL,
-        .timer_sel = LEDC_TIMER,
-        .intr_type = LEDC_INTR_FADE_END,
-        .gpio_num = LED_PIN,
-        .duty = 0, // Set duty to 0%
-        .hpoint = 0
+    // Configure the channels
+    channel_config(LEDC_CHANNEL, LED_PIN);
+    channel_config(LEDC_CHANNEL2, LED2_PIN);
+
+    // Fades are chained from the LEDC fade end interrupt
+    fader_backend_t backend;
+    ESP_ERROR_CHECK(fader_ledc_init(&fader_ledc, &backend));
+    fader_config_t config = {
+        .backend = &backend,
+        .task_priority = 5,
+        .task_core = tskNO_AFFINITY,
     };
-    ledc_channel_config(&ledc_channel);
+    fader_handle_t fader;
+    ESP_ERROR_CHECK(fader_new(&config, &fader));
 
-    // Install fade function
-    ledc_fade_func_install(0);
+    // First LED breathes, second one blinks softly in counterpoint. The gamma
+    // curve keeps the low end from snapping on, as a linear ramp to 8191 does.
+    const fader_keyframe_t breathe[] = {
+        { .duty = LEDC_DUTY_MAX, .duration_ms = DUTY_CYCE_ms, .easing = FADER_EASE_GAMMA },
+        { .duty = 0, .duration_ms = DUTY_CYCE_ms, .easing = FADER_EASE_GAMMA },
+    };
+    const fader_keyframe_t blink[] = {
+        { .duty = 0, .duration_ms = DUTY_CYCE_ms / 2, .easing = FADER_EASE_LINEAR },
+        { .duty = LEDC_DUTY_MAX, .duration_ms = DUTY_CYCE_ms / 4, .easing = FADER_EASE_OUT },
+        { .duty = 0, .duration_ms = DUTY_CYCE_ms / 4, .easing = FADER_EASE_IN },
+        { .duty = LEDC_DUTY_MAX, .duration_ms = DUTY_CYCE_ms / 4, .easing = FADER_EASE_OUT },
+        { .duty = 0, .duration_ms = DUTY_CYCE_ms / 4, .easing = FADER_EASE_IN },
+        { .duty = 0, .duration_ms = DUTY_CYCE_ms / 2, .easing = FADER_EASE_LINEAR },
+    };
+
+    // One cycle of keyframes
+    for (size_t i = 0; i < sizeof(breathe) / sizeof(breathe[0]); i++)
+        ESP_ERROR_CHECK(fader_push(fader, FADE_CH, &breathe[i]));
+    for (size_t i = 0; i < sizeof(blink) / sizeof(blink[0]); i++)
+        ESP_ERROR_CHECK(fader_push(fader, FADE_CH2, &blink[i]));
 
+    // Wait for both channels to finish the cycle
+    ESP_ERROR_CHECK(fader_wait(fader, (1UL << FADE_CH) | (1UL << FADE_CH2), portMAX_DELAY));
+    ESP_LOGI(TAG, "Cycle done");
+
+    // Then periodic waveforms, the CPU only runs at segment boundaries
+    static fader_wave_seg_t sine_segs[SINE_SEGMENTS];
+    static fader_wave_t sine;
+    ESP_ERROR_CHECK(fader_wave_sine(&sine, sine_segs, SINE_SEGMENTS));
+    ESP_ERROR_CHECK(fader_play_wave(fader, FADE_CH, &sine, 0, LEDC_DUTY_MAX, 2 * DUTY_CYCE_ms));
+    ESP_ERROR_CHECK(fader_play_wave(fader, FADE_CH2, &fader_wave_heartbeat, 0, LEDC_DUTY_MAX, HEARTBEAT_ms));
+
+    uint32_t last[2] = { 0 };
     while (1) {
-        // Fade in
-        ledc_set_fade_with_time(ledc_channel.speed_mode, ledc_channel.channel, 8191, DUTY_CYCE_ms); // 8191 is 100% duty cycle for 13-bit resolution
-        ledc_fade_start(ledc_channel.speed_mode, ledc_channel.channel, LEDC_FADE_NO_WAIT);
-        vTaskDelay(2000 / portTICK_PERIOD_MS);
-
-        // Fade out
-        ledc_set_fade_with_time(ledc_channel.speed_mode, ledc_channel.channel, 0, DUTY_CYCE_ms);
-        ledc_fade_start(ledc_channel.speed_mode, ledc_channel.channel, LEDC_FADE_NO_WAIT);
-        vTaskDelay(DUTY_CYCE_ms / portTICK_PERIOD_MS);
+        vTaskDelay(STATS_PERIOD_ms / portTICK_PERIOD_MS);
+
+        uint32_t now[2];
+        ESP_ERROR_CHECK(fader_get_wakeups(fader, FADE_CH, &now[0]));
+        ESP_ERROR_CHECK(fader_get_wakeups(fader, FADE_CH2, &now[1]));
+        ESP_LOGI(TAG, "Wakeups/s: sine %.1f, heartbeat %.1f",
+                 (now[0] - last[0]) * 1000.0f / STATS_PERIOD_ms, (now[1] - last[1]) * 1000.0f / STATS_PERIOD_ms);
+        last[0] = now[0];
+        last[1] = now[1];
     }
 }
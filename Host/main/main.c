@@ -0,0 +1,1729 @@
+/**
+ * Drives the components on the linux target and checks what reached the
+ * fake drivers. Exits with 1 if a check fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdarg.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "halfake.h"
+#include "max7219.h"
+#include "max7219emu.h"
+#include "keyarray.h"
+#include "keysim.h"
+#include "ws2812b_output.h"
+#include "ws2812b_fx.h"
+#include "fader.h"
+#include "fader_ledc.h"
+#include "fader_fake.h"
+#include "fader_curves.h"
+#include "fader_wave.h"
+#include "taskprof_report.h"
+#include "framepipe.h"
+#include "framepipe_queue.h"
+#include "lfring.h"
+#include "blink_engine.h"
+#include "blink_code.h"
+#include "rtclog_ring.h"
+#include "asynclog.h"
+#include "asynclog_args.h"
+
+static const char *TAG = "host";
+
+#define EXPECT(cond) do { \
+        if (!(cond)) \
+        { \
+            ESP_LOGE(TAG, "%s:%d: %s", __func__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+typedef struct
+{
+    uint8_t data[MAX7219_MAX_CASCADE_SIZE * 2];
+    size_t bits;
+} spi_frame_t;
+
+static void on_spi(void *ctx, spi_device_handle_t dev, const uint8_t *data, size_t bits)
+{
+    spi_frame_t *frame = ctx;
+
+    frame->bits = bits;
+    memcpy(frame->data, data, bits / 8 < sizeof(frame->data) ? bits / 8 : sizeof(frame->data));
+}
+
+static int check_max7219(void)
+{
+    int failures = 0;
+    spi_frame_t frame = { 0 };
+
+    spi_bus_config_t cfg = {
+        .mosi_io_num = CONFIG_MAX7219_MOSI_GPIO,
+        .miso_io_num = -1,
+        .sclk_io_num = CONFIG_MAX7219_CLK_GPIO,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = 0,
+        .flags = 0,
+    };
+    EXPECT(spi_bus_initialize(MAX7219_CONFIG_HOST, &cfg, SPI_DMA_CH_AUTO) == ESP_OK);
+
+    max7219_t dev = MAX7219_CONFIG_DEFAULT();
+    EXPECT(max7219_init_desc(&dev, MAX7219_CONFIG_HOST, CONFIG_MAX7219_CLOCK_SPEED_HZ, CONFIG_MAX7219_CS_GPIO) == ESP_OK);
+    halfake_reset();
+    halfake_spi_listen(on_spi, &frame);
+    EXPECT(max7219_init(&dev) == ESP_OK);
+
+    // Every register write shifts one word through each chip
+    halfake_call_t call;
+    for (size_t i = 0; halfake_get(i, &call); i++)
+    {
+        EXPECT(call.op == HALFAKE_SPI_TRANSMIT);
+        EXPECT(call.id == CONFIG_MAX7219_CS_GPIO);
+        EXPECT(call.value == dev.cascade_size * 16);
+    }
+
+    // Words are big-endian, register first, in chip order. Mirrored
+    // displays count digits from the end of the last chip.
+    EXPECT(max7219_set_digit(&dev, 0, 0x5a) == ESP_OK);
+    uint8_t digit = dev.mirrored ? dev.digits - 1 : 0;
+    size_t at = digit / 8 * 2;
+    EXPECT(frame.bits == dev.cascade_size * 16u);
+    EXPECT(frame.data[at] == digit % 8 + 1 && frame.data[at + 1] == 0x5a);
+
+    halfake_stats_t stats;
+    halfake_get_stats(&stats);
+    ESP_LOGI(TAG, "max7219: %" PRIu32 " transactions, %" PRIu32 " bytes", stats.calls[HALFAKE_SPI_TRANSMIT],
+             stats.spi_bytes);
+
+    halfake_spi_listen(NULL, NULL);
+    EXPECT(max7219_free_desc(&dev) == ESP_OK);
+    EXPECT(spi_bus_free(MAX7219_CONFIG_HOST) == ESP_OK);
+
+    return failures;
+}
+
+// Segments the emulator shows for a digit numbered as in max7219_set_digit()
+static uint8_t shown(const max7219emu_t *emu, const max7219_t *dev, uint8_t digit)
+{
+    if (dev->mirrored)
+        digit = dev->digits - digit - 1;
+    return max7219emu_segments(emu, digit / 8, digit % 8);
+}
+
+static int check_max7219emu(void)
+{
+    int failures = 0;
+    static max7219emu_t emu;
+    static const uint8_t image[8] = { 0x3c, 0x42, 0x81, 0xa5, 0xa5, 0x81, 0x42, 0x3c };
+
+    spi_bus_config_t cfg = {
+        .mosi_io_num = CONFIG_MAX7219_MOSI_GPIO,
+        .miso_io_num = -1,
+        .sclk_io_num = CONFIG_MAX7219_CLK_GPIO,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = 0,
+        .flags = 0,
+    };
+    EXPECT(spi_bus_initialize(MAX7219_CONFIG_HOST, &cfg, SPI_DMA_CH_AUTO) == ESP_OK);
+
+    max7219_t dev = MAX7219_CONFIG_DEFAULT();
+    EXPECT(max7219emu_init(&emu, dev.cascade_size) == ESP_OK);
+    EXPECT(max7219emu_attach(&emu, CONFIG_MAX7219_CS_GPIO) == ESP_OK);
+    EXPECT(max7219_init_desc(&dev, MAX7219_CONFIG_HOST, CONFIG_MAX7219_CLOCK_SPEED_HZ, CONFIG_MAX7219_CS_GPIO) == ESP_OK);
+    EXPECT(max7219_init(&dev) == ESP_OK);
+    if (failures)
+        return failures;
+
+    for (uint8_t i = 0; i < dev.cascade_size; i++)
+    {
+        EXPECT(!emu.chip[i].shutdown && !emu.chip[i].test);
+        EXPECT(emu.chip[i].scan_limit == 7 && emu.chip[i].decode == 0 && emu.chip[i].intensity == 0);
+    }
+
+    // A targeted write is one word for the chip and no-ops for the others
+    max7219emu_stats_t stats;
+    max7219emu_take_stats(&emu, &stats);
+    EXPECT(max7219_draw_image_8x8(&dev, 0, image) == ESP_OK);
+    for (uint8_t i = 0; i < 8; i++)
+        EXPECT(shown(&emu, &dev, i) == image[i]);
+    max7219emu_take_stats(&emu, &stats);
+    EXPECT(stats.transactions == 8 && stats.changes == 8 && stats.redundant == 0);
+    EXPECT(stats.noops == 8u * (dev.cascade_size - 1) && stats.overflow_bits == 0 && stats.misaligned == 0);
+
+    // Drawing it again changes nothing
+    EXPECT(max7219_draw_image_8x8(&dev, 0, image) == ESP_OK);
+    max7219emu_take_stats(&emu, &stats);
+    EXPECT(stats.changes == 0 && stats.redundant == 8);
+    ESP_LOGI(TAG, "max7219emu: %" PRIu32 " of %" PRIu32 " bytes wasted redrawing an image",
+             max7219emu_wasted_bytes(&stats), stats.bytes);
+
+    // Code B digits
+    EXPECT(max7219_set_decode_mode(&dev, true) == ESP_OK);
+    EXPECT(max7219_draw_text_7seg(&dev, 0, "1.-") == ESP_OK);
+    EXPECT(shown(&emu, &dev, 0) == (0x80 | 0x30));
+    EXPECT(shown(&emu, &dev, 1) == 0x01);
+    EXPECT(shown(&emu, &dev, 2) == 0x00);
+
+    // Numbers, right aligned with the sign next to the first digit
+    EXPECT(max7219_draw_fixed_7seg(&dev, 0, 6, -1234, 2, 0) == ESP_OK);
+    static const uint8_t fixed[6] = { 0x00, 0x01, 0x30, 0x80 | 0x6d, 0x79, 0x33 };
+    for (uint8_t i = 0; i < 6; i++)
+        EXPECT(shown(&emu, &dev, i) == fixed[i]);
+    EXPECT(max7219_draw_fixed_7seg(&dev, 0, 4, 5, 2, 0) == ESP_OK);
+    EXPECT(shown(&emu, &dev, 0) == 0x00 && shown(&emu, &dev, 1) == (0x80 | 0x7e));
+    EXPECT(max7219_draw_fixed_7seg(&dev, 0, 4, 5, 3, 0) == ESP_OK);
+    EXPECT(shown(&emu, &dev, 0) == (0x80 | 0x7e));
+    EXPECT(max7219_draw_fixed_7seg(&dev, 0, 4, 5, 4, 0) == ESP_ERR_INVALID_ARG);
+    EXPECT(max7219_draw_fixed_7seg(&dev, 0, 4, 5, 255, 0) == ESP_ERR_INVALID_ARG);
+    EXPECT(shown(&emu, &dev, 0) == (0x80 | 0x7e));
+
+    // All chips of the field in one transaction per digit register
+    uint8_t width = dev.digits < 16 ? dev.digits : 16;
+    max7219emu_take_stats(&emu, &stats);
+    EXPECT(max7219_draw_int_7seg(&dev, 0, width, 12345678, MAX7219_NUM_ZEROS) == ESP_OK);
+    max7219emu_take_stats(&emu, &stats);
+    EXPECT(stats.transactions == 8 && stats.noops == 0);
+    EXPECT(shown(&emu, &dev, width - 8) == 0x30 && shown(&emu, &dev, width - 1) == 0x7f);
+    EXPECT(max7219_draw_int_7seg(&dev, 0, width, 12345678, MAX7219_NUM_ZEROS) == ESP_OK);
+    max7219emu_take_stats(&emu, &stats);
+    EXPECT(stats.transactions == 0);
+
+    EXPECT(max7219_draw_int_7seg(&dev, 0, 4, 12345, 0) == ESP_ERR_INVALID_SIZE);
+    for (uint8_t i = 0; i < 4; i++)
+        EXPECT(shown(&emu, &dev, i) == 0x01);
+    EXPECT(max7219_draw_hex_7seg(&dev, 0, 4, 0xbeef, 0) == ESP_ERR_NOT_SUPPORTED);
+
+    EXPECT(max7219_set_decode_mode(&dev, false) == ESP_OK);
+    max7219emu_take_stats(&emu, &stats);
+    EXPECT(max7219_draw_hex_7seg(&dev, 0, 4, 0xbeef, MAX7219_NUM_DP | MAX7219_NUM_DEFER) == ESP_OK);
+    max7219emu_take_stats(&emu, &stats);
+    EXPECT(stats.transactions == 0);
+    EXPECT(max7219_flush(&dev) == ESP_OK);
+    static const uint8_t hex[4] = { 0x1f, 0x4f, 0x4f, 0x80 | 0x47 };
+    for (uint8_t i = 0; i < 4; i++)
+        EXPECT(shown(&emu, &dev, i) == hex[i]);
+
+    EXPECT(max7219_set_shutdown_mode(&dev, true) == ESP_OK);
+    EXPECT(shown(&emu, &dev, 0) == 0);
+
+    max7219emu_detach();
+    EXPECT(max7219_free_desc(&dev) == ESP_OK);
+    EXPECT(spi_bus_free(MAX7219_CONFIG_HOST) == ESP_OK);
+
+    return failures;
+}
+
+// The last key, found by a full scan
+#if CONFIG_KEYARRAY_ROWS > 3
+#define LAST_ROW_GPIO CONFIG_KEYARRAY_ROW3_GPIO
+#elif CONFIG_KEYARRAY_ROWS > 2
+#define LAST_ROW_GPIO CONFIG_KEYARRAY_ROW2_GPIO
+#elif CONFIG_KEYARRAY_ROWS > 1
+#define LAST_ROW_GPIO CONFIG_KEYARRAY_ROW1_GPIO
+#else
+#define LAST_ROW_GPIO CONFIG_KEYARRAY_ROW0_GPIO
+#endif
+#if CONFIG_KEYARRAY_COLS > 3
+#define LAST_COL_GPIO CONFIG_KEYARRAY_COL3_GPIO
+#elif CONFIG_KEYARRAY_COLS > 2
+#define LAST_COL_GPIO CONFIG_KEYARRAY_COL2_GPIO
+#elif CONFIG_KEYARRAY_COLS > 1
+#define LAST_COL_GPIO CONFIG_KEYARRAY_COL1_GPIO
+#else
+#define LAST_COL_GPIO CONFIG_KEYARRAY_COL0_GPIO
+#endif
+
+// A pressed key connects its column to its row
+static int on_key_input(void *ctx, gpio_num_t pin)
+{
+    return pin == LAST_COL_GPIO ? (int)halfake_gpio_get_output(LAST_ROW_GPIO) : -1;
+}
+
+static int check_keyarray(void)
+{
+    int failures = 0;
+    const char keys[] = CONFIG_KEYARRAY_KEYS;
+
+    halfake_reset();
+    keypad_setup_config();
+    EXPECT(halfake_gpio_get_mode(LAST_ROW_GPIO) == GPIO_MODE_OUTPUT);
+    EXPECT(halfake_gpio_get_mode(LAST_COL_GPIO) == GPIO_MODE_INPUT);
+    EXPECT(halfake_gpio_get_pull(LAST_COL_GPIO) == GPIO_PULLDOWN_ONLY);
+
+    EXPECT(scanForSingleKeyOnce('?') == '?');
+
+    halfake_gpio_set_input_hook(on_key_input, NULL);
+    EXPECT(scanForSingleKeyOnce('?') == keys[sizeof(keys) - 2]);
+    halfake_gpio_set_input_hook(NULL, NULL);
+
+    halfake_stats_t stats;
+    halfake_get_stats(&stats);
+    ESP_LOGI(TAG, "keyarray: %" PRIu32 " pin writes for two scans", stats.calls[HALFAKE_GPIO_LEVEL]);
+
+    return failures;
+}
+
+// The key matrix of menuconfig
+static const keysim_config_t KEY_MATRIX = {
+    .rows = CONFIG_KEYARRAY_ROWS,
+    .cols = CONFIG_KEYARRAY_COLS,
+    .row_pins = {
+        CONFIG_KEYARRAY_ROW0_GPIO,
+#if CONFIG_KEYARRAY_ROWS > 1
+        CONFIG_KEYARRAY_ROW1_GPIO,
+#endif
+#if CONFIG_KEYARRAY_ROWS > 2
+        CONFIG_KEYARRAY_ROW2_GPIO,
+#endif
+#if CONFIG_KEYARRAY_ROWS > 3
+        CONFIG_KEYARRAY_ROW3_GPIO,
+#endif
+    },
+    .col_pins = {
+        CONFIG_KEYARRAY_COL0_GPIO,
+#if CONFIG_KEYARRAY_COLS > 1
+        CONFIG_KEYARRAY_COL1_GPIO,
+#endif
+#if CONFIG_KEYARRAY_COLS > 2
+        CONFIG_KEYARRAY_COL2_GPIO,
+#endif
+#if CONFIG_KEYARRAY_COLS > 3
+        CONFIG_KEYARRAY_COL3_GPIO,
+#endif
+    },
+};
+
+#define SCAN_PERIOD_US 10000
+
+static int check_keysim(void)
+{
+    int failures = 0;
+    static keysim_t sim;
+    const char keys[] = CONFIG_KEYARRAY_KEYS;
+    keysim_config_t config = KEY_MATRIX;
+    keysim_stats_t stats;
+
+    keypad_setup_config();
+
+#if CONFIG_KEYARRAY_ROWS > 1 && CONFIG_KEYARRAY_COLS > 1
+    // Three corners of a rectangle show the fourth one without diodes
+    for (int diodes = 0; diodes < 2; diodes++)
+    {
+        config.diodes = diodes;
+        EXPECT(keysim_init(&sim, &config) == ESP_OK);
+        EXPECT(keysim_attach(&sim) == ESP_OK);
+        keysim_set_key(&sim, 1, 0, true);
+        keysim_set_key(&sim, 1, 1, true);
+        keysim_set_key(&sim, 0, 1, true);
+        EXPECT(scanForSingleKeyOnce('?') == keys[diodes ? 1 : 0]);
+        keysim_take_stats(&sim, &stats);
+        EXPECT(diodes ? stats.ghosts == 0 : stats.ghosts > 0);
+    }
+#endif
+
+    // A press while scanning every 10 ms, bouncing for 5 ms
+    config.diodes = false;
+    config.bounce_us = 5000;
+    config.chatter_us = 300;
+    config.read_us = 20;
+    config.seed = 1;
+    uint8_t row = CONFIG_KEYARRAY_ROWS - 1, col = CONFIG_KEYARRAY_COLS - 1;
+    const keysim_event_t script[] = {
+        { .at_us = 7000, .row = row, .col = col, .pressed = true },
+        { .at_us = 47000, .row = row, .col = col, .pressed = false },
+    };
+    EXPECT(keysim_init(&sim, &config) == ESP_OK);
+    EXPECT(keysim_attach(&sim) == ESP_OK);
+    EXPECT(keysim_script(&sim, script, 2) == ESP_OK);
+
+    uint64_t first = 0;
+    int found = 0;
+    for (uint64_t t = 0; t < 100000; t += SCAN_PERIOD_US)
+    {
+        keysim_advance(&sim, t - keysim_now(&sim));
+        if (scanForSingleKeyOnce('?') == keys[sizeof(keys) - 2])
+        {
+            if (!found++)
+                first = t;
+            EXPECT(t < script[1].at_us + config.bounce_us);
+        }
+    }
+    keysim_take_stats(&sim, &stats);
+    keysim_detach();
+
+    EXPECT(found > 0);
+    EXPECT(first >= script[0].at_us && first < script[0].at_us + config.bounce_us + SCAN_PERIOD_US);
+    ESP_LOGI(TAG, "keysim: found after %" PRIu64 " us, %d scans, %" PRIu32 " reads while bouncing",
+             first - script[0].at_us, found, stats.bounces);
+
+    return failures;
+}
+
+typedef struct
+{
+    uint8_t grb[CONFIG_WS2812B_LENGTH * 3];
+    size_t bytes;
+} rmt_frame_t;
+
+static void on_rmt(void *ctx, rmt_channel_handle_t channel, const rmt_symbol_word_t *symbols, size_t count)
+{
+    rmt_frame_t *frame = ctx;
+
+    frame->bytes = halfake_rmt_decode(symbols, count, frame->grb, sizeof(frame->grb));
+}
+
+static int check_ws2812b(void)
+{
+    int failures = 0;
+    static rmt_frame_t frame;
+    static ws2812b_rgb_t pixels[CONFIG_WS2812B_LENGTH];
+
+    for (int i = 0; i < CONFIG_WS2812B_LENGTH; i++)
+        pixels[i] = (ws2812b_rgb_t) { .r = i, .g = 0x80 | i, .b = 0xff - i };
+    ws2812b_fb_t fb = { .pixels = pixels, .length = CONFIG_WS2812B_LENGTH, .width = CONFIG_WS2812B_MATRIX_WIDTH };
+
+    ws2812b_output_config_t config = WS2812B_OUTPUT_CONFIG_DEFAULT();
+    ws2812b_output_handle_t out;
+    EXPECT(ws2812b_output_new(&config, &out) == ESP_OK);
+    if (failures)
+        return failures;
+
+    halfake_reset();
+    halfake_rmt_listen(on_rmt, &frame);
+    EXPECT(ws2812b_output_commit(out, &fb) == ESP_OK);
+    halfake_rmt_listen(NULL, NULL);
+
+    EXPECT(frame.bytes == sizeof(frame.grb));
+    for (int i = 0; i < CONFIG_WS2812B_LENGTH; i++)
+    {
+        const uint8_t *p = &frame.grb[i * 3];
+        EXPECT(p[0] == pixels[i].g && p[1] == pixels[i].r && p[2] == pixels[i].b);
+    }
+
+    // The refills the plan expects are the ones the encoder needed
+    ws2812b_output_plan_t plan;
+    ws2812b_output_stats_t stats;
+    ws2812b_output_get_plan(out, &plan);
+    ws2812b_output_get_stats(out, &stats);
+    EXPECT(stats.frames == 1);
+    EXPECT(stats.refills == plan.expected_refills);
+    ESP_LOGI(TAG, "ws2812b: %" PRIu32 " symbols, %" PRIu32 " refills", plan.frame_symbols, stats.refills);
+
+    EXPECT(ws2812b_output_del(out) == ESP_OK);
+
+    // The same frame from caller owned memory
+    static ws2812b_output_t out_buf;
+    static uint8_t grb[WS2812B_OUTPUT_GRB_SIZE(CONFIG_WS2812B_LENGTH)];
+    EXPECT(ws2812b_output_new_static(&config, &out_buf, grb, &out) == ESP_OK);
+    if (failures)
+        return failures;
+    EXPECT(out == &out_buf);
+
+    memset(&frame, 0, sizeof(frame));
+    halfake_rmt_listen(on_rmt, &frame);
+    EXPECT(ws2812b_output_commit(out, &fb) == ESP_OK);
+    halfake_rmt_listen(NULL, NULL);
+    EXPECT(frame.bytes == sizeof(grb));
+    EXPECT(memcmp(frame.grb, grb, sizeof(grb)) == 0);
+    ESP_LOGI(TAG, "ws2812b: %d bytes of static RAM", (int)WS2812B_OUTPUT_STATIC_RAM_SIZE(CONFIG_WS2812B_LENGTH));
+
+    EXPECT(ws2812b_output_del(out) == ESP_OK);
+
+    return failures;
+}
+
+#define RGB_EQ(c, R, G, B) ((c).r == (R) && (c).g == (G) && (c).b == (B))
+
+/* FNV-1a over the pixels, pins a whole sequence of frames with one number */
+static uint32_t fb_hash(uint32_t hash, const ws2812b_fb_t *fb)
+{
+    const uint8_t *p = (const uint8_t *)fb->pixels;
+
+    for (size_t i = 0; i < fb->length * sizeof(ws2812b_rgb_t); i++)
+        hash = (hash ^ p[i]) * 16777619u;
+
+    return hash;
+}
+
+static uint32_t render_hash(ws2812b_fx_t *fx, ws2812b_fb_t *fb, uint32_t frames)
+{
+    uint32_t hash = 2166136261u;
+
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        fx->render(fx, fb, f);
+        hash = fb_hash(hash, fb);
+    }
+
+    return hash;
+}
+
+/*
+ * A 4x1 asset of two frames, 2 bits per pixel: a key frame of 100 ms
+ * black, red, green, red and a delta frame of 300 ms that turns the last
+ * pixel green
+ */
+static const uint8_t fx_asset[] = {
+    'L', 'A', 'N', 'M', 1, 2, 4, 0, 1, 0, 2, 0, 3, 0, 100, 0,
+    0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff, 0x00,
+    LEDANIM_FRAME_KEY, 2, 0, 0x03, 0x19,
+    LEDANIM_FRAME_DELTA | LEDANIM_FRAME_HAS_DELAY, 3, 0, 0x2c, 0x01, 0x81, 0x41, 0x02,
+};
+
+/*
+ * Fixed inputs against golden outputs. The color math is exact integer
+ * arithmetic, so the hashes only change with the rendered frames.
+ */
+static int check_ws2812b_fx(void)
+{
+    int failures = 0;
+    static ws2812b_rgb_t pixels[16];
+    static uint8_t heat[16];
+    ws2812b_fb_t fb = { .pixels = pixels, .length = 16, .width = 8 };
+    ws2812b_fx_t fx;
+    const ws2812b_rgb_t black = { 0, 0, 0 }, white = { 255, 255, 255 };
+    const ws2812b_rgb_t orange = { 200, 100, 0 };
+
+    EXPECT(RGB_EQ(ws2812b_hsv_to_rgb(WS2812B_HUE_RED, 255, 255), 255, 0, 0));
+    EXPECT(RGB_EQ(ws2812b_hsv_to_rgb(WS2812B_HUE_GREEN, 255, 255), 0, 255, 0));
+    EXPECT(RGB_EQ(ws2812b_hsv_to_rgb(WS2812B_HUE_BLUE, 255, 255), 0, 0, 255));
+    EXPECT(RGB_EQ(ws2812b_hsv_to_rgb(0x2000, 255, 128), 128, 96, 0));
+    EXPECT(RGB_EQ(ws2812b_hsv_to_rgb(0x9000, 0, 77), 77, 77, 77));
+    EXPECT(RGB_EQ(ws2812b_blend(orange, white, 0), 200, 100, 0));
+    EXPECT(RGB_EQ(ws2812b_blend(orange, white, 255), 255, 255, 255));
+    EXPECT(RGB_EQ(ws2812b_blend(black, white, 128), 128, 128, 128));
+    EXPECT(ws2812b_scale8(255, 255) == 255 && ws2812b_scale8(200, 0) == 0 && ws2812b_scale8(200, 127) == 100);
+
+    // Half a pixel per frame, done with the last pixel
+    ws2812b_fb_fill(&fb, black);
+    ws2812b_fx_wipe(&fx, orange, 128);
+    EXPECT(fx.render(&fx, &fb, 2));
+    EXPECT(RGB_EQ(pixels[0], 200, 100, 0) && RGB_EQ(pixels[1], 0, 0, 0));
+    EXPECT(!fx.render(&fx, &fb, 31));
+    EXPECT(RGB_EQ(pixels[15], 200, 100, 0));
+
+    ws2812b_fx_fade(&fx, black, orange, 4);
+    EXPECT(fx.render(&fx, &fb, 0));
+    EXPECT(RGB_EQ(pixels[0], 49, 24, 0) && RGB_EQ(pixels[15], 49, 24, 0));
+    EXPECT(fx.render(&fx, &fb, 3));
+    EXPECT(RGB_EQ(pixels[7], 200, 100, 0));
+    EXPECT(!fx.render(&fx, &fb, 4));
+
+    // Two glyphs on two rows, the second one in view after 8 columns
+    static const uint64_t glyphs[2] = { 0x8000000000000000ULL | 0x0100000000000000ULL, 0x0080000000000000ULL };
+    ws2812b_fx_text(&fx, glyphs, 2, orange, black, 2);
+    EXPECT(fx.render(&fx, &fb, 0));
+    EXPECT(RGB_EQ(pixels[0], 200, 100, 0) && RGB_EQ(pixels[7], 200, 100, 0) && RGB_EQ(pixels[8], 0, 0, 0));
+    EXPECT(fx.render(&fx, &fb, 2));
+    EXPECT(RGB_EQ(pixels[6], 200, 100, 0) && RGB_EQ(pixels[7], 0, 0, 0));
+    EXPECT(fx.render(&fx, &fb, 16));
+    EXPECT(RGB_EQ(pixels[0], 0, 0, 0) && RGB_EQ(pixels[8], 200, 100, 0));
+
+    // The other renderers, pinned by a hash of all their frames
+    ws2812b_fx_rainbow(&fx, 0x1000, 0x800, 255);
+    EXPECT(render_hash(&fx, &fb, 32) == 0x6ab11e85);
+    ws2812b_fx_fire(&fx, heat, 55, 120, 42);
+    EXPECT(render_hash(&fx, &fb, 64) == 0x41195fef);
+    ws2812b_fx_sparkle(&fx, orange, 200, 96, 7);
+    EXPECT(render_hash(&fx, &fb, 64) == 0xe6146169);
+
+    // 100 ms and 300 ms at 10 fps are one and three runner frames
+    ledanim_t anim;
+    ws2812b_fb_t strip = { .pixels = pixels, .length = 4 };
+    EXPECT(ledanim_open(&anim, fx_asset, sizeof(fx_asset)) == ESP_OK);
+    EXPECT(ws2812b_fx_anim(&fx, &anim, &fb, 10) == ESP_ERR_INVALID_SIZE);
+    EXPECT(ws2812b_fx_anim(&fx, &anim, &strip, 10) == ESP_OK);
+    EXPECT(fx.render(&fx, &strip, 0));
+    EXPECT(RGB_EQ(pixels[0], 0, 0, 0) && RGB_EQ(pixels[1], 255, 0, 0) && RGB_EQ(pixels[2], 0, 255, 0) && RGB_EQ(pixels[3], 255, 0, 0));
+    EXPECT(fx.render(&fx, &strip, 1));
+    EXPECT(RGB_EQ(pixels[2], 0, 255, 0) && RGB_EQ(pixels[3], 0, 255, 0));
+    pixels[3] = white;
+    EXPECT(fx.render(&fx, &strip, 3));
+    EXPECT(RGB_EQ(pixels[3], 255, 255, 255));
+    EXPECT(fx.render(&fx, &strip, 4));
+    EXPECT(RGB_EQ(pixels[3], 255, 0, 0));
+
+    // A frame larger than the sink is rejected before anything is written,
+    // a mono frame takes a whole 8x8 block
+    ws2812b_fb_t short_strip = { .pixels = pixels, .length = 3 };
+    pixels[3] = white;
+    EXPECT(!fx.render(&fx, &short_strip, 5));
+    EXPECT(RGB_EQ(pixels[3], 255, 255, 255));
+    uint64_t block = 0;
+    ledanim_sink_t mono = { .type = LEDANIM_SINK_MONO, .buf = &block, .pixels = 8 };
+    EXPECT(ledanim_next(&anim, &mono, NULL) == ESP_ERR_INVALID_SIZE);
+    mono.pixels = 64;
+    EXPECT(ledanim_next(&anim, &mono, NULL) == ESP_OK);
+
+    // The duration of a frame cut after its length is not read, the copy
+    // ends there so that the sanitizers see a read past it
+    uint16_t delay_ms = 0;
+    size_t cut = sizeof(fx_asset) - 5;
+    uint8_t *truncated = malloc(cut);
+    memcpy(truncated, fx_asset, cut);
+    ledanim_sink_t rgb = { .type = LEDANIM_SINK_RGB, .buf = pixels, .pixels = 4 };
+    EXPECT(ledanim_open(&anim, truncated, cut) == ESP_OK);
+    EXPECT(ledanim_next(&anim, &rgb, &delay_ms) == ESP_OK && delay_ms == 100);
+    EXPECT(ledanim_next(&anim, &rgb, &delay_ms) == ESP_ERR_INVALID_SIZE);
+    free(truncated);
+
+    // High cooling on a short strip used to wrap the cooling range to 0
+    ws2812b_fb_t ten = { .pixels = pixels, .length = 10 };
+    ws2812b_fx_fire(&fx, heat, 254, 120, 42);
+    render_hash(&fx, &ten, 8);
+
+    // The runner on a fake strip, then a framebuffer longer than the strip
+    // whose commits fail and are not counted as frames
+    led_strip_config_t strip_config = { .max_leds = 16 };
+    led_strip_rmt_config_t rmt_config = { 0 };
+    led_strip_handle_t led_strip;
+    EXPECT(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip) == ESP_OK);
+    if (failures)
+        return failures;
+
+    static ws2812b_rgb_t long_pixels[17];
+    ws2812b_fb_t long_fb = { .pixels = long_pixels, .length = 17 };
+    ws2812b_fx_stats_t stats;
+    static ws2812b_fx_runner_t runner;
+    runner = (ws2812b_fx_runner_t) { .strip = led_strip, .fb = &fb, .fps = 200 };
+    ws2812b_fx_rainbow(&fx, 0x1000, 0x800, 255);
+    EXPECT(ws2812b_fx_runner_start(&runner, 5, 0) == ESP_OK);
+    EXPECT(ws2812b_fx_runner_set(&runner, &fx) == ESP_OK);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    EXPECT(ws2812b_fx_runner_stop(&runner) == ESP_OK);
+    ws2812b_fx_runner_get_stats(&runner, &stats);
+    EXPECT(stats.frames > 0 && stats.frames <= halfake_led_strip_refreshes(led_strip));
+    ESP_LOGI(TAG, "ws2812b_fx: %" PRIu32 " runner frames", stats.frames);
+
+    runner.fb = &long_fb;
+    EXPECT(ws2812b_fx_runner_start(&runner, 5, 0) == ESP_OK);
+    EXPECT(ws2812b_fx_runner_set(&runner, &fx) == ESP_OK);
+    vTaskDelay(pdMS_TO_TICKS(50));
+    EXPECT(ws2812b_fx_runner_stop(&runner) == ESP_OK);
+    ws2812b_fx_runner_get_stats(&runner, &stats);
+    EXPECT(stats.frames == 0);
+    EXPECT(led_strip_del(led_strip) == ESP_OK);
+
+    return failures;
+}
+
+static int check_fader(void)
+{
+    int failures = 0;
+    static fader_ledc_t fader_ledc;
+
+    ledc_timer_config_t timer = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .timer_num = LEDC_TIMER_0,
+        .duty_resolution = LEDC_TIMER_13_BIT,
+        .freq_hz = 5000,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    ledc_channel_config_t channel = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel = LEDC_CHANNEL_0,
+        .timer_sel = LEDC_TIMER_0,
+        .intr_type = LEDC_INTR_FADE_END,
+        .gpio_num = 2,
+    };
+    halfake_reset();
+    EXPECT(ledc_timer_config(&timer) == ESP_OK);
+    EXPECT(ledc_channel_config(&channel) == ESP_OK);
+
+    fader_backend_t backend;
+    EXPECT(fader_ledc_init(&fader_ledc, &backend) == ESP_OK);
+    fader_config_t config = {
+        .backend = &backend,
+        .task_priority = 5,
+        .task_core = tskNO_AFFINITY,
+    };
+    fader_handle_t fader;
+    EXPECT(fader_new(&config, &fader) == ESP_OK);
+    if (failures)
+        return failures;
+
+    uint8_t ch = FADER_LEDC_CHANNEL(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0);
+    fader_keyframe_t kf = { .duty = 4096, .duration_ms = 100, .easing = FADER_EASE_LINEAR };
+    EXPECT(fader_push(fader, ch, &kf) == ESP_OK);
+
+    // The fader task starts the fade, the simulated clock ends it
+    for (int i = 0; i < 100 && !fader_idle(fader, ch); i++)
+    {
+        vTaskDelay(1);
+        halfake_ledc_advance(10);
+    }
+    EXPECT(fader_idle(fader, ch));
+    EXPECT(halfake_ledc_get_duty(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0) == 4096);
+
+    halfake_stats_t stats;
+    halfake_get_stats(&stats);
+    ESP_LOGI(TAG, "fader: %" PRIu32 " LEDC fades", stats.calls[HALFAKE_LEDC_FADE]);
+
+    // Deleted during a hold, neither its timer nor a fade that ends later
+    // may reach the freed fader
+    kf.duration_ms = 200;
+    EXPECT(fader_push(fader, ch, &kf) == ESP_OK);
+    vTaskDelay(pdMS_TO_TICKS(20));
+    EXPECT(!fader_idle(fader, ch));
+    EXPECT(fader_del(fader) == ESP_OK);
+    EXPECT(!fader_ledc.registered && !fader_ledc.hold[ch].timer && !fader_ledc.fader);
+    EXPECT(ledc_set_fade_time_and_start(LEDC_LOW_SPEED_MODE, LEDC_CHANNEL_0, 0, 10, LEDC_FADE_NO_WAIT) == ESP_OK);
+    EXPECT(halfake_ledc_advance(10) == 1);
+    vTaskDelay(pdMS_TO_TICKS(300));
+
+    return failures;
+}
+
+static void on_fade_done(fader_handle_t fader, uint8_t channel, void *user)
+{
+    __atomic_fetch_or((uint32_t *)user, 1UL << channel, __ATOMIC_RELAXED);
+}
+
+static size_t fake_fades(fader_fake_t *fake)
+{
+    portENTER_CRITICAL(&fake->lock);
+    size_t count = fake->count;
+    portEXIT_CRITICAL(&fake->lock);
+
+    return count;
+}
+
+/* Advance the fake clock and wait until the fader task followed up every fade that ended */
+static void fake_step(fader_fake_t *fake, fader_handle_t fader, uint32_t ms)
+{
+    uint32_t pending = fader_fake_advance(fake, ms);
+
+    for (int i = 0; i < 1000 && pending; i++)
+    {
+        vTaskDelay(1);
+        portENTER_CRITICAL(&fake->lock);
+        pending &= ~fake->running;
+        portEXIT_CRITICAL(&fake->lock);
+        for (uint32_t bits = pending; bits; bits &= bits - 1)
+            if (fader_idle(fader, __builtin_ctz(bits)))
+                pending &= ~(1UL << __builtin_ctz(bits));
+    }
+}
+
+static int check_fader_fake(void)
+{
+    int failures = 0;
+    static fader_fake_t fake;
+    uint32_t done = 0;
+
+    fader_backend_t backend;
+    EXPECT(fader_fake_init(&fake, &backend) == ESP_OK);
+    fader_config_t config = {
+        .backend = &backend,
+        .task_priority = 5,
+        .task_core = tskNO_AFFINITY,
+        .on_done = on_fade_done,
+        .user = &done,
+    };
+    fader_handle_t fader;
+    EXPECT(fader_new(&config, &fader) == ESP_OK);
+    if (failures)
+        return failures;
+
+    // An eased keyframe of 320 ms is split in 16 linear fades of 20 ms,
+    // next to two chained linear keyframes on another channel
+    fader_keyframe_t eased = { .duty = 8192, .duration_ms = 320, .easing = FADER_EASE_IN };
+    fader_keyframe_t up = { .duty = 1000, .duration_ms = 100, .easing = FADER_EASE_LINEAR };
+    fader_keyframe_t down = { .duty = 0, .duration_ms = 50, .easing = FADER_EASE_LINEAR };
+    EXPECT(fader_push(fader, 0, &eased) == ESP_OK);
+    EXPECT(fader_push(fader, 3, &up) == ESP_OK);
+    EXPECT(fader_push(fader, 3, &down) == ESP_OK);
+    EXPECT(!fader_idle(fader, 0) && !fader_idle(fader, 3));
+    for (int i = 0; i < 100 && fake_fades(&fake) < 2; i++)
+        vTaskDelay(1);
+
+    while (fake.now_ms < 320)
+    {
+        fake_step(&fake, fader, 10);
+        if (fake.now_ms == 150)
+        {
+            EXPECT(fader_idle(fader, 3) && !fader_idle(fader, 0));
+            EXPECT(__atomic_load_n(&done, __ATOMIC_RELAXED) == 1UL << 3);
+            EXPECT(fader_wait(fader, 1UL << 0 | 1UL << 3, 0) == ESP_ERR_TIMEOUT);
+        }
+    }
+    EXPECT(fader_wait(fader, 1UL << 0 | 1UL << 3, 0) == ESP_OK);
+    EXPECT(__atomic_load_n(&done, __ATOMIC_RELAXED) == (1UL << 0 | 1UL << 3));
+
+    EXPECT(fake.count == 18);
+    uint32_t seg = 0;
+    for (size_t i = 0; i < fake.count && i < FADER_FAKE_LOG_LEN; i++)
+    {
+        const fader_fake_fade_t *f = &fake.log[i];
+        if (f->channel == 0)
+        {
+            seg++;
+            uint32_t duty = (uint64_t)eased.duty * fader_curve_in[seg * 2] / FADER_CURVE_MAX;
+            EXPECT(f->at_ms == (seg - 1) * 20 && f->duration_ms == 20);
+            EXPECT(f->duty == (seg == 16 ? eased.duty : duty));
+        }
+        else if (f->channel == 3)
+        {
+            const fader_keyframe_t *kf = f->at_ms ? &down : &up;
+            EXPECT((f->at_ms == 0 || f->at_ms == 100) && f->duty == kf->duty && f->duration_ms == kf->duration_ms);
+        }
+        else
+            EXPECT(false);
+    }
+    EXPECT(seg == 16);
+    uint32_t wakeups;
+    EXPECT(fader_get_wakeups(fader, 0, &wakeups) == ESP_OK && wakeups == 16);
+
+    // Deleting with keyframes still queued
+    EXPECT(fader_push(fader, 1, &up) == ESP_OK);
+    EXPECT(fader_push(fader, 1, &down) == ESP_OK);
+    for (int i = 0; i < 100 && fake_fades(&fake) < 19; i++)
+        vTaskDelay(1);
+    EXPECT(fader_del(fader) == ESP_OK);
+
+    return failures;
+}
+
+/*
+ * A heartbeat and a sine wave side by side: every segment is one fade to
+ * the duty of its level over its share of the period, the first ones start
+ * at once and each one where the previous one ended
+ */
+static int check_fader_wave(void)
+{
+    int failures = 0;
+    static fader_fake_t fake;
+
+    fader_backend_t backend;
+    EXPECT(fader_fake_init(&fake, &backend) == ESP_OK);
+    fader_config_t config = {
+        .backend = &backend,
+        .task_priority = 5,
+        .task_core = tskNO_AFFINITY,
+    };
+    fader_handle_t fader;
+    EXPECT(fader_new(&config, &fader) == ESP_OK);
+    if (failures)
+        return failures;
+
+    fader_wave_t sine;
+    fader_wave_seg_t sine_segs[8];
+    EXPECT(fader_wave_sine(&sine, sine_segs, 8) == ESP_OK);
+    EXPECT(fader_play_wave(fader, 0, &fader_wave_heartbeat, 0, 8191, 1000) == ESP_OK);
+    EXPECT(fader_play_wave(fader, 1, &sine, 1000, 5000, 800) == ESP_OK);
+    for (int i = 0; i < 100 && fake_fades(&fake) < 2; i++)
+        vTaskDelay(1);
+
+    while (fake.now_ms < 1600)
+        fake_step(&fake, fader, 10);
+    EXPECT(!fader_idle(fader, 0) && !fader_idle(fader, 1));
+
+    // The segments that run finish, no other one starts
+    EXPECT(fader_stop_wave(fader, 0) == ESP_OK && fader_stop_wave(fader, 1) == ESP_OK);
+    for (int i = 0; i < 100 && fader_wait(fader, 1UL << 0 | 1UL << 1, 0) != ESP_OK; i++)
+        fake_step(&fake, fader, 10);
+    EXPECT(fader_wait(fader, 1UL << 0 | 1UL << 1, 0) == ESP_OK);
+
+    // Double beat to full and 3/5 duty, then a rest
+    static const uint32_t beat_duty[] = { 8191, 0, 4914, 0, 0 };
+    static const uint32_t beat_ms[] = { 80, 100, 80, 140, 600 };
+    // Raised cosine from the bottom to the top and back, symmetric up to
+    // the rounding of the table
+    static const uint32_t sine_duty[] = { 1585, 2999, 4414, 5000, 4414, 3000, 1585, 1000 };
+
+    // Ten heartbeat segments start before 1.6 s, seventeen sine segments
+    // by then
+    EXPECT(fake.count == 27);
+    uint32_t n[2] = { 0 }, at[2] = { 0 };
+    for (size_t i = 0; i < fake.count && i < FADER_FAKE_LOG_LEN; i++)
+    {
+        const fader_fake_fade_t *f = &fake.log[i];
+        if (f->channel == 0)
+        {
+            uint32_t seg = n[0]++ % 5;
+            EXPECT(f->at_ms == at[0] && f->duty == beat_duty[seg] && f->duration_ms == beat_ms[seg]);
+            at[0] += beat_ms[seg];
+        }
+        else if (f->channel == 1)
+        {
+            uint32_t seg = n[1]++ % 8;
+            EXPECT(f->at_ms == at[1] && f->duty == sine_duty[seg] && f->duration_ms == 100);
+            at[1] += 100;
+        }
+        else
+            EXPECT(false);
+    }
+    EXPECT(n[0] == 10 && n[1] == 17);
+
+    EXPECT(fader_del(fader) == ESP_OK);
+
+    return failures;
+}
+
+static int check_taskprof(void)
+{
+    int failures = 0;
+
+    static const taskprof_sample_t prev[] = {
+        { .name = "IDLE0", .id = 1, .runtime = 100000, .stack_free = 900, .core = 0 },
+        { .name = "IDLE1", .id = 2, .runtime = 100000, .stack_free = 900, .core = 1 },
+        { .name = "game", .id = 5, .runtime = 4000, .stack_free = 412, .core = 1 },
+        { .name = "keypad", .id = 6, .runtime = 0xfffffff0, .stack_free = 300, .core = -1 },
+    };
+    static const taskprof_sample_t cur[] = {
+        { .name = "IDLE0", .id = 1, .runtime = 108750, .stack_free = 900, .core = 0 },
+        { .name = "IDLE1", .id = 2, .runtime = 100500, .stack_free = 900, .core = 1 },
+        { .name = "keypad", .id = 6, .runtime = 100, .stack_free = 188, .core = -1 },
+        { .name = "game", .id = 5, .runtime = 13500, .stack_free = 412, .core = 1 },
+        { .name = "taskprof", .id = 7, .runtime = 20, .stack_free = 1024, .core = -1 },
+    };
+    const taskprof_limits_t limits = { .stack_free_min = 256, .hog_permille = 900 };
+    taskprof_usage_t usage[5];
+    char line[128];
+
+    // 10000 ticks: game took 95% of core 1, the keypad counter wrapped
+    EXPECT(taskprof_usage(prev, 4, cur, 5, 10000, &limits, usage) == 2);
+    EXPECT(strcmp(usage[0].name, "game") == 0 && usage[0].permille == 950 && usage[0].flags == TASKPROF_FLAG_HOG);
+    EXPECT(strcmp(usage[1].name, "IDLE0") == 0 && usage[1].flags == 0);
+    EXPECT(strcmp(usage[3].name, "keypad") == 0 && usage[3].permille == 11 && usage[3].flags == TASKPROF_FLAG_STACK);
+    EXPECT(strcmp(usage[4].name, "taskprof") == 0 && usage[4].flags == TASKPROF_FLAG_NEW);
+
+    // Flagged tasks are shown past max_tasks
+    taskprof_format(usage, 5, 1, line, sizeof(line));
+    EXPECT(strcmp(line, "5 tasks, 46.2% idle: game/1 95.0% 412B !hog, keypad/- 1.1% 188B !stack") == 0);
+    ESP_LOGI(TAG, "taskprof: %s", line);
+
+    // A line that does not fit keeps whole tasks
+    size_t len = taskprof_format(usage, 5, 5, line, 48);
+    EXPECT(strcmp(line, "5 tasks, 46.2% idle: game/1 95.0% 412B !hog ...") == 0);
+    EXPECT(len == strlen(line));
+
+    return failures;
+}
+
+typedef struct
+{
+    uint32_t hold_ms;
+    uint32_t shown;              // frames flushed
+    uint32_t out_of_order;
+} pipe_check_t;
+
+static esp_err_t render_seq(void *ctx, void *frame, uint32_t seq, uint32_t *hold_ms)
+{
+    pipe_check_t *c = ctx;
+    *(uint32_t *)frame = seq;
+    *hold_ms = c->hold_ms;
+    return ESP_OK;
+}
+
+static esp_err_t output_seq(void *ctx, const void *frame)
+{
+    pipe_check_t *c = ctx;
+    if (*(const uint32_t *)frame != c->shown)
+        c->out_of_order++;
+    __atomic_store_n(&c->shown, c->shown + 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+static int check_framepipe(void)
+{
+    int failures = 0;
+
+    // Counters that run over keep the order
+    framepipe_queue_t q;
+    framepipe_queue_init(&q, 4);
+    q.head = q.tail = UINT32_MAX - 1;
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT(framepipe_queue_acquire(&q) == (int)((UINT32_MAX - 1 + i) & 3));
+        framepipe_queue_publish(&q);
+    }
+    EXPECT(framepipe_queue_acquire(&q) < 0);
+    EXPECT(framepipe_queue_count(&q) == 4);
+    EXPECT(framepipe_queue_peek(&q) == 2);
+    framepipe_queue_release(&q);
+    EXPECT(framepipe_queue_acquire(&q) == 2);
+    for (int i = 0; i < 3; i++)
+        framepipe_queue_release(&q);
+    EXPECT(framepipe_queue_peek(&q) < 0 && framepipe_queue_count(&q) == 0);
+
+    // Frames come out in order, held ones at their cadence
+    static const uint32_t holds[] = { 0, 20 };
+    for (int i = 0; i < 2; i++)
+    {
+        pipe_check_t c = { .hold_ms = holds[i] };
+        framepipe_config_t config = FRAMEPIPE_DEFAULT_CONFIG();
+        config.frame_size = sizeof(uint32_t);
+        config.depth = 4;
+        config.render = render_seq;
+        config.output = output_seq;
+        config.ctx = &c;
+        framepipe_handle_t pipe;
+        esp_err_t err = framepipe_new(&config, &pipe);
+        EXPECT(err == ESP_OK);
+        if (err != ESP_OK)
+            return failures;
+
+        TickType_t start = xTaskGetTickCount();
+        while (__atomic_load_n(&c.shown, __ATOMIC_RELAXED) < 10)
+            vTaskDelay(pdMS_TO_TICKS(10));
+        uint32_t elapsed_ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+
+        framepipe_stats_t stats;
+        framepipe_get_stats(pipe, &stats);
+        EXPECT(framepipe_del(pipe) == ESP_OK);
+        EXPECT(c.out_of_order == 0);
+        EXPECT(stats.errors == 0 && stats.underruns == 0);
+        EXPECT(stats.render.frames >= stats.output.frames);
+        if (holds[i])
+            EXPECT(elapsed_ms >= 9 * holds[i]);
+        ESP_LOGI(TAG, "framepipe: hold %" PRIu32 " ms, %" PRIu32 " frames in %" PRIu32 " ms, %" PRIu32 " stalls, latency %" PRIu32 " us",
+                 holds[i], stats.output.frames, elapsed_ms, stats.stalls, stats.latency_us_max);
+    }
+
+    return failures;
+}
+
+#define STRESS_RING      64      // small, so producers keep running into a full ring
+#define STRESS_SPSC_MSGS 100000
+#define STRESS_PRODUCERS 4
+#define STRESS_MPSC_MSGS 25000   // per producer
+
+static lfring_spsc_t stress_spsc;
+static lfring_mpsc_t stress_mpsc;
+
+static void spsc_producer(void *arg)
+{
+    for (uint32_t msg = 0; msg < STRESS_SPSC_MSGS;)
+    {
+        if (lfring_spsc_push(&stress_spsc, &msg))
+            msg++;
+        else
+            taskYIELD();
+    }
+    vTaskDelete(NULL);
+}
+
+/* Messages carry the producer in the top byte and its sequence number below */
+static void mpsc_producer(void *arg)
+{
+    uint32_t id = (uintptr_t)arg;
+
+    for (uint32_t seq = 0; seq < STRESS_MPSC_MSGS;)
+    {
+        uint32_t msg = id << 24 | seq;
+        if (lfring_mpsc_push(&stress_mpsc, &msg))
+            seq++;
+        else
+            taskYIELD();
+    }
+    vTaskDelete(NULL);
+}
+
+/* Producer tasks against this task as the consumer, at the same priority */
+static int check_lfring_stress(void)
+{
+    int failures = 0;
+    static uint32_t spsc_buf[STRESS_RING];
+    static uint32_t mpsc_buf[LFRING_MPSC_BUF_SIZE(STRESS_RING, sizeof(uint32_t)) / sizeof(uint32_t)];
+    UBaseType_t prio = uxTaskPriorityGet(NULL);
+    TaskHandle_t task;
+    uint32_t msg, lost = 0, repeated = 0;
+
+    EXPECT(lfring_spsc_init(&stress_spsc, spsc_buf, STRESS_RING, sizeof(uint32_t)) == ESP_OK);
+    EXPECT(xTaskCreatePinnedToCore(spsc_producer, "spsc", 2048, NULL, prio, &task, tskNO_AFFINITY) == pdPASS);
+    if (failures)
+        return failures;
+    for (uint32_t next = 0; next < STRESS_SPSC_MSGS; next++)
+    {
+        if (!lfring_spsc_pop_wait(&stress_spsc, &msg, pdMS_TO_TICKS(1000)))
+        {
+            ESP_LOGE(TAG, "lfring: SPSC stalled after %" PRIu32 " messages", next);
+            failures++;
+            break;
+        }
+        lost += msg > next;
+        repeated += msg < next;
+        next = msg;
+    }
+    EXPECT(lost == 0 && repeated == 0);
+    EXPECT(!lfring_spsc_pop_wait(&stress_spsc, &msg, pdMS_TO_TICKS(10)));
+
+    // Each producer's messages arrive in its order, none lost or repeated
+    uint32_t next[STRESS_PRODUCERS] = { 0 };
+    EXPECT(lfring_mpsc_init(&stress_mpsc, mpsc_buf, STRESS_RING, sizeof(uint32_t)) == ESP_OK);
+    for (uintptr_t id = 0; id < STRESS_PRODUCERS; id++)
+        EXPECT(xTaskCreatePinnedToCore(mpsc_producer, "mpsc", 2048, (void *)id, prio, &task, tskNO_AFFINITY) == pdPASS);
+    if (failures)
+        return failures;
+    for (uint32_t n = 0; n < STRESS_PRODUCERS * STRESS_MPSC_MSGS; n++)
+    {
+        if (!lfring_mpsc_pop_wait(&stress_mpsc, &msg, pdMS_TO_TICKS(1000)))
+        {
+            ESP_LOGE(TAG, "lfring: MPSC stalled after %" PRIu32 " messages", n);
+            failures++;
+            break;
+        }
+        uint32_t id = msg >> 24, seq = msg & 0xffffff;
+        if (id >= STRESS_PRODUCERS)
+        {
+            repeated++;
+            continue;
+        }
+        lost += seq > next[id];
+        repeated += seq < next[id];
+        next[id] = seq + 1;
+    }
+    EXPECT(lost == 0 && repeated == 0);
+    EXPECT(!lfring_mpsc_pop_wait(&stress_mpsc, &msg, pdMS_TO_TICKS(10)));
+    ESP_LOGI(TAG, "lfring: %d + %d x %d messages through the SPSC and MPSC rings",
+             STRESS_SPSC_MSGS, STRESS_PRODUCERS, STRESS_MPSC_MSGS);
+
+    return failures;
+}
+
+static int check_lfring(void)
+{
+    int failures = 0;
+
+    // SPSC, with counters that run over
+    static lfring_spsc_t spsc;
+    static uint32_t spsc_buf[4];
+    EXPECT(lfring_spsc_init(&spsc, spsc_buf, 3, sizeof(uint32_t)) == ESP_ERR_INVALID_ARG);
+    EXPECT(lfring_spsc_init(&spsc, spsc_buf, 4, sizeof(uint32_t)) == ESP_OK);
+    spsc.prod.head = spsc.prod.tail_cache = spsc.cons.tail = spsc.cons.head_cache = UINT32_MAX - 1;
+    for (uint32_t round = 0, next = 0; round < 3; round++)
+    {
+        uint32_t msg = next;
+        while (lfring_spsc_push(&spsc, &msg))
+            msg++;
+        EXPECT(msg - next == 4 && lfring_spsc_count(&spsc) == 4);
+        while (lfring_spsc_pop(&spsc, &msg))
+            EXPECT(msg == next++);
+    }
+    uint32_t msg;
+    EXPECT(!lfring_spsc_pop_wait(&spsc, &msg, 0));
+
+    // MPSC with odd sized messages, each slot published by its sequence number
+    typedef struct { uint8_t v[3]; } odd_t;
+    static lfring_mpsc_t mpsc;
+    static uint32_t mpsc_buf[LFRING_MPSC_BUF_SIZE(4, sizeof(odd_t)) / sizeof(uint32_t)];
+    EXPECT(lfring_mpsc_init(&mpsc, mpsc_buf, 4, sizeof(odd_t)) == ESP_OK);
+    EXPECT(mpsc.stride == 8);
+    for (uint8_t round = 0, next = 0; round < 10; round++)
+    {
+        odd_t m = { { next, 0xa5, 0x5a } };
+        while (lfring_mpsc_push(&mpsc, &m))
+            m.v[0]++;
+        EXPECT((uint8_t)(m.v[0] - next) == 4 && lfring_mpsc_count(&mpsc) == 4);
+        while (lfring_mpsc_pop(&mpsc, &m))
+            EXPECT(m.v[0] == next++ && m.v[1] == 0xa5 && m.v[2] == 0x5a);
+    }
+    odd_t m;
+    EXPECT(!lfring_mpsc_pop_wait(&mpsc, &m, 0));
+    EXPECT(lfring_mpsc_count(&mpsc) == 0);
+
+    failures += check_lfring_stress();
+
+    return failures;
+}
+
+#define BLINK_MAX_EDGES 64
+
+// LED edges and pattern ends on the simulated clock of the blink engine
+typedef struct
+{
+    int64_t now;
+    int64_t edges[2][BLINK_MAX_EDGES];   //!< Times in ms, by LED, alternately on and off
+    size_t count[2];
+    int64_t done[2];                     //!< Time in ms, -1 while playing
+} blink_trace_t;
+
+static void on_blink(void *ctx, uint16_t led, bool on)
+{
+    blink_trace_t *t = ctx;
+
+    if (t->count[led] < BLINK_MAX_EDGES)
+        t->edges[led][t->count[led]] = t->now / 1000;
+    t->count[led]++;
+}
+
+static void on_blink_done(void *ctx, uint16_t led)
+{
+    blink_trace_t *t = ctx;
+
+    t->done[led] = t->now / 1000;
+}
+
+static void on_blink_count(void *ctx, uint16_t led, bool on)
+{
+    (*(uint32_t *)ctx)++;
+}
+
+/* What blink_engine_set() does, without the timer */
+static void blink_start(blink_led_t *led, const blink_pattern_t *pattern, int64_t now)
+{
+    led->pattern = pattern;
+    led->run = 0;
+    led->left = pattern->repeat;
+    led->deadline = now;
+}
+
+static bool blink_edges_eq(const blink_trace_t *t, uint16_t led, const int64_t *edges, size_t count)
+{
+    if (t->count[led] != count)
+        return false;
+    for (size_t i = 0; i < count; i++)
+        if (t->edges[led][i] != edges[i])
+            return false;
+
+    return true;
+}
+
+BLINK_STATUS_DEFINE(BLINK_STATUS_23, 2, 3, 1);
+
+static int check_blink(void)
+{
+    int failures = 0;
+
+    // SOS at 150 ms a dot, played twice, and status code 23 played once:
+    // two long flashes, one second, three short ones, three seconds
+    uint16_t morse_runs[BLINK_MORSE_RUNS(3)];
+    blink_pattern_t sos = { morse_runs, 0, 2 };
+    sos.count = blink_morse_encode("SOS", 150, morse_runs, sizeof(morse_runs) / sizeof(morse_runs[0]));
+    EXPECT(sos.count == 18);
+
+    uint16_t status_runs[BLINK_CODE_MAX_RUNS];
+    size_t n = blink_status_encode(23, status_runs, sizeof(status_runs) / sizeof(status_runs[0]));
+    EXPECT(n == BLINK_STATUS_23.count && !memcmp(status_runs, BLINK_STATUS_23.runs, n * sizeof(uint16_t)));
+
+    static const int64_t sos_edges[] = {
+        0, 150, 300, 450, 600, 750,                 // S
+        1200, 1650, 1800, 2250, 2400, 2850,         // O
+        3300, 3450, 3600, 3750, 3900, 4050,         // S, then the word gap
+        5100, 5250, 5400, 5550, 5700, 5850,
+        6300, 6750, 6900, 7350, 7500, 7950,
+        8400, 8550, 8700, 8850, 9000, 9150,
+    };
+    static const int64_t status_edges[] = {
+        0, 600, 900, 1500,                          // tens
+        2500, 2700, 3000, 3200, 3500, 3700,         // units, then the end gap
+    };
+    const size_t sos_count = sizeof(sos_edges) / sizeof(sos_edges[0]);
+    const size_t status_count = sizeof(status_edges) / sizeof(status_edges[0]);
+
+    // Woken at every deadline, as by the timer
+    blink_trace_t t = { .done = { -1, -1 } };
+    blink_led_t leds[2];
+    blink_engine_t engine;
+    EXPECT(blink_engine_init(&engine, leds, 2, on_blink, on_blink_done, &t) == ESP_OK);
+    // Switched off once
+    EXPECT(t.count[0] == 1 && t.count[1] == 1);
+    t.count[0] = t.count[1] = 0;
+    EXPECT(blink_engine_process(&engine, 0) == BLINK_IDLE);
+    blink_start(&leds[0], &sos, 0);
+    blink_start(&leds[1], &BLINK_STATUS_23, 0);
+
+    int wakeups = 0;
+    for (int64_t next = 0; next != BLINK_IDLE && wakeups < 100; wakeups++)
+    {
+        t.now = next;
+        next = blink_engine_process(&engine, t.now);
+        EXPECT(next > t.now);
+    }
+    EXPECT(blink_edges_eq(&t, 0, sos_edges, sos_count));
+    EXPECT(blink_edges_eq(&t, 1, status_edges, status_count));
+    EXPECT(t.done[0] == 10200 && t.done[1] == 6700);
+    EXPECT(!leds[0].pattern && !leds[0].on && !leds[1].pattern && !leds[1].on);
+    // One per edge and pattern end, 0 and 600 ms are shared
+    EXPECT(wakeups == 37 + 11 - 2);
+
+    // Woken late on a 70 ms tick: every edge comes at the first tick after
+    // its time and the late wakeups do not shift the ones that follow
+    memset(&t, 0, sizeof(t));
+    t.done[0] = t.done[1] = -1;
+    blink_start(&leds[0], &sos, 0);
+    for (t.now = 0; t.now < 10300000; t.now += 70000)
+        blink_engine_process(&engine, t.now);
+    EXPECT(t.count[0] == sos_count);
+    for (size_t i = 0; i < t.count[0] && i < sos_count; i++)
+        EXPECT(t.edges[0][i] == (sos_edges[i] + 69) / 70 * 70);
+    EXPECT(t.done[0] == (10200 + 69) / 70 * 70 && t.count[1] == 0);
+
+    // A message of more than 255 runs plays all of them: 50 O are 300 runs,
+    // 14 units each and 4 more for the final word gap
+    static uint16_t long_runs[BLINK_MORSE_RUNS(50)];
+    char long_text[51];
+    memset(long_text, 'O', 50);
+    long_text[50] = 0;
+    blink_pattern_t long_msg = { long_runs, 0, 1 };
+    long_msg.count = blink_morse_encode(long_text, 10, long_runs, sizeof(long_runs) / sizeof(long_runs[0]));
+    EXPECT(long_msg.count == 300);
+    memset(&t, 0, sizeof(t));
+    t.done[0] = t.done[1] = -1;
+    blink_start(&leds[0], &long_msg, 0);
+    for (int64_t next = 0; next != BLINK_IDLE; )
+    {
+        t.now = next;
+        next = blink_engine_process(&engine, t.now);
+    }
+    EXPECT(t.count[0] == 300 && t.done[0] == (50 * 14 + 4) * 10);
+
+    EXPECT(blink_engine_free(&engine) == ESP_OK);
+
+    // On the real timer, with patterns set while 1 ms runs keep re-arming it
+    static const uint16_t fast_runs[] = { 1, 1 };
+    static const blink_pattern_t fast = { fast_runs, 2, BLINK_FOREVER };
+    uint32_t edges = 0, set_failures = 0;
+    EXPECT(blink_engine_init(&engine, leds, 2, on_blink_count, NULL, &edges) == ESP_OK);
+    for (int i = 0; i < 10000; i++)
+    {
+        if (blink_engine_set(&engine, i & 1, &fast) != ESP_OK)
+            set_failures++;
+        if (i % 100 == 0)
+            vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+    EXPECT(blink_engine_set(&engine, 0, NULL) == ESP_OK && blink_engine_set(&engine, 1, NULL) == ESP_OK);
+    EXPECT(blink_engine_free(&engine) == ESP_OK);
+    EXPECT(set_failures == 0 && edges > 2);
+
+    return failures;
+}
+
+#define RTC_SIZE 256
+
+typedef struct
+{
+    rtclog_ring_t ring;
+    uint8_t data[RTC_SIZE];
+} rtc_image_t;
+
+// Recovered records, checked against the text they were appended with
+typedef struct
+{
+    uint32_t first;
+    uint32_t next;
+    size_t count;
+    bool bad;
+} rtc_walk_t;
+
+/* Text of record `seq`, 9 to 40 bytes */
+static size_t rtc_text(uint32_t seq, char *buf)
+{
+    return sprintf(buf, "line %04" PRIu32 " %.*s", seq, (int)(seq * 7 % 32), "................................");
+}
+
+static void on_rtc_record(uint32_t seq, const char *text, size_t len, void *ctx)
+{
+    rtc_walk_t *w = ctx;
+    char expected[48];
+
+    if (!w->count)
+        w->first = seq;
+    else if (seq != w->next)
+        w->bad = true;
+    if (len != rtc_text(seq, expected) || memcmp(text, expected, len))
+        w->bad = true;
+    w->next = seq + 1;
+    w->count++;
+}
+
+static rtc_walk_t rtc_walk(const rtclog_ring_t *ring)
+{
+    rtc_walk_t w = { 0 };
+    char buf[RTC_SIZE / 4];
+
+    rtclog_ring_recover(ring, buf, sizeof(buf), on_rtc_record, &w);
+
+    return w;
+}
+
+// State copy written last, the one with the higher generation
+static const rtclog_state_t *rtc_current(const rtclog_ring_t *ring)
+{
+    return (int32_t)(ring->state[1].gen - ring->state[0].gen) > 0 ? &ring->state[1] : &ring->state[0];
+}
+
+static void rtc_append(rtclog_ring_t *ring, uint32_t seq)
+{
+    char text[48];
+
+    rtclog_ring_append(ring, text, rtc_text(seq, text));
+}
+
+static int check_rtclog(void)
+{
+    int failures = 0;
+    static rtc_image_t img, before, after, torn;
+
+    // Random power-on contents are not taken for a ring
+    uint32_t x = 0x12345678;
+    for (size_t i = 0; i < sizeof(img); i++)
+    {
+        x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+        ((uint8_t *)&img)[i] = x;
+    }
+    EXPECT(!rtclog_ring_valid(&img.ring, RTC_SIZE));
+    img.ring.magic = RTCLOG_RING_MAGIC;
+    img.ring.size = RTC_SIZE;
+    EXPECT(!rtclog_ring_valid(&img.ring, RTC_SIZE));
+
+    rtclog_ring_init(&img.ring, RTC_SIZE, 100);
+    EXPECT(rtclog_ring_valid(&img.ring, RTC_SIZE) && !rtclog_ring_valid(&img.ring, RTC_SIZE * 2));
+    EXPECT(rtclog_ring_seq(&img.ring) == 100 && rtc_walk(&img.ring).count == 0);
+
+    // Many times around the data area: the newest records survive, in
+    // order, and fill it but for less than a record
+    for (uint32_t seq = 100; seq < 200; seq++)
+        rtc_append(&img.ring, seq);
+    rtc_walk_t w = rtc_walk(&img.ring);
+    EXPECT(!w.bad && w.next == 200 && rtclog_ring_seq(&img.ring) == 200);
+    size_t used = 0;
+    for (uint32_t seq = w.first; seq < w.next; seq++)
+    {
+        char text[48];
+        used += sizeof(rtclog_rec_t) + rtc_text(seq, text);
+    }
+    EXPECT(used <= RTC_SIZE && used + sizeof(rtclog_rec_t) + 40 > RTC_SIZE);
+
+    // Long texts are cut to a quarter of the data area
+    rtclog_ring_t *ring = &img.ring;
+    char text[RTC_SIZE];
+    memset(text, 'x', sizeof(text));
+    EXPECT(rtclog_ring_append(ring, text, sizeof(text)) == RTC_SIZE / 4);
+    rtclog_ring_init(ring, RTC_SIZE, 0);
+
+    // A reset after any byte of an append that drops records and wraps:
+    // the ring is still valid and holds either the records before the
+    // append or those after it, all intact
+    for (uint32_t seq = 0; seq < 37; seq++)
+        rtc_append(ring, seq);
+    before = img;
+    rtc_walk_t old = rtc_walk(ring);
+    rtc_append(ring, 37);
+    after = img;
+    rtc_walk_t new = rtc_walk(ring);
+    EXPECT(!old.bad && !new.bad && new.first > old.first && new.next == 38);
+
+    // Bytes in the order the append writes them: the state copy that moves
+    // the tail, the record from the old head on, the one that moves the head
+    const rtclog_state_t *last = rtc_current(&after.ring);
+    const rtclog_state_t *first = last == &after.ring.state[0] ? &after.ring.state[1] : &after.ring.state[0];
+    EXPECT(last->gen == first->gen + 1 && first->head == rtc_current(&before.ring)->head);
+    EXPECT(first->tail == last->tail && first->tail != rtc_current(&before.ring)->tail);
+    EXPECT(last->head - first->head <= RTC_SIZE / 4 + sizeof(rtclog_rec_t));
+    if (failures)
+        return failures;
+    size_t order[sizeof(rtc_image_t)];
+    size_t n = 0;
+    for (size_t i = 0; i < sizeof(rtclog_state_t); i++)
+        order[n++] = (const uint8_t *)first - (const uint8_t *)&after + i;
+    uint32_t head = first->head;
+    for (uint32_t i = 0; i < last->head - head; i++)
+        order[n++] = offsetof(rtc_image_t, data) + ((head + i) & (RTC_SIZE - 1));
+    for (size_t i = 0; i < sizeof(rtclog_state_t); i++)
+        order[n++] = (const uint8_t *)last - (const uint8_t *)&after + i;
+
+    int torn_bad = 0, torn_old = 0, torn_new = 0;
+    for (size_t k = 0; k <= n; k++)
+    {
+        torn = before;
+        for (size_t i = 0; i < k; i++)
+            ((uint8_t *)&torn)[order[i]] = ((const uint8_t *)&after)[order[i]];
+        if (!rtclog_ring_valid(&torn.ring, RTC_SIZE))
+        {
+            torn_bad++;
+            continue;
+        }
+        w = rtc_walk(&torn.ring);
+        if (w.bad || (w.next != old.next && w.next != new.next) || w.first < old.first)
+            torn_bad++;
+        else if (w.next == new.next)
+            torn_new++;
+        else
+            torn_old++;
+    }
+    EXPECT(!memcmp(&torn, &after, sizeof(torn)));
+    EXPECT(torn_bad == 0 && torn_old > 0 && torn_new > 0);
+
+    // A corrupt record ends the recovery before it
+    torn = after;
+    uint32_t pos = last->tail;
+    for (uint32_t seq = new.first; seq < new.first + 2; seq++)
+        pos += sizeof(rtclog_rec_t) + rtc_text(seq, text);
+    torn.data[(pos + sizeof(rtclog_rec_t) + 2) & (RTC_SIZE - 1)] ^= 0x20;
+    w = rtc_walk(&torn.ring);
+    EXPECT(rtclog_ring_valid(&torn.ring, RTC_SIZE) && !w.bad && w.first == new.first && w.count == 2);
+
+    return failures;
+}
+
+/* Capture the arguments as asynclog does, render them, and compare with vsnprintf() */
+static bool __attribute__((format(printf, 2, 3))) log_renders(size_t max, const char *fmt, ...)
+{
+    uint8_t args[ASYNCLOG_MAX_RECORD];
+    char line[ASYNCLOG_MAX_LINE], expected[ASYNCLOG_MAX_LINE];
+    bool truncated;
+    va_list ap, copy;
+
+    va_start(ap, fmt);
+    va_copy(copy, ap);
+    size_t len = asynclog_capture(fmt, ap, args, max, &truncated);
+    vsnprintf(expected, sizeof(expected), fmt, copy);
+    va_end(copy);
+    va_end(ap);
+
+    size_t n = asynclog_render(fmt, args, len, false, line, sizeof(line));
+    if (truncated || n != strlen(expected) || strcmp(line, expected))
+    {
+        ESP_LOGE(TAG, "\"%s\" rendered as \"%s\"", expected, line);
+        return false;
+    }
+
+    return true;
+}
+
+/* Capture into `max` bytes, returns the rendered line. Not checked as printf, it is given NULL strings */
+static const char *log_render(size_t max, bool *truncated, const char *fmt, ...)
+{
+    static char line[ASYNCLOG_MAX_LINE];
+    uint8_t args[ASYNCLOG_MAX_RECORD];
+    va_list ap;
+
+    va_start(ap, fmt);
+    size_t len = asynclog_capture(fmt, ap, args, max, truncated);
+    va_end(ap);
+    asynclog_render(fmt, args, len, false, line, sizeof(line));
+
+    return line;
+}
+
+static int check_asynclog(void)
+{
+    int failures = 0;
+    const size_t max = ASYNCLOG_MAX_RECORD;
+    bool truncated;
+
+    EXPECT(log_renders(max, "no conversions"));
+    EXPECT(log_renders(max, "%d %u %x %X %o %c %hhd %hu", -7, 4000000000u, 0xbeef, 0xbeef, 8, 'q', (char)-1, (unsigned short)65535));
+    EXPECT(log_renders(max, "[%*d] [%-*d] [%.*f] [%*.*s]", 6, 42, 6, 42, 2, 3.14159, 8, 3, "abcdef"));
+    EXPECT(log_renders(max, "100%% of %d%%, %%d %s", 5, "done"));
+    EXPECT(log_renders(max, "%" PRId64 " %" PRIu64 " %" PRIx64 " %lld", INT64_MIN, UINT64_MAX, (uint64_t)0x123456789abcdef0ULL, -1LL));
+    EXPECT(log_renders(max, "%zu %ld %lu %jd", (size_t)SIZE_MAX, LONG_MIN, ULONG_MAX, (intmax_t)-3));
+    EXPECT(log_renders(max, "%f %.3f %e %g %G %a", 1.5, -2.0 / 3, 6.02e23, 1e-10, 1e20, 0.75));
+    EXPECT(log_renders(max, "%p %s|%-8s|%8s|", (void *)&failures, "", "left", "right"));
+    EXPECT(log_renders(max, "%" PRIu32 " ms %s: %s", (uint32_t)1234, "host", "mixed"));
+
+    // NULL strings are captured as "(null)", as newlib prints them
+    EXPECT(!strcmp(log_render(max, &truncated, "<%s>", (const char *)NULL), "<(null)>") && !truncated);
+
+    // Strings are copied up to ASYNCLOG_MAX_STRING - 1 bytes
+    char longer[ASYNCLOG_MAX_STRING + 8];
+    memset(longer, 's', sizeof(longer) - 1);
+    longer[sizeof(longer) - 1] = 0;
+    const char *line = log_render(max, &truncated, "%s|", longer);
+    EXPECT(strlen(line) == ASYNCLOG_MAX_STRING - 1 + 1 && line[ASYNCLOG_MAX_STRING - 1] == '|' && !truncated);
+
+    // Arguments that do not fit are dropped, their conversions are shown as such
+    line = log_render(2 * sizeof(int) + 1, &truncated, "%d %d %s %d", 1, 2, "three", 4);
+    EXPECT(truncated && !strcmp(line, "1 2 %s %d"));
+    line = log_render(3, &truncated, "%d", 1);
+    EXPECT(truncated && !strcmp(line, "%d"));
+    line = log_render(4, &truncated, "<%s>", "abc");
+    EXPECT(!truncated && !strcmp(line, "<abc>"));
+    line = log_render(3, &truncated, "<%s>", "abc");
+    EXPECT(truncated && !strcmp(line, "<%s>"));
+    line = log_render(max, &truncated, "%lld %.*f", 1LL << 40, 3, 1.0);
+    EXPECT(!truncated && !strcmp(line, "1099511627776 1.000"));
+    line = log_render(8 + 4, &truncated, "%lld %.*f", 1LL << 40, 3, 1.0);
+    EXPECT(truncated && !strcmp(line, "1099511627776 %.*f"));
+
+    // Lines are cut to the output buffer
+    uint8_t args[ASYNCLOG_MAX_RECORD];
+    char small[8];
+    int v = 123456789;
+    memcpy(args, &v, sizeof(v));
+    EXPECT(asynclog_render("v=%d!", args, sizeof(v), false, small, sizeof(small)) == 7 && !strcmp(small, "v=12345"));
+    EXPECT(asynclog_render("abc", args, 0, false, small, 0) == 0);
+
+    return failures;
+}
+
+// Console output of the asynclog task, frames and text
+static struct
+{
+    uint8_t buf[1024];
+    size_t len;
+} s_console;
+
+static int capture_console(const char *fmt, va_list args)
+{
+    char out[ASYNCLOG_MAX_LINE + 8];
+    int len = vsnprintf(out, sizeof(out), fmt, args);
+
+    if (len > 0 && s_console.len + len <= sizeof(s_console.buf))
+    {
+        memcpy(s_console.buf + s_console.len, out, len);
+        s_console.len += len;
+    }
+
+    return len;
+}
+
+static uint8_t frame_crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int b = 0; b < 8; b++)
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+
+    return crc;
+}
+
+/* Returns the length of the decoded frame, 0 if it is not valid COBS */
+static size_t cobs_decode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < len;)
+    {
+        uint8_t code = in[i];
+        if (!code || i + code > len)
+            return 0;
+        memcpy(out + n, in + i + 1, code - 1);
+        n += code - 1;
+        i += code;
+        if (code < 0xff && i < len)
+            out[n++] = 0;
+    }
+
+    return n;
+}
+
+/* Next run of bytes between zero bytes, NULL past the end */
+static const char *next_chunk(size_t *at, size_t *len)
+{
+    while (*at < s_console.len && !s_console.buf[*at])
+        (*at)++;
+    if (*at == s_console.len)
+        return NULL;
+
+    const char *chunk = (const char *)s_console.buf + *at;
+    *len = strnlen(chunk, s_console.len - *at);
+    *at += *len;
+
+    return chunk;
+}
+
+/* Words of a frame, 0 if the chunk is not one */
+static size_t frame_words(const char *chunk, size_t len, asynclog_word_t *words, size_t max)
+{
+    uint8_t raw[sizeof(s_console.buf)];
+
+    size_t n = cobs_decode((const uint8_t *)chunk, len, raw);
+    if (n < sizeof(asynclog_word_t) + 1 || (n - 1) % sizeof(asynclog_word_t) || frame_crc8(raw, n - 1) != raw[n - 1])
+        return 0;
+    size_t count = (n - 1) / sizeof(asynclog_word_t);
+    memcpy(words, raw, (count < max ? count : max) * sizeof(asynclog_word_t));
+
+    return count;
+}
+
+static int check_asynclog_frames(void)
+{
+    int failures = 0;
+    static const char ok[] = "ok";
+
+    // Installed between the console and the capture, and taken out again
+    vprintf_like_t console = esp_log_set_vprintf(capture_console);
+    asynclog_config_t config = ASYNCLOG_DEFAULT_CONFIG();
+    config.binary = true;
+    esp_err_t installed = asynclog_install(&config);
+    if (installed == ESP_OK)
+    {
+        ESP_LOGI(TAG, "text %d", 1);
+        ASYNCLOG_LOGI(TAG, "frame %d of %u, %s %.2f", -5, 256u, ok, 2.5);
+        ASYNCLOG_LOGW(TAG, "no arguments");
+        ESP_LOGI(TAG, "text %d", 2);
+        installed = asynclog_flush(pdMS_TO_TICKS(1000));
+    }
+    esp_log_set_vprintf(console);
+    EXPECT(installed == ESP_OK);
+    if (failures)
+        return failures;
+
+    // Text, two frames delimited by zero bytes, text
+    asynclog_word_t words[ASYNCLOG_MAX_ARGS + 3];
+    const size_t max = sizeof(words) / sizeof(words[0]);
+    size_t at = 0, len = 0;
+    const char *chunk = next_chunk(&at, &len);
+    EXPECT(chunk && !frame_words(chunk, len, words, max) && len > 13 && !memcmp(chunk + len - 13, "host: text 1\n", 13));
+
+    chunk = next_chunk(&at, &len);
+    EXPECT(chunk && chunk[-1] == 0 && chunk[len] == 0 && frame_words(chunk, len, words, max) == 7);
+    if (failures)
+        return failures;
+    EXPECT(!strcmp((const char *)words[0], LOG_FORMAT(I, "frame %d of %u, %s %.2f")));
+    EXPECT(words[2] == (asynclog_word_t)TAG && words[3] == (asynclog_word_t)-5 && words[4] == 256);
+    EXPECT(words[5] == (asynclog_word_t)ok && words[6] == asynclog_float_word(2.5f));
+    char line[ASYNCLOG_MAX_LINE], expected[ASYNCLOG_MAX_LINE];
+    asynclog_render((const char *)words[0], (const uint8_t *)&words[1], 6 * sizeof(asynclog_word_t), true, line, sizeof(line));
+    snprintf(expected, sizeof(expected), LOG_FORMAT(I, "frame %d of %u, %s %.2f"), (uint32_t)words[1], TAG, -5, 256u, ok, 2.5);
+    EXPECT(!strcmp(line, expected));
+
+    chunk = next_chunk(&at, &len);
+    EXPECT(chunk && frame_words(chunk, len, words, max) == 3);
+    if (failures)
+        return failures;
+    EXPECT(!strcmp((const char *)words[0], LOG_FORMAT(W, "no arguments")) && words[2] == (asynclog_word_t)TAG);
+
+    chunk = next_chunk(&at, &len);
+    EXPECT(chunk && !frame_words(chunk, len, words, max) && len > 13 && !memcmp(chunk + len - 13, "host: text 2\n", 13));
+    EXPECT(!next_chunk(&at, &len));
+
+    asynclog_stats_t stats;
+    EXPECT(asynclog_get_stats(&stats) == ESP_OK && stats.dropped == 0 && stats.bytes == s_console.len);
+
+    return failures;
+}
+
+void app_main(void)
+{
+    int failures = 0;
+
+    failures += check_max7219();
+    failures += check_max7219emu();
+    failures += check_keyarray();
+    failures += check_keysim();
+    failures += check_ws2812b();
+    failures += check_ws2812b_fx();
+    failures += check_fader();
+    failures += check_fader_fake();
+    failures += check_fader_wave();
+    failures += check_taskprof();
+    failures += check_framepipe();
+    failures += check_lfring();
+    failures += check_blink();
+    failures += check_rtclog();
+    failures += check_asynclog();
+    failures += check_asynclog_frames();
+
+    if (failures)
+        ESP_LOGE(TAG, "%d checks failed", failures);
+    else
+        ESP_LOGI(TAG, "All checks passed");
+    fflush(stdout);
+    exit(failures ? 1 : 0);
+}
@@ -20,6 +20,19 @@
 
 #define KEY_NOT_PRESSED       -1     
 
+/**
+ * @brief RAM of the driver, a constant expression.
+ * Pins and key values stay in the caller's arrays, the driver keeps
+ * pointers to them and allocates nothing. With menuconfig it also holds
+ * the arrays keypad_setup_config() passes.
+ */
+#ifdef CONFIG_KEYARRAY_ROWS
+#define KEYARRAY_STATIC_RAM_SIZE (2 * sizeof(int) + 2 * sizeof(int *) + sizeof(char *) + \
+                                  (CONFIG_KEYARRAY_ROWS + CONFIG_KEYARRAY_COLS) * sizeof(int) + sizeof(CONFIG_KEYARRAY_KEYS))
+#else
+#define KEYARRAY_STATIC_RAM_SIZE (2 * sizeof(int) + 2 * sizeof(int *) + sizeof(char *))
+#endif
+
 /*---------------------------------------------------------------*/
 /**
  * @brief Set up the row and column dimensions, pins, and key values.
@@ -35,6 +48,14 @@ void keypad_setup(int rowCount, int columnCount,
                   char *buttonValues);
 
 
+/*---------------------------------------------------------------*/
+
+/**
+ * @brief Set up the keypad from menuconfig, Component config -> Key array.
+ * Pins and key values are compile-time constants, checked when building.
+ */
+void keypad_setup_config(void);
+
 /*---------------------------------------------------------------*/
 
 /**
@@ -5,9 +5,18 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
+#include "keyarray.h"
 
 static const char *TAG = "Keypad";
 
+#ifdef CONFIG_KEYARRAY_DEBOUNCE_MS
+#define DEBOUNCE_MS CONFIG_KEYARRAY_DEBOUNCE_MS
+#define RELEASE_MS  CONFIG_KEYARRAY_RELEASE_MS
+#else
+#define DEBOUNCE_MS 50
+#define RELEASE_MS  200
+#endif
+
 static int rows;      
 static int cols;      
 static int *rowIo;    
@@ -59,6 +68,49 @@ void keypad_setup(int rowCount, int columnCount, int *rowPinCons, int *columnPin
     return;
 }
 
+#ifdef CONFIG_KEYARRAY_ROWS
+
+_Static_assert(sizeof(CONFIG_KEYARRAY_KEYS) - 1 == CONFIG_KEYARRAY_ROWS * CONFIG_KEYARRAY_COLS,
+               "CONFIG_KEYARRAY_KEYS needs one character per key");
+
+static int configRowIo[CONFIG_KEYARRAY_ROWS] = {
+    CONFIG_KEYARRAY_ROW0_GPIO,
+#if CONFIG_KEYARRAY_ROWS > 1
+    CONFIG_KEYARRAY_ROW1_GPIO,
+#endif
+#if CONFIG_KEYARRAY_ROWS > 2
+    CONFIG_KEYARRAY_ROW2_GPIO,
+#endif
+#if CONFIG_KEYARRAY_ROWS > 3
+    CONFIG_KEYARRAY_ROW3_GPIO,
+#endif
+};
+
+static int configColIo[CONFIG_KEYARRAY_COLS] = {
+    CONFIG_KEYARRAY_COL0_GPIO,
+#if CONFIG_KEYARRAY_COLS > 1
+    CONFIG_KEYARRAY_COL1_GPIO,
+#endif
+#if CONFIG_KEYARRAY_COLS > 2
+    CONFIG_KEYARRAY_COL2_GPIO,
+#endif
+#if CONFIG_KEYARRAY_COLS > 3
+    CONFIG_KEYARRAY_COL3_GPIO,
+#endif
+};
+
+static char configBtnVals[] = CONFIG_KEYARRAY_KEYS;
+
+_Static_assert(KEYARRAY_STATIC_RAM_SIZE == sizeof(rows) + sizeof(cols) + sizeof(rowIo) + sizeof(colIo) + sizeof(btnVals) +
+               sizeof(configRowIo) + sizeof(configColIo) + sizeof(configBtnVals), "KEYARRAY_STATIC_RAM_SIZE is out of date");
+
+void keypad_setup_config(void)
+{
+    keypad_setup(CONFIG_KEYARRAY_ROWS, CONFIG_KEYARRAY_COLS, configRowIo, configColIo, configBtnVals);
+}
+
+#endif
+
 char scanForSingleKeyOnce(char KeyToReturnWhenNOKeyPressed)
 {
     for (int i = 0; i < rows; i++)
@@ -73,7 +125,7 @@ char scanForSingleKeyOnce(char KeyToReturnWhenNOKeyPressed)
             if (gpio_get_level(colIo[j]))
             {
                 // Debounce delay
-                vTaskDelay(50 / portTICK_PERIOD_MS);
+                vTaskDelay(pdMS_TO_TICKS(DEBOUNCE_MS));
                 if (gpio_get_level(colIo[j])) // Check again to confirm the key press
                 {
                     ESP_LOGI(TAG, "Key in row %d and col %d Pressed: %c", i, j, btnVals[(i * cols) + j]);
@@ -81,7 +133,7 @@ char scanForSingleKeyOnce(char KeyToReturnWhenNOKeyPressed)
                     {
                         gpio_set_level(rowIo[k], 0);
                     }
-                    vTaskDelay(200 / portTICK_PERIOD_MS);
+                    vTaskDelay(pdMS_TO_TICKS(RELEASE_MS));
                     return btnVals[(i * cols) + j];
                 }
             }
@@ -6,18 +6,18 @@
 #include "freertos/task.h"
 #include "driver/gpio.h"
 #include "keyarray.h"
+#include "asynclog.h"
 
 static const char *TAG = "Main";
 
 void app_main(void)
 {
-    int rows1[4] = {4,27, 26, 25}; 
-    int cols1[4] = { 33,32,18,19}; 
-    char values[16] = { '1', '2', '3', '/', 
-                      '4', '5', '6', '*',
-                      '7', '8', '9', '-',
-                      '.', '0', '^', '+' };
-    keypad_setup(4, 4, rows1, cols1, values);
+    // Keep the key scan and setup logging off the UART
+    asynclog_config_t log_config = ASYNCLOG_DEFAULT_CONFIG();
+    ESP_ERROR_CHECK(asynclog_install(&log_config));
+
+    // Pins and key values are set in menuconfig, Component config -> Key array
+    keypad_setup_config();
     while (1)
     {
         TickType_t ticks = pdMS_TO_TICKS(10000);
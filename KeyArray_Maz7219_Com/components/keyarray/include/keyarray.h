@@ -20,6 +20,13 @@
 
 #define KEY_NOT_PRESSED       -1     
 
+/**
+ * @brief RAM of the driver, a constant expression.
+ * Pins and key values stay in the caller's arrays, the driver keeps
+ * pointers to them and allocates nothing.
+ */
+#define KEYARRAY_STATIC_RAM_SIZE (2 * sizeof(int) + 3 * sizeof(int *))
+
 /*---------------------------------------------------------------*/
 /**
  * @brief Set up the row and column dimensions, pins, and key values.
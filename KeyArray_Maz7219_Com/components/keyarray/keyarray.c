@@ -5,6 +5,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
+#include "keyarray.h"
 
 static const char *TAG = "Keypad";
 
@@ -14,6 +15,9 @@ static int *rowIo;
 static int *colIo;    
 static int *btnVals;   
 
+_Static_assert(KEYARRAY_STATIC_RAM_SIZE == sizeof(rows) + sizeof(cols) + sizeof(rowIo) + sizeof(colIo) + sizeof(btnVals),
+               "KEYARRAY_STATIC_RAM_SIZE is out of date");
+
 /* --------------------------------------------------------*/
 
 void keypad_setup(int rowCount, int columnCount, int *rowPinCons, int *columnPinCons, int *buttonValues)
@@ -56,6 +56,7 @@ extern "C" {
 
 #define MAX7219_MAX_CASCADE_SIZE 8
 #define MAX7219_MAX_BRIGHTNESS   15
+#define MAX7219_SCROLL_MAX_CHARS 16 //!< Longest string of a scroller
 
 /**
  * Display descriptor
@@ -70,6 +71,24 @@ typedef struct
     bool bcd;
 } max7219_t;
 
+/**
+ * RAM of a display, a constant expression. All state is in the caller's
+ * descriptor and the driver allocates nothing, drawing takes a few words of
+ * stack; only the SPI master driver allocates its device in
+ * max7219_init_desc().
+ */
+#define MAX7219_STATIC_RAM_SIZE (sizeof(max7219_t))
+
+/**
+ * String scrolled one step at a time, see max7219_scroll_init()
+ */
+typedef struct
+{
+    uint64_t images[MAX7219_SCROLL_MAX_CHARS]; //!< Glyphs of the string
+    size_t steps;                //!< Steps of one pass, 0 if it fits the display
+    size_t offs;                 //!< Next step
+} max7219_scroll_t;
+
 /**
  * @brief Initialize device descriptor
  *
@@ -184,6 +203,30 @@ esp_err_t max7219_draw_char_8x8(max7219_t *dev, uint8_t pos, char c);
  * @return `ESP_OK` on success
  */
 esp_err_t max7219_draw_string_8x8(max7219_t *dev,char s[]);
+
+/**
+ * @brief Prepare a string for scrolling without blocking
+ *
+ * Scrolls like max7219_draw_string_8x8(), one row of the 8x8 matrices
+ * per step, the caller paces the steps.
+ *
+ * @param dev Display descriptor
+ * @param scroll Scroller
+ * @param s String, up to `MAX7219_SCROLL_MAX_CHARS` characters
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219_scroll_init(max7219_t *dev, max7219_scroll_t *scroll, const char *s);
+
+/**
+ * @brief Draw the next step of a scroller
+ *
+ * @param dev Display descriptor
+ * @param scroll Scroller
+ * @param[out] done true after the last step of a pass, the next step
+ *                  starts the string again
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219_scroll_step(max7219_t *dev, max7219_scroll_t *scroll, bool *done);
 #ifdef __cplusplus
 }
 #endif
@@ -464,30 +464,57 @@ esp_err_t max7219_draw_char_8x8(max7219_t *dev, uint8_t pos, char c)
     return max7219_draw_image_8x8(dev,pos,get_char_imageMap(c));
 }
 
+// Glyph of a character of the string, blank past its end
+static uint64_t string_glyph(const char *s, size_t length, size_t c)
+{
+    return c < length ? *get_char_imageMap(s[c]) : 0;
+}
+
 esp_err_t max7219_draw_string_8x8(max7219_t *dev,char s[])
 {
     CHECK_ARG(dev && s);
-    int length = strlen(s);
-    uint64_t images[length];
-    uint64_t *value;
-    for (int i = 0; i < length; i++) {
-         value = get_char_imageMap(s[i]);
-         images[i] = (uint64_t)*value;
-    }
-    size_t offs = 0;
-    size_t symbols_size = sizeof(images) - sizeof(uint64_t) * dev->cascade_size;
-    for (uint8_t j=0; j< (length*8); j++)
+    size_t length = strlen(s);
+    size_t steps = length > dev->cascade_size ? (length - dev->cascade_size) * 8 : 1;
+    for (size_t offs = 0; offs < steps; offs++)
     {
-        for (uint8_t i=0; i< dev->cascade_size; i++)
-        {
-            max7219_draw_image_8x8(dev,i*8,(uint8_t *)images + i*8 + offs);
-        } 
-        vTaskDelay(pdMS_TO_TICKS(100));
-        if (++offs == symbols_size)
+        // The rows of a chip span two glyphs, read them in place instead
+        // of copying the whole string to the stack
+        for (uint8_t i = 0; i < dev->cascade_size; i++)
         {
-            offs = 0;
-            break;
+            size_t c = i + offs / 8;
+            uint64_t glyphs[2] = { string_glyph(s, length, c), string_glyph(s, length, c + 1) };
+            CHECK(max7219_draw_image_8x8(dev, i * 8, (uint8_t *)glyphs + offs % 8));
         }
+        vTaskDelay(pdMS_TO_TICKS(100));
     }
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+esp_err_t max7219_scroll_init(max7219_t *dev, max7219_scroll_t *scroll, const char *s)
+{
+    CHECK_ARG(dev && scroll && s);
+
+    size_t length = strlen(s);
+    CHECK_ARG(length <= MAX7219_SCROLL_MAX_CHARS);
+
+    memset(scroll, 0, sizeof(max7219_scroll_t));
+    for (size_t i = 0; i < length; i++)
+        scroll->images[i] = *get_char_imageMap(s[i]);
+    scroll->steps = length > dev->cascade_size ? (length - dev->cascade_size) * 8 : 0;
+
+    return ESP_OK;
+}
+
+esp_err_t max7219_scroll_step(max7219_t *dev, max7219_scroll_t *scroll, bool *done)
+{
+    CHECK_ARG(dev && scroll && done);
+
+    for (uint8_t i = 0; i < dev->cascade_size && i < MAX7219_SCROLL_MAX_CHARS; i++)
+        CHECK(max7219_draw_image_8x8(dev, i * 8, (uint8_t *)scroll->images + i * 8 + scroll->offs));
+
+    *done = ++scroll->offs >= scroll->steps;
+    if (*done)
+        scroll->offs = 0;
+
+    return ESP_OK;
+}
@@ -1,32 +1,94 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
 #include "keyarray.h"
 #include "max7219.h"
-#include "freertos/queue.h"
 #include "esp_random.h"
+#include "taskprof.h"
+#include "lfring.h"
 
 static const char *TAG = "Main";
 #define HOST    SPI2_HOST
-#define APP_CPU_NUM PRO_CPU_NUM
 
 #define CASCADE_SIZE 1
 #define MOSI_PIN 23
 #define CS_PIN 5
 #define CLK_PIN 21
-QueueHandle_t queue;
-QueueHandle_t queue1;
-max7219_t dev = {
+
+#define NO_KEY           '?'
+#define SCAN_PERIOD_MS   10
+#define EVENT_QUEUE_LEN  4       // power of two
+#define GAME_STACK       3072
+#define KEYPAD_STACK     2048
+
+#define SCROLL_STEP_MS   100     // as max7219_draw_string_8x8()
+#define SCROLL_PAUSE_MS  600     // between passes of the question
+#define FEEDBACK_MS      1000
+#define LEVEL_MS         800
+#define ROUNDS_PER_LEVEL 5
+#define START_TIME_MS    15000
+#define MIN_TIME_MS      3000
+
+static const uint64_t okay_image = 0x4020180c06060c00;
+static const uint64_t timeout_image = 0x1e2125a5eda1211e;
+
+/*
+ * The keypad task posts a key event, the game task owns the display and
+ * waits for events or for its next display step, whichever comes first.
+ * Events go through a lock-free ring, the game task is only notified when
+ * it sleeps.
+ */
+typedef struct
+{
+    char key;
+    int64_t scan_us;             // start of the scan that found the key
+} key_event_t;
+
+typedef enum
+{
+    GAME_QUESTION = 0,           // scrolling the question, waiting for the answer
+    GAME_FEEDBACK,               // showing the result of the round
+    GAME_LEVEL,                  // showing the new level
+    GAME_LEVEL_SCROLL,           // scrolling "<<<" once
+} game_state_t;
+
+typedef struct
+{
+    game_state_t state;
+    max7219_scroll_t scroll;
+    char question[5];
+    int result;
+    int round;
+    int counter;                 // right answers in a row
+    int level;
+    int time_ms;                 // time to answer
+    TickType_t step_at;          // next display step
+    TickType_t deadline;         // end of the question
+    int64_t question_us;         // question shown
+} game_t;
+
+static lfring_spsc_t events;
+static key_event_t event_buf[EVENT_QUEUE_LEN];
+
+// Both tasks live in .bss
+static StackType_t game_stack[GAME_STACK];
+static StaticTask_t game_tcb;
+static StackType_t keypad_stack[KEYPAD_STACK];
+static StaticTask_t keypad_tcb;
+
+static max7219_t dev = {
     .cascade_size = CASCADE_SIZE,
     .digits = 0,
     .mirrored = true
 };
 
-spi_bus_config_t cfg = {
+static spi_bus_config_t cfg = {
     .mosi_io_num = MOSI_PIN,
     .miso_io_num = -1,
     .sclk_io_num = CLK_PIN,
@@ -35,121 +97,193 @@ spi_bus_config_t cfg = {
     .max_transfer_sz = 0,
     .flags = 0
 };
-const int *rows1[4] = {4,27, 26, 25}; 
-const int *cols1[4] = { 33,32,18,19}; 
-const int *values[16] = {'1', '2', '3', '/', '4', '5', '6', '*', '7', '8', '9', '-', '.', '0', '^', '+'};
-int time=15000;
-void setUP() {
+static int rows1[4] = { 4, 27, 26, 25 };
+static int cols1[4] = { 33, 32, 18, 19 };
+static int values[16] = { '1', '2', '3', '/', '4', '5', '6', '*', '7', '8', '9', '-', '.', '0', '^', '+' };
+
+static void setUP(void)
+{
     ESP_ERROR_CHECK(spi_bus_initialize(HOST, &cfg, 1));
     ESP_ERROR_CHECK(max7219_init_desc(&dev, HOST, MAX7219_MAX_CLOCK_SPEED_HZ, CS_PIN));
     ESP_ERROR_CHECK(max7219_init(&dev));
     keypad_setup(4, 4, rows1, cols1, values);
 }
-char digit_to_char(int digit) {
-    return digit + '0';
+
+// Ticks are compared through their difference, so the counter may wrap
+static bool reached(TickType_t now, TickType_t at)
+{
+    return (int32_t)(now - at) >= 0;
 }
 
-void Task1(void *pvParameters) {
-    int counter = 0 ;
-    int level = 0;
-    while (1) {
-        char message = '?';
-        char myString[] = "1+1?";
-        int num1 = esp_random() % 5;
-        int num2 = esp_random() % 5;
-        int operator = esp_random() % 2;
-        int res;
-        if (operator !=0)
-        {
-            myString[1] = '-';
-            if(num1 < num2){
-                int temp = num2;
-                num2 = num1;
-                num1 = temp;
-            }
-            res = num1-num2;
-        }
-        else
-        {
-            myString[1] = '+';
-            res = num1+num2;
-        } 
-        myString[0] =  num1 + '0';
-        myString[2] =  num2 + '0';
-        uint64_t okay_image = 0x4020180c06060c00;
-        uint64_t okay_timeout = 0x1e2125a5eda1211e;
-        if (xQueueSend(queue, &message, portMAX_DELAY) != pdPASS) {
-            printf("Failed to send to queue\n");
-        }
-        while(xQueueReceive(queue1, &message, 0) != pdPASS)
+static void new_round(game_t *g, TickType_t now)
+{
+    int num1 = esp_random() % 5;
+    int num2 = esp_random() % 5;
+    char op = '+';
+
+    if (esp_random() % 2)
+    {
+        op = '-';
+        if (num1 < num2)
         {
-            max7219_draw_string_8x8(&dev, myString);
-            vTaskDelay(pdMS_TO_TICKS(600));
-        }
-        printf("task 1 Received: %c\n", message);
-        
-        if (res == message - '0'){
-            counter++;
-            max7219_draw_image_8x8(&dev,0,&okay_image);
+            int temp = num2;
+            num2 = num1;
+            num1 = temp;
         }
+        g->result = num1 - num2;
+    }
+    else
+        g->result = num1 + num2;
+    snprintf(g->question, sizeof(g->question), "%d%c%d?", num1, op, num2);
+
+    ESP_ERROR_CHECK(max7219_scroll_init(&dev, &g->scroll, g->question));
+    g->state = GAME_QUESTION;
+    g->round++;
+    g->step_at = now;
+    g->deadline = now + pdMS_TO_TICKS(g->time_ms);
+    g->question_us = esp_timer_get_time();
+}
+
+// Draws the result of a round, key is NO_KEY on timeout
+static void answer(game_t *g, char key, TickType_t now)
+{
+    bool right = key != NO_KEY && key - '0' == g->result;
+
+    if (right)
+    {
+        g->counter++;
+        max7219_draw_image_8x8(&dev, 0, &okay_image);
+    }
+    else
+    {
+        g->counter = 0;
+        if (key == NO_KEY)
+            max7219_draw_image_8x8(&dev, 0, &timeout_image);
         else
-        {
-            counter=0;
-            if ('?'==message)
-                max7219_draw_image_8x8(&dev,0,&okay_timeout);
-            else
-                max7219_draw_char_8x8(&dev, 0,'*');
-        }
-            
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        if (counter ==5)
-        {
-            counter =0;
-            max7219_draw_char_8x8(&dev, 0,level + '0');
-            time = time - (1000 + (50*level));
-            level++;
-            vTaskDelay(pdMS_TO_TICKS(400));
-            max7219_draw_string_8x8(&dev, "<<<");
-            max7219_draw_char_8x8(&dev, 0,level + '0');
-            vTaskDelay(pdMS_TO_TICKS(400));
-            max7219_draw_string_8x8(&dev, "<<<");
-        }
+            max7219_draw_char_8x8(&dev, 0, '*');
     }
+    g->state = GAME_FEEDBACK;
+    g->step_at = now + pdMS_TO_TICKS(FEEDBACK_MS);
 }
 
-void Task2(void *pvParameters) {
-    char message;
-    while (1) {
-        if (xQueueReceive(queue, &message, portMAX_DELAY) == pdPASS) {
-            printf("task 2 Received: %c\n", message);
-            if (message == '?') {
-                TickType_t ticks = pdMS_TO_TICKS(time);
-                char keyPressed = scanForSingleKeyWithTimeOut(message, ticks);
-                message = keyPressed;
-                if (xQueueSend(queue1, &message, portMAX_DELAY) != pdPASS) {
-                    printf("Failed to send to queue\n");
-                }
-                printf("task 2 Sent: %c\n", message);
+static void on_key(game_t *g, const key_event_t *ev)
+{
+    if (g->state != GAME_QUESTION)
+    {
+        ESP_LOGD(TAG, "Key %c ignored", ev->key);
+        return;
+    }
+
+    answer(g, ev->key, xTaskGetTickCount());
+
+    // From the scan that found the key to the feedback on the display
+    int64_t drawn_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Round %d: %s %c %s, answered in %" PRId64 " ms, key to feedback %" PRId64 " us",
+             g->round, g->question, ev->key, g->counter ? "right" : "wrong",
+             (ev->scan_us - g->question_us) / 1000, drawn_us - ev->scan_us);
+}
+
+static void on_step(game_t *g, TickType_t now)
+{
+    bool done;
+
+    switch (g->state)
+    {
+        case GAME_QUESTION:
+            if (reached(now, g->deadline))
+            {
+                ESP_LOGI(TAG, "Round %d: %s timed out after %d ms", g->round, g->question, g->time_ms);
+                answer(g, NO_KEY, now);
+                break;
             }
-        }
-        vTaskDelay(pdMS_TO_TICKS(100));
+            ESP_ERROR_CHECK(max7219_scroll_step(&dev, &g->scroll, &done));
+            g->step_at = now + pdMS_TO_TICKS(done ? SCROLL_PAUSE_MS : SCROLL_STEP_MS);
+            break;
+        case GAME_FEEDBACK:
+            if (g->counter < ROUNDS_PER_LEVEL)
+            {
+                new_round(g, now);
+                break;
+            }
+            g->counter = 0;
+            g->time_ms -= 1000 + 50 * g->level;
+            if (g->time_ms < MIN_TIME_MS)
+                g->time_ms = MIN_TIME_MS;
+            g->level++;
+            ESP_LOGI(TAG, "Level %d, %d ms per question", g->level, g->time_ms);
+            max7219_draw_char_8x8(&dev, 0, g->level % 10 + '0');
+            g->state = GAME_LEVEL;
+            g->step_at = now + pdMS_TO_TICKS(LEVEL_MS);
+            break;
+        case GAME_LEVEL:
+            ESP_ERROR_CHECK(max7219_scroll_init(&dev, &g->scroll, "<<<"));
+            g->state = GAME_LEVEL_SCROLL;
+            g->step_at = now;
+            break;
+        case GAME_LEVEL_SCROLL:
+            ESP_ERROR_CHECK(max7219_scroll_step(&dev, &g->scroll, &done));
+            if (done)
+                new_round(g, now);
+            else
+                g->step_at = now + pdMS_TO_TICKS(SCROLL_STEP_MS);
+            break;
     }
 }
 
+static void game_task(void *pvParameters)
+{
+    static game_t game = { .time_ms = START_TIME_MS };
+    game_t *g = &game;
 
-void app_main() {
-    queue = xQueueCreate(10, sizeof(char *));
-    if (queue == NULL) {
-        printf("Failed to create queue\n");
-        return;
+    new_round(g, xTaskGetTickCount());
+    while (1)
+    {
+        TickType_t now = xTaskGetTickCount();
+        TickType_t next = g->step_at;
+        if (g->state == GAME_QUESTION && (int32_t)(g->deadline - next) < 0)
+            next = g->deadline;
+        TickType_t wait = reached(now, next) ? 0 : next - now;
+
+        key_event_t ev;
+        if (lfring_spsc_pop_wait(&events, &ev, wait))
+            on_key(g, &ev);
+        else
+            on_step(g, xTaskGetTickCount());
     }
-    queue1 = xQueueCreate(10, sizeof(char *));
-    if (queue1 == NULL) {
-        printf("Failed to create queue\n");
-        return;
+}
+
+static void keypad_task(void *pvParameters)
+{
+    while (1)
+    {
+        // A found key returns after the debounce and release delays of the driver
+        int64_t start = esp_timer_get_time();
+        char key = scanForSingleKeyOnce(NO_KEY);
+        if (key != NO_KEY)
+        {
+            key_event_t ev = { .key = key, .scan_us = start };
+            if (!lfring_spsc_push(&events, &ev))
+                ESP_LOGW(TAG, "Key %c dropped", key);
+        }
+        vTaskDelay(pdMS_TO_TICKS(SCAN_PERIOD_MS));
     }
+}
+
+void app_main(void)
+{
+    ESP_ERROR_CHECK(lfring_spsc_init(&events, event_buf, EVENT_QUEUE_LEN, sizeof(key_event_t)));
     setUP();
-    xTaskCreate(Task1, "Task1", 2048, NULL, 1, NULL);
-    xTaskCreate(Task2, "Task2", 2048, NULL, 1, NULL);
+    xTaskCreateStatic(game_task, "game", GAME_STACK, NULL, 2, game_stack, &game_tcb);
+    xTaskCreateStatic(keypad_task, "keypad", KEYPAD_STACK, NULL, 1, keypad_stack, &keypad_tcb);
+    ESP_LOGI(TAG, "Static RAM: display %d, keypad %d, game %d bytes",
+             (int)(MAX7219_STATIC_RAM_SIZE + sizeof(cfg)),
+             (int)(KEYARRAY_STATIC_RAM_SIZE + sizeof(rows1) + sizeof(cols1) + sizeof(values) +
+                   sizeof(keypad_stack) + sizeof(keypad_tcb)),
+             (int)(sizeof(game_t) + sizeof(events) + sizeof(event_buf) + sizeof(game_stack) + sizeof(game_tcb)));
 
+    // CPU share and stack headroom of the game and keypad tasks
+    taskprof_config_t prof = TASKPROF_DEFAULT_CONFIG();
+    prof.period_ms = 10000;
+    if (taskprof_start(&prof) != ESP_OK)
+        ESP_LOGW(TAG, "Task profiler not started");
 }
@@ -47,6 +47,7 @@
 #include <driver/spi_master.h>
 #include <driver/gpio.h> // add by nopnop2002
 #include <esp_err.h>
+#include <sdkconfig.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -54,8 +55,17 @@ extern "C" {
 
 #define MAX7219_MAX_CLOCK_SPEED_HZ (10000000) // 10 MHz
 
+#ifdef CONFIG_MAX7219_CASCADE_SIZE
+#define MAX7219_MAX_CASCADE_SIZE CONFIG_MAX7219_CASCADE_SIZE //!< Longest cascade of this build, see menuconfig
+#else
 #define MAX7219_MAX_CASCADE_SIZE 8
+#endif
 #define MAX7219_MAX_BRIGHTNESS   15
+#define MAX7219_SCROLL_MAX_CHARS 16 //!< Longest string of a scroller
+
+#define MAX7219_NUM_ZEROS (1 << 0) //!< Fill the field with leading zeros instead of blanks
+#define MAX7219_NUM_DP    (1 << 1) //!< Light the decimal point of the last digit of the field
+#define MAX7219_NUM_DEFER (1 << 2) //!< Only update the framebuffer, send it with max7219_flush()
 
 /**
  * Display descriptor
@@ -68,8 +78,58 @@ typedef struct
     uint8_t cascade_size;        //!< Up to `MAX7219_MAX_CASCADE_SIZE` MAX721xx cascaded
     bool mirrored;               //!< true for horizontally mirrored displays
     bool bcd;
+    uint8_t fb[8][MAX7219_MAX_CASCADE_SIZE]; //!< Digit registers by digit and chip, see max7219_flush()
+    uint8_t dirty;               //!< Digits of `fb` not sent yet, one bit each
+#ifdef CONFIG_MAX7219_FIXED_CASCADE
+    spi_transaction_t trans;     //!< Transaction prepared by max7219_init_desc()
+    uint16_t tx[MAX7219_MAX_CASCADE_SIZE] __attribute__((aligned(4))); //!< Its buffer, used beyond two chips
+#endif
 } max7219_t;
 
+/**
+ * RAM of a display, a constant expression. All state is in the caller's
+ * descriptor and the driver allocates nothing, drawing takes a few words of
+ * stack; only the SPI master driver allocates its device in
+ * max7219_init_desc().
+ */
+#define MAX7219_STATIC_RAM_SIZE (sizeof(max7219_t))
+
+/**
+ * String scrolled one step at a time, see max7219_scroll_init()
+ */
+typedef struct
+{
+    uint64_t images[MAX7219_SCROLL_MAX_CHARS]; //!< Glyphs of the string
+    size_t steps;                //!< Steps of one pass, 0 if it fits the display
+    size_t offs;                 //!< Next step
+} max7219_scroll_t;
+
+#ifdef CONFIG_MAX7219_CASCADE_SIZE
+
+#ifdef CONFIG_MAX7219_SPI3_HOST
+#define MAX7219_CONFIG_HOST SPI3_HOST
+#else
+#define MAX7219_CONFIG_HOST SPI2_HOST
+#endif
+
+#ifdef CONFIG_MAX7219_MIRRORED
+#define MAX7219_CONFIG_MIRRORED true
+#else
+#define MAX7219_CONFIG_MIRRORED false
+#endif
+
+/**
+ * Device descriptor as set in menuconfig, pins and clock are
+ * `CONFIG_MAX7219_*`
+ */
+#define MAX7219_CONFIG_DEFAULT() { \
+    .cascade_size = CONFIG_MAX7219_CASCADE_SIZE, \
+    .digits = 0, \
+    .mirrored = MAX7219_CONFIG_MIRRORED, \
+}
+
+#endif
+
 /**
  * @brief Initialize device descriptor
  *
@@ -148,6 +208,8 @@ esp_err_t max7219_clear(max7219_t *dev);
 /**
  * @brief Draw text on 7-segment display
  *
+ * Written to the framebuffer and sent as max7219_flush() does.
+ *
  * @param dev Display descriptor
  * @param pos Start digit
  * @param s Text
@@ -155,6 +217,70 @@ esp_err_t max7219_clear(max7219_t *dev);
  */
 esp_err_t max7219_draw_text_7seg(max7219_t *dev, uint8_t pos, const char *s);
 
+/**
+ * @brief Draw an integer on 7-segment display
+ *
+ * Right aligned in the field of `width` digits from `pos`, the minus sign
+ * next to the first digit. Digits are written to the framebuffer and sent
+ * with one transaction per changed digit register of the cascade, see
+ * max7219_flush(). With BCD decode mode the digits are sent as Code B
+ * without a font lookup.
+ *
+ * @param dev Display descriptor
+ * @param pos Start digit
+ * @param width Digits of the field
+ * @param value Number
+ * @param flags `MAX7219_NUM_*`
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_SIZE` if the number does not
+ *         fit, the field shows dashes then
+ */
+esp_err_t max7219_draw_int_7seg(max7219_t *dev, uint8_t pos, uint8_t width, int32_t value, uint8_t flags);
+
+/**
+ * @brief Draw a fixed-point number on 7-segment display
+ *
+ * As max7219_draw_int_7seg(), `value` counts in units of the last decimal,
+ * e.g. 1234 with 2 decimals is drawn as 12.34 and 5 as 0.05.
+ *
+ * @param dev Display descriptor
+ * @param pos Start digit
+ * @param width Digits of the field
+ * @param value Number, scaled by 10^decimals
+ * @param decimals Digits after the decimal point, less than `width`
+ * @param flags `MAX7219_NUM_*`
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_SIZE` if the number does not
+ *         fit, the field shows dashes then
+ */
+esp_err_t max7219_draw_fixed_7seg(max7219_t *dev, uint8_t pos, uint8_t width, int32_t value, uint8_t decimals,
+                                  uint8_t flags);
+
+/**
+ * @brief Draw a hexadecimal number on 7-segment display
+ *
+ * As max7219_draw_int_7seg(), needs normal decode mode as Code B has no
+ * A..F.
+ *
+ * @param dev Display descriptor
+ * @param pos Start digit
+ * @param width Digits of the field
+ * @param value Number
+ * @param flags `MAX7219_NUM_*`
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_SIZE` if the number does not
+ *         fit, `ESP_ERR_NOT_SUPPORTED` in BCD decode mode
+ */
+esp_err_t max7219_draw_hex_7seg(max7219_t *dev, uint8_t pos, uint8_t width, uint32_t value, uint8_t flags);
+
+/**
+ * @brief Send the digits changed in the framebuffer
+ *
+ * A digit register of every chip goes in one transaction, so a flush takes
+ * at most 8 transactions for any cascade size.
+ *
+ * @param dev Display descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219_flush(max7219_t *dev);
+
 /**
  * @brief Draw 64-bit image on 8x8 matrix
  *
@@ -184,6 +310,30 @@ esp_err_t max7219_draw_char_8x8(max7219_t *dev, uint8_t pos, char c);
  * @return `ESP_OK` on success
  */
 esp_err_t max7219_draw_string_8x8(max7219_t *dev,char s[]);
+
+/**
+ * @brief Prepare a string for scrolling without blocking
+ *
+ * Scrolls like max7219_draw_string_8x8(), one row of the 8x8 matrices
+ * per step, the caller paces the steps.
+ *
+ * @param dev Display descriptor
+ * @param scroll Scroller
+ * @param s String, up to `MAX7219_SCROLL_MAX_CHARS` characters
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219_scroll_init(max7219_t *dev, max7219_scroll_t *scroll, const char *s);
+
+/**
+ * @brief Draw the next step of a scroller
+ *
+ * @param dev Display descriptor
+ * @param scroll Scroller
+ * @param[out] done true after the last step of a pass, the next step
+ *                  starts the string again
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219_scroll_step(max7219_t *dev, max7219_scroll_t *scroll, bool *done);
 #ifdef __cplusplus
 }
 #endif
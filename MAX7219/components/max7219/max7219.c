@@ -40,11 +40,21 @@
 #include "max7219.h"
 #include <string.h>
 #include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#ifdef CONFIG_MAX7219_LOG_CEILING
+#define TAGLOG_CEILING CONFIG_MAX7219_LOG_CEILING
+#endif
+#include <taglog.h>
 
 #include "max7219_priv.h"
 
 static const char *TAG = "max7219";
 
+// Per-digit tracing, compiled in up to CONFIG_MAX7219_LOG_CEILING
+TAGLOG_DEFINE(trace, "max7219");
+
 #define ALL_CHIPS 0xff
 #define ALL_DIGITS 8
 
@@ -66,6 +76,71 @@ static inline uint16_t shuffle(uint16_t val)
     return (val >> 8) | (val << 8);
 }
 
+#ifdef CONFIG_MAX7219_FIXED_CASCADE
+
+#define CASCADE CONFIG_MAX7219_CASCADE_SIZE
+
+/*
+ * Every word of the cascade is written once, a no-op for the other chips,
+ * so the buffer needs no clearing. The loop has a constant count, the
+ * compiler decides on unrolling it.
+ */
+static inline void pack_fixed(uint16_t *buf, uint8_t chip, uint16_t value)
+{
+    uint16_t v = shuffle(value);
+
+    for (uint8_t i = 0; i < CASCADE; i++)
+        buf[i] = (chip == ALL_CHIPS || chip == i) ? v : 0;
+}
+
+static void prepare(max7219_t *dev)
+{
+    memset(&dev->trans, 0, sizeof(dev->trans));
+    dev->trans.length = CASCADE * 16;
+#if CASCADE <= 2
+    dev->trans.flags = SPI_TRANS_USE_TXDATA;
+#endif
+}
+
+// A few microseconds on the bus, polling is cheaper than waiting for the ISR
+static esp_err_t send(max7219_t *dev, uint8_t chip, uint16_t value)
+{
+#if CASCADE <= 2
+    uint16_t buf[CASCADE];
+    pack_fixed(buf, chip, value);
+    memcpy(dev->trans.tx_data, buf, sizeof(buf));
+#else
+    pack_fixed(dev->tx, chip, value);
+    dev->trans.tx_buffer = dev->tx;
+#endif
+
+    return spi_device_polling_transmit(dev->spi_dev, &dev->trans);
+}
+
+static inline void pack_row(uint16_t *buf, uint16_t reg, const uint8_t *vals)
+{
+    for (uint8_t i = 0; i < CASCADE; i++)
+        buf[i] = shuffle(reg | vals[i]);
+}
+
+// One digit register of every chip from the framebuffer
+static esp_err_t send_row(max7219_t *dev, uint8_t digit)
+{
+    uint16_t reg = REG_DIGIT_0 + ((uint16_t)digit << 8);
+#if CASCADE <= 2
+    uint16_t buf[CASCADE];
+    pack_row(buf, reg, dev->fb[digit]);
+    memcpy(dev->trans.tx_data, buf, sizeof(buf));
+#else
+    pack_row(dev->tx, reg, dev->fb[digit]);
+    dev->trans.tx_buffer = dev->tx;
+#endif
+
+    return spi_device_polling_transmit(dev->spi_dev, &dev->trans);
+}
+
+#else
+
 static esp_err_t send(max7219_t *dev, uint8_t chip, uint16_t value)
 {
     uint16_t buf[MAX7219_MAX_CASCADE_SIZE] = { 0 };
@@ -83,6 +158,22 @@ static esp_err_t send(max7219_t *dev, uint8_t chip, uint16_t value)
     return spi_device_transmit(dev->spi_dev, &t);
 }
 
+static esp_err_t send_row(max7219_t *dev, uint8_t digit)
+{
+    uint16_t reg = REG_DIGIT_0 + ((uint16_t)digit << 8);
+    uint16_t buf[MAX7219_MAX_CASCADE_SIZE];
+    for (uint8_t i = 0; i < dev->cascade_size; i++)
+        buf[i] = shuffle(reg | dev->fb[digit][i]);
+
+    spi_transaction_t t;
+    memset(&t, 0, sizeof(t));
+    t.length = dev->cascade_size * 16;
+    t.tx_buffer = buf;
+    return spi_device_transmit(dev->spi_dev, &t);
+}
+
+#endif
+
 
 inline static uint8_t get_char(max7219_t *dev, char c)
 {
@@ -113,6 +204,85 @@ inline static uint8_t get_char(max7219_t *dev, char c)
     return font_7seg[(c - 0x20) & 0x7f];
 }
 
+// Framebuffer register of a display digit, as max7219_set_digit() maps it
+static inline void put_digit(max7219_t *dev, uint8_t pos, uint8_t val)
+{
+    uint8_t digit = dev->mirrored ? dev->digits - pos - 1 : pos;
+    uint8_t *reg = &dev->fb[digit % ALL_DIGITS][digit / ALL_DIGITS];
+    if (*reg == val)
+        return;
+    *reg = val;
+    dev->dirty |= 1 << (digit % ALL_DIGITS);
+}
+
+#define NUM_MAX_DIGITS 10        // of a 32 bit number
+
+/*
+ * Decimal digits, least significant first. The quotient by 10 is a multiply
+ * by its reciprocal, exact for all 32 bit values, so builds for size do not
+ * call the division of libgcc for every digit.
+ */
+static uint8_t to_decimal(uint32_t v, uint8_t *digits)
+{
+    uint8_t n = 0;
+    do
+    {
+        uint32_t q = (uint32_t)(((uint64_t)v * 0xcccccccdu) >> 35);
+        digits[n++] = v - q * 10;
+        v = q;
+    } while (v);
+
+    return n;
+}
+
+/*
+ * Right aligned field of n digits, least significant first, `point` of them
+ * after the decimal point. Only the framebuffer changes, the caller flushes.
+ */
+static esp_err_t put_number(max7219_t *dev, uint8_t pos, uint8_t width, const uint8_t *digits, uint8_t n,
+                            bool negative, uint8_t point, uint8_t flags)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    // At least one digit before the point, zeros fill the whole field
+    uint8_t shown = n > point ? n : point + 1;
+    if ((flags & MAX7219_NUM_ZEROS) && shown < width - negative)
+        shown = width - negative;
+    if (shown + negative > width)
+    {
+        for (uint8_t i = 0; i < width; i++)
+            put_digit(dev, pos + i, get_char(dev, '-'));
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    for (uint8_t i = 0; i < width; i++)
+    {
+        uint8_t val;
+        if (i < shown)
+        {
+            uint8_t d = i < n ? digits[i] : 0;
+            val = dev->bcd ? d : font_7seg[hex[d] - 0x20];
+            if ((point && i == point) || (!i && (flags & MAX7219_NUM_DP)))
+                val |= 0x80;
+        }
+        else
+            val = get_char(dev, i == shown && negative ? '-' : ' ');
+        put_digit(dev, pos + width - 1 - i, val);
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t draw_number(max7219_t *dev, uint8_t pos, uint8_t width, const uint8_t *digits, uint8_t n,
+                             bool negative, uint8_t point, uint8_t flags)
+{
+    esp_err_t res = put_number(dev, pos, width, digits, n, negative, point, flags);
+    if (!(flags & MAX7219_NUM_DEFER))
+        CHECK(max7219_flush(dev));
+
+    return res;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 esp_err_t max7219_init_desc(max7219_t *dev, spi_host_device_t host, uint32_t clock_speed_hz, gpio_num_t cs_pin)
@@ -125,6 +295,9 @@ esp_err_t max7219_init_desc(max7219_t *dev, spi_host_device_t host, uint32_t clo
     dev->spi_cfg.mode = 0;
     dev->spi_cfg.queue_size = 1;
     dev->spi_cfg.flags = SPI_DEVICE_NO_DUMMY;
+#ifdef CONFIG_MAX7219_FIXED_CASCADE
+    prepare(dev);
+#endif
 
     return spi_bus_add_device(host, &dev->spi_cfg, &dev->spi_dev);
 }
@@ -144,6 +317,13 @@ esp_err_t max7219_init(max7219_t *dev)
         ESP_LOGE(TAG, "Invalid cascade size %d", dev->cascade_size);
         return ESP_ERR_INVALID_ARG;
     }
+#ifdef CONFIG_MAX7219_FIXED_CASCADE
+    if (dev->cascade_size != CASCADE)
+    {
+        ESP_LOGE(TAG, "Cascade size %d, this build drives %d chips only", dev->cascade_size, CASCADE);
+        return ESP_ERR_INVALID_ARG;
+    }
+#endif
 
     uint8_t max_digits = dev->cascade_size * ALL_DIGITS;
     if (dev->digits > max_digits)
@@ -215,8 +395,9 @@ esp_err_t max7219_set_digit(max7219_t *dev, uint8_t digit, uint8_t val)
     uint8_t c = digit / ALL_DIGITS;
     uint8_t d = digit % ALL_DIGITS;
 
-    ESP_LOGV(TAG, "Chip %d, digit %d val 0x%02x", c, d, val);
+    TAGLOG_LOGV(&trace, "Chip %d, digit %d val 0x%02x", c, d, val);
 
+    dev->fb[d][c] = val;
     CHECK(send(dev, c, (REG_DIGIT_0 + ((uint16_t)d << 8)) | val));
 
     return ESP_OK;
@@ -227,6 +408,8 @@ esp_err_t max7219_clear(max7219_t *dev)
     CHECK_ARG(dev);
 
     uint8_t val = dev->bcd ? VAL_CLEAR_BCD : VAL_CLEAR_NORMAL;
+    memset(dev->fb, val, sizeof(dev->fb));
+    dev->dirty = 0;
     for (uint8_t i = 0; i < ALL_DIGITS; i++)
         CHECK(send(dev, ALL_CHIPS, (REG_DIGIT_0 + ((uint16_t)i << 8)) | val));
 
@@ -237,7 +420,7 @@ esp_err_t max7219_draw_text_7seg(max7219_t *dev, uint8_t pos, const char *s)
 {
     CHECK_ARG(dev && s);
 
-    while (s && pos < dev->digits)
+    while (*s && pos < dev->digits)
     {
         uint8_t c = get_char(dev, *s);
         if (*(s + 1) == '.')
@@ -245,11 +428,61 @@ esp_err_t max7219_draw_text_7seg(max7219_t *dev, uint8_t pos, const char *s)
             c |= 0x80;
             s++;
         }
-        CHECK(max7219_set_digit(dev, pos, c));
+        put_digit(dev, pos, c);
         pos++;
         s++;
     }
 
+    return max7219_flush(dev);
+}
+
+esp_err_t max7219_draw_int_7seg(max7219_t *dev, uint8_t pos, uint8_t width, int32_t value, uint8_t flags)
+{
+    return max7219_draw_fixed_7seg(dev, pos, width, value, 0, flags);
+}
+
+esp_err_t max7219_draw_fixed_7seg(max7219_t *dev, uint8_t pos, uint8_t width, int32_t value, uint8_t decimals,
+                                  uint8_t flags)
+{
+    // The field needs a digit in front of the point
+    CHECK_ARG(dev && width && pos + width <= dev->digits && decimals < width);
+
+    uint8_t digits[NUM_MAX_DIGITS];
+    uint32_t mag = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    uint8_t n = to_decimal(mag, digits);
+
+    return draw_number(dev, pos, width, digits, n, value < 0, decimals, flags);
+}
+
+esp_err_t max7219_draw_hex_7seg(max7219_t *dev, uint8_t pos, uint8_t width, uint32_t value, uint8_t flags)
+{
+    CHECK_ARG(dev && width && pos + width <= dev->digits);
+    if (dev->bcd)
+        return ESP_ERR_NOT_SUPPORTED;
+
+    uint8_t digits[8];
+    uint8_t n = 0;
+    do
+    {
+        digits[n++] = value & 0x0f;
+        value >>= 4;
+    } while (value);
+
+    return draw_number(dev, pos, width, digits, n, false, 0, flags);
+}
+
+esp_err_t max7219_flush(max7219_t *dev)
+{
+    CHECK_ARG(dev);
+
+    for (uint8_t i = 0; i < ALL_DIGITS; i++)
+    {
+        if (!(dev->dirty & (1 << i)))
+            continue;
+        CHECK(send_row(dev, i));
+        dev->dirty &= ~(1 << i);
+    }
+
     return ESP_OK;
 }
 
@@ -464,30 +697,57 @@ esp_err_t max7219_draw_char_8x8(max7219_t *dev, uint8_t pos, char c)
     return max7219_draw_image_8x8(dev,pos,get_char_imageMap(c));
 }
 
+// Glyph of a character of the string, blank past its end
+static uint64_t string_glyph(const char *s, size_t length, size_t c)
+{
+    return c < length ? *get_char_imageMap(s[c]) : 0;
+}
+
 esp_err_t max7219_draw_string_8x8(max7219_t *dev,char s[])
 {
     CHECK_ARG(dev && s);
-    int length = strlen(s);
-    uint64_t images[length];
-    uint64_t *value;
-    for (int i = 0; i < length; i++) {
-         value = get_char_imageMap(s[i]);
-         images[i] = (uint64_t)*value;
-    }
-    size_t offs = 0;
-    size_t symbols_size = sizeof(images) - sizeof(uint64_t) * dev->cascade_size;
-    for (uint8_t j=0; j< (length*8); j++)
+    size_t length = strlen(s);
+    size_t steps = length > dev->cascade_size ? (length - dev->cascade_size) * 8 : 1;
+    for (size_t offs = 0; offs < steps; offs++)
     {
-        for (uint8_t i=0; i< dev->cascade_size; i++)
-        {
-            max7219_draw_image_8x8(dev,i*8,(uint8_t *)images + i*8 + offs);
-        } 
-        vTaskDelay(pdMS_TO_TICKS(100));
-        if (++offs == symbols_size)
+        // The rows of a chip span two glyphs, read them in place instead
+        // of copying the whole string to the stack
+        for (uint8_t i = 0; i < dev->cascade_size; i++)
         {
-            offs = 0;
-            break;
+            size_t c = i + offs / 8;
+            uint64_t glyphs[2] = { string_glyph(s, length, c), string_glyph(s, length, c + 1) };
+            CHECK(max7219_draw_image_8x8(dev, i * 8, (uint8_t *)glyphs + offs % 8));
         }
+        vTaskDelay(pdMS_TO_TICKS(100));
     }
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+esp_err_t max7219_scroll_init(max7219_t *dev, max7219_scroll_t *scroll, const char *s)
+{
+    CHECK_ARG(dev && scroll && s);
+
+    size_t length = strlen(s);
+    CHECK_ARG(length <= MAX7219_SCROLL_MAX_CHARS);
+
+    memset(scroll, 0, sizeof(max7219_scroll_t));
+    for (size_t i = 0; i < length; i++)
+        scroll->images[i] = *get_char_imageMap(s[i]);
+    scroll->steps = length > dev->cascade_size ? (length - dev->cascade_size) * 8 : 0;
+
+    return ESP_OK;
+}
+
+esp_err_t max7219_scroll_step(max7219_t *dev, max7219_scroll_t *scroll, bool *done)
+{
+    CHECK_ARG(dev && scroll && done);
+
+    for (uint8_t i = 0; i < dev->cascade_size && i < MAX7219_SCROLL_MAX_CHARS; i++)
+        CHECK(max7219_draw_image_8x8(dev, i * 8, (uint8_t *)scroll->images + i * 8 + scroll->offs));
+
+    *done = ++scroll->offs >= scroll->steps;
+    if (*done)
+        scroll->offs = 0;
+
+    return ESP_OK;
+}
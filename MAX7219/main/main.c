@@ -1,103 +1,105 @@
 #include <stdio.h>
+#include <inttypes.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <esp_idf_version.h>
 #include <max7219.h>
+#include <ledanim.h>
+#include <ledanim_map.h>
+#include <esp_log.h>
+#include <framepipe.h>
 
-#ifndef APP_CPU_NUM
-    #define APP_CPU_NUM PRO_CPU_NUM
-#endif
-
-#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(4, 0, 0)
-    #define HOST    HSPI_HOST
-#else
-    #define HOST    SPI2_HOST
-#endif
-
-#define CASCADE_SIZE 1
-#define MOSI_PIN 23
-#define CS_PIN 5
-#define CLK_PIN 18
-
-const uint64_t IMAGES[] = {
-  0x0000000000000001,
-  0x0000000000000002,
-  0x0000000000000004,
-  0x0000000000000008,
-  0x0000000000000010,
-  0x0000000000000020,
-  0x0000000000000040,
-  0x0000000000000080,
-  0x0000000000008000,
-  0x0000000000004000,
-  0x0000000000002000,
-  0x0000000000001000,
-  0x0000000000000800,
-  0x0000000000000400,
-  0x0000000000000200,
-  0x0000000000000100,
-  0x0000000000010000,
-  0x0000000000020000,
-  0x0000000000040000,
-  0x0000000000080000,
-  0x0000000000100000,
-  0x0000000000200000,
-  0x0000000000400000,
-  0x0000000000800000,
-  0x0000000080000000,
-  0x0000000040000000,
-  0x0000000020000000,
-  0x0000000010000000,
-  0x0000000008000000,
-  0x0000000004000000,
-  0x0000000002000000,
-  0x0000000001000000,
-  0x0000000100000000,
-  0x0000000200000000,
-  0x0000000400000000,
-  0x0000000800000000,
-  0x0000001000000000,
-  0x0000002000000000,
-  0x0000004000000000,
-  0x0000008000000000,
-  0x0000800000000000,
-  0x0000400000000000,
-  0x0000200000000000,
-  0x0000100000000000,
-  0x0000080000000000,
-  0x0000040000000000,
-  0x0000020000000000,
-  0x0000010000000000,
-  0x0001000000000000,
-  0x0002000000000000,
-  0x0004000000000000,
-  0x0008000000000000,
-  0x0010000000000000,
-  0x0020000000000000,
-  0x0040000000000000,
-  0x0080000000000000,
-  0x8000000000000000,
-  0x4000000000000000,
-  0x2000000000000000,
-  0x1000000000000000,
-  0x0800000000000000,
-  0x0400000000000000,
-  0x0200000000000000,
-  0x0100000000000000,
-  0xffffffffffffffff,
-  0xffffffe7e7ffffff,
-  0xffffc3c3c3c3ffff,
-  0xff818181818181ff
+// Host, pins, clock and cascade are set in menuconfig, Component config -> MAX7219
+#define HOST MAX7219_CONFIG_HOST
+
+static const char *TAG = "MAX7219";
+
+// Created from images.txt with
+// tools/ledanim_encode.py --masks main/images.txt --delay 10 -o main/images.lan
+extern const uint8_t images_lan_start[] asm("_binary_images_lan_start");
+extern const uint8_t images_lan_end[] asm("_binary_images_lan_end");
+
+#define STATS_PERIOD_MS 10000
+
+static char hello[] = "Hello World";
+
+/*
+ * The render stage decodes the animation on one core, the output stage
+ * draws it over SPI on the other. After the last frame of the animation
+ * the output stage scrolls the text.
+ */
+typedef struct
+{
+    uint64_t image;
+    char *text;                  // scrolled instead of the image when set
+} frame_t;
+
+typedef struct
+{
+    max7219_t dev;
+    ledanim_t anim;
+    uint64_t image;              // delta frames need the previous one, the slots do not keep it
+    uint16_t frame;
+} player_t;
+
+static player_t player = {
+    .dev = MAX7219_CONFIG_DEFAULT(),
 };
-const int IMAGES_LEN = sizeof(IMAGES)/8;
 
-void task(void *pvParameter)
+static esp_err_t render(void *ctx, void *frame, uint32_t seq, uint32_t *hold_ms)
+{
+    player_t *p = ctx;
+    frame_t *f = frame;
+
+    if (p->frame == p->anim.hdr.frame_count)
+    {
+        p->frame = 0;
+        f->text = hello;
+        *hold_ms = 0;
+        return ESP_OK;
+    }
+
+    uint16_t delay_ms;
+    ledanim_sink_t sink = { .type = LEDANIM_SINK_MONO, .buf = &p->image, .pixels = 64 };
+    esp_err_t err = ledanim_next(&p->anim, &sink, &delay_ms);
+    if (err != ESP_OK)
+        return err;
+    p->frame++;
+    f->image = p->image;
+    f->text = NULL;
+    *hold_ms = delay_ms;
+
+    return ESP_OK;
+}
+
+static esp_err_t output(void *ctx, const void *frame)
+{
+    player_t *p = ctx;
+    const frame_t *f = frame;
+
+    // Scrolling blocks the output stage for the whole text
+    if (f->text)
+        return max7219_draw_string_8x8(&p->dev, f->text);
+    return max7219_draw_image_8x8(&p->dev, 0, &f->image);
+}
+
+static void log_stats(const framepipe_stats_t *s)
 {
+    ESP_LOGI(TAG, "render %" PRIu32 " frames, %" PRIu32 " us avg, %" PRIu32 " us max, %" PRIu32 " stalls",
+             s->render.frames, (uint32_t)(s->render.total_us / (s->render.frames ? s->render.frames : 1)),
+             s->render.max_us, s->stalls);
+    ESP_LOGI(TAG, "output %" PRIu32 " frames, %" PRIu32 " us avg, %" PRIu32 " us max, %" PRIu32 " underruns",
+             s->output.frames, (uint32_t)(s->output.total_us / (s->output.frames ? s->output.frames : 1)),
+             s->output.max_us, s->underruns);
+    ESP_LOGI(TAG, "latency %" PRIu32 " us, max %" PRIu32 " us, %" PRIu32 " errors",
+             s->latency_us, s->latency_us_max, s->errors);
+}
 
+void app_main()
+{
     spi_bus_config_t cfg = {
-       .mosi_io_num = MOSI_PIN,
+       .mosi_io_num = CONFIG_MAX7219_MOSI_GPIO,
        .miso_io_num = -1,
-       .sclk_io_num = CLK_PIN,
+       .sclk_io_num = CONFIG_MAX7219_CLK_GPIO,
        .quadwp_io_num = -1,
        .quadhd_io_num = -1,
        .max_transfer_sz = 0,
@@ -105,29 +107,40 @@ void task(void *pvParameter)
     };
     ESP_ERROR_CHECK(spi_bus_initialize(HOST, &cfg, 1));
 
+    ESP_ERROR_CHECK(max7219_init_desc(&player.dev, HOST, CONFIG_MAX7219_CLOCK_SPEED_HZ, CONFIG_MAX7219_CS_GPIO));
+    ESP_ERROR_CHECK(max7219_init(&player.dev));
 
-    max7219_t dev = {
-       .cascade_size = CASCADE_SIZE,
-       .digits = 0,
-       .mirrored = true
-    };
-    ESP_ERROR_CHECK(max7219_init_desc(&dev, HOST, MAX7219_MAX_CLOCK_SPEED_HZ, CS_PIN));
-    ESP_ERROR_CHECK(max7219_init(&dev));
-   while (1)
+    // Prefer the asset in the "anim" partition, frames are read through the
+    // flash cache mapping without being copied. The player draws one 8x8
+    // image on the first chip.
+    ledanim_map_t map;
+    if (ledanim_map_open(&map, "anim") == ESP_OK && ledanim_map_anim(&map, &player.anim) == ESP_OK
+        && player.anim.hdr.width == 8 && player.anim.hdr.height == 8)
+        ESP_LOGI(TAG, "Playing %d frames from the anim partition", player.anim.hdr.frame_count);
+    else
     {
-        for (uint8_t i=0; i < IMAGES_LEN; i++)
-        //max7219_draw_image_8x8(&dev,0,(uint8_t *)symbols + i*8 + offs);
-        {
-            max7219_draw_image_8x8(&dev,0,(uint8_t *)IMAGES+ i*8);
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
-        char myString[] = "Hello World";
-        
-        max7219_draw_string_8x8(&dev,myString);
+        if (map.data)
+            ESP_LOGW(TAG, "The anim partition is not an 8x8 asset, playing the embedded one");
+        ledanim_map_close(&map);
+        ESP_ERROR_CHECK(ledanim_open(&player.anim, images_lan_start, images_lan_end - images_lan_start));
+        ESP_LOGI(TAG, "Playing %d frames from the embedded asset, %d bytes/frame", player.anim.hdr.frame_count,
+                 (int)(images_lan_end - images_lan_start) / player.anim.hdr.frame_count);
     }
-}
 
-void app_main()
-{
-    xTaskCreatePinnedToCore(task, "task", configMINIMAL_STACK_SIZE * 3, NULL, 5, NULL, APP_CPU_NUM);
-}
\ No newline at end of file
+    // Render and output on different cores, see FRAMEPIPE_RENDER_CORE
+    framepipe_config_t pipe_config = FRAMEPIPE_DEFAULT_CONFIG();
+    pipe_config.frame_size = sizeof(frame_t);
+    pipe_config.render = render;
+    pipe_config.output = output;
+    pipe_config.ctx = &player;
+    framepipe_handle_t pipe;
+    ESP_ERROR_CHECK(framepipe_new(&pipe_config, &pipe));
+
+    while (1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(STATS_PERIOD_MS));
+        framepipe_stats_t stats;
+        framepipe_get_stats(pipe, &stats);
+        log_stats(&stats);
+    }
+}
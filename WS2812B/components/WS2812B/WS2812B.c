@@ -1,7 +1,7 @@
 #include <stdio.h>
 #include "WS2812B.h"
 void uint64ToRGBArray(uint64_t value[], uint8_t rgbArray[2][64][3], uint8_t r, uint8_t g,uint8_t b) {
-    for(int j =0 ; j < sizeof(value);j++ )
+    for(int j =0 ; j < 2;j++ )
     for (int i = 0; i < 64; i++) {
         // Extract the bit at position i
         uint8_t bit = (value[j] >> (63 - i)) & 1;
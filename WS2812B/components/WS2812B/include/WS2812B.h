@@ -1,2 +1,7 @@
-void uint64ToRGBArray(uint64_t value, uint8_t rgbArray[64][3], uint8_t r, uint8_t g,uint8_t b);
+
+#include <stdint.h>
+#include "ws2812b_fx.h"
+#include "ws2812b_output.h"
+
+void uint64ToRGBArray(uint64_t value[], uint8_t rgbArray[2][64][3], uint8_t r, uint8_t g,uint8_t b);
 
@@ -0,0 +1,354 @@
+/**
+ * @file ws2812b_fx.h
+ * @defgroup ws2812b_fx ws2812b_fx
+ * @{
+ *
+ * Frame based effects engine for WS2812B strips and 8x8 matrices.
+ *
+ * Every effect renders exactly one frame per call into a framebuffer,
+ * the runner commits that framebuffer to the strip with a single refresh
+ * at a fixed frame rate. All color math is fixed point (Q8 for
+ * saturation, value and blend amounts, Q16 for hue), there is no floating
+ * point anywhere in the render path.
+ */
+#ifndef __WS2812B_FX_H__
+#define __WS2812B_FX_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "led_strip.h"
+#include "ledanim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Hue values are Q16 fractions of a full turn: 0x0000 is red,
+ * 0x5555 is green, 0xaaaa is blue.
+ */
+#define WS2812B_HUE_RED   0x0000
+#define WS2812B_HUE_GREEN 0x5555
+#define WS2812B_HUE_BLUE  0xaaaa
+
+/**
+ * RGB pixel
+ */
+typedef struct
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} ws2812b_rgb_t;
+
+/**
+ * Framebuffer, one pixel per LED in strip order
+ */
+typedef struct
+{
+    ws2812b_rgb_t *pixels;       //!< Caller owned pixel storage, `length` entries
+    uint16_t length;             //!< Number of LEDs
+    uint8_t width;               //!< Matrix width for 2D effects (8 for an 8x8 matrix)
+} ws2812b_fb_t;
+
+typedef struct ws2812b_fx ws2812b_fx_t;
+
+/**
+ * @brief Render one frame of an effect
+ *
+ * @param fx Effect descriptor
+ * @param fb Framebuffer to render into
+ * @param frame Frame number since the effect was started
+ * @return false once the effect has finished, true while it is running
+ */
+typedef bool (*ws2812b_fx_render_t)(ws2812b_fx_t *fx, ws2812b_fb_t *fb, uint32_t frame);
+
+/**
+ * Effect descriptor, set up by one of the `ws2812b_fx_*()` constructors
+ */
+struct ws2812b_fx
+{
+    ws2812b_fx_render_t render;
+    union
+    {
+        struct
+        {
+            ws2812b_rgb_t color;
+            uint16_t step;           //!< Q8 pixels per frame
+        } wipe;
+        struct
+        {
+            ws2812b_rgb_t from;
+            ws2812b_rgb_t to;
+            uint16_t frames;
+        } fade;
+        struct
+        {
+            uint16_t hue_step;       //!< Q16 hue delta between neighbouring pixels
+            uint16_t hue_speed;      //!< Q16 hue delta per frame
+            uint8_t sat;
+            uint8_t val;
+        } rainbow;
+        struct
+        {
+            uint8_t *heat;           //!< Caller owned, one byte per LED
+            uint8_t cooling;
+            uint8_t sparking;
+            uint32_t seed;
+        } fire;
+        struct
+        {
+            ws2812b_rgb_t color;
+            uint8_t decay;           //!< Q8 brightness kept per frame
+            uint8_t density;         //!< Q8 probability of a new sparkle per frame
+            uint32_t seed;
+        } sparkle;
+        struct
+        {
+            const uint64_t *glyphs;  //!< 8x8 glyph images, MSB is the top left pixel
+            size_t count;
+            ws2812b_rgb_t color;
+            ws2812b_rgb_t background;
+            uint8_t frames_per_column;
+        } text;
+        struct
+        {
+            ledanim_t *anim;
+            uint16_t fps;
+            uint32_t next;           //!< Frame number the next asset frame is due
+        } anim;
+    };
+};
+
+/**
+ * @brief Scale an 8 bit value by a Q8 factor, 255 is unity
+ */
+static inline uint8_t ws2812b_scale8(uint8_t value, uint8_t scale)
+{
+    return ((uint16_t)value * ((uint16_t)scale + 1)) >> 8;
+}
+
+/**
+ * @brief Convert a HSV color to RGB
+ *
+ * @param hue Q16 hue, full turn is 0x10000
+ * @param sat Q8 saturation
+ * @param val Q8 value
+ * @return RGB color
+ */
+ws2812b_rgb_t ws2812b_hsv_to_rgb(uint16_t hue, uint8_t sat, uint8_t val);
+
+/**
+ * @brief Linear blend of two colors
+ *
+ * @param a Color at amount 0
+ * @param b Color at amount 255
+ * @param amount Q8 blend factor
+ * @return Blended color
+ */
+ws2812b_rgb_t ws2812b_blend(ws2812b_rgb_t a, ws2812b_rgb_t b, uint8_t amount);
+
+/**
+ * @brief Fill the whole framebuffer with one color
+ *
+ * @param fb Framebuffer
+ * @param color Color
+ */
+void ws2812b_fb_fill(ws2812b_fb_t *fb, ws2812b_rgb_t color);
+
+/**
+ * @brief Copy framebuffer to the strip and transmit it with one refresh
+ *
+ * @param fb Framebuffer
+ * @param strip LED strip handle
+ * @return `ESP_OK` on success
+ */
+esp_err_t ws2812b_fb_commit(const ws2812b_fb_t *fb, led_strip_handle_t strip);
+
+/**
+ * @brief Wipe a color across the strip
+ *
+ * @param fx Effect descriptor
+ * @param color Wipe color
+ * @param step Q8 pixels per frame, 256 for one pixel per frame
+ */
+void ws2812b_fx_wipe(ws2812b_fx_t *fx, ws2812b_rgb_t color, uint16_t step);
+
+/**
+ * @brief Fade the whole strip from one color to another
+ *
+ * @param fx Effect descriptor
+ * @param from Start color
+ * @param to End color
+ * @param frames Fade duration in frames
+ */
+void ws2812b_fx_fade(ws2812b_fx_t *fx, ws2812b_rgb_t from, ws2812b_rgb_t to, uint16_t frames);
+
+/**
+ * @brief Moving rainbow
+ *
+ * @param fx Effect descriptor
+ * @param hue_step Q16 hue delta between neighbouring pixels
+ * @param hue_speed Q16 hue delta per frame
+ * @param val Q8 brightness
+ */
+void ws2812b_fx_rainbow(ws2812b_fx_t *fx, uint16_t hue_step, uint16_t hue_speed, uint8_t val);
+
+/**
+ * @brief Fire simulation
+ *
+ * @param fx Effect descriptor
+ * @param heat Heat buffer, one byte per LED, must outlive the effect
+ * @param cooling How much the flame cools down per frame, 20..100 is sensible
+ * @param sparking Q8 chance of a new spark per frame
+ * @param seed Random seed, same seed renders the same frames
+ */
+void ws2812b_fx_fire(ws2812b_fx_t *fx, uint8_t *heat, uint8_t cooling, uint8_t sparking, uint32_t seed);
+
+/**
+ * @brief Random sparkles fading out
+ *
+ * @param fx Effect descriptor
+ * @param color Sparkle color
+ * @param decay Q8 brightness kept per frame
+ * @param density Q8 chance of a new sparkle per frame
+ * @param seed Random seed, same seed renders the same frames
+ */
+void ws2812b_fx_sparkle(ws2812b_fx_t *fx, ws2812b_rgb_t color, uint8_t decay, uint8_t density, uint32_t seed);
+
+/**
+ * @brief Scroll a row of 8x8 glyphs across a matrix
+ *
+ * @param fx Effect descriptor
+ * @param glyphs Glyph images, must outlive the effect
+ * @param count Number of glyphs
+ * @param color Foreground color
+ * @param background Background color
+ * @param frames_per_column Frames before scrolling by one column
+ */
+void ws2812b_fx_text(ws2812b_fx_t *fx, const uint64_t *glyphs, size_t count,
+                     ws2812b_rgb_t color, ws2812b_rgb_t background, uint8_t frames_per_column);
+
+/**
+ * @brief Play a ledanim asset
+ *
+ * The asset must have one pixel per LED of the framebuffer, and on a
+ * matrix its width. Frame durations of the asset are rounded to whole
+ * runner frames. Rendering into a framebuffer with fewer pixels ends the
+ * effect.
+ *
+ * @param fx Effect descriptor
+ * @param anim Opened asset, must outlive the effect
+ * @param fb Framebuffer the effect will render into
+ * @param fps Frame rate of the runner playing the effect
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_SIZE` if the asset does not
+ *         match the framebuffer
+ */
+esp_err_t ws2812b_fx_anim(ws2812b_fx_t *fx, ledanim_t *anim, const ws2812b_fb_t *fb, uint16_t fps);
+
+/**
+ * Runner statistics
+ */
+typedef struct
+{
+    uint32_t frames;             //!< Frames committed, failed commits are not counted
+    uint32_t overruns;           //!< Ticks missed because the previous frame was late
+    uint32_t render_us;          //!< Duration of the last render
+    uint32_t commit_us;          //!< Duration of the last commit
+} ws2812b_fx_stats_t;
+
+#define WS2812B_FX_RUNNER_STACK_SIZE 3072 //!< Bytes of stack of the runner task
+
+/**
+ * Effects runner, renders and commits one frame per tick
+ */
+typedef struct
+{
+    led_strip_handle_t strip;    //!< Strip to commit frames to
+    struct ws2812b_output *output; //!< RMT output to commit to instead of `strip`
+    ws2812b_fb_t *fb;            //!< Framebuffer effects render into
+    uint16_t fps;                //!< Frame rate
+    StackType_t *stack;          //!< Task stack of `WS2812B_FX_RUNNER_STACK_SIZE` bytes, NULL to allocate it
+    /* private */
+    ws2812b_fx_t fx;
+    ws2812b_fx_t pending;
+    bool has_pending;
+    bool active;
+    bool exit;
+    bool parked;
+    uint32_t frame;
+    portMUX_TYPE lock;
+    TaskHandle_t task;
+    TaskHandle_t stopper;
+    StaticTask_t task_buf;
+    esp_timer_handle_t timer;
+    ws2812b_fx_stats_t stats;
+} ws2812b_fx_runner_t;
+
+/**
+ * RAM of a runner with its own stack, a constant expression. The frame
+ * timer is still allocated by esp_timer, once, when the runner starts.
+ */
+#define WS2812B_FX_RUNNER_STATIC_RAM_SIZE (sizeof(ws2812b_fx_runner_t) + WS2812B_FX_RUNNER_STACK_SIZE)
+
+/**
+ * @brief Start the runner task and frame timer
+ *
+ * `strip` or `output`, `fb` and `fps` must be set before calling. With
+ * `stack` set the task is created in the runner, without the heap.
+ *
+ * @param runner Runner descriptor
+ * @param priority Task priority
+ * @param core Core to pin the task to, or `tskNO_AFFINITY`
+ * @return `ESP_OK` on success
+ */
+esp_err_t ws2812b_fx_runner_start(ws2812b_fx_runner_t *runner, UBaseType_t priority, BaseType_t core);
+
+/**
+ * @brief Stop the runner task and frame timer
+ *
+ * Waits for the frame being rendered or committed, the task exits between
+ * two frames.
+ *
+ * @param runner Runner descriptor
+ * @return `ESP_OK` on success
+ */
+esp_err_t ws2812b_fx_runner_stop(ws2812b_fx_runner_t *runner);
+
+/**
+ * @brief Switch to another effect, it starts at frame 0 on the next tick
+ *
+ * @param runner Runner descriptor
+ * @param fx Effect descriptor, copied
+ * @return `ESP_OK` on success
+ */
+esp_err_t ws2812b_fx_runner_set(ws2812b_fx_runner_t *runner, const ws2812b_fx_t *fx);
+
+/**
+ * @brief Check whether the current effect is still running
+ *
+ * @param runner Runner descriptor
+ * @return true while the current effect renders frames
+ */
+bool ws2812b_fx_runner_busy(ws2812b_fx_runner_t *runner);
+
+/**
+ * @brief Get a copy of the runner statistics
+ *
+ * @param runner Runner descriptor
+ * @param stats Statistics
+ */
+void ws2812b_fx_runner_get_stats(ws2812b_fx_runner_t *runner, ws2812b_fx_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __WS2812B_FX_H__ */
@@ -0,0 +1,240 @@
+/**
+ * @file ws2812b_output.h
+ * @defgroup ws2812b_output ws2812b_output
+ * @{
+ *
+ * High throughput RMT output for long WS2812B strips.
+ *
+ * The RMT channel memory is a small ring the encoder refills from an ISR
+ * whenever half of it has been sent. With 24 symbols per LED a 48 or 64
+ * symbol block needs dozens of refills per frame and any interrupt latency (Wi-Fi,
+ * flash writes) stretches a bit and corrupts the frame. This output picks
+ * DMA where the RMT supports it and otherwise the largest sensible symbol
+ * block for the strip length, and counts the refills actually done.
+ */
+#ifndef __WS2812B_OUTPUT_H__
+#define __WS2812B_OUTPUT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include <sdkconfig.h>
+#include "freertos/FreeRTOS.h"
+#include "driver/rmt_tx.h"
+#include "driver/rmt_encoder.h"
+#include "soc/soc_caps.h"
+#include "ws2812b_fx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WS2812B_BITS_PER_LED         24
+#define WS2812B_RMT_DMA_MAX_SYMBOLS  4096 //!< Upper bound for the DMA symbol buffer
+
+// A channel without DMA chains the memory blocks of the TX channels that
+// follow it, at most 4 of them so that other channels are left. The linux
+// target has no RMT and gets the sizes of the ESP32.
+#ifdef SOC_RMT_MEM_WORDS_PER_CHANNEL
+    #define WS2812B_RMT_BLOCK_SYMBOLS SOC_RMT_MEM_WORDS_PER_CHANNEL //!< Symbols in one RMT memory block
+#else
+    #define WS2812B_RMT_BLOCK_SYMBOLS 64
+#endif
+#if defined(SOC_RMT_TX_CANDIDATES_PER_GROUP) && SOC_RMT_TX_CANDIDATES_PER_GROUP < 4
+    #define WS2812B_RMT_MAX_BLOCKS SOC_RMT_TX_CANDIDATES_PER_GROUP //!< Blocks one channel may claim without DMA
+#else
+    #define WS2812B_RMT_MAX_BLOCKS 4
+#endif
+
+/**
+ * Output mode
+ */
+typedef enum
+{
+    WS2812B_OUTPUT_AUTO = 0,     //!< DMA if supported and worth it, else the largest block
+    WS2812B_OUTPUT_STANDARD,     //!< Single RMT memory block, refilled from the ISR
+    WS2812B_OUTPUT_DMA,          //!< DMA, fails where the RMT has no DMA
+} ws2812b_output_mode_t;
+
+/**
+ * Channel sizing chosen for a strip
+ */
+typedef struct
+{
+    bool with_dma;
+    uint32_t mem_block_symbols;
+    uint32_t frame_symbols;      //!< RMT symbols needed for one frame
+    uint32_t expected_refills;   //!< ISR refills needed for one frame
+} ws2812b_output_plan_t;
+
+/**
+ * Output configuration
+ */
+typedef struct
+{
+    int gpio_num;
+    uint16_t length;             //!< Number of LEDs
+    ws2812b_output_mode_t mode;
+    uint32_t resolution_hz;      //!< RMT tick rate, 0 for 10 MHz
+} ws2812b_output_config_t;
+
+/**
+ * Output statistics
+ */
+typedef struct
+{
+    uint32_t frames;             //!< Frames transmitted
+    uint32_t refills;            //!< ISR refills of the last frame
+    uint32_t refills_max;        //!< Worst frame so far
+    uint32_t tx_us;              //!< Transmit duration of the last frame
+    uint32_t tx_us_max;          //!< Worst frame so far
+} ws2812b_output_stats_t;
+
+/**
+ * Counting WS2812B encoder of an output
+ */
+typedef struct
+{
+    rmt_encoder_t base;
+    rmt_encoder_t *bytes_encoder;
+    rmt_encoder_t *copy_encoder;
+    int state;
+    rmt_symbol_word_t reset_code;
+    volatile uint32_t calls;     //!< Encoder calls of the frame being sent
+} ws2812b_output_encoder_t;
+
+/**
+ * Output channel, allocated by ws2812b_output_new() or owned by the caller
+ * with ws2812b_output_new_static(). All fields are private.
+ */
+typedef struct ws2812b_output
+{
+    rmt_channel_handle_t channel;
+    ws2812b_output_encoder_t encoder;
+    uint8_t *grb;
+    uint16_t length;
+    bool is_static;
+    ws2812b_output_plan_t plan;
+    int64_t tx_start;
+    portMUX_TYPE lock;
+    ws2812b_output_stats_t stats;
+} ws2812b_output_t;
+
+typedef ws2812b_output_t *ws2812b_output_handle_t;
+
+#define WS2812B_OUTPUT_GRB_SIZE(length) ((length) * 3) //!< Bytes of the transmit buffer for `length` LEDs
+
+/**
+ * RAM of an output with ws2812b_output_new_static(), a constant expression
+ * for a constant length
+ */
+#define WS2812B_OUTPUT_STATIC_RAM_SIZE(length) (sizeof(ws2812b_output_t) + WS2812B_OUTPUT_GRB_SIZE(length))
+
+#ifdef CONFIG_WS2812B_LENGTH
+
+#if defined(CONFIG_WS2812B_OUTPUT_DMA)
+#define WS2812B_CONFIG_OUTPUT_MODE WS2812B_OUTPUT_DMA
+#elif defined(CONFIG_WS2812B_OUTPUT_STANDARD)
+#define WS2812B_CONFIG_OUTPUT_MODE WS2812B_OUTPUT_STANDARD
+#else
+#define WS2812B_CONFIG_OUTPUT_MODE WS2812B_OUTPUT_AUTO
+#endif
+
+/**
+ * Output configuration as set in menuconfig
+ */
+#define WS2812B_OUTPUT_CONFIG_DEFAULT() { \
+    .gpio_num = CONFIG_WS2812B_GPIO, \
+    .length = CONFIG_WS2812B_LENGTH, \
+    .mode = WS2812B_CONFIG_OUTPUT_MODE, \
+    .resolution_hz = CONFIG_WS2812B_RESOLUTION_HZ, \
+}
+
+#endif
+
+/**
+ * @brief Choose DMA and symbol block size for a strip
+ *
+ * Pure function, does not touch the hardware.
+ *
+ * @param length Number of LEDs
+ * @param mode Requested mode
+ * @param dma_supported Whether the RMT of this chip supports DMA
+ * @param[out] plan Chosen sizing
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_SUPPORTED` if DMA was requested
+ *         but is not available
+ */
+esp_err_t ws2812b_output_plan(uint16_t length, ws2812b_output_mode_t mode, bool dma_supported,
+                              ws2812b_output_plan_t *plan);
+
+/**
+ * @brief Create an output channel
+ *
+ * @param config Output configuration
+ * @param[out] out Output handle
+ * @return `ESP_OK` on success
+ */
+esp_err_t ws2812b_output_new(const ws2812b_output_config_t *config, ws2812b_output_handle_t *out);
+
+/**
+ * @brief Create an output channel in caller owned memory
+ *
+ * Takes nothing from the heap but what the RMT driver allocates for its
+ * channel and encoders, once, here.
+ *
+ * @param config Output configuration
+ * @param buf Output storage, must outlive the output
+ * @param grb Transmit buffer of `WS2812B_OUTPUT_GRB_SIZE(config->length)`
+ *            bytes, in internal RAM as the RMT ISR reads it
+ * @param[out] out Output handle, points to `buf`
+ * @return `ESP_OK` on success
+ */
+esp_err_t ws2812b_output_new_static(const ws2812b_output_config_t *config, ws2812b_output_t *buf, uint8_t *grb,
+                                    ws2812b_output_handle_t *out);
+
+/**
+ * @brief Delete an output channel
+ *
+ * The memory of an output from ws2812b_output_new_static() stays with the
+ * caller.
+ *
+ * @param out Output handle
+ * @return `ESP_OK` on success
+ */
+esp_err_t ws2812b_output_del(ws2812b_output_handle_t out);
+
+/**
+ * @brief Transmit a framebuffer
+ *
+ * Waits for the previous frame to finish, then starts the transmission and
+ * returns, so the next frame can be rendered while this one is sent.
+ *
+ * @param out Output handle
+ * @param fb Framebuffer, at most `length` LEDs are sent
+ * @return `ESP_OK` on success
+ */
+esp_err_t ws2812b_output_commit(ws2812b_output_handle_t out, const ws2812b_fb_t *fb);
+
+/**
+ * @brief Get the sizing the channel was created with
+ *
+ * @param out Output handle
+ * @param[out] plan Sizing
+ */
+void ws2812b_output_get_plan(ws2812b_output_handle_t out, ws2812b_output_plan_t *plan);
+
+/**
+ * @brief Get a copy of the output statistics
+ *
+ * @param out Output handle
+ * @param[out] stats Statistics
+ */
+void ws2812b_output_get_stats(ws2812b_output_handle_t out, ws2812b_output_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __WS2812B_OUTPUT_H__ */
@@ -0,0 +1,315 @@
+/**
+ * @file ws2812b_fx.c
+ *
+ * Fixed point color math and frame renderers of the effects engine.
+ * Nothing in here touches the hardware, frames only depend on the effect
+ * parameters and the frame number.
+ */
+#include <string.h>
+#include "ws2812b_fx.h"
+
+static const ws2812b_rgb_t BLACK = { 0, 0, 0 };
+
+static inline uint32_t xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static inline uint8_t qadd8(uint8_t a, uint8_t b)
+{
+    uint16_t s = (uint16_t)a + b;
+    return s > 255 ? 255 : s;
+}
+
+static inline uint8_t qsub8(uint8_t a, uint8_t b)
+{
+    return a > b ? a - b : 0;
+}
+
+static inline ws2812b_rgb_t scale_rgb(ws2812b_rgb_t c, uint8_t scale)
+{
+    ws2812b_rgb_t res = {
+        ws2812b_scale8(c.r, scale),
+        ws2812b_scale8(c.g, scale),
+        ws2812b_scale8(c.b, scale),
+    };
+    return res;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+ws2812b_rgb_t ws2812b_hsv_to_rgb(uint16_t hue, uint8_t sat, uint8_t val)
+{
+    // Six sectors of 0x10000 / 6, Q8 position inside the sector
+    uint32_t h6 = (uint32_t)hue * 6;
+    uint8_t sector = h6 >> 16;
+    uint8_t frac = (h6 >> 8) & 0xff;
+
+    uint8_t p = ws2812b_scale8(val, 255 - sat);
+    uint8_t q = ws2812b_scale8(val, 255 - ws2812b_scale8(sat, frac));
+    uint8_t t = ws2812b_scale8(val, 255 - ws2812b_scale8(sat, 255 - frac));
+
+    ws2812b_rgb_t res;
+    switch (sector)
+    {
+        case 0:  res = (ws2812b_rgb_t){ val, t, p }; break;
+        case 1:  res = (ws2812b_rgb_t){ q, val, p }; break;
+        case 2:  res = (ws2812b_rgb_t){ p, val, t }; break;
+        case 3:  res = (ws2812b_rgb_t){ p, q, val }; break;
+        case 4:  res = (ws2812b_rgb_t){ t, p, val }; break;
+        default: res = (ws2812b_rgb_t){ val, p, q }; break;
+    }
+    return res;
+}
+
+ws2812b_rgb_t ws2812b_blend(ws2812b_rgb_t a, ws2812b_rgb_t b, uint8_t amount)
+{
+    uint16_t amt = amount + (amount >> 7); // 255 -> 256 so that b is reached exactly
+    uint16_t inv = 256 - amt;
+    ws2812b_rgb_t res = {
+        (a.r * inv + b.r * amt) >> 8,
+        (a.g * inv + b.g * amt) >> 8,
+        (a.b * inv + b.b * amt) >> 8,
+    };
+    return res;
+}
+
+void ws2812b_fb_fill(ws2812b_fb_t *fb, ws2812b_rgb_t color)
+{
+    for (uint16_t i = 0; i < fb->length; i++)
+        fb->pixels[i] = color;
+}
+
+esp_err_t ws2812b_fb_commit(const ws2812b_fb_t *fb, led_strip_handle_t strip)
+{
+    if (!fb || !strip)
+        return ESP_ERR_INVALID_ARG;
+
+    // led_strip_set_pixel() only fills the driver's buffer, the single
+    // refresh below is the only transmission for the whole frame
+    for (uint16_t i = 0; i < fb->length; i++)
+    {
+        esp_err_t err = led_strip_set_pixel(strip, i, fb->pixels[i].r, fb->pixels[i].g, fb->pixels[i].b);
+        if (err != ESP_OK)
+            return err;
+    }
+    return led_strip_refresh(strip);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static bool render_wipe(ws2812b_fx_t *fx, ws2812b_fb_t *fb, uint32_t frame)
+{
+    uint32_t lit = ((frame + 1) * fx->wipe.step) >> 8;
+    if (lit > fb->length)
+        lit = fb->length;
+    for (uint32_t i = 0; i < lit; i++)
+        fb->pixels[i] = fx->wipe.color;
+    return lit < fb->length;
+}
+
+void ws2812b_fx_wipe(ws2812b_fx_t *fx, ws2812b_rgb_t color, uint16_t step)
+{
+    memset(fx, 0, sizeof(*fx));
+    fx->render = render_wipe;
+    fx->wipe.color = color;
+    fx->wipe.step = step ? step : 256;
+}
+
+static bool render_fade(ws2812b_fx_t *fx, ws2812b_fb_t *fb, uint32_t frame)
+{
+    uint32_t frames = fx->fade.frames;
+    if (frame >= frames)
+    {
+        ws2812b_fb_fill(fb, fx->fade.to);
+        return false;
+    }
+    // One division per frame, none per pixel
+    uint8_t amount = ((frame + 1) * 255) / frames;
+    ws2812b_fb_fill(fb, ws2812b_blend(fx->fade.from, fx->fade.to, amount));
+    return true;
+}
+
+void ws2812b_fx_fade(ws2812b_fx_t *fx, ws2812b_rgb_t from, ws2812b_rgb_t to, uint16_t frames)
+{
+    memset(fx, 0, sizeof(*fx));
+    fx->render = render_fade;
+    fx->fade.from = from;
+    fx->fade.to = to;
+    fx->fade.frames = frames;
+}
+
+static bool render_rainbow(ws2812b_fx_t *fx, ws2812b_fb_t *fb, uint32_t frame)
+{
+    uint16_t hue = frame * fx->rainbow.hue_speed;
+    for (uint16_t i = 0; i < fb->length; i++, hue += fx->rainbow.hue_step)
+        fb->pixels[i] = ws2812b_hsv_to_rgb(hue, fx->rainbow.sat, fx->rainbow.val);
+    return true;
+}
+
+void ws2812b_fx_rainbow(ws2812b_fx_t *fx, uint16_t hue_step, uint16_t hue_speed, uint8_t val)
+{
+    memset(fx, 0, sizeof(*fx));
+    fx->render = render_rainbow;
+    fx->rainbow.hue_step = hue_step;
+    fx->rainbow.hue_speed = hue_speed;
+    fx->rainbow.sat = 255;
+    fx->rainbow.val = val;
+}
+
+static ws2812b_rgb_t heat_color(uint8_t heat)
+{
+    // Black -> red -> yellow -> white in three Q6 ramps
+    uint8_t t = ws2812b_scale8(heat, 191);
+    uint8_t ramp = (t & 0x3f) << 2;
+    if (t & 0x80)
+        return (ws2812b_rgb_t){ 255, 255, ramp };
+    if (t & 0x40)
+        return (ws2812b_rgb_t){ 255, ramp, 0 };
+    return (ws2812b_rgb_t){ ramp, 0, 0 };
+}
+
+static bool render_fire(ws2812b_fx_t *fx, ws2812b_fb_t *fb, uint32_t frame)
+{
+    uint8_t *heat = fx->fire.heat;
+    uint16_t n = fb->length;
+    uint32_t *seed = &fx->fire.seed;
+
+    if (!n)
+        return false;
+    if (frame == 0)
+        memset(heat, 0, n);
+
+    // Cool down every cell a little, high cooling on short strips saturates
+    uint32_t max_cool = (fx->fire.cooling * 10u) / n + 2;
+    if (max_cool > 255)
+        max_cool = 255;
+    for (uint16_t i = 0; i < n; i++)
+        heat[i] = qsub8(heat[i], xorshift32(seed) % max_cool);
+
+    // Heat drifts up and diffuses
+    for (uint16_t i = n - 1; i >= 2; i--)
+        heat[i] = (heat[i - 1] + heat[i - 2] + heat[i - 2]) / 3;
+
+    // Randomly ignite new sparks near the bottom
+    if ((xorshift32(seed) & 0xff) < fx->fire.sparking)
+    {
+        uint16_t y = xorshift32(seed) % (n < 7 ? n : 7);
+        heat[y] = qadd8(heat[y], 160 + (xorshift32(seed) % 96));
+    }
+
+    for (uint16_t i = 0; i < n; i++)
+        fb->pixels[i] = heat_color(heat[i]);
+    return true;
+}
+
+void ws2812b_fx_fire(ws2812b_fx_t *fx, uint8_t *heat, uint8_t cooling, uint8_t sparking, uint32_t seed)
+{
+    memset(fx, 0, sizeof(*fx));
+    fx->render = render_fire;
+    fx->fire.heat = heat;
+    fx->fire.cooling = cooling;
+    fx->fire.sparking = sparking;
+    fx->fire.seed = seed ? seed : 1;
+}
+
+static bool render_sparkle(ws2812b_fx_t *fx, ws2812b_fb_t *fb, uint32_t frame)
+{
+    uint32_t *seed = &fx->sparkle.seed;
+
+    if (!fb->length)
+        return false;
+    if (frame == 0)
+        ws2812b_fb_fill(fb, BLACK);
+
+    for (uint16_t i = 0; i < fb->length; i++)
+        fb->pixels[i] = scale_rgb(fb->pixels[i], fx->sparkle.decay);
+
+    if ((xorshift32(seed) & 0xff) < fx->sparkle.density)
+        fb->pixels[xorshift32(seed) % fb->length] = fx->sparkle.color;
+    return true;
+}
+
+void ws2812b_fx_sparkle(ws2812b_fx_t *fx, ws2812b_rgb_t color, uint8_t decay, uint8_t density, uint32_t seed)
+{
+    memset(fx, 0, sizeof(*fx));
+    fx->render = render_sparkle;
+    fx->sparkle.color = color;
+    fx->sparkle.decay = decay;
+    fx->sparkle.density = density;
+    fx->sparkle.seed = seed ? seed : 1;
+}
+
+static bool render_text(ws2812b_fx_t *fx, ws2812b_fb_t *fb, uint32_t frame)
+{
+    uint8_t width = fb->width ? fb->width : 8;
+    uint16_t height = fb->length / width;
+    if (height > 8)
+        height = 8;
+    uint32_t columns = fx->text.count * 8;
+    uint32_t offset = (frame / fx->text.frames_per_column) % columns;
+
+    for (uint16_t y = 0; y < height; y++)
+    {
+        for (uint8_t x = 0; x < width; x++)
+        {
+            uint32_t col = (offset + x) % columns;
+            uint64_t glyph = fx->text.glyphs[col >> 3];
+            bool on = (glyph >> (63 - (y * 8 + (col & 7)))) & 1;
+            fb->pixels[y * width + x] = on ? fx->text.color : fx->text.background;
+        }
+    }
+    return true;
+}
+
+void ws2812b_fx_text(ws2812b_fx_t *fx, const uint64_t *glyphs, size_t count,
+                     ws2812b_rgb_t color, ws2812b_rgb_t background, uint8_t frames_per_column)
+{
+    memset(fx, 0, sizeof(*fx));
+    fx->render = render_text;
+    fx->text.glyphs = glyphs;
+    fx->text.count = count ? count : 1;
+    fx->text.color = color;
+    fx->text.background = background;
+    fx->text.frames_per_column = frames_per_column ? frames_per_column : 1;
+}
+
+static bool render_anim(ws2812b_fx_t *fx, ws2812b_fb_t *fb, uint32_t frame)
+{
+    if (frame == 0)
+    {
+        ledanim_rewind(fx->anim.anim);
+        fx->anim.next = 0;
+    }
+    if (frame < fx->anim.next)
+        return true;
+
+    ledanim_sink_t sink = { .type = LEDANIM_SINK_RGB, .buf = fb->pixels, .pixels = fb->length };
+    uint16_t delay_ms;
+    if (ledanim_next(fx->anim.anim, &sink, &delay_ms) != ESP_OK)
+        return false;
+
+    uint32_t frames = (uint32_t)delay_ms * fx->anim.fps / 1000;
+    fx->anim.next = frame + (frames ? frames : 1);
+    return true;
+}
+
+esp_err_t ws2812b_fx_anim(ws2812b_fx_t *fx, ledanim_t *anim, const ws2812b_fb_t *fb, uint16_t fps)
+{
+    if (!fx || !anim || !fb)
+        return ESP_ERR_INVALID_ARG;
+    if ((uint32_t)anim->hdr.width * anim->hdr.height != fb->length
+        || (anim->hdr.height > 1 && anim->hdr.width != fb->width))
+        return ESP_ERR_INVALID_SIZE;
+
+    memset(fx, 0, sizeof(*fx));
+    fx->render = render_anim;
+    fx->anim.anim = anim;
+    fx->anim.fps = fps ? fps : 1;
+
+    return ESP_OK;
+}
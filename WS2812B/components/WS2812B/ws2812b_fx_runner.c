@@ -0,0 +1,190 @@
+/**
+ * @file ws2812b_fx_runner.c
+ *
+ * Fixed frame rate scheduler for the effects engine. A periodic esp_timer
+ * notifies the runner task once per frame, the task renders the frame and
+ * commits it with a single strip refresh.
+ *
+ * ws2812b_fx_runner_stop() sets `exit` and wakes the task. Between two
+ * frames the task sets `parked`, notifies the stopping task and suspends
+ * itself; only then are the timer and the task deleted, so a commit is
+ * never cut short.
+ */
+#include <string.h>
+#include <esp_log.h>
+#include "ws2812b_fx.h"
+#include "ws2812b_output.h"
+
+static const char *TAG = "ws2812b_fx";
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static void frame_timer_cb(void *arg)
+{
+    ws2812b_fx_runner_t *runner = arg;
+    xTaskNotifyGive(runner->task);
+}
+
+static void runner_task(void *arg)
+{
+    ws2812b_fx_runner_t *runner = arg;
+
+    while (1)
+    {
+        // More than one pending notification means we missed ticks
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        portENTER_CRITICAL(&runner->lock);
+        if (runner->exit)
+        {
+            runner->parked = true;
+            portEXIT_CRITICAL(&runner->lock);
+            break;
+        }
+        if (ticks > 1)
+            runner->stats.overruns += ticks - 1;
+        if (runner->has_pending)
+        {
+            runner->fx = runner->pending;
+            runner->has_pending = false;
+            runner->active = true;
+            runner->frame = 0;
+        }
+        bool active = runner->active;
+        portEXIT_CRITICAL(&runner->lock);
+
+        if (!active)
+            continue;
+
+        int64_t start = esp_timer_get_time();
+        bool running = runner->fx.render(&runner->fx, runner->fb, runner->frame++);
+        int64_t rendered = esp_timer_get_time();
+        esp_err_t err = runner->output
+                        ? ws2812b_output_commit(runner->output, runner->fb)
+                        : ws2812b_fb_commit(runner->fb, runner->strip);
+        int64_t committed = esp_timer_get_time();
+        if (err != ESP_OK)
+            ESP_LOGE(TAG, "Failed to commit frame: %s", esp_err_to_name(err));
+
+        portENTER_CRITICAL(&runner->lock);
+        if (!runner->has_pending)
+            runner->active = running;
+        if (err == ESP_OK)
+            runner->stats.frames++;
+        runner->stats.render_us = rendered - start;
+        runner->stats.commit_us = committed - rendered;
+        portEXIT_CRITICAL(&runner->lock);
+    }
+
+    // The frame timer may notify the task until ws2812b_fx_runner_stop()
+    // has deleted it
+    xTaskNotifyGive(runner->stopper);
+    vTaskSuspend(NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t ws2812b_fx_runner_start(ws2812b_fx_runner_t *runner, UBaseType_t priority, BaseType_t core)
+{
+    CHECK_ARG(runner && (runner->strip || runner->output) && runner->fb && runner->fps);
+
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    runner->lock = lock;
+    runner->has_pending = false;
+    runner->active = false;
+    runner->exit = false;
+    runner->parked = false;
+    runner->stopper = NULL;
+    runner->frame = 0;
+    runner->timer = NULL;
+    memset(&runner->stats, 0, sizeof(runner->stats));
+
+    if (runner->stack)
+        runner->task = xTaskCreateStaticPinnedToCore(runner_task, "ws2812b_fx", WS2812B_FX_RUNNER_STACK_SIZE, runner,
+                                                     priority, runner->stack, &runner->task_buf, core);
+    else if (xTaskCreatePinnedToCore(runner_task, "ws2812b_fx", WS2812B_FX_RUNNER_STACK_SIZE, runner,
+                                     priority, &runner->task, core) != pdPASS)
+        return ESP_ERR_NO_MEM;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = frame_timer_cb,
+        .arg = runner,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "ws2812b_fx",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &runner->timer);
+    if (err == ESP_OK)
+        err = esp_timer_start_periodic(runner->timer, 1000000 / runner->fps);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start frame timer: %s", esp_err_to_name(err));
+        if (runner->timer)
+            esp_timer_delete(runner->timer);
+        vTaskDelete(runner->task);
+        runner->timer = NULL;
+        runner->task = NULL;
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Runner started, %d LEDs at %d fps", runner->fb->length, runner->fps);
+
+    return ESP_OK;
+}
+
+esp_err_t ws2812b_fx_runner_stop(ws2812b_fx_runner_t *runner)
+{
+    CHECK_ARG(runner && runner->task);
+
+    portENTER_CRITICAL(&runner->lock);
+    runner->stopper = xTaskGetCurrentTaskHandle();
+    runner->exit = true;
+    portEXIT_CRITICAL(&runner->lock);
+    xTaskNotifyGive(runner->task);
+
+    bool parked;
+    do
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        portENTER_CRITICAL(&runner->lock);
+        parked = runner->parked;
+        portEXIT_CRITICAL(&runner->lock);
+    } while (!parked);
+
+    esp_timer_stop(runner->timer);
+    CHECK(esp_timer_delete(runner->timer));
+    vTaskDelete(runner->task);
+    runner->timer = NULL;
+    runner->task = NULL;
+
+    return ESP_OK;
+}
+
+esp_err_t ws2812b_fx_runner_set(ws2812b_fx_runner_t *runner, const ws2812b_fx_t *fx)
+{
+    CHECK_ARG(runner && fx && fx->render);
+
+    portENTER_CRITICAL(&runner->lock);
+    runner->pending = *fx;
+    runner->has_pending = true;
+    portEXIT_CRITICAL(&runner->lock);
+
+    return ESP_OK;
+}
+
+bool ws2812b_fx_runner_busy(ws2812b_fx_runner_t *runner)
+{
+    portENTER_CRITICAL(&runner->lock);
+    bool busy = runner->active || runner->has_pending;
+    portEXIT_CRITICAL(&runner->lock);
+
+    return busy;
+}
+
+void ws2812b_fx_runner_get_stats(ws2812b_fx_runner_t *runner, ws2812b_fx_stats_t *stats)
+{
+    portENTER_CRITICAL(&runner->lock);
+    *stats = runner->stats;
+    portEXIT_CRITICAL(&runner->lock);
+}
@@ -0,0 +1,330 @@
+/**
+ * @file ws2812b_output.c
+ *
+ * RMT output channel with a counting WS2812B encoder. The encoder is the
+ * usual bytes + reset code pair; every call after the first one for a
+ * frame is an ISR refill of the channel memory, which is what we count.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include "soc/soc_caps.h"
+#include "ws2812b_output.h"
+
+static const char *TAG = "ws2812b_output";
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define DEFAULT_RESOLUTION_HZ (10 * 1000 * 1000)
+#define RESET_US 50
+
+// DMA is left out where the chip has none or menuconfig rules it out
+#if SOC_RMT_SUPPORT_DMA && !defined(CONFIG_WS2812B_OUTPUT_STANDARD)
+    #define DMA_SUPPORTED true
+#else
+    #define DMA_SUPPORTED false
+#endif
+
+#if defined(CONFIG_WS2812B_MATRIX_WIDTH) && CONFIG_WS2812B_MATRIX_WIDTH
+_Static_assert(CONFIG_WS2812B_LENGTH % CONFIG_WS2812B_MATRIX_WIDTH == 0,
+               "CONFIG_WS2812B_LENGTH must be a multiple of CONFIG_WS2812B_MATRIX_WIDTH");
+#endif
+
+static size_t encode_strip(rmt_encoder_t *encoder, rmt_channel_handle_t channel,
+                           const void *data, size_t size, rmt_encode_state_t *ret_state)
+{
+    ws2812b_output_encoder_t *enc = __containerof(encoder, ws2812b_output_encoder_t, base);
+    rmt_encode_state_t session_state = RMT_ENCODING_RESET;
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    size_t encoded = 0;
+
+    enc->calls++;
+
+    switch (enc->state)
+    {
+        case 0:
+            encoded += enc->bytes_encoder->encode(enc->bytes_encoder, channel, data, size, &session_state);
+            if (session_state & RMT_ENCODING_COMPLETE)
+                enc->state = 1;
+            if (session_state & RMT_ENCODING_MEM_FULL)
+            {
+                state |= RMT_ENCODING_MEM_FULL;
+                break;
+            }
+            // fall-through
+        case 1:
+            encoded += enc->copy_encoder->encode(enc->copy_encoder, channel, &enc->reset_code,
+                                                 sizeof(enc->reset_code), &session_state);
+            if (session_state & RMT_ENCODING_COMPLETE)
+            {
+                enc->state = RMT_ENCODING_RESET;
+                state |= RMT_ENCODING_COMPLETE;
+            }
+            if (session_state & RMT_ENCODING_MEM_FULL)
+                state |= RMT_ENCODING_MEM_FULL;
+            break;
+    }
+
+    *ret_state = state;
+    return encoded;
+}
+
+static esp_err_t reset_strip(rmt_encoder_t *encoder)
+{
+    ws2812b_output_encoder_t *enc = __containerof(encoder, ws2812b_output_encoder_t, base);
+    rmt_encoder_reset(enc->bytes_encoder);
+    rmt_encoder_reset(enc->copy_encoder);
+    enc->state = RMT_ENCODING_RESET;
+    return ESP_OK;
+}
+
+static esp_err_t del_strip(rmt_encoder_t *encoder)
+{
+    ws2812b_output_encoder_t *enc = __containerof(encoder, ws2812b_output_encoder_t, base);
+    if (enc->bytes_encoder)
+        rmt_del_encoder(enc->bytes_encoder);
+    if (enc->copy_encoder)
+        rmt_del_encoder(enc->copy_encoder);
+    enc->bytes_encoder = NULL;
+    enc->copy_encoder = NULL;
+    return ESP_OK;
+}
+
+// The encoder is part of the output, only the RMT encoders it wraps are allocated
+static esp_err_t init_strip_encoder(uint32_t resolution_hz, ws2812b_output_encoder_t *enc)
+{
+    memset(enc, 0, sizeof(ws2812b_output_encoder_t));
+    enc->base.encode = encode_strip;
+    enc->base.reset = reset_strip;
+    enc->base.del = del_strip;
+
+    // T0H 0.3us, T0L 0.9us, T1H 0.9us, T1L 0.3us
+    uint32_t short_ticks = resolution_hz / 1000000 * 3 / 10;
+    uint32_t long_ticks = resolution_hz / 1000000 * 9 / 10;
+    rmt_bytes_encoder_config_t bytes_config = {
+        .bit0 = { .level0 = 1, .duration0 = short_ticks, .level1 = 0, .duration1 = long_ticks },
+        .bit1 = { .level0 = 1, .duration0 = long_ticks, .level1 = 0, .duration1 = short_ticks },
+        .flags.msb_first = 1,
+    };
+    rmt_copy_encoder_config_t copy_config = {};
+    esp_err_t err = rmt_new_bytes_encoder(&bytes_config, &enc->bytes_encoder);
+    if (err == ESP_OK)
+        err = rmt_new_copy_encoder(&copy_config, &enc->copy_encoder);
+    if (err != ESP_OK)
+    {
+        del_strip(&enc->base);
+        return err;
+    }
+
+    uint32_t reset_ticks = resolution_hz / 1000000 * RESET_US / 2;
+    enc->reset_code = (rmt_symbol_word_t) {
+        .level0 = 0, .duration0 = reset_ticks,
+        .level1 = 0, .duration1 = reset_ticks,
+    };
+
+    return ESP_OK;
+}
+
+static bool on_trans_done(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    struct ws2812b_output *out = user_ctx;
+    uint32_t tx_us = esp_timer_get_time() - out->tx_start;
+    uint32_t refills = out->encoder.calls ? out->encoder.calls - 1 : 0;
+
+    portENTER_CRITICAL_ISR(&out->lock);
+    out->stats.frames++;
+    out->stats.refills = refills;
+    out->stats.tx_us = tx_us;
+    if (refills > out->stats.refills_max)
+        out->stats.refills_max = refills;
+    if (tx_us > out->stats.tx_us_max)
+        out->stats.tx_us_max = tx_us;
+    portEXIT_CRITICAL_ISR(&out->lock);
+
+    return false;
+}
+
+static esp_err_t start_output(const ws2812b_output_config_t *config, const ws2812b_output_plan_t *plan,
+                              struct ws2812b_output *out)
+{
+    out->length = config->length;
+    out->plan = *plan;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    out->lock = lock;
+
+    uint32_t resolution_hz = config->resolution_hz ? config->resolution_hz : DEFAULT_RESOLUTION_HZ;
+    rmt_tx_channel_config_t chan_config = {
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .gpio_num = config->gpio_num,
+        .mem_block_symbols = plan->mem_block_symbols,
+        .resolution_hz = resolution_hz,
+        .trans_queue_depth = 1,
+        .flags.with_dma = plan->with_dma,
+    };
+    rmt_tx_event_callbacks_t cbs = {
+        .on_trans_done = on_trans_done,
+    };
+
+    esp_err_t err = rmt_new_tx_channel(&chan_config, &out->channel);
+    if (err == ESP_OK)
+        err = init_strip_encoder(resolution_hz, &out->encoder);
+    if (err == ESP_OK)
+        err = rmt_tx_register_event_callbacks(out->channel, &cbs, out);
+    if (err == ESP_OK)
+        err = rmt_enable(out->channel);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to create output: %s", esp_err_to_name(err));
+        del_strip(&out->encoder.base);
+        if (out->channel)
+            rmt_del_channel(out->channel);
+        return err;
+    }
+
+    ESP_LOGI(TAG, "%d LEDs, %s, %lu symbols, %lu symbols/frame, %lu refills/frame expected",
+             out->length, plan->with_dma ? "DMA" : "no DMA", (unsigned long)plan->mem_block_symbols,
+             (unsigned long)plan->frame_symbols, (unsigned long)plan->expected_refills);
+
+    return ESP_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t ws2812b_output_plan(uint16_t length, ws2812b_output_mode_t mode, bool dma_supported,
+                              ws2812b_output_plan_t *plan)
+{
+    CHECK_ARG(plan && length);
+
+    memset(plan, 0, sizeof(*plan));
+    // One symbol per bit plus the reset code
+    plan->frame_symbols = (uint32_t)length * WS2812B_BITS_PER_LED + 1;
+    uint32_t rounded = (plan->frame_symbols + WS2812B_RMT_BLOCK_SYMBOLS - 1)
+                       / WS2812B_RMT_BLOCK_SYMBOLS * WS2812B_RMT_BLOCK_SYMBOLS;
+
+    if (mode == WS2812B_OUTPUT_DMA && !dma_supported)
+        return ESP_ERR_NOT_SUPPORTED;
+
+    if (mode == WS2812B_OUTPUT_STANDARD)
+        plan->mem_block_symbols = WS2812B_RMT_BLOCK_SYMBOLS;
+    else if (dma_supported && (mode == WS2812B_OUTPUT_DMA || plan->frame_symbols > WS2812B_RMT_BLOCK_SYMBOLS))
+    {
+        plan->with_dma = true;
+        plan->mem_block_symbols = rounded < WS2812B_RMT_DMA_MAX_SYMBOLS ? rounded : WS2812B_RMT_DMA_MAX_SYMBOLS;
+    }
+    else
+    {
+        uint32_t max = WS2812B_RMT_BLOCK_SYMBOLS * WS2812B_RMT_MAX_BLOCKS;
+        plan->mem_block_symbols = rounded < max ? rounded : max;
+    }
+
+    // The driver refills half of the channel memory at a time
+    if (plan->frame_symbols > plan->mem_block_symbols)
+    {
+        uint32_t half = plan->mem_block_symbols / 2;
+        plan->expected_refills = (plan->frame_symbols - plan->mem_block_symbols + half - 1) / half;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ws2812b_output_new(const ws2812b_output_config_t *config, ws2812b_output_handle_t *ret)
+{
+    CHECK_ARG(config && ret);
+
+    ws2812b_output_plan_t plan;
+    CHECK(ws2812b_output_plan(config->length, config->mode, DMA_SUPPORTED, &plan));
+
+    struct ws2812b_output *out = calloc(1, sizeof(struct ws2812b_output));
+    if (!out)
+        return ESP_ERR_NO_MEM;
+    // Read by the encoder from the RMT ISR, keep it in internal RAM
+    out->grb = heap_caps_calloc(config->length, 3, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!out->grb)
+    {
+        free(out);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = start_output(config, &plan, out);
+    if (err != ESP_OK)
+    {
+        free(out->grb);
+        free(out);
+        return err;
+    }
+
+    *ret = out;
+    return ESP_OK;
+}
+
+esp_err_t ws2812b_output_new_static(const ws2812b_output_config_t *config, ws2812b_output_t *buf, uint8_t *grb,
+                                    ws2812b_output_handle_t *ret)
+{
+    CHECK_ARG(config && buf && grb && ret);
+
+    ws2812b_output_plan_t plan;
+    CHECK(ws2812b_output_plan(config->length, config->mode, DMA_SUPPORTED, &plan));
+
+    memset(buf, 0, sizeof(ws2812b_output_t));
+    memset(grb, 0, WS2812B_OUTPUT_GRB_SIZE(config->length));
+    buf->grb = grb;
+    buf->is_static = true;
+    CHECK(start_output(config, &plan, buf));
+
+    *ret = buf;
+    return ESP_OK;
+}
+
+esp_err_t ws2812b_output_del(ws2812b_output_handle_t out)
+{
+    CHECK_ARG(out);
+
+    CHECK(rmt_tx_wait_all_done(out->channel, -1));
+    CHECK(rmt_disable(out->channel));
+    CHECK(rmt_del_channel(out->channel));
+    rmt_del_encoder(&out->encoder.base);
+    if (!out->is_static)
+    {
+        free(out->grb);
+        free(out);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t ws2812b_output_commit(ws2812b_output_handle_t out, const ws2812b_fb_t *fb)
+{
+    CHECK_ARG(out && fb);
+
+    // The encoder still reads the buffer until the previous frame is out
+    CHECK(rmt_tx_wait_all_done(out->channel, -1));
+
+    uint16_t n = fb->length < out->length ? fb->length : out->length;
+    uint8_t *p = out->grb;
+    for (uint16_t i = 0; i < n; i++)
+    {
+        *p++ = fb->pixels[i].g;
+        *p++ = fb->pixels[i].r;
+        *p++ = fb->pixels[i].b;
+    }
+
+    rmt_transmit_config_t tx_config = { .loop_count = 0 };
+    out->encoder.calls = 0;
+    out->tx_start = esp_timer_get_time();
+    return rmt_transmit(out->channel, &out->encoder.base, out->grb, n * 3, &tx_config);
+}
+
+void ws2812b_output_get_plan(ws2812b_output_handle_t out, ws2812b_output_plan_t *plan)
+{
+    *plan = out->plan;
+}
+
+void ws2812b_output_get_stats(ws2812b_output_handle_t out, ws2812b_output_stats_t *stats)
+{
+    portENTER_CRITICAL(&out->lock);
+    *stats = out->stats;
+    portEXIT_CRITICAL(&out->lock);
+}
@@ -1,87 +1,127 @@
 #include <stdio.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "led_strip.h"
 #include "esp_log.h"
 #include "esp_random.h"
 #include "WS2812B.h"
+#include "ledanim_map.h"
 
-#define LED_STRIP_GPIO 2  // GPIO pin connected to the data line of the LED strip
-#define LED_STRIP_LENGTH 64  // Total number of LEDs in the strip
+// Strip, matrix and output are set in menuconfig, Component config -> WS2812B
+#define LED_STRIP_LENGTH CONFIG_WS2812B_LENGTH
+#define LED_MATRIX_WIDTH CONFIG_WS2812B_MATRIX_WIDTH
+#define FX_FPS CONFIG_WS2812B_FPS
+#define FX_DURATION_MS 5000
 
 static const char *TAG = "LED_STRIP";
-void color_wipe(led_strip_handle_t led_strip, uint8_t red, uint8_t green, uint8_t blue, int delay_ms) {
-    for (int i = 0; i < LED_STRIP_LENGTH; i++) {
-        ESP_ERROR_CHECK(led_strip_set_pixel(led_strip, i, red, green, blue));
-        ESP_ERROR_CHECK(led_strip_refresh(led_strip));
-        vTaskDelay(pdMS_TO_TICKS(delay_ms));
-    }
+
+// Created from the two 64 bit masks the example used to expand by hand with
+// tools/ledanim_encode.py --masks <file> --mask-layout ws2812b -o main/images.lan
+extern const uint8_t images_lan_start[] asm("_binary_images_lan_start");
+extern const uint8_t images_lan_end[] asm("_binary_images_lan_end");
+
+static ws2812b_rgb_t pixels[LED_STRIP_LENGTH];
+static uint8_t heat[LED_STRIP_LENGTH];
+static ws2812b_fb_t fb = {
+    .pixels = pixels,
+    .length = LED_STRIP_LENGTH,
+    .width = LED_MATRIX_WIDTH,
+};
+// Output and runner in .bss too, nothing of the strip is on the heap
+static ws2812b_output_t output_buf;
+static uint8_t grb[WS2812B_OUTPUT_GRB_SIZE(LED_STRIP_LENGTH)];
+static StackType_t fx_stack[WS2812B_FX_RUNNER_STACK_SIZE];
+static ws2812b_output_handle_t output;
+static ws2812b_fx_runner_t runner = {
+    .fb = &fb,
+    .fps = FX_FPS,
+    .stack = fx_stack,
+};
+
+#define STATIC_RAM_SIZE (sizeof(pixels) + sizeof(heat) + sizeof(fb) + \
+                         WS2812B_OUTPUT_STATIC_RAM_SIZE(LED_STRIP_LENGTH) + WS2812B_FX_RUNNER_STATIC_RAM_SIZE)
+
+static void play(const ws2812b_fx_t *fx, const char *name)
+{
+    ws2812b_fx_stats_t before, after;
+    ws2812b_fx_runner_get_stats(&runner, &before);
+    ESP_ERROR_CHECK(ws2812b_fx_runner_set(&runner, fx));
+
+    TickType_t start = xTaskGetTickCount();
+    do {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    } while (ws2812b_fx_runner_busy(&runner) && xTaskGetTickCount() - start < pdMS_TO_TICKS(FX_DURATION_MS));
+
+    ws2812b_fx_runner_get_stats(&runner, &after);
+    uint32_t elapsed_ms = pdTICKS_TO_MS(xTaskGetTickCount() - start);
+    ESP_LOGI(TAG, "%s: %" PRIu32 " frames in %" PRIu32 " ms (%" PRIu32 " fps), render %" PRIu32 " us, commit %" PRIu32 " us, overruns %" PRIu32,
+             name, after.frames - before.frames, elapsed_ms,
+             (after.frames - before.frames) * 1000 / (elapsed_ms ? elapsed_ms : 1),
+             after.render_us, after.commit_us, after.overruns - before.overruns);
+
+    ws2812b_output_stats_t tx;
+    ws2812b_output_get_stats(output, &tx);
+    ESP_LOGI(TAG, "%s: transmit %" PRIu32 " us (max %" PRIu32 "), ISR refills %" PRIu32 " (max %" PRIu32 ")",
+             name, tx.tx_us, tx.tx_us_max, tx.refills, tx.refills_max);
 }
+
 void app_main(void) {
-    // Configuration for the LED strip
-    led_strip_config_t strip_config = {
-        .strip_gpio_num = LED_STRIP_GPIO,
-        .max_leds = LED_STRIP_LENGTH,
-        .led_model = LED_MODEL_WS2812,
-        .color_component_format = LED_STRIP_COLOR_COMPONENT_FMT_GRB,
-        .flags = {
-            .invert_out = false,
-        },
-    };
+    // By default DMA where the RMT has it, otherwise the largest symbol
+    // block for the strip
+    ws2812b_output_config_t output_config = WS2812B_OUTPUT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(ws2812b_output_new_static(&output_config, &output_buf, grb, &output));
+    ESP_LOGI(TAG, "%d LEDs in %d bytes of static RAM", LED_STRIP_LENGTH, (int)STATIC_RAM_SIZE);
 
-    // RMT configuration for the LED strip
-    led_strip_rmt_config_t rmt_config = {
-        .clk_src = RMT_CLK_SRC_DEFAULT,
-        .resolution_hz = 10 * 1000 * 1000,  // 10 MHz
-        .mem_block_symbols = 64,
-        .flags = {
-            .with_dma = false,
-        },
-    };
+    runner.output = output;
+    ESP_ERROR_CHECK(ws2812b_fx_runner_start(&runner, 5, tskNO_AFFINITY));
 
-    // Create the LED strip object
-    led_strip_handle_t led_strip;
-    ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip));
+    const ws2812b_rgb_t red = { 255, 0, 0 };
+    const ws2812b_rgb_t black = { 0, 0, 0 };
+    const ws2812b_rgb_t white = { 255, 255, 255 };
+    const uint64_t images[2] = {
+        0x0000007f3e1c0800,
+        0x2222227f3e1c0800,
+    };
 
-    // Set the color of each LED in the strip
-    for (int i = 0; i < LED_STRIP_LENGTH; i++) {
-        ESP_ERROR_CHECK(led_strip_set_pixel(led_strip, i, 255, 0, 0));  // Set to red color
+    // Prefer the asset in the "anim" partition if it matches the strip,
+    // frames are read through the flash cache mapping without being copied
+    ledanim_map_t map;
+    ledanim_t anim;
+    ws2812b_fx_t fx;
+    if (ledanim_map_open(&map, "anim") != ESP_OK || ledanim_map_anim(&map, &anim) != ESP_OK
+        || ws2812b_fx_anim(&fx, &anim, &fb, FX_FPS) != ESP_OK)
+    {
+        ledanim_map_close(&map);
+        ESP_ERROR_CHECK(ledanim_open(&anim, images_lan_start, images_lan_end - images_lan_start));
     }
+    bool play_anim = ws2812b_fx_anim(&fx, &anim, &fb, FX_FPS) == ESP_OK;
+    if (!play_anim)
+        ESP_LOGW(TAG, "No %dx%d asset for the strip, the %ux%u one is not played",
+                 LED_MATRIX_WIDTH, LED_STRIP_LENGTH / LED_MATRIX_WIDTH, anim.hdr.width, anim.hdr.height);
 
-    // Refresh the strip to show the colors
-    ESP_ERROR_CHECK(led_strip_refresh(led_strip));
-
-    
     // Main loop
-    color_wipe(led_strip, 0,0,0,10);
-    uint64_t images[2];
-    images[0] = 0x0000007f3e1c0800;
-    images[1] = 0x2222227f3e1c0800;
-    uint8_t rgbArray[2][64][3];
-    int scroll = 0;
-    int r = 255;
-    int g = 255;
-    int b = 255;
-    uint64ToRGBArray(images, rgbArray, r, g, b);
     while (true) {
+        ws2812b_fx_wipe(&fx, red, 256);
+        play(&fx, "wipe");
 
-        int selectorImage =0;
-        for (int i = 0; i < 128; i++) {
-            int pos = (i + scroll) % 64;
-            ESP_ERROR_CHECK(led_strip_set_pixel(led_strip, pos, rgbArray[selectorImage][i][0], rgbArray[selectorImage][i][1], rgbArray[selectorImage][i][2]));
-            if(i%64==0)
-            {
-                selectorImage =1;
-            }
-        }
+        ws2812b_fx_fade(&fx, red, black, FX_FPS);
+        play(&fx, "fade");
 
-        ESP_ERROR_CHECK(led_strip_refresh(led_strip));
-        vTaskDelay(pdMS_TO_TICKS(100));
+        ws2812b_fx_rainbow(&fx, 0x10000 / LED_STRIP_LENGTH, 0x200, 64);
+        play(&fx, "rainbow");
 
-        scroll = (scroll +1) % 8;
-    }
+        ws2812b_fx_fire(&fx, heat, 55, 120, esp_random());
+        play(&fx, "fire");
 
-    // Clean up
-    ESP_ERROR_CHECK(led_strip_clear(led_strip));
-    ESP_ERROR_CHECK(led_strip_del(led_strip));
-}
\ No newline at end of file
+        ws2812b_fx_sparkle(&fx, white, 220, 100, esp_random());
+        play(&fx, "sparkle");
+
+        ws2812b_fx_text(&fx, images, 2, white, black, FX_FPS / 10);
+        play(&fx, "text");
+
+        if (play_anim) {
+            ESP_ERROR_CHECK(ws2812b_fx_anim(&fx, &anim, &fb, FX_FPS));
+            play(&fx, "anim");
+        }
+    }
+}
@@ -0,0 +1,354 @@
+/**
+ * @file asynclog.c
+ *
+ * Asynchronous ESP_LOG backend: per-core lock-free rings and an output task.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "asynclog.h"
+#include "asynclog_args.h"
+
+static const char *TAG = "asynclog";
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define TASK_STACK   3072
+#define POLL_TICKS   pdMS_TO_TICKS(50)
+
+#define REC_EMPTY    0
+#define REC_READY    1
+#define REC_PADDING  2
+
+#define REC_ARGS     0           // captured by asynclog_vprintf()
+#define REC_WORDS    1           // binary, one word per argument
+
+#define FRAME_MAX    ((ASYNCLOG_MAX_ARGS + 3) * sizeof(asynclog_word_t) + 1)
+
+/*
+ * Record, followed by the captured arguments. The state is written last,
+ * so the reader never sees a record that is still being filled.
+ */
+typedef struct
+{
+    uint16_t size;               // whole record, multiple of REC_ALIGN
+    uint8_t state;
+    uint8_t kind;
+    const char *fmt;
+} record_t;
+
+#define REC_ALIGN _Alignof(record_t)
+
+/*
+ * Ring of one core. Any task may reserve space with a CAS on head; only
+ * the output task moves tail. Both counters run freely.
+ */
+typedef struct
+{
+    uint8_t *buf;
+    uint32_t mask;
+    uint32_t head;
+    uint32_t tail;
+} ring_t;
+
+static struct
+{
+    ring_t ring[portNUM_PROCESSORS];
+    vprintf_like_t prev;
+    TaskHandle_t task;
+    bool binary;
+    asynclog_stats_t stats;
+} s_log;
+
+static int emit(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int res = s_log.prev(fmt, args);
+    va_end(args);
+
+    if (res > 0)
+        __atomic_add_fetch(&s_log.stats.bytes, res, __ATOMIC_RELAXED);
+
+    return res;
+}
+
+static inline uint8_t core_id(void)
+{
+#if portNUM_PROCESSORS > 1
+    return xPortGetCoreID();
+#else
+    return 0;
+#endif
+}
+
+static record_t *reserve(ring_t *r, uint32_t size)
+{
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    uint32_t pad, next;
+
+    do
+    {
+        uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+        // Records never wrap, the end of the ring is skipped instead
+        uint32_t left = r->mask + 1 - (head & r->mask);
+        pad = left < size ? left : 0;
+        next = head + pad + size;
+        if (next - tail > r->mask + 1)
+            return NULL;
+    } while (!__atomic_compare_exchange_n(&r->head, &head, next, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    if (pad)
+    {
+        record_t *p = (record_t *)(r->buf + (head & r->mask));
+        p->size = pad;
+        __atomic_store_n(&p->state, REC_PADDING, __ATOMIC_RELEASE);
+    }
+
+    return (record_t *)(r->buf + ((head + pad) & r->mask));
+}
+
+static bool push(const char *fmt, uint8_t kind, const void *data, size_t len)
+{
+    uint32_t size = (sizeof(record_t) + len + REC_ALIGN - 1) & ~(REC_ALIGN - 1);
+    ring_t *r = &s_log.ring[core_id()];
+    bool was_empty = __atomic_load_n(&r->head, __ATOMIC_RELAXED) == __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+    record_t *rec = reserve(r, size);
+    if (!rec)
+    {
+        __atomic_add_fetch(&s_log.stats.dropped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    rec->size = size;
+    rec->kind = kind;
+    rec->fmt = fmt;
+    memcpy(rec + 1, data, len);
+    __atomic_store_n(&rec->state, REC_READY, __ATOMIC_RELEASE);
+
+    __atomic_add_fetch(&s_log.stats.logged, 1, __ATOMIC_RELAXED);
+    if (was_empty && s_log.task)
+        xTaskNotifyGive(s_log.task);
+
+    return true;
+}
+
+static int asynclog_vprintf(const char *fmt, va_list args)
+{
+    uint8_t data[ASYNCLOG_MAX_RECORD - sizeof(record_t)];
+    bool truncated;
+    size_t len = asynclog_capture(fmt, args, data, sizeof(data), &truncated);
+
+    if (!push(fmt, REC_ARGS, data, len))
+        return 0;
+    if (truncated)
+        __atomic_add_fetch(&s_log.stats.truncated, 1, __ATOMIC_RELAXED);
+
+    return (int)len;
+}
+
+static uint8_t crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++)
+            crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+
+    return crc;
+}
+
+/* COBS, the output has no zero bytes and is at most one byte longer */
+static size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t code_pos = 0, o = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (in[i])
+        {
+            out[o++] = in[i];
+            code++;
+        }
+        if (!in[i] || code == 0xff)
+        {
+            out[code_pos] = code;
+            code = 1;
+            code_pos = o++;
+        }
+    }
+    out[code_pos] = code;
+
+    return o;
+}
+
+/*
+ * A binary record goes out as 0, COBS(format address, words, CRC-8), 0.
+ * Text never contains a zero byte, so tools/asynclog_decode.py can pick
+ * the frames out of the console output.
+ */
+static void emit_frame(const record_t *rec)
+{
+    uint8_t raw[FRAME_MAX];
+    uint8_t enc[FRAME_MAX + FRAME_MAX / 254 + 2];
+    size_t words = rec->size - sizeof(record_t);
+    size_t len = sizeof(asynclog_word_t) + words;
+
+    if (len + 1 > sizeof(raw))
+        return;
+    asynclog_word_t id = (asynclog_word_t)rec->fmt;
+    memcpy(raw, &id, sizeof(id));
+    memcpy(raw + sizeof(id), rec + 1, words);
+    raw[len] = crc8(raw, len);
+
+    enc[cobs_encode(raw, len + 1, enc)] = 0;
+    emit("%c%s%c", 0, (const char *)enc, 0);
+}
+
+/* Write out the committed records of a ring, returns false if it is not empty */
+static bool drain(ring_t *r, char *line)
+{
+    uint32_t tail = r->tail;
+
+    while (tail != __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+    {
+        record_t *rec = (record_t *)(r->buf + (tail & r->mask));
+        uint8_t state = __atomic_load_n(&rec->state, __ATOMIC_ACQUIRE);
+        if (state == REC_EMPTY)
+            return false; // reserved, not written yet
+
+        uint16_t size = rec->size;
+        if (state == REC_READY && rec->kind == REC_WORDS && s_log.binary)
+            emit_frame(rec);
+        else if (state == REC_READY)
+        {
+            asynclog_render(rec->fmt, (const uint8_t *)(rec + 1), size - sizeof(record_t),
+                            rec->kind == REC_WORDS, line, ASYNCLOG_MAX_LINE);
+            emit("%s", line);
+        }
+        // Consumed space is zeroed, so a record reserved over it reads as
+        // empty until it is committed
+        memset(rec, 0, size);
+        tail += size;
+        __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    return true;
+}
+
+static void asynclog_task(void *arg)
+{
+    static char line[ASYNCLOG_MAX_LINE];
+    uint32_t reported = 0;
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, POLL_TICKS);
+
+        for (int i = 0; i < portNUM_PROCESSORS; i++)
+            drain(&s_log.ring[i], line);
+
+        uint32_t dropped = __atomic_load_n(&s_log.stats.dropped, __ATOMIC_RELAXED);
+        if (dropped != reported)
+        {
+            emit("asynclog: %u records dropped\n", (unsigned)(dropped - reported));
+            reported = dropped;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t asynclog_install(const asynclog_config_t *config)
+{
+    CHECK_ARG(config && config->ring_size >= 2 * ASYNCLOG_MAX_RECORD);
+    if (s_log.prev)
+        return ESP_ERR_INVALID_STATE;
+
+    uint32_t size = 1;
+    while (size * 2 <= config->ring_size)
+        size *= 2;
+
+    for (int i = 0; i < portNUM_PROCESSORS; i++)
+    {
+        s_log.ring[i].buf = calloc(1, size);
+        if (!s_log.ring[i].buf)
+            goto fail;
+        s_log.ring[i].mask = size - 1;
+    }
+    s_log.binary = config->binary;
+
+    if (xTaskCreatePinnedToCore(asynclog_task, "asynclog", TASK_STACK, NULL,
+                                config->task_priority, &s_log.task, config->task_core) != pdPASS)
+        goto fail;
+
+    s_log.prev = esp_log_set_vprintf(asynclog_vprintf);
+    ESP_LOGI(TAG, "Installed, %d rings of %" PRIu32 " bytes", portNUM_PROCESSORS, size);
+
+    return ESP_OK;
+
+fail:
+    for (int i = 0; i < portNUM_PROCESSORS; i++)
+    {
+        free(s_log.ring[i].buf);
+        s_log.ring[i].buf = NULL;
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void asynclog_write(const char *fmt, const asynclog_word_t *words, size_t count)
+{
+    if (count > ASYNCLOG_MAX_ARGS + 2)
+        count = ASYNCLOG_MAX_ARGS + 2;
+
+    if (!s_log.prev)
+    {
+        char line[ASYNCLOG_MAX_LINE];
+        asynclog_render(fmt, (const uint8_t *)words, count * sizeof(*words), true, line, sizeof(line));
+        printf("%s", line);
+        return;
+    }
+
+    push(fmt, REC_WORDS, words, count * sizeof(*words));
+}
+
+esp_err_t asynclog_flush(TickType_t timeout)
+{
+    if (!s_log.prev)
+        return ESP_OK;
+
+    TickType_t start = xTaskGetTickCount();
+    while (1)
+    {
+        bool empty = true;
+        for (int i = 0; i < portNUM_PROCESSORS; i++)
+            empty = empty && __atomic_load_n(&s_log.ring[i].tail, __ATOMIC_ACQUIRE)
+                == __atomic_load_n(&s_log.ring[i].head, __ATOMIC_ACQUIRE);
+        if (empty)
+            return ESP_OK;
+        if (xTaskGetTickCount() - start >= timeout)
+            return ESP_ERR_TIMEOUT;
+        xTaskNotifyGive(s_log.task);
+        vTaskDelay(1);
+    }
+}
+
+esp_err_t asynclog_get_stats(asynclog_stats_t *stats)
+{
+    CHECK_ARG(stats);
+
+    stats->logged = __atomic_load_n(&s_log.stats.logged, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&s_log.stats.dropped, __ATOMIC_RELAXED);
+    stats->truncated = __atomic_load_n(&s_log.stats.truncated, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&s_log.stats.bytes, __ATOMIC_RELAXED);
+
+    return ESP_OK;
+}
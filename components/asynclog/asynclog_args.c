@@ -0,0 +1,342 @@
+/**
+ * @file asynclog_args.c
+ *
+ * Capture and deferred rendering of printf arguments.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "asynclog.h"
+#include "asynclog_args.h"
+
+static asynclog_arg_kind_t int_kind(uint8_t size)
+{
+    return size == 8 ? ASYNCLOG_ARG_INT64 : ASYNCLOG_ARG_INT;
+}
+
+static bool put(uint8_t *out, size_t max, size_t *n, const void *v, size_t size)
+{
+    if (*n + size > max)
+        return false;
+    memcpy(out + *n, v, size);
+    *n += size;
+
+    return true;
+}
+
+static bool get(const uint8_t *args, size_t len, size_t *n, void *v, size_t size)
+{
+    if (*n + size > len)
+        return false;
+    memcpy(v, args + *n, size);
+    *n += size;
+
+    return true;
+}
+
+static bool get_int(const uint8_t *args, size_t len, size_t *n, bool words, int *v)
+{
+    asynclog_word_t w;
+
+    if (!words)
+        return get(args, len, n, v, sizeof(*v));
+    if (!get(args, len, n, &w, sizeof(w)))
+        return false;
+    *v = (int)w;
+
+    return true;
+}
+
+/* One conversion of a binary record */
+static int render_word(const asynclog_spec_t *spec, const char *conv, asynclog_word_t w, char *out, size_t room)
+{
+    switch (spec->kind)
+    {
+        case ASYNCLOG_ARG_INT:
+            return snprintf(out, room, conv, (unsigned int)w);
+        case ASYNCLOG_ARG_INT64:
+        {
+            // Truncated by the caller, signed conversions are extended again
+            long long v = strchr("di", spec->end[-1]) ? (long long)(int32_t)w : (long long)(uint32_t)w;
+            return snprintf(out, room, conv, v);
+        }
+        case ASYNCLOG_ARG_DOUBLE:
+        {
+            uint32_t bits = (uint32_t)w;
+            float v;
+            memcpy(&v, &bits, sizeof(v));
+            return snprintf(out, room, conv, (double)v);
+        }
+        case ASYNCLOG_ARG_PTR:
+            return snprintf(out, room, conv, (void *)w);
+        case ASYNCLOG_ARG_STR:
+            return snprintf(out, room, conv, w ? (const char *)w : "(null)");
+        default:
+            return -1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const char *asynclog_parse_spec(const char *p, asynclog_spec_t *spec)
+{
+    spec->start = p++;
+    spec->stars = 0;
+
+    while (*p && strchr("-+ #0", *p))
+        p++;
+    if (*p == '*')
+    {
+        spec->stars++;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9')
+        p++;
+    if (*p == '.')
+    {
+        p++;
+        if (*p == '*')
+        {
+            spec->stars++;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9')
+            p++;
+    }
+
+    uint8_t size = sizeof(int);
+    switch (*p)
+    {
+        case 'h':
+            while (*p == 'h')
+                p++;
+            break;
+        case 'l':
+            p++;
+            size = sizeof(long);
+            if (*p == 'l')
+            {
+                p++;
+                size = sizeof(long long);
+            }
+            break;
+        case 'j':
+        case 'q':
+            p++;
+            size = sizeof(long long);
+            break;
+        case 'z':
+        case 't':
+            p++;
+            size = sizeof(size_t);
+            break;
+        case 'L':
+            p++;
+            break;
+    }
+
+    switch (*p)
+    {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            spec->kind = int_kind(size);
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec->kind = ASYNCLOG_ARG_DOUBLE;
+            break;
+        case 'p':
+            spec->kind = ASYNCLOG_ARG_PTR;
+            break;
+        case 's':
+            spec->kind = ASYNCLOG_ARG_STR;
+            break;
+        default:
+            spec->kind = ASYNCLOG_ARG_NONE;
+            break;
+    }
+    if (*p)
+        p++;
+    spec->end = p;
+
+    return p;
+}
+
+size_t asynclog_capture(const char *fmt, va_list args, uint8_t *out, size_t max, bool *truncated)
+{
+    size_t n = 0;
+    bool ok = true;
+
+    for (const char *p = fmt; ok && (p = strchr(p, '%'));)
+    {
+        asynclog_spec_t spec;
+        p = asynclog_parse_spec(p, &spec);
+
+        for (uint8_t i = 0; ok && i < spec.stars; i++)
+        {
+            int v = va_arg(args, int);
+            ok = put(out, max, &n, &v, sizeof(v));
+        }
+        if (!ok)
+            break;
+
+        switch (spec.kind)
+        {
+            case ASYNCLOG_ARG_INT:
+            {
+                unsigned int v = va_arg(args, unsigned int);
+                ok = put(out, max, &n, &v, sizeof(v));
+                break;
+            }
+            case ASYNCLOG_ARG_INT64:
+            {
+                unsigned long long v = va_arg(args, unsigned long long);
+                ok = put(out, max, &n, &v, sizeof(v));
+                break;
+            }
+            case ASYNCLOG_ARG_DOUBLE:
+            {
+                double v = va_arg(args, double);
+                ok = put(out, max, &n, &v, sizeof(v));
+                break;
+            }
+            case ASYNCLOG_ARG_PTR:
+            {
+                void *v = va_arg(args, void *);
+                ok = put(out, max, &n, &v, sizeof(v));
+                break;
+            }
+            case ASYNCLOG_ARG_STR:
+            {
+                const char *s = va_arg(args, const char *);
+                if (!s)
+                    s = "(null)";
+                size_t len = strnlen(s, ASYNCLOG_MAX_STRING - 1);
+                ok = n + len + 1 <= max;
+                if (ok)
+                {
+                    memcpy(out + n, s, len);
+                    out[n + len] = 0;
+                    n += len + 1;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    *truncated = !ok;
+
+    return n;
+}
+
+size_t asynclog_render(const char *fmt, const uint8_t *args, size_t len, bool words, char *out, size_t max)
+{
+    size_t pos = 0;
+    size_t n = 0;
+    const char *p = fmt;
+
+    if (!max)
+        return 0;
+
+    while (*p && pos + 1 < max)
+    {
+        if (*p != '%')
+        {
+            out[pos++] = *p++;
+            continue;
+        }
+
+        asynclog_spec_t spec;
+        const char *next = asynclog_parse_spec(p, &spec);
+        size_t room = max - pos;
+        int w = -1;
+
+        // Rebuild the conversion with the captured '*' values
+        char conv[24];
+        size_t c = 0;
+        bool ok = true;
+        for (const char *s = spec.start; ok && s < spec.end; s++)
+        {
+            if (*s == '*')
+            {
+                int v;
+                ok = get_int(args, len, &n, words, &v);
+                if (ok)
+                    c += snprintf(conv + c, sizeof(conv) - c, "%d", v);
+            }
+            else
+                conv[c++] = *s;
+            ok = ok && c < sizeof(conv) - 1;
+        }
+        conv[ok ? c : 0] = 0;
+
+        if (ok && words && spec.kind != ASYNCLOG_ARG_NONE)
+        {
+            asynclog_word_t v;
+            if (get(args, len, &n, &v, sizeof(v)))
+                w = render_word(&spec, conv, v, out + pos, room);
+        }
+        else if (ok)
+        {
+            switch (spec.kind)
+            {
+                case ASYNCLOG_ARG_INT:
+                {
+                    unsigned int v;
+                    if (get(args, len, &n, &v, sizeof(v)))
+                        w = snprintf(out + pos, room, conv, v);
+                    break;
+                }
+                case ASYNCLOG_ARG_INT64:
+                {
+                    unsigned long long v;
+                    if (get(args, len, &n, &v, sizeof(v)))
+                        w = snprintf(out + pos, room, conv, v);
+                    break;
+                }
+                case ASYNCLOG_ARG_DOUBLE:
+                {
+                    double v;
+                    if (get(args, len, &n, &v, sizeof(v)))
+                        w = snprintf(out + pos, room, conv, v);
+                    break;
+                }
+                case ASYNCLOG_ARG_PTR:
+                {
+                    void *v;
+                    if (get(args, len, &n, &v, sizeof(v)))
+                        w = snprintf(out + pos, room, conv, v);
+                    break;
+                }
+                case ASYNCLOG_ARG_STR:
+                {
+                    size_t slen = n < len ? strnlen((const char *)args + n, len - n) : len;
+                    if (n + slen < len)
+                    {
+                        w = snprintf(out + pos, room, conv, (const char *)args + n);
+                        n += slen + 1;
+                    }
+                    break;
+                }
+                default:
+                    if (spec.end[-1] == '%')
+                    {
+                        out[pos] = '%';
+                        w = 1;
+                    }
+                    break;
+            }
+        }
+
+        if (w < 0)
+        {
+            // No data for it, show the conversion itself
+            w = snprintf(out + pos, room, "%.*s", (int)(spec.end - spec.start), spec.start);
+            n = len;
+        }
+        pos += (size_t)w < room ? (size_t)w : room - 1;
+        p = next;
+    }
+    out[pos] = 0;
+
+    return pos;
+}
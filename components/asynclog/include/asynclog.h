@@ -0,0 +1,94 @@
+/**
+ * @file asynclog.h
+ * @defgroup asynclog asynclog
+ * @{
+ *
+ * Asynchronous ESP_LOG backend.
+ *
+ * Installed with `esp_log_set_vprintf()`, it takes formatting and UART
+ * output off the caller's path. A log call only walks its format string to
+ * copy the format pointer and the raw arguments (strings by value) into a
+ * lock-free ring buffer of the calling core. A low priority task formats
+ * the records and hands them to the previous vprintf. When a ring is full
+ * the record is dropped and counted.
+ *
+ * asynclog_bin.h adds binary records that skip the format string walk.
+ */
+#ifndef __ASYNCLOG_H__
+#define __ASYNCLOG_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "freertos/FreeRTOS.h"
+#include "asynclog_bin.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASYNCLOG_MAX_RECORD 160  //!< Largest record in bytes, longer argument lists are truncated
+#define ASYNCLOG_MAX_STRING 48   //!< Longest string argument copied, including the terminator
+#define ASYNCLOG_MAX_LINE   256  //!< Longest formatted line
+
+/**
+ * Logger configuration
+ */
+typedef struct
+{
+    size_t ring_size;            //!< Bytes per core, rounded down to a power of two
+    UBaseType_t task_priority;   //!< Priority of the output task, keep it low
+    BaseType_t task_core;        //!< Core of the output task, or `tskNO_AFFINITY`
+    bool binary;                 //!< Write binary records as frames for tools/asynclog_decode.py
+} asynclog_config_t;
+
+#define ASYNCLOG_DEFAULT_CONFIG() { \
+    .ring_size = 4096, \
+    .task_priority = 1, \
+    .task_core = tskNO_AFFINITY, \
+    .binary = false, \
+}
+
+/**
+ * Logger statistics
+ */
+typedef struct
+{
+    uint32_t logged;             //!< Records queued
+    uint32_t dropped;            //!< Records lost to a full ring
+    uint32_t truncated;          //!< Records with arguments cut off
+    uint32_t bytes;              //!< Bytes written out by the output task
+} asynclog_stats_t;
+
+/**
+ * @brief Allocate the rings, start the output task and install the backend
+ *
+ * @param config Logger configuration
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_STATE` if already installed
+ */
+esp_err_t asynclog_install(const asynclog_config_t *config);
+
+/**
+ * @brief Wait until all queued records are written
+ *
+ * @param timeout Ticks to wait
+ * @return `ESP_OK` on success, `ESP_ERR_TIMEOUT` otherwise
+ */
+esp_err_t asynclog_flush(TickType_t timeout);
+
+/**
+ * @brief Get the logger statistics
+ *
+ * @param[out] stats Statistics
+ * @return `ESP_OK` on success
+ */
+esp_err_t asynclog_get_stats(asynclog_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __ASYNCLOG_H__ */
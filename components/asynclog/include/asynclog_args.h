@@ -0,0 +1,73 @@
+/**
+ * @file asynclog_args.h
+ * @defgroup asynclog_args asynclog_args
+ * @{
+ *
+ * Capture and deferred rendering of printf arguments.
+ *
+ * Arguments are stored in the order of the conversions of the format
+ * string: `*` widths and integers up to 32 bits as 4 bytes, 64 bit
+ * integers and doubles as 8 bytes, pointers with their native size and
+ * strings by value, NUL terminated. Nothing is aligned.
+ *
+ * Binary records hold one asynclog_word_t per argument instead, see
+ * asynclog_bin.h.
+ *
+ * No platform dependencies, so lines can be checked on the host.
+ */
+#ifndef __ASYNCLOG_ARGS_H__
+#define __ASYNCLOG_ARGS_H__
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "asynclog_bin.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    ASYNCLOG_ARG_NONE = 0,       // %% or unsupported conversion
+    ASYNCLOG_ARG_INT,
+    ASYNCLOG_ARG_INT64,
+    ASYNCLOG_ARG_DOUBLE,
+    ASYNCLOG_ARG_PTR,
+    ASYNCLOG_ARG_STR,
+} asynclog_arg_kind_t;
+
+typedef struct
+{
+    const char *start;           // the '%'
+    const char *end;             // past the conversion character
+    uint8_t stars;               // '*' width and precision
+    asynclog_arg_kind_t kind;
+} asynclog_spec_t;
+
+/**
+ * Parse the conversion at `p`, which points at a '%'. Returns the end of it.
+ */
+const char *asynclog_parse_spec(const char *p, asynclog_spec_t *spec);
+
+/**
+ * Copy the arguments of `fmt` from `args`. Returns the number of bytes
+ * used in `out`, `truncated` is set when they did not fit in `max`.
+ */
+size_t asynclog_capture(const char *fmt, va_list args, uint8_t *out, size_t max, bool *truncated);
+
+/**
+ * Format `fmt` with captured arguments into `out`, `words` selects the
+ * layout of binary records. Conversions without captured data are copied
+ * verbatim. Returns the length of the line.
+ */
+size_t asynclog_render(const char *fmt, const uint8_t *args, size_t len, bool words, char *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __ASYNCLOG_ARGS_H__ */
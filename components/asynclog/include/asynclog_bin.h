@@ -0,0 +1,121 @@
+/**
+ * @file asynclog_bin.h
+ * @defgroup asynclog_bin asynclog_bin
+ * @{
+ *
+ * Binary log records.
+ *
+ * `ASYNCLOG_LOGI()` and friends take the same arguments as `ESP_LOGI()`,
+ * but the format string is never walked on the target. Every argument is
+ * turned into one word at compile time, and the call queues the address of
+ * the format string, which identifies the log site, followed by the words.
+ *
+ * With `binary` set in ::asynclog_config_t the output task writes these
+ * records as frames of a few bytes, and tools/asynclog_decode.py rebuilds
+ * the lines from the format strings in the ELF file. Otherwise they are
+ * formatted on the target like any other record.
+ *
+ * As arguments are words:
+ *  - 64 bit integers are truncated to 32 bits
+ *  - doubles are stored as floats
+ *  - `%s` stores the pointer, so only strings in flash or static data can
+ *    be decoded on the host, and only strings that outlive the record can
+ *    be formatted on the target
+ *
+ * Only for C sources, the macros rely on `_Generic`.
+ */
+#ifndef __ASYNCLOG_BIN_H__
+#define __ASYNCLOG_BIN_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <esp_log.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASYNCLOG_MAX_ARGS 8      //!< Arguments of a binary log call, besides timestamp and tag
+
+/**
+ * One argument of a binary record
+ */
+typedef uintptr_t asynclog_word_t;
+
+/**
+ * @brief Queue a binary record, use the `ASYNCLOG_LOGx()` macros instead
+ *
+ * Formats and prints the record right away if the logger is not installed.
+ *
+ * @param fmt Format string, its address is the log site ID
+ * @param words Arguments
+ * @param count Number of arguments
+ */
+void asynclog_write(const char *fmt, const asynclog_word_t *words, size_t count);
+
+static inline asynclog_word_t asynclog_float_word(float v)
+{
+    uint32_t w;
+    memcpy(&w, &v, sizeof(w));
+    return w;
+}
+
+static inline void __attribute__((format(printf, 1, 2))) asynclog_check_format(const char *fmt, ...)
+{
+    (void)fmt;
+}
+
+#define ASYNCLOG_WORD(x) (_Generic((x), float: 1, double: 1, default: 0) \
+    ? asynclog_float_word(_Generic((x), float: (x), double: (x), default: 0.0f)) \
+    : (asynclog_word_t)_Generic((x), float: 0, double: 0, default: (x)))
+
+#define ASYNCLOG_CAT_(a, b) a ## b
+#define ASYNCLOG_CAT(a, b) ASYNCLOG_CAT_(a, b)
+#define ASYNCLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, N, ...) N
+#define ASYNCLOG_NARGS(...) ASYNCLOG_NARGS_(0, ##__VA_ARGS__, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+#define ASYNCLOG_WORDS_0()
+#define ASYNCLOG_WORDS_1(a) ASYNCLOG_WORD(a)
+#define ASYNCLOG_WORDS_2(a, ...) ASYNCLOG_WORD(a), ASYNCLOG_WORDS_1(__VA_ARGS__)
+#define ASYNCLOG_WORDS_3(a, ...) ASYNCLOG_WORD(a), ASYNCLOG_WORDS_2(__VA_ARGS__)
+#define ASYNCLOG_WORDS_4(a, ...) ASYNCLOG_WORD(a), ASYNCLOG_WORDS_3(__VA_ARGS__)
+#define ASYNCLOG_WORDS_5(a, ...) ASYNCLOG_WORD(a), ASYNCLOG_WORDS_4(__VA_ARGS__)
+#define ASYNCLOG_WORDS_6(a, ...) ASYNCLOG_WORD(a), ASYNCLOG_WORDS_5(__VA_ARGS__)
+#define ASYNCLOG_WORDS_7(a, ...) ASYNCLOG_WORD(a), ASYNCLOG_WORDS_6(__VA_ARGS__)
+#define ASYNCLOG_WORDS_8(a, ...) ASYNCLOG_WORD(a), ASYNCLOG_WORDS_7(__VA_ARGS__)
+#define ASYNCLOG_WORDS_9(a, ...) ASYNCLOG_WORD(a), ASYNCLOG_WORDS_8(__VA_ARGS__)
+#define ASYNCLOG_WORDS_10(a, ...) ASYNCLOG_WORD(a), ASYNCLOG_WORDS_9(__VA_ARGS__)
+#define ASYNCLOG_WORDS(...) ASYNCLOG_CAT(ASYNCLOG_WORDS_, ASYNCLOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+/**
+ * Queue a binary record with a format string and up to ASYNCLOG_MAX_ARGS + 2
+ * arguments. The format strings share a section, so the decoder and the map
+ * file can tell them apart.
+ */
+#define ASYNCLOG_WRITE(fmt, ...) do { \
+        static const char _asynclog_fmt[] __attribute__((section(".rodata.asynclog_fmt"))) = fmt; \
+        const asynclog_word_t _asynclog_words[] = { ASYNCLOG_WORDS(__VA_ARGS__) }; \
+        if (0) \
+            asynclog_check_format(fmt, ##__VA_ARGS__); \
+        asynclog_write(_asynclog_fmt, _asynclog_words, ASYNCLOG_NARGS(__VA_ARGS__)); \
+    } while (0)
+
+#define ASYNCLOG_LEVEL(level, letter, tag, fmt, ...) do { \
+        if (LOG_LOCAL_LEVEL >= level) \
+            ASYNCLOG_WRITE(LOG_FORMAT(letter, fmt), esp_log_timestamp(), tag, ##__VA_ARGS__); \
+    } while (0)
+
+#define ASYNCLOG_LOGE(tag, fmt, ...) ASYNCLOG_LEVEL(ESP_LOG_ERROR, E, tag, fmt, ##__VA_ARGS__)
+#define ASYNCLOG_LOGW(tag, fmt, ...) ASYNCLOG_LEVEL(ESP_LOG_WARN, W, tag, fmt, ##__VA_ARGS__)
+#define ASYNCLOG_LOGI(tag, fmt, ...) ASYNCLOG_LEVEL(ESP_LOG_INFO, I, tag, fmt, ##__VA_ARGS__)
+#define ASYNCLOG_LOGD(tag, fmt, ...) ASYNCLOG_LEVEL(ESP_LOG_DEBUG, D, tag, fmt, ##__VA_ARGS__)
+#define ASYNCLOG_LOGV(tag, fmt, ...) ASYNCLOG_LEVEL(ESP_LOG_VERBOSE, V, tag, fmt, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __ASYNCLOG_BIN_H__ */
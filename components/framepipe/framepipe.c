@@ -0,0 +1,246 @@
+/**
+ * @file framepipe.c
+ *
+ * Two-stage render/output pipeline: the render and output tasks.
+ */
+#include <stdlib.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "framepipe.h"
+#include "framepipe_queue.h"
+
+static const char *TAG = "framepipe";
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define SLOT_ALIGN   8           // frames of uint64_t images
+
+typedef struct
+{
+    TickType_t hold;
+    int64_t render_us;           // start of the render
+} slot_t;
+
+/*
+ * framepipe_del() sets `deleter` and `stop` and notifies both tasks. Each
+ * task finishes the frame it is on, counts itself in `parked`, notifies the
+ * deleting task and suspends itself, it touches nothing of the pipeline
+ * after that. Both tasks notify each other, so they are only deleted once
+ * both are parked.
+ */
+struct framepipe
+{
+    framepipe_config_t config;
+    size_t stride;
+    uint8_t *frames;
+    slot_t slot[FRAMEPIPE_MAX_DEPTH];
+    framepipe_queue_t queue;
+    bool stop;
+    TaskHandle_t deleter;        // task in framepipe_del(), set before `stop`
+    uint32_t parked;             // tasks done with the pipeline
+    TaskHandle_t render_task;
+    TaskHandle_t output_task;
+    portMUX_TYPE lock;           // statistics
+    framepipe_stats_t stats;
+};
+
+// Ticks are compared through their difference, so the counter may wrap
+static bool reached(TickType_t now, TickType_t at)
+{
+    return (int32_t)(now - at) >= 0;
+}
+
+static bool stopping(framepipe_handle_t p)
+{
+    return __atomic_load_n(&p->stop, __ATOMIC_ACQUIRE);
+}
+
+static void park(framepipe_handle_t p)
+{
+    // The pipeline may be freed as soon as `parked` is counted
+    TaskHandle_t deleter = p->deleter;
+    __atomic_add_fetch(&p->parked, 1, __ATOMIC_RELEASE);
+    xTaskNotifyGive(deleter);
+    vTaskSuspend(NULL);
+}
+
+static void add_timing(framepipe_timing_t *t, uint32_t us)
+{
+    t->frames++;
+    t->last_us = us;
+    if (us > t->max_us)
+        t->max_us = us;
+    t->total_us += us;
+}
+
+static void render_task(void *arg)
+{
+    framepipe_handle_t p = arg;
+    uint32_t seq = 0;
+
+    while (1)
+    {
+        // The output task notifies every slot it releases
+        int slot;
+        bool stalled = false;
+        while ((slot = framepipe_queue_acquire(&p->queue)) < 0 && !stopping(p))
+        {
+            stalled = true;
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        if (stopping(p))
+            break;
+
+        uint32_t hold_ms = 0;
+        int64_t start = esp_timer_get_time();
+        esp_err_t err = p->config.render(p->config.ctx, p->frames + slot * p->stride, seq++, &hold_ms);
+        int64_t end = esp_timer_get_time();
+
+        // Counted before the frame is published, so no frame is output uncounted
+        portENTER_CRITICAL(&p->lock);
+        p->stats.stalls += stalled;
+        if (err == ESP_OK)
+            add_timing(&p->stats.render, end - start);
+        else
+            p->stats.errors++;
+        portEXIT_CRITICAL(&p->lock);
+
+        if (err == ESP_OK)
+        {
+            p->slot[slot].hold = pdMS_TO_TICKS(hold_ms);
+            p->slot[slot].render_us = start;
+            framepipe_queue_publish(&p->queue);
+            xTaskNotifyGive(p->output_task);
+        }
+        else
+        {
+            // Let lower priority tasks run if the render keeps failing
+            ESP_LOGD(TAG, "Frame dropped: %s", esp_err_to_name(err));
+            vTaskDelay(1);
+        }
+    }
+
+    park(p);
+}
+
+static void output_task(void *arg)
+{
+    framepipe_handle_t p = arg;
+    TickType_t due = xTaskGetTickCount();
+    bool paced = false;          // the last frame asked to be held
+
+    while (1)
+    {
+        // Keep the previous frame up for its time, renders wake us early
+        TickType_t now;
+        while (!reached(now = xTaskGetTickCount(), due) && !stopping(p))
+            ulTaskNotifyTake(pdTRUE, due - now);
+
+        int slot = framepipe_queue_peek(&p->queue);
+        bool late = slot < 0;
+        while (slot < 0 && !stopping(p))
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            slot = framepipe_queue_peek(&p->queue);
+        }
+        if (stopping(p))
+            break;
+
+        int64_t start = esp_timer_get_time();
+        esp_err_t err = p->config.output(p->config.ctx, p->frames + slot * p->stride);
+        int64_t end = esp_timer_get_time();
+        TickType_t hold = p->slot[slot].hold;
+        int64_t render_us = p->slot[slot].render_us;
+        framepipe_queue_release(&p->queue);
+        xTaskNotifyGive(p->render_task);
+
+        if (err != ESP_OK)
+            ESP_LOGE(TAG, "Failed to output frame: %s", esp_err_to_name(err));
+
+        portENTER_CRITICAL(&p->lock);
+        add_timing(&p->stats.output, end - start);
+        p->stats.latency_us = end - render_us;
+        if (p->stats.latency_us > p->stats.latency_us_max)
+            p->stats.latency_us_max = p->stats.latency_us;
+        p->stats.underruns += late && paced;
+        p->stats.errors += err != ESP_OK;
+        portEXIT_CRITICAL(&p->lock);
+
+        // A late frame starts a new cadence
+        due = (late ? xTaskGetTickCount() : due) + hold;
+        paced = hold > 0;
+    }
+
+    park(p);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t framepipe_new(const framepipe_config_t *config, framepipe_handle_t *pipe)
+{
+    CHECK_ARG(config && config->render && config->output && config->frame_size && pipe);
+    CHECK_ARG(config->depth >= 2 && config->depth <= FRAMEPIPE_MAX_DEPTH && !(config->depth & (config->depth - 1)));
+
+    framepipe_handle_t p = calloc(1, sizeof(struct framepipe));
+    if (!p)
+        return ESP_ERR_NO_MEM;
+    p->config = *config;
+    p->stride = (config->frame_size + SLOT_ALIGN - 1) & ~(size_t)(SLOT_ALIGN - 1);
+    p->frames = calloc(config->depth, p->stride);
+    if (!p->frames)
+        goto fail;
+    framepipe_queue_init(&p->queue, config->depth);
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    p->lock = lock;
+
+    // The render task notifies the output task, so the output task comes first
+    if (xTaskCreatePinnedToCore(output_task, "fp_output", config->output_stage.stack_size, p,
+                                config->output_stage.priority, &p->output_task, config->output_stage.core) != pdPASS)
+        goto fail;
+    if (xTaskCreatePinnedToCore(render_task, "fp_render", config->render_stage.stack_size, p,
+                                config->render_stage.priority, &p->render_task, config->render_stage.core) != pdPASS)
+    {
+        vTaskDelete(p->output_task);
+        goto fail;
+    }
+
+    ESP_LOGI(TAG, "Started, %d frames of %d bytes, render on core %d, output on core %d", config->depth,
+             (int)config->frame_size, (int)config->render_stage.core, (int)config->output_stage.core);
+
+    *pipe = p;
+    return ESP_OK;
+
+fail:
+    free(p->frames);
+    free(p);
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t framepipe_del(framepipe_handle_t pipe)
+{
+    CHECK_ARG(pipe);
+
+    pipe->deleter = xTaskGetCurrentTaskHandle();
+    __atomic_store_n(&pipe->stop, true, __ATOMIC_RELEASE);
+    xTaskNotifyGive(pipe->render_task);
+    xTaskNotifyGive(pipe->output_task);
+    while (__atomic_load_n(&pipe->parked, __ATOMIC_ACQUIRE) < 2)
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    vTaskDelete(pipe->render_task);
+    vTaskDelete(pipe->output_task);
+
+    free(pipe->frames);
+    free(pipe);
+
+    return ESP_OK;
+}
+
+void framepipe_get_stats(framepipe_handle_t pipe, framepipe_stats_t *stats)
+{
+    portENTER_CRITICAL(&pipe->lock);
+    *stats = pipe->stats;
+    portEXIT_CRITICAL(&pipe->lock);
+    stats->queued = framepipe_queue_count(&pipe->queue);
+}
@@ -0,0 +1,161 @@
+/**
+ * @file framepipe.h
+ * @defgroup framepipe framepipe
+ * @{
+ *
+ * Two-stage render/output pipeline for displays.
+ *
+ * A render task fills frames into the slots of a lock-free single-producer/
+ * single-consumer queue (framepipe_queue.h) and an output task flushes them
+ * to the display, each on its own core by default. Rendering the next frame
+ * overlaps with the SPI or RMT transfer of the previous one, and the tasks
+ * only wake each other with task notifications.
+ *
+ * The render callback sets how long its frame stays on the display. The
+ * output task keeps that cadence, so the render task may run up to the
+ * queue depth ahead. Both stages are timed; a frame that was due but not
+ * rendered yet counts as an underrun, a render stage that found all slots
+ * full counts as a stall.
+ */
+#ifndef __FRAMEPIPE_H__
+#define __FRAMEPIPE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include <sdkconfig.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAMEPIPE_MAX_DEPTH  8   //!< Most frames in flight
+
+#if CONFIG_FREERTOS_UNICORE
+#define FRAMEPIPE_RENDER_CORE tskNO_AFFINITY
+#define FRAMEPIPE_OUTPUT_CORE tskNO_AFFINITY
+#else
+#define FRAMEPIPE_RENDER_CORE 1  //!< APP CPU, away from the Wi-Fi and BT stacks
+#define FRAMEPIPE_OUTPUT_CORE 0  //!< PRO CPU, where the SPI and RMT drivers take their interrupts
+#endif
+
+/**
+ * @brief Render a frame, called from the render task
+ *
+ * @param ctx Context of the pipeline configuration
+ * @param frame Slot to fill, `frame_size` bytes
+ * @param seq Frame number, counts from 0
+ * @param[out] hold_ms Time the frame stays on the display, 0 to show the next one as soon as it is rendered
+ * @return `ESP_OK` to queue the frame, anything else drops it
+ */
+typedef esp_err_t (*framepipe_render_t)(void *ctx, void *frame, uint32_t seq, uint32_t *hold_ms);
+
+/**
+ * @brief Flush a frame to the display, called from the output task
+ *
+ * The slot is reused once the callback returns.
+ *
+ * @param ctx Context of the pipeline configuration
+ * @param frame Rendered frame
+ * @return `ESP_OK` on success, errors are logged and counted
+ */
+typedef esp_err_t (*framepipe_output_t)(void *ctx, const void *frame);
+
+/**
+ * Task of a stage
+ */
+typedef struct
+{
+    UBaseType_t priority;
+    BaseType_t core;             //!< Core to pin the task to, or `tskNO_AFFINITY`
+    uint32_t stack_size;         //!< Bytes
+} framepipe_stage_t;
+
+/**
+ * Pipeline configuration
+ */
+typedef struct
+{
+    size_t frame_size;           //!< Bytes per frame
+    uint8_t depth;               //!< Frames in flight, a power of two up to `FRAMEPIPE_MAX_DEPTH`
+    framepipe_render_t render;
+    framepipe_output_t output;
+    void *ctx;                   //!< Passed to both callbacks
+    framepipe_stage_t render_stage;
+    framepipe_stage_t output_stage;
+} framepipe_config_t;
+
+#define FRAMEPIPE_DEFAULT_CONFIG() { \
+    .frame_size = 0, \
+    .depth = 2, \
+    .render = NULL, \
+    .output = NULL, \
+    .ctx = NULL, \
+    .render_stage = { .priority = 4, .core = FRAMEPIPE_RENDER_CORE, .stack_size = 3072 }, \
+    .output_stage = { .priority = 5, .core = FRAMEPIPE_OUTPUT_CORE, .stack_size = 3072 }, \
+}
+
+/**
+ * Timing of a stage
+ */
+typedef struct
+{
+    uint32_t frames;             //!< Frames through the stage
+    uint32_t last_us;            //!< Duration of the last frame
+    uint32_t max_us;             //!< Worst frame so far
+    uint64_t total_us;           //!< All frames, for the average
+} framepipe_timing_t;
+
+/**
+ * Pipeline statistics
+ */
+typedef struct
+{
+    framepipe_timing_t render;
+    framepipe_timing_t output;
+    uint32_t latency_us;         //!< Start of the render to the end of the output, last frame
+    uint32_t latency_us_max;     //!< Worst frame so far
+    uint32_t stalls;             //!< Renders that waited for a free slot, the render stage is ahead
+    uint32_t underruns;          //!< Frames that were due before they were rendered
+    uint32_t errors;             //!< Frames dropped by the render or failed by the output
+    uint8_t queued;              //!< Frames waiting for the output now
+} framepipe_stats_t;
+
+typedef struct framepipe *framepipe_handle_t;
+
+/**
+ * @brief Allocate the frame slots and start both tasks
+ *
+ * @param config Pipeline configuration
+ * @param[out] pipe Pipeline handle
+ * @return `ESP_OK` on success
+ */
+esp_err_t framepipe_new(const framepipe_config_t *config, framepipe_handle_t *pipe);
+
+/**
+ * @brief Stop both tasks and free the pipeline
+ *
+ * Waits for a render or output that is running, queued frames are dropped.
+ * The stopped tasks wake the caller through its task notification.
+ *
+ * @param pipe Pipeline handle
+ * @return `ESP_OK` on success
+ */
+esp_err_t framepipe_del(framepipe_handle_t pipe);
+
+/**
+ * @brief Get a copy of the pipeline statistics
+ *
+ * @param pipe Pipeline handle
+ * @param[out] stats Statistics
+ */
+void framepipe_get_stats(framepipe_handle_t pipe, framepipe_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __FRAMEPIPE_H__ */
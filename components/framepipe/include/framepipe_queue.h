@@ -0,0 +1,116 @@
+/**
+ * @file framepipe_queue.h
+ * @defgroup framepipe_queue framepipe_queue
+ * @{
+ *
+ * Lock-free single-producer/single-consumer queue of frame slots.
+ *
+ * The queue only hands out slot indices, the frames stay in place. The
+ * producer acquires the slot at `head`, fills it and publishes it; the
+ * consumer peeks the slot at `tail`, uses it and releases it. Each counter
+ * has a single writer and both run freely, so no locks or critical
+ * sections are needed, on one core or two.
+ *
+ * No platform dependencies, so the queue can be checked on the host.
+ */
+#ifndef __FRAMEPIPE_QUEUE_H__
+#define __FRAMEPIPE_QUEUE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Queue of slot indices
+ */
+typedef struct
+{
+    uint32_t head;               //!< Slots published, written by the producer only
+    uint32_t tail;               //!< Slots released, written by the consumer only
+    uint32_t mask;               //!< Slots - 1, a power of two
+} framepipe_queue_t;
+
+/**
+ * @brief Initialize an empty queue
+ *
+ * @param q Queue
+ * @param slots Number of slots, a power of two
+ */
+static inline void framepipe_queue_init(framepipe_queue_t *q, uint32_t slots)
+{
+    q->head = 0;
+    q->tail = 0;
+    q->mask = slots - 1;
+}
+
+/**
+ * @brief Slot the producer may fill, producer only
+ *
+ * @param q Queue
+ * @return Slot index, -1 if all slots are in use
+ */
+static inline int framepipe_queue_acquire(const framepipe_queue_t *q)
+{
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    if (q->head - tail > q->mask)
+        return -1;
+    return q->head & q->mask;
+}
+
+/**
+ * @brief Hand the acquired slot to the consumer, producer only
+ *
+ * @param q Queue
+ */
+static inline void framepipe_queue_publish(framepipe_queue_t *q)
+{
+    __atomic_store_n(&q->head, q->head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Oldest published slot, consumer only
+ *
+ * @param q Queue
+ * @return Slot index, -1 if the queue is empty
+ */
+static inline int framepipe_queue_peek(const framepipe_queue_t *q)
+{
+    uint32_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if (head == q->tail)
+        return -1;
+    return q->tail & q->mask;
+}
+
+/**
+ * @brief Give the peeked slot back to the producer, consumer only
+ *
+ * @param q Queue
+ */
+static inline void framepipe_queue_release(framepipe_queue_t *q)
+{
+    __atomic_store_n(&q->tail, q->tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Published slots not yet released, from either side
+ *
+ * @param q Queue
+ * @return Number of slots
+ */
+static inline uint32_t framepipe_queue_count(const framepipe_queue_t *q)
+{
+    // Tail first, head can only have grown since
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) - tail;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __FRAMEPIPE_QUEUE_H__ */
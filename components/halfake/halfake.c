@@ -0,0 +1,69 @@
+/**
+ * @file halfake.c
+ *
+ * Call log of the driver fakes.
+ */
+#include <string.h>
+#include "halfake_priv.h"
+
+portMUX_TYPE halfake_lock = portMUX_INITIALIZER_UNLOCKED;
+halfake_stats_t halfake_stats;
+
+static halfake_call_t s_log[HALFAKE_LOG_LEN];
+static size_t s_count;
+
+void halfake_record(halfake_op_t op, uint32_t id, uint32_t value, uint32_t arg)
+{
+    portENTER_CRITICAL(&halfake_lock);
+    halfake_call_t *c = &s_log[s_count % HALFAKE_LOG_LEN];
+    c->op = op;
+    c->id = id;
+    c->value = value;
+    c->arg = arg;
+    s_count++;
+    halfake_stats.calls[op]++;
+    portEXIT_CRITICAL(&halfake_lock);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void halfake_reset(void)
+{
+    portENTER_CRITICAL(&halfake_lock);
+    s_count = 0;
+    memset(&halfake_stats, 0, sizeof(halfake_stats));
+    halfake_gpio_reset();
+    halfake_ledc_reset();
+    portEXIT_CRITICAL(&halfake_lock);
+}
+
+size_t halfake_count(void)
+{
+    portENTER_CRITICAL(&halfake_lock);
+    size_t count = s_count;
+    portEXIT_CRITICAL(&halfake_lock);
+
+    return count;
+}
+
+bool halfake_get(size_t n, halfake_call_t *call)
+{
+    bool found = false;
+
+    portENTER_CRITICAL(&halfake_lock);
+    if (n < s_count && s_count - n <= HALFAKE_LOG_LEN)
+    {
+        *call = s_log[n % HALFAKE_LOG_LEN];
+        found = true;
+    }
+    portEXIT_CRITICAL(&halfake_lock);
+
+    return found;
+}
+
+void halfake_get_stats(halfake_stats_t *stats)
+{
+    portENTER_CRITICAL(&halfake_lock);
+    *stats = halfake_stats;
+    portEXIT_CRITICAL(&halfake_lock);
+}
@@ -0,0 +1,206 @@
+/**
+ * @file halfake_gpio.c
+ *
+ * Recording fake of the GPIO driver.
+ */
+#include <string.h>
+#include "halfake_priv.h"
+
+#define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
+#define CHECK_PIN(PIN) do { if ((PIN) < 0 || (PIN) >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define PULL_UP   1
+#define PULL_DOWN 2
+
+typedef struct
+{
+    gpio_mode_t mode;
+    uint8_t pull;                //!< PULL_UP and PULL_DOWN bits
+    uint8_t out;
+    uint8_t in;                  //!< Level + 1, 0 until set with halfake_gpio_set_input()
+} pin_t;
+
+static pin_t s_pins[GPIO_NUM_MAX];
+static halfake_gpio_listener_t s_listener;
+static void *s_listener_ctx;
+static halfake_gpio_input_t s_input;
+static void *s_input_ctx;
+
+static gpio_pull_mode_t pull_mode(uint8_t pull)
+{
+    return pull == (PULL_UP | PULL_DOWN) ? GPIO_PULLUP_PULLDOWN
+           : pull == PULL_UP ? GPIO_PULLUP_ONLY
+           : pull == PULL_DOWN ? GPIO_PULLDOWN_ONLY
+           : GPIO_FLOATING;
+}
+
+static esp_err_t set_pull(gpio_num_t pin, uint8_t set, uint8_t clear)
+{
+    CHECK_PIN(pin);
+
+    portENTER_CRITICAL(&halfake_lock);
+    s_pins[pin].pull = (s_pins[pin].pull & ~clear) | set;
+    uint8_t pull = s_pins[pin].pull;
+    portEXIT_CRITICAL(&halfake_lock);
+
+    halfake_record(HALFAKE_GPIO_PULL, pin, pull_mode(pull), 0);
+
+    return ESP_OK;
+}
+
+void halfake_gpio_reset(void)
+{
+    memset(s_pins, 0, sizeof(s_pins));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+    if (!cfg || cfg->pin_bit_mask >> GPIO_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    for (uint64_t bits = cfg->pin_bit_mask; bits; bits &= bits - 1)
+    {
+        gpio_num_t pin = __builtin_ctzll(bits);
+        CHECK(gpio_set_direction(pin, cfg->mode));
+        CHECK(set_pull(pin, (cfg->pull_up_en ? PULL_UP : 0) | (cfg->pull_down_en ? PULL_DOWN : 0),
+                       PULL_UP | PULL_DOWN));
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    CHECK(gpio_set_direction(gpio_num, GPIO_MODE_DISABLE));
+    return set_pull(gpio_num, PULL_UP, PULL_DOWN);
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    CHECK_PIN(gpio_num);
+
+    portENTER_CRITICAL(&halfake_lock);
+    s_pins[gpio_num].mode = mode;
+    portEXIT_CRITICAL(&halfake_lock);
+    halfake_record(HALFAKE_GPIO_DIRECTION, gpio_num, mode, 0);
+
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull)
+{
+    uint8_t bits = pull == GPIO_PULLUP_PULLDOWN ? PULL_UP | PULL_DOWN
+                   : pull == GPIO_PULLUP_ONLY ? PULL_UP
+                   : pull == GPIO_PULLDOWN_ONLY ? PULL_DOWN
+                   : 0;
+
+    return set_pull(gpio_num, bits, PULL_UP | PULL_DOWN);
+}
+
+esp_err_t gpio_pullup_en(gpio_num_t gpio_num)
+{
+    return set_pull(gpio_num, PULL_UP, 0);
+}
+
+esp_err_t gpio_pullup_dis(gpio_num_t gpio_num)
+{
+    return set_pull(gpio_num, 0, PULL_UP);
+}
+
+esp_err_t gpio_pulldown_en(gpio_num_t gpio_num)
+{
+    return set_pull(gpio_num, PULL_DOWN, 0);
+}
+
+esp_err_t gpio_pulldown_dis(gpio_num_t gpio_num)
+{
+    return set_pull(gpio_num, 0, PULL_DOWN);
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    CHECK_PIN(gpio_num);
+
+    level = level ? 1 : 0;
+    portENTER_CRITICAL(&halfake_lock);
+    bool changed = s_pins[gpio_num].out != level;
+    s_pins[gpio_num].out = level;
+    halfake_gpio_listener_t listener = s_listener;
+    void *ctx = s_listener_ctx;
+    portEXIT_CRITICAL(&halfake_lock);
+
+    halfake_record(HALFAKE_GPIO_LEVEL, gpio_num, level, 0);
+    if (changed && listener)
+        listener(ctx, gpio_num, level);
+
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (gpio_num < 0 || gpio_num >= GPIO_NUM_MAX)
+        return 0;
+
+    portENTER_CRITICAL(&halfake_lock);
+    halfake_gpio_input_t input = s_input;
+    void *ctx = s_input_ctx;
+    pin_t pin = s_pins[gpio_num];
+    portEXIT_CRITICAL(&halfake_lock);
+
+    if (input)
+    {
+        int level = input(ctx, gpio_num);
+        if (level >= 0)
+            return level ? 1 : 0;
+    }
+    // Reads back the output when both directions are enabled
+    if ((pin.mode & GPIO_MODE_INPUT) && (pin.mode & GPIO_MODE_OUTPUT))
+        return pin.out;
+    if (pin.in)
+        return pin.in - 1;
+
+    return pin.pull == PULL_UP ? 1 : 0;
+}
+
+void halfake_gpio_set_input(gpio_num_t pin, uint32_t level)
+{
+    if (pin < 0 || pin >= GPIO_NUM_MAX)
+        return;
+
+    portENTER_CRITICAL(&halfake_lock);
+    s_pins[pin].in = level ? 2 : 1;
+    portEXIT_CRITICAL(&halfake_lock);
+}
+
+uint32_t halfake_gpio_get_output(gpio_num_t pin)
+{
+    return pin >= 0 && pin < GPIO_NUM_MAX ? s_pins[pin].out : 0;
+}
+
+gpio_mode_t halfake_gpio_get_mode(gpio_num_t pin)
+{
+    return pin >= 0 && pin < GPIO_NUM_MAX ? s_pins[pin].mode : GPIO_MODE_DISABLE;
+}
+
+gpio_pull_mode_t halfake_gpio_get_pull(gpio_num_t pin)
+{
+    return pin >= 0 && pin < GPIO_NUM_MAX ? pull_mode(s_pins[pin].pull) : GPIO_FLOATING;
+}
+
+void halfake_gpio_listen(halfake_gpio_listener_t listener, void *ctx)
+{
+    portENTER_CRITICAL(&halfake_lock);
+    s_listener = listener;
+    s_listener_ctx = ctx;
+    portEXIT_CRITICAL(&halfake_lock);
+}
+
+void halfake_gpio_set_input_hook(halfake_gpio_input_t input, void *ctx)
+{
+    portENTER_CRITICAL(&halfake_lock);
+    s_input = input;
+    s_input_ctx = ctx;
+    portEXIT_CRITICAL(&halfake_lock);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file halfake_led_strip.c
+ *
+ * Recording fake of the led_strip component.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "halfake_priv.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+struct led_strip_t
+{
+    int gpio_num;
+    uint32_t length;
+    uint32_t refreshes;
+    uint8_t pixels[];            //!< RGB
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config,
+                                   led_strip_handle_t *ret_strip)
+{
+    CHECK_ARG(led_config && rmt_config && ret_strip && led_config->max_leds);
+
+    struct led_strip_t *strip = calloc(1, sizeof(struct led_strip_t) + led_config->max_leds * 3);
+    if (!strip)
+        return ESP_ERR_NO_MEM;
+    strip->gpio_num = led_config->strip_gpio_num;
+    strip->length = led_config->max_leds;
+
+    *ret_strip = strip;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    CHECK_ARG(strip && index < strip->length);
+
+    uint8_t *p = &strip->pixels[index * 3];
+    p[0] = red;
+    p[1] = green;
+    p[2] = blue;
+
+    return ESP_OK;
+}
+
+esp_err_t led_strip_refresh(led_strip_handle_t strip)
+{
+    CHECK_ARG(strip);
+
+    strip->refreshes++;
+    halfake_record(HALFAKE_LED_STRIP_REFRESH, strip->gpio_num, strip->length, 0);
+
+    return ESP_OK;
+}
+
+esp_err_t led_strip_clear(led_strip_handle_t strip)
+{
+    CHECK_ARG(strip);
+
+    memset(strip->pixels, 0, strip->length * 3);
+
+    return led_strip_refresh(strip);
+}
+
+esp_err_t led_strip_del(led_strip_handle_t strip)
+{
+    CHECK_ARG(strip);
+
+    free(strip);
+
+    return ESP_OK;
+}
+
+const uint8_t *halfake_led_strip_pixels(led_strip_handle_t strip, uint32_t *length)
+{
+    *length = strip->length;
+
+    return strip->pixels;
+}
+
+uint32_t halfake_led_strip_refreshes(led_strip_handle_t strip)
+{
+    return strip->refreshes;
+}
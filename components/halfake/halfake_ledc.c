@@ -0,0 +1,228 @@
+/**
+ * @file halfake_ledc.c
+ *
+ * Recording fake of the LEDC driver with fades on a simulated clock.
+ */
+#include "halfake_priv.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+#define CHECK_CHANNEL(MODE, CH) CHECK_ARG((MODE) < LEDC_SPEED_MODE_MAX && (CH) < LEDC_CHANNEL_MAX)
+
+#define ID(mode, channel) ((mode) * LEDC_CHANNEL_MAX + (channel))
+
+typedef struct
+{
+    uint32_t duty;               //!< Duty, or start duty of the running fade
+    uint32_t pending;            //!< Set with ledc_set_duty(), applied by ledc_update_duty()
+    uint32_t target;
+    uint32_t start_ms;
+    uint32_t duration_ms;
+    bool fading;
+    ledc_cb_t fade_cb;
+    void *user_arg;
+} channel_t;
+
+static channel_t s_channels[LEDC_SPEED_MODE_MAX][LEDC_CHANNEL_MAX];
+static uint32_t s_now_ms;
+static bool s_fade_installed;
+
+static uint32_t duty_at(const channel_t *c, uint32_t now_ms)
+{
+    if (!c->fading)
+        return c->duty;
+
+    int64_t span = (int64_t)c->target - c->duty;
+    return c->duty + span * (now_ms - c->start_ms) / c->duration_ms;
+}
+
+static void set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty)
+{
+    portENTER_CRITICAL(&halfake_lock);
+    channel_t *c = &s_channels[mode][channel];
+    c->fading = false;
+    c->duty = duty;
+    portEXIT_CRITICAL(&halfake_lock);
+
+    halfake_record(HALFAKE_LEDC_DUTY, ID(mode, channel), duty, 0);
+}
+
+void halfake_ledc_reset(void)
+{
+    s_now_ms = 0;
+    for (int m = 0; m < LEDC_SPEED_MODE_MAX; m++)
+    {
+        for (int ch = 0; ch < LEDC_CHANNEL_MAX; ch++)
+        {
+            channel_t *c = &s_channels[m][ch];
+            c->duty = c->pending = c->target = 0;
+            c->fading = false;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf)
+{
+    CHECK_ARG(timer_conf && timer_conf->speed_mode < LEDC_SPEED_MODE_MAX && timer_conf->timer_num < LEDC_TIMER_MAX);
+    CHECK_ARG(timer_conf->deconfigure || timer_conf->freq_hz);
+
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf)
+{
+    CHECK_ARG(ledc_conf);
+    CHECK_CHANNEL(ledc_conf->speed_mode, ledc_conf->channel);
+
+    set_duty(ledc_conf->speed_mode, ledc_conf->channel, ledc_conf->duty);
+
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty)
+{
+    CHECK_CHANNEL(speed_mode, channel);
+
+    portENTER_CRITICAL(&halfake_lock);
+    s_channels[speed_mode][channel].pending = duty;
+    portEXIT_CRITICAL(&halfake_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    CHECK_CHANNEL(speed_mode, channel);
+
+    set_duty(speed_mode, channel, s_channels[speed_mode][channel].pending);
+
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty_and_update(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty, uint32_t hpoint)
+{
+    CHECK_CHANNEL(speed_mode, channel);
+
+    set_duty(speed_mode, channel, duty);
+
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    return halfake_ledc_get_duty(speed_mode, channel);
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags)
+{
+    if (s_fade_installed)
+        return ESP_ERR_INVALID_STATE;
+    s_fade_installed = true;
+
+    return ESP_OK;
+}
+
+void ledc_fade_func_uninstall(void)
+{
+    s_fade_installed = false;
+}
+
+esp_err_t ledc_set_fade_time_and_start(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty,
+                                       uint32_t max_fade_time_ms, ledc_fade_mode_t fade_mode)
+{
+    CHECK_CHANNEL(speed_mode, channel);
+
+    if (!s_fade_installed)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&halfake_lock);
+    channel_t *c = &s_channels[speed_mode][channel];
+    c->duty = duty_at(c, s_now_ms);
+    c->target = target_duty;
+    c->start_ms = s_now_ms;
+    // Takes at least one PWM period
+    c->duration_ms = max_fade_time_ms ? max_fade_time_ms : 1;
+    c->fading = true;
+    portEXIT_CRITICAL(&halfake_lock);
+
+    halfake_record(HALFAKE_LEDC_FADE, ID(speed_mode, channel), target_duty, max_fade_time_ms);
+    if (fade_mode == LEDC_FADE_WAIT_DONE)
+        halfake_ledc_advance(c->duration_ms);
+
+    return ESP_OK;
+}
+
+esp_err_t ledc_cb_register(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_cbs_t *cbs, void *user_arg)
+{
+    CHECK_CHANNEL(speed_mode, channel);
+    CHECK_ARG(cbs);
+
+    if (!s_fade_installed)
+        return ESP_ERR_INVALID_STATE;
+
+    portENTER_CRITICAL(&halfake_lock);
+    s_channels[speed_mode][channel].fade_cb = cbs->fade_cb;
+    s_channels[speed_mode][channel].user_arg = user_arg;
+    portEXIT_CRITICAL(&halfake_lock);
+
+    return ESP_OK;
+}
+
+uint32_t halfake_ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel)
+{
+    if (mode >= LEDC_SPEED_MODE_MAX || channel >= LEDC_CHANNEL_MAX)
+        return 0;
+
+    portENTER_CRITICAL(&halfake_lock);
+    uint32_t duty = duty_at(&s_channels[mode][channel], s_now_ms);
+    portEXIT_CRITICAL(&halfake_lock);
+
+    return duty;
+}
+
+uint32_t halfake_ledc_advance(uint32_t ms)
+{
+    uint32_t ended = 0;
+
+    portENTER_CRITICAL(&halfake_lock);
+    s_now_ms += ms;
+    uint32_t now_ms = s_now_ms;
+    portEXIT_CRITICAL(&halfake_lock);
+
+    // Callbacks may start the next fade, so each channel is finished on its own
+    for (int m = 0; m < LEDC_SPEED_MODE_MAX; m++)
+    {
+        for (int ch = 0; ch < LEDC_CHANNEL_MAX; ch++)
+        {
+            channel_t *c = &s_channels[m][ch];
+
+            portENTER_CRITICAL(&halfake_lock);
+            bool end = c->fading && now_ms - c->start_ms >= c->duration_ms;
+            if (end)
+            {
+                c->fading = false;
+                c->duty = c->target;
+            }
+            ledc_cb_t cb = c->fade_cb;
+            void *arg = c->user_arg;
+            portEXIT_CRITICAL(&halfake_lock);
+
+            if (!end)
+                continue;
+            ended++;
+            if (cb)
+            {
+                ledc_cb_param_t param = {
+                    .event = LEDC_FADE_END_EVT,
+                    .speed_mode = m,
+                    .channel = ch,
+                    .duty = c->target,
+                };
+                cb(&param, arg);
+            }
+        }
+    }
+
+    return ended;
+}
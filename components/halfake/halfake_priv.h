@@ -0,0 +1,32 @@
+/**
+ * @file halfake_priv.h
+ *
+ * State shared by the fakes.
+ */
+#ifndef __HALFAKE_PRIV_H__
+#define __HALFAKE_PRIV_H__
+
+#include "freertos/FreeRTOS.h"
+#include "halfake.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern portMUX_TYPE halfake_lock;
+extern halfake_stats_t halfake_stats; //!< Updated with halfake_lock held
+
+/**
+ * @brief Append a call to the log, takes halfake_lock
+ */
+void halfake_record(halfake_op_t op, uint32_t id, uint32_t value, uint32_t arg);
+
+// Called by halfake_reset() with halfake_lock held
+void halfake_gpio_reset(void);
+void halfake_ledc_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HALFAKE_PRIV_H__ */
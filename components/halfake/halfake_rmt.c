@@ -0,0 +1,323 @@
+/**
+ * @file halfake_rmt.c
+ *
+ * Recording fake of the RMT TX driver and its bytes and copy encoders.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "halfake_priv.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+struct rmt_channel_t
+{
+    rmt_tx_channel_config_t cfg;
+    bool enabled;
+    rmt_tx_done_callback_t on_trans_done;
+    void *user_data;
+    size_t room;                 //!< Free symbols in the channel memory until the next refill
+    rmt_symbol_word_t *frame;    //!< Symbols of the last frame
+    size_t frame_len;
+    size_t frame_cap;
+};
+
+typedef struct
+{
+    rmt_encoder_t base;
+    rmt_bytes_encoder_config_t cfg;
+    size_t byte;                 //!< Position to go on from after a full channel memory
+    uint8_t bit;
+} bytes_encoder_t;
+
+typedef struct
+{
+    rmt_encoder_t base;
+    size_t index;
+} copy_encoder_t;
+
+static halfake_rmt_listener_t s_listener;
+static void *s_listener_ctx;
+
+static bool put(rmt_channel_handle_t channel, rmt_symbol_word_t symbol)
+{
+    if (!channel->room)
+        return false;
+
+    if (channel->frame_len == channel->frame_cap)
+    {
+        size_t cap = channel->frame_cap ? channel->frame_cap * 2 : channel->cfg.mem_block_symbols;
+        rmt_symbol_word_t *frame = realloc(channel->frame, cap * sizeof(rmt_symbol_word_t));
+        if (!frame)
+            return false;
+        channel->frame = frame;
+        channel->frame_cap = cap;
+    }
+    channel->frame[channel->frame_len++] = symbol;
+    channel->room--;
+
+    return true;
+}
+
+static size_t encode_bytes(rmt_encoder_t *encoder, rmt_channel_handle_t channel,
+                           const void *data, size_t size, rmt_encode_state_t *ret_state)
+{
+    bytes_encoder_t *enc = __containerof(encoder, bytes_encoder_t, base);
+    const uint8_t *bytes = data;
+    size_t encoded = 0;
+
+    for (; enc->byte < size; enc->byte++, enc->bit = 0)
+    {
+        for (; enc->bit < 8; enc->bit++)
+        {
+            uint8_t shift = enc->cfg.flags.msb_first ? 7 - enc->bit : enc->bit;
+            if (!put(channel, (bytes[enc->byte] >> shift) & 1 ? enc->cfg.bit1 : enc->cfg.bit0))
+            {
+                *ret_state = RMT_ENCODING_MEM_FULL;
+                return encoded;
+            }
+            encoded++;
+        }
+    }
+
+    enc->byte = 0;
+    enc->bit = 0;
+    *ret_state = channel->room ? RMT_ENCODING_COMPLETE : RMT_ENCODING_COMPLETE | RMT_ENCODING_MEM_FULL;
+    return encoded;
+}
+
+static esp_err_t reset_bytes(rmt_encoder_t *encoder)
+{
+    bytes_encoder_t *enc = __containerof(encoder, bytes_encoder_t, base);
+
+    enc->byte = 0;
+    enc->bit = 0;
+
+    return ESP_OK;
+}
+
+static size_t encode_copy(rmt_encoder_t *encoder, rmt_channel_handle_t channel,
+                          const void *data, size_t size, rmt_encode_state_t *ret_state)
+{
+    copy_encoder_t *enc = __containerof(encoder, copy_encoder_t, base);
+    const rmt_symbol_word_t *symbols = data;
+    size_t count = size / sizeof(rmt_symbol_word_t);
+    size_t encoded = 0;
+
+    for (; enc->index < count; enc->index++, encoded++)
+    {
+        if (!put(channel, symbols[enc->index]))
+        {
+            *ret_state = RMT_ENCODING_MEM_FULL;
+            return encoded;
+        }
+    }
+
+    enc->index = 0;
+    *ret_state = channel->room ? RMT_ENCODING_COMPLETE : RMT_ENCODING_COMPLETE | RMT_ENCODING_MEM_FULL;
+    return encoded;
+}
+
+static esp_err_t reset_copy(rmt_encoder_t *encoder)
+{
+    copy_encoder_t *enc = __containerof(encoder, copy_encoder_t, base);
+
+    enc->index = 0;
+
+    return ESP_OK;
+}
+
+static esp_err_t del_encoder(rmt_encoder_t *encoder)
+{
+    // Both encoders start with their base
+    free(encoder);
+
+    return ESP_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config, rmt_channel_handle_t *ret_chan)
+{
+    CHECK_ARG(config && ret_chan && config->resolution_hz && config->mem_block_symbols >= 2);
+
+    struct rmt_channel_t *channel = calloc(1, sizeof(struct rmt_channel_t));
+    if (!channel)
+        return ESP_ERR_NO_MEM;
+    channel->cfg = *config;
+
+    *ret_chan = channel;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel)
+{
+    CHECK_ARG(channel);
+
+    if (channel->enabled)
+        return ESP_ERR_INVALID_STATE;
+    free(channel->frame);
+    free(channel);
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel)
+{
+    CHECK_ARG(channel);
+
+    if (channel->enabled)
+        return ESP_ERR_INVALID_STATE;
+    channel->enabled = true;
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel)
+{
+    CHECK_ARG(channel);
+
+    if (!channel->enabled)
+        return ESP_ERR_INVALID_STATE;
+    channel->enabled = false;
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel, rmt_encoder_handle_t encoder,
+                       const void *payload, size_t payload_bytes, const rmt_transmit_config_t *config)
+{
+    CHECK_ARG(tx_channel && encoder && payload && payload_bytes && config);
+
+    if (!tx_channel->enabled)
+        return ESP_ERR_INVALID_STATE;
+
+    // The first call fills the whole memory, the ISR refills half of it
+    // each time it has been sent
+    rmt_encoder_reset(encoder);
+    tx_channel->frame_len = 0;
+    tx_channel->room = tx_channel->cfg.mem_block_symbols;
+    uint32_t refills = 0;
+    for (;;)
+    {
+        rmt_encode_state_t state = RMT_ENCODING_RESET;
+        encoder->encode(encoder, tx_channel, payload, payload_bytes, &state);
+        if (state & RMT_ENCODING_COMPLETE)
+            break;
+        if (!(state & RMT_ENCODING_MEM_FULL) || tx_channel->room)
+            return ESP_FAIL;     // No progress, out of memory for the frame
+        tx_channel->room = tx_channel->cfg.mem_block_symbols / 2;
+        refills++;
+    }
+
+    portENTER_CRITICAL(&halfake_lock);
+    halfake_stats.rmt_symbols += tx_channel->frame_len;
+    halfake_stats.rmt_refills += refills;
+    halfake_rmt_listener_t listener = s_listener;
+    void *ctx = s_listener_ctx;
+    portEXIT_CRITICAL(&halfake_lock);
+
+    halfake_record(HALFAKE_RMT_TRANSMIT, tx_channel->cfg.gpio_num, tx_channel->frame_len, refills);
+    if (listener)
+        listener(ctx, tx_channel, tx_channel->frame, tx_channel->frame_len);
+    if (tx_channel->on_trans_done)
+    {
+        rmt_tx_done_event_data_t edata = { .num_symbols = tx_channel->frame_len };
+        tx_channel->on_trans_done(tx_channel, &edata, tx_channel->user_data);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel, int timeout_ms)
+{
+    CHECK_ARG(tx_channel);
+
+    // Frames are done when rmt_transmit() returns
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t tx_channel, const rmt_tx_event_callbacks_t *cbs,
+                                          void *user_data)
+{
+    CHECK_ARG(tx_channel && cbs);
+
+    if (tx_channel->enabled)
+        return ESP_ERR_INVALID_STATE;
+    tx_channel->on_trans_done = cbs->on_trans_done;
+    tx_channel->user_data = user_data;
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    CHECK_ARG(config && ret_encoder);
+
+    bytes_encoder_t *enc = calloc(1, sizeof(bytes_encoder_t));
+    if (!enc)
+        return ESP_ERR_NO_MEM;
+    enc->base.encode = encode_bytes;
+    enc->base.reset = reset_bytes;
+    enc->base.del = del_encoder;
+    enc->cfg = *config;
+
+    *ret_encoder = &enc->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    CHECK_ARG(config && ret_encoder);
+
+    copy_encoder_t *enc = calloc(1, sizeof(copy_encoder_t));
+    if (!enc)
+        return ESP_ERR_NO_MEM;
+    enc->base.encode = encode_copy;
+    enc->base.reset = reset_copy;
+    enc->base.del = del_encoder;
+
+    *ret_encoder = &enc->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder)
+{
+    CHECK_ARG(encoder);
+
+    return encoder->del(encoder);
+}
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t encoder)
+{
+    CHECK_ARG(encoder);
+
+    return encoder->reset(encoder);
+}
+
+void halfake_rmt_listen(halfake_rmt_listener_t listener, void *ctx)
+{
+    portENTER_CRITICAL(&halfake_lock);
+    s_listener = listener;
+    s_listener_ctx = ctx;
+    portEXIT_CRITICAL(&halfake_lock);
+}
+
+size_t halfake_rmt_decode(const rmt_symbol_word_t *symbols, size_t count, uint8_t *bytes, size_t max)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i + 8 <= count && n < max; i += 8)
+    {
+        uint8_t byte = 0;
+        for (size_t b = 0; b < 8; b++)
+        {
+            const rmt_symbol_word_t *s = &symbols[i + b];
+            if (!s->level0)
+                return n;
+            byte = (byte << 1) | (s->duration0 > s->duration1);
+        }
+        bytes[n++] = byte;
+    }
+
+    return n;
+}
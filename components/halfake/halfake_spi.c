@@ -0,0 +1,121 @@
+/**
+ * @file halfake_spi.c
+ *
+ * Recording fake of the SPI master driver.
+ */
+#include <stdlib.h>
+#include "halfake_priv.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+struct spi_device_t
+{
+    spi_host_device_t host;
+    spi_device_interface_config_t cfg;
+};
+
+static bool s_bus[SPI_HOST_MAX];
+static uint32_t s_devices[SPI_HOST_MAX];
+static halfake_spi_listener_t s_listener;
+static void *s_listener_ctx;
+
+static esp_err_t transmit(spi_device_handle_t handle, spi_transaction_t *trans)
+{
+    CHECK_ARG(handle && trans);
+
+    const uint8_t *data = (trans->flags & SPI_TRANS_USE_TXDATA) ? trans->tx_data : trans->tx_buffer;
+    size_t bytes = (trans->length + 7) / 8;
+    CHECK_ARG(data || !bytes);
+
+    uint32_t head = 0;
+    for (size_t i = 0; i < 4; i++)
+        head = (head << 8) | (i < bytes ? data[i] : 0);
+
+    portENTER_CRITICAL(&halfake_lock);
+    halfake_stats.spi_bytes += bytes;
+    halfake_spi_listener_t listener = s_listener;
+    void *ctx = s_listener_ctx;
+    portEXIT_CRITICAL(&halfake_lock);
+
+    halfake_record(HALFAKE_SPI_TRANSMIT, handle->cfg.spics_io_num, trans->length, head);
+    if (listener)
+        listener(ctx, handle, data, trans->length);
+
+    return ESP_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_dma_chan_t dma_chan)
+{
+    CHECK_ARG(host_id < SPI_HOST_MAX && bus_config);
+
+    if (s_bus[host_id])
+        return ESP_ERR_INVALID_STATE;
+    s_bus[host_id] = true;
+
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host_id)
+{
+    CHECK_ARG(host_id < SPI_HOST_MAX);
+
+    if (!s_bus[host_id] || s_devices[host_id])
+        return ESP_ERR_INVALID_STATE;
+    s_bus[host_id] = false;
+
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle)
+{
+    CHECK_ARG(host_id < SPI_HOST_MAX && dev_config && handle);
+
+    if (!s_bus[host_id])
+        return ESP_ERR_INVALID_STATE;
+
+    struct spi_device_t *dev = calloc(1, sizeof(struct spi_device_t));
+    if (!dev)
+        return ESP_ERR_NO_MEM;
+    dev->host = host_id;
+    dev->cfg = *dev_config;
+    s_devices[host_id]++;
+
+    *handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    CHECK_ARG(handle);
+
+    s_devices[handle->host]--;
+    free(handle);
+
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    return transmit(handle, trans_desc);
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    return transmit(handle, trans_desc);
+}
+
+void halfake_spi_listen(halfake_spi_listener_t listener, void *ctx)
+{
+    portENTER_CRITICAL(&halfake_lock);
+    s_listener = listener;
+    s_listener_ctx = ctx;
+    portEXIT_CRITICAL(&halfake_lock);
+}
+
+int halfake_spi_cs(spi_device_handle_t dev)
+{
+    return dev->cfg.spics_io_num;
+}
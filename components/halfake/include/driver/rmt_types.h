@@ -0,0 +1,56 @@
+/**
+ * @file rmt_types.h
+ *
+ * RMT types of the linux target, see halfake.h.
+ */
+#ifndef __HALFAKE_RMT_TYPES_H__
+#define __HALFAKE_RMT_TYPES_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __containerof
+#define __containerof(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#endif
+
+typedef struct rmt_channel_t *rmt_channel_handle_t;
+typedef struct rmt_encoder_t rmt_encoder_t;
+typedef rmt_encoder_t *rmt_encoder_handle_t;
+
+typedef union
+{
+    struct
+    {
+        uint16_t duration0 : 15;
+        uint16_t level0 : 1;
+        uint16_t duration1 : 15;
+        uint16_t level1 : 1;
+    };
+    uint32_t val;
+} rmt_symbol_word_t;
+
+typedef enum
+{
+    RMT_CLK_SRC_DEFAULT = 0,
+    RMT_CLK_SRC_APB = 0,
+} rmt_clock_source_t;
+
+typedef struct
+{
+    size_t num_symbols;          //!< Symbols sent in the frame
+} rmt_tx_done_event_data_t;
+
+typedef bool (*rmt_tx_done_callback_t)(rmt_channel_handle_t tx_chan, const rmt_tx_done_event_data_t *edata,
+                                       void *user_ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HALFAKE_RMT_TYPES_H__ */
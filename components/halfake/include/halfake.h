@@ -0,0 +1,254 @@
+/**
+ * @file halfake.h
+ * @defgroup halfake halfake
+ * @{
+ *
+ * Recording fakes of the SPI master, GPIO, RMT, LEDC and led_strip drivers
+ * for the linux target.
+ *
+ * On linux this component supplies `driver/spi_master.h`, `driver/gpio.h`,
+ * `driver/rmt_tx.h`, `driver/rmt_encoder.h`, `driver/ledc.h` and
+ * `led_strip.h`, so the components build unchanged against them. The fakes
+ * keep the state a test wants to look at (pin levels, duties, pixels) and
+ * append every call that drives an output to a log. Listeners see the data
+ * itself, e.g. the bytes of an SPI transaction or the symbols of an RMT
+ * frame, so emulators of the attached chips can be plugged in.
+ *
+ * Nothing runs in the background: RMT frames are encoded within
+ * rmt_transmit() and LEDC fades end when halfake_ledc_advance() moves the
+ * simulated clock past them.
+ */
+#ifndef __HALFAKE_H__
+#define __HALFAKE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <driver/spi_master.h>
+#include <driver/gpio.h>
+#include <driver/rmt_tx.h>
+#include <driver/ledc.h>
+#include <led_strip.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HALFAKE_LOG_LEN 256      //!< Recorded calls, older entries are overwritten
+
+/**
+ * Recorded call
+ */
+typedef enum
+{
+    HALFAKE_SPI_TRANSMIT = 0,    //!< id: CS pin, value: bits, arg: first 4 bytes, big-endian
+    HALFAKE_GPIO_DIRECTION,      //!< id: pin, value: gpio_mode_t
+    HALFAKE_GPIO_PULL,           //!< id: pin, value: gpio_pull_mode_t
+    HALFAKE_GPIO_LEVEL,          //!< id: pin, value: level
+    HALFAKE_RMT_TRANSMIT,        //!< id: pin, value: symbols, arg: refills
+    HALFAKE_LEDC_DUTY,           //!< id: channel, value: duty
+    HALFAKE_LEDC_FADE,           //!< id: channel, value: duty, arg: duration in ms
+    HALFAKE_LED_STRIP_REFRESH,   //!< id: pin, value: LEDs
+    HALFAKE_OP_MAX,
+} halfake_op_t;
+
+typedef struct
+{
+    halfake_op_t op;
+    uint32_t id;
+    uint32_t value;
+    uint32_t arg;
+} halfake_call_t;
+
+/**
+ * Totals since the last halfake_reset()
+ */
+typedef struct
+{
+    uint32_t calls[HALFAKE_OP_MAX]; //!< Recorded calls by kind
+    uint32_t spi_bytes;          //!< Bytes clocked out by all SPI devices
+    uint32_t rmt_symbols;        //!< Symbols sent by all RMT channels
+    uint32_t rmt_refills;        //!< Channel memory refills of all RMT frames
+} halfake_stats_t;
+
+/**
+ * Called with the bytes of every SPI transaction
+ */
+typedef void (*halfake_spi_listener_t)(void *ctx, spi_device_handle_t dev, const uint8_t *data, size_t bits);
+
+/**
+ * Called when an output pin changes its level
+ */
+typedef void (*halfake_gpio_listener_t)(void *ctx, gpio_num_t pin, uint32_t level);
+
+/**
+ * Returns the level of an input pin, -1 to use the level set with
+ * halfake_gpio_set_input()
+ */
+typedef int (*halfake_gpio_input_t)(void *ctx, gpio_num_t pin);
+
+/**
+ * Called with the symbols of every RMT frame
+ */
+typedef void (*halfake_rmt_listener_t)(void *ctx, rmt_channel_handle_t channel,
+                                       const rmt_symbol_word_t *symbols, size_t count);
+
+/**
+ * @brief Clear the call log, the statistics and the pin, duty and clock state
+ *
+ * Listeners, devices and channels stay.
+ */
+void halfake_reset(void);
+
+/**
+ * @brief Number of calls recorded since the last reset
+ */
+size_t halfake_count(void);
+
+/**
+ * @brief Get a recorded call
+ *
+ * @param n Index since the last reset, the last `HALFAKE_LOG_LEN` are kept
+ * @param[out] call Recorded call
+ * @return false if the call was overwritten or not made yet
+ */
+bool halfake_get(size_t n, halfake_call_t *call);
+
+/**
+ * @brief Get a copy of the statistics
+ *
+ * @param[out] stats Statistics
+ */
+void halfake_get_stats(halfake_stats_t *stats);
+
+/**
+ * @brief Listen to the SPI transactions of all devices
+ *
+ * @param listener Listener, NULL to stop
+ * @param ctx Listener context
+ */
+void halfake_spi_listen(halfake_spi_listener_t listener, void *ctx);
+
+/**
+ * @brief CS pin of an SPI device
+ *
+ * @param dev Device handle
+ * @return `spics_io_num` the device was added with
+ */
+int halfake_spi_cs(spi_device_handle_t dev);
+
+/**
+ * @brief Set the level read from an input pin
+ *
+ * @param pin GPIO number
+ * @param level Level
+ */
+void halfake_gpio_set_input(gpio_num_t pin, uint32_t level);
+
+/**
+ * @brief Level last written to a pin
+ *
+ * @param pin GPIO number
+ * @return Level, 0 for pins never written
+ */
+uint32_t halfake_gpio_get_output(gpio_num_t pin);
+
+/**
+ * @brief Mode last set for a pin
+ *
+ * @param pin GPIO number
+ * @return Mode, `GPIO_MODE_DISABLE` for pins never set up
+ */
+gpio_mode_t halfake_gpio_get_mode(gpio_num_t pin);
+
+/**
+ * @brief Pull mode last set for a pin
+ *
+ * @param pin GPIO number
+ * @return Pull mode, `GPIO_FLOATING` for pins never set up
+ */
+gpio_pull_mode_t halfake_gpio_get_pull(gpio_num_t pin);
+
+/**
+ * @brief Listen to level changes of output pins
+ *
+ * @param listener Listener, NULL to stop
+ * @param ctx Listener context
+ */
+void halfake_gpio_listen(halfake_gpio_listener_t listener, void *ctx);
+
+/**
+ * @brief Compute the levels of input pins, e.g. from the outputs
+ *
+ * @param input Input callback, NULL to use the levels set with halfake_gpio_set_input()
+ * @param ctx Callback context
+ */
+void halfake_gpio_set_input_hook(halfake_gpio_input_t input, void *ctx);
+
+/**
+ * @brief Listen to the frames of all RMT channels
+ *
+ * @param listener Listener, NULL to stop
+ * @param ctx Listener context
+ */
+void halfake_rmt_listen(halfake_rmt_listener_t listener, void *ctx);
+
+/**
+ * @brief Turn the symbols of a bytes encoder back into bytes, MSB first
+ *
+ * A symbol whose high part is longer than its low part is a 1. Decoding
+ * stops at the first symbol with a low first level, e.g. a reset code.
+ *
+ * @param symbols Symbols
+ * @param count Number of symbols
+ * @param[out] bytes Decoded bytes
+ * @param max Size of `bytes`
+ * @return Number of complete bytes decoded
+ */
+size_t halfake_rmt_decode(const rmt_symbol_word_t *symbols, size_t count, uint8_t *bytes, size_t max);
+
+/**
+ * @brief Duty of an LEDC channel at the simulated time
+ *
+ * @param mode Speed mode
+ * @param channel Channel
+ * @return Duty, interpolated while a fade runs
+ */
+uint32_t halfake_ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel);
+
+/**
+ * @brief Advance the simulated LEDC clock
+ *
+ * Fades that end within the step call their fade end callbacks. A fade
+ * started from a callback starts at the end of the step, so advance in
+ * steps no longer than the shortest fade to keep chains on time.
+ *
+ * @param ms Step
+ * @return Number of fades that ended
+ */
+uint32_t halfake_ledc_advance(uint32_t ms);
+
+/**
+ * @brief Pixels of a strip as set with led_strip_set_pixel()
+ *
+ * @param strip Strip handle
+ * @param[out] length Number of LEDs
+ * @return RGB bytes, three per LED
+ */
+const uint8_t *halfake_led_strip_pixels(led_strip_handle_t strip, uint32_t *length);
+
+/**
+ * @brief Number of refreshes of a strip
+ *
+ * @param strip Strip handle
+ * @return Refreshes since the strip was created
+ */
+uint32_t halfake_led_strip_refreshes(led_strip_handle_t strip);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __HALFAKE_H__ */
@@ -0,0 +1,201 @@
+/**
+ * @file keysim.h
+ * @defgroup keysim keysim
+ * @{
+ *
+ * Simulator of a key matrix read by driving rows and sensing columns.
+ *
+ * A column reads high when a closed key connects it to a row driven high.
+ * Without diodes current also flows backwards through keys, so three keys
+ * on the corners of a rectangle connect the fourth corner as well, a
+ * ghost key. Rows that are not driven high are taken as driven low, as the
+ * keyarray scan does; a high and a low row connected through keys are a
+ * short, counted and read as high.
+ *
+ * Every press and release bounces: for `bounce_us` the contact opens and
+ * closes at random in steps of `chatter_us`, starting with the new state.
+ * The pattern is a hash of the seed, the key and the time of the change,
+ * so runs with the same script read the same levels.
+ *
+ * The clock is simulated. It moves with keysim_advance() and by `read_us`
+ * for every column read, delays of the code under test do not move it.
+ * Key changes come from keysim_set_key() or from a script of timed events.
+ *
+ * No platform dependencies. On linux keysim_attach() answers the reads of
+ * the column pins from the GPIO fake of halfake.
+ */
+#ifndef __KEYSIM_H__
+#define __KEYSIM_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <sdkconfig.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KEYSIM_MAX_ROWS 8
+#define KEYSIM_MAX_COLS 8
+
+typedef struct
+{
+    uint8_t rows;
+    uint8_t cols;
+    int row_pins[KEYSIM_MAX_ROWS]; //!< Driven rows, used by keysim_attach()
+    int col_pins[KEYSIM_MAX_COLS]; //!< Sensed columns, used by keysim_attach()
+    bool diodes;                 //!< One diode per key, no ghosts
+    uint32_t bounce_us;          //!< Contacts chatter this long after a change
+    uint32_t chatter_us;         //!< Contact state holds this long while bouncing
+    uint32_t read_us;            //!< Clock advance per column read
+    uint32_t seed;               //!< Seed of the chatter pattern
+} keysim_config_t;
+
+/**
+ * Scripted key change
+ */
+typedef struct
+{
+    uint64_t at_us;              //!< Simulated time of the change
+    uint8_t row;
+    uint8_t col;
+    bool pressed;
+} keysim_event_t;
+
+/**
+ * Totals since the last keysim_take_stats()
+ */
+typedef struct
+{
+    uint32_t reads;              //!< Column reads
+    uint32_t high;               //!< Reads that found the column high
+    uint32_t ghosts;             //!< High reads with no closed key on a driven row
+    uint32_t bounces;            //!< Reads of a column with a bouncing key
+    uint32_t shorts;             //!< Reads with a high and a low row connected
+} keysim_stats_t;
+
+typedef struct
+{
+    bool pressed;                //!< State after bouncing
+    uint64_t since_us;           //!< Time of the last change
+    uint64_t settled_us;         //!< End of bouncing
+} keysim_key_t;
+
+typedef struct
+{
+    keysim_config_t config;
+    uint64_t now_us;
+    keysim_key_t keys[KEYSIM_MAX_ROWS][KEYSIM_MAX_COLS];
+    const keysim_event_t *script;
+    size_t script_len;
+    size_t script_pos;           //!< Next event to apply
+    keysim_stats_t stats;
+} keysim_t;
+
+/**
+ * @brief Start a simulation at time 0 with all keys released
+ *
+ * @param sim Simulator
+ * @param config Matrix, copied
+ * @return `ESP_OK` on success
+ */
+esp_err_t keysim_init(keysim_t *sim, const keysim_config_t *config);
+
+/**
+ * @brief Press or release a key now
+ *
+ * @param sim Simulator
+ * @param row Row
+ * @param col Column
+ * @param pressed true to press
+ * @return `ESP_OK` on success
+ */
+esp_err_t keysim_set_key(keysim_t *sim, uint8_t row, uint8_t col, bool pressed);
+
+/**
+ * @brief Play key changes as the clock passes them
+ *
+ * Events before the current time are applied at once, with their own time.
+ *
+ * @param sim Simulator
+ * @param events Events sorted by time, kept until the script is replaced
+ * @param count Number of events, 0 to stop a script
+ * @return `ESP_OK` on success
+ */
+esp_err_t keysim_script(keysim_t *sim, const keysim_event_t *events, size_t count);
+
+/**
+ * @brief Advance the clock
+ *
+ * @param sim Simulator
+ * @param us Step
+ */
+void keysim_advance(keysim_t *sim, uint64_t us);
+
+/**
+ * @brief Current simulated time
+ *
+ * @param sim Simulator
+ * @return Microseconds since keysim_init()
+ */
+uint64_t keysim_now(const keysim_t *sim);
+
+/**
+ * @brief State of a contact at the current time, bouncing included
+ *
+ * @param sim Simulator
+ * @param row Row
+ * @param col Column
+ * @return true if closed
+ */
+bool keysim_contact(const keysim_t *sim, uint8_t row, uint8_t col);
+
+/**
+ * @brief Read a column
+ *
+ * Counts the read and advances the clock by `read_us` afterwards.
+ *
+ * @param sim Simulator
+ * @param col Column
+ * @param driven Rows driven high, one bit per row
+ * @return Level
+ */
+uint32_t keysim_read(keysim_t *sim, uint8_t col, uint32_t driven);
+
+/**
+ * @brief Get and clear the statistics
+ *
+ * @param sim Simulator
+ * @param[out] stats Statistics since the last call
+ */
+void keysim_take_stats(keysim_t *sim, keysim_stats_t *stats);
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+
+/**
+ * @brief Answer the reads of the column pins from the halfake GPIO fake
+ *
+ * Uses the input hook of halfake, only one simulator can be attached. The
+ * driven rows are the row pins with a high output level.
+ *
+ * @param sim Simulator
+ * @return `ESP_OK` on success
+ */
+esp_err_t keysim_attach(keysim_t *sim);
+
+/**
+ * @brief Stop answering pin reads
+ */
+void keysim_detach(void);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __KEYSIM_H__ */
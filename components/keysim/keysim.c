@@ -0,0 +1,180 @@
+/**
+ * @file keysim.c
+ *
+ * Simulator of a key matrix.
+ */
+#include <string.h>
+#include "keysim.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+// Finalizer of MurmurHash3, spreads every input bit over the result
+static uint32_t mix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+static void change(keysim_t *sim, uint8_t row, uint8_t col, bool pressed, uint64_t at_us)
+{
+    keysim_key_t *key = &sim->keys[row][col];
+
+    if (key->pressed == pressed)
+        return;
+    key->pressed = pressed;
+    key->since_us = at_us;
+    key->settled_us = at_us + sim->config.bounce_us;
+}
+
+static void play(keysim_t *sim)
+{
+    while (sim->script_pos < sim->script_len && sim->script[sim->script_pos].at_us <= sim->now_us)
+    {
+        const keysim_event_t *e = &sim->script[sim->script_pos++];
+        if (e->row < sim->config.rows && e->col < sim->config.cols)
+            change(sim, e->row, e->col, e->pressed, e->at_us);
+    }
+}
+
+static bool bouncing(const keysim_t *sim, uint8_t row, uint8_t col)
+{
+    return sim->now_us < sim->keys[row][col].settled_us;
+}
+
+// Rows and columns connected to a column through closed keys, as bit masks
+static uint32_t connected_rows(const keysim_t *sim, const uint32_t *closed, uint8_t col)
+{
+    uint32_t rows = 0, cols = 1u << col, seen = 0;
+
+    while (cols != seen)
+    {
+        seen = cols;
+        for (uint8_t r = 0; r < sim->config.rows; r++)
+            if (closed[r] & cols)
+                rows |= 1u << r;
+        for (uint8_t r = 0; r < sim->config.rows; r++)
+            if (rows & (1u << r))
+                cols |= closed[r];
+    }
+
+    return rows;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t keysim_init(keysim_t *sim, const keysim_config_t *config)
+{
+    CHECK_ARG(sim && config);
+    CHECK_ARG(config->rows && config->rows <= KEYSIM_MAX_ROWS && config->cols && config->cols <= KEYSIM_MAX_COLS);
+    CHECK_ARG(config->chatter_us || !config->bounce_us);
+
+    memset(sim, 0, sizeof(keysim_t));
+    sim->config = *config;
+
+    return ESP_OK;
+}
+
+esp_err_t keysim_set_key(keysim_t *sim, uint8_t row, uint8_t col, bool pressed)
+{
+    CHECK_ARG(sim && row < sim->config.rows && col < sim->config.cols);
+
+    change(sim, row, col, pressed, sim->now_us);
+
+    return ESP_OK;
+}
+
+esp_err_t keysim_script(keysim_t *sim, const keysim_event_t *events, size_t count)
+{
+    CHECK_ARG(sim && (events || !count));
+
+    sim->script = events;
+    sim->script_len = count;
+    sim->script_pos = 0;
+    play(sim);
+
+    return ESP_OK;
+}
+
+void keysim_advance(keysim_t *sim, uint64_t us)
+{
+    sim->now_us += us;
+    play(sim);
+}
+
+uint64_t keysim_now(const keysim_t *sim)
+{
+    return sim->now_us;
+}
+
+bool keysim_contact(const keysim_t *sim, uint8_t row, uint8_t col)
+{
+    if (row >= sim->config.rows || col >= sim->config.cols)
+        return false;
+
+    const keysim_key_t *key = &sim->keys[row][col];
+    if (!bouncing(sim, row, col))
+        return key->pressed;
+
+    // The first step is the new state, later ones are random
+    uint32_t step = (sim->now_us - key->since_us) / sim->config.chatter_us;
+    if (!step)
+        return key->pressed;
+    uint32_t h = mix(sim->config.seed ^ mix((uint32_t)key->since_us ^ (row << 24) ^ (col << 16)) ^ step);
+    return h & 1;
+}
+
+uint32_t keysim_read(keysim_t *sim, uint8_t col, uint32_t driven)
+{
+    if (col >= sim->config.cols)
+        return 0;
+
+    uint32_t closed[KEYSIM_MAX_ROWS] = { 0 };
+    bool bounce = false;
+    for (uint8_t r = 0; r < sim->config.rows; r++)
+    {
+        for (uint8_t c = 0; c < sim->config.cols; c++)
+            if (keysim_contact(sim, r, c))
+                closed[r] |= 1u << c;
+        bounce |= bouncing(sim, r, col);
+    }
+
+    uint32_t all = (1u << sim->config.rows) - 1;
+    driven &= all;
+
+    // Keys on the column with a driven row, or through diodes only these
+    uint32_t direct = 0;
+    for (uint8_t r = 0; r < sim->config.rows; r++)
+        if (closed[r] & (1u << col))
+            direct |= 1u << r;
+
+    uint32_t level;
+    if (sim->config.diodes)
+        level = (direct & driven) != 0;
+    else
+    {
+        uint32_t rows = connected_rows(sim, closed, col);
+        level = (rows & driven) != 0;
+        if (level && (rows & ~driven & all))
+            sim->stats.shorts++;
+        if (level && !(direct & driven))
+            sim->stats.ghosts++;
+    }
+
+    sim->stats.reads++;
+    sim->stats.high += level;
+    sim->stats.bounces += bounce;
+
+    keysim_advance(sim, sim->config.read_us);
+
+    return level;
+}
+
+void keysim_take_stats(keysim_t *sim, keysim_stats_t *stats)
+{
+    *stats = sim->stats;
+    memset(&sim->stats, 0, sizeof(sim->stats));
+}
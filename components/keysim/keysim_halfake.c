@@ -0,0 +1,44 @@
+/**
+ * @file keysim_halfake.c
+ *
+ * Answers the column reads of the GPIO fake on linux.
+ */
+#include "keysim.h"
+#include "halfake.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static int on_input(void *ctx, gpio_num_t pin)
+{
+    keysim_t *sim = ctx;
+
+    for (uint8_t c = 0; c < sim->config.cols; c++)
+    {
+        if (sim->config.col_pins[c] != pin)
+            continue;
+
+        uint32_t driven = 0;
+        for (uint8_t r = 0; r < sim->config.rows; r++)
+            if (halfake_gpio_get_output(sim->config.row_pins[r]))
+                driven |= 1u << r;
+        return keysim_read(sim, c, driven);
+    }
+
+    return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t keysim_attach(keysim_t *sim)
+{
+    CHECK_ARG(sim && sim->config.rows);
+
+    halfake_gpio_set_input_hook(on_input, sim);
+
+    return ESP_OK;
+}
+
+void keysim_detach(void)
+{
+    halfake_gpio_set_input_hook(NULL, NULL);
+}
@@ -0,0 +1,137 @@
+/**
+ * @file ledanim.h
+ * @defgroup ledanim ledanim
+ * @{
+ *
+ * Compact palette animation format shared by the MAX7219 and WS2812B
+ * examples, and its streaming decoder.
+ *
+ * An asset is a 16 byte header, an RGB palette and a sequence of frames.
+ * Pixels are palette indices of 1, 2 or 4 bits. Every frame is a list of
+ * tokens in raster order:
+ *
+ * - `00nnnnnn` literal: n + 1 packed indices follow, MSB first, byte padded
+ * - `01nnnnnn` run: one index byte follows, repeated n + 1 times
+ * - `10nnnnnn` skip: n + 1 pixels keep their value from the previous frame
+ *
+ * Each frame starts with a flags byte and a 16 bit token length, followed
+ * by a 16 bit duration if it differs from the default in the header.
+ * Key frames only use literals and runs, delta frames may skip. The
+ * decoder reads the asset sequentially and writes straight into the
+ * target framebuffer, so the asset can live in RAM, in flash rodata or in
+ * a memory mapped partition. Use `tools/ledanim_encode.py` to create
+ * assets from PNG/GIF sequences or 64 bit masks.
+ */
+#ifndef __LEDANIM_H__
+#define __LEDANIM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LEDANIM_MAGIC        "LANM"
+#define LEDANIM_VERSION      1
+#define LEDANIM_HEADER_SIZE  16
+
+#define LEDANIM_FRAME_KEY       0x00
+#define LEDANIM_FRAME_DELTA     0x01
+#define LEDANIM_FRAME_HAS_DELAY 0x80 //!< Frame overrides the default duration
+
+/**
+ * Asset header, little endian on disk
+ */
+typedef struct
+{
+    uint8_t version;
+    uint8_t bpp;                 //!< Bits per pixel index, 1, 2 or 4
+    uint16_t width;
+    uint16_t height;
+    uint16_t frame_count;
+    uint8_t palette_size;        //!< Palette entries, up to 1 << bpp
+    uint16_t delay_ms;           //!< Default frame duration
+} ledanim_header_t;
+
+/**
+ * Framebuffer layouts the decoder can expand into
+ */
+typedef enum
+{
+    LEDANIM_SINK_RGB = 0,        //!< 3 bytes R, G, B per pixel in raster order, as `ws2812b_rgb_t`
+    LEDANIM_SINK_MONO,           //!< 8x8 blocks of 8 row bytes, bit x of byte y, as `max7219_draw_image_8x8()`
+} ledanim_sink_type_t;
+
+/**
+ * Decoder target
+ *
+ * A mono sink lights every pixel with a non zero index. Blocks of a mono
+ * sink are laid out left to right, 8 bytes each, so a row of cascaded
+ * MAX7219 matrices is one contiguous buffer. A mono frame needs whole
+ * blocks, width and height rounded up to 8.
+ */
+typedef struct
+{
+    ledanim_sink_type_t type;
+    void *buf;                   //!< Framebuffer in the sink layout
+    uint32_t pixels;             //!< Pixels `buf` holds, frames that need more are rejected
+} ledanim_sink_t;
+
+/**
+ * Decoder state
+ */
+typedef struct
+{
+    ledanim_header_t hdr;
+    const uint8_t *data;         //!< Whole asset
+    size_t size;
+    const uint8_t *palette;      //!< hdr.palette_size RGB triplets
+    size_t first_frame;          //!< Offset of the first frame
+    size_t pos;                  //!< Offset of the next frame
+    uint16_t frame;              //!< Index of the next frame
+} ledanim_t;
+
+/**
+ * @brief Parse an asset header
+ *
+ * The asset is not copied, it has to stay accessible while decoding.
+ *
+ * @param anim Decoder state
+ * @param data Asset data
+ * @param size Asset size in bytes
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_VERSION` or
+ *         `ESP_ERR_INVALID_SIZE` for broken assets
+ */
+esp_err_t ledanim_open(ledanim_t *anim, const void *data, size_t size);
+
+/**
+ * @brief Decode the next frame into a sink
+ *
+ * Loops back to the first frame after the last one. Delta frames only
+ * touch changed pixels, the sink must still hold the previous frame.
+ *
+ * @param anim Decoder state
+ * @param sink Target framebuffer
+ * @param[out] delay_ms Frame duration, may be NULL
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_SIZE` for broken frames or
+ *         a frame larger than the sink, nothing is written then
+ */
+esp_err_t ledanim_next(ledanim_t *anim, const ledanim_sink_t *sink, uint16_t *delay_ms);
+
+/**
+ * @brief Restart from the first frame
+ *
+ * @param anim Decoder state
+ */
+void ledanim_rewind(ledanim_t *anim);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __LEDANIM_H__ */
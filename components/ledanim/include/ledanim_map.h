@@ -0,0 +1,75 @@
+/**
+ * @file ledanim_map.h
+ * @defgroup ledanim_map ledanim_map
+ * @{
+ *
+ * Memory mapped ledanim assets.
+ *
+ * On target an asset is stored in a data partition and mapped through the
+ * flash cache with `esp_partition_mmap()`, so the decoder reads frames
+ * straight from flash and nothing is copied to heap. On the linux target
+ * the same API maps a file with `mmap()`, which allows playback and decode
+ * timing to be measured on a development machine.
+ */
+#ifndef __LEDANIM_MAP_H__
+#define __LEDANIM_MAP_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include "ledanim.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LEDANIM_PARTITION_SUBTYPE 0x40 //!< Data partition subtype for assets
+
+/**
+ * Mapped asset
+ */
+typedef struct
+{
+    const void *data;            //!< Start of the mapped region
+    size_t size;                 //!< Size of the mapped region
+    uint32_t handle;             //!< Platform mapping handle
+} ledanim_map_t;
+
+/**
+ * @brief Map an asset
+ *
+ * @param map Mapping descriptor
+ * @param name Partition label on target, file path on linux
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_FOUND` if there is no such
+ *         partition or file
+ */
+esp_err_t ledanim_map_open(ledanim_map_t *map, const char *name);
+
+/**
+ * @brief Unmap an asset
+ *
+ * Decoders using the asset must not be used afterwards.
+ *
+ * @param map Mapping descriptor
+ */
+void ledanim_map_close(ledanim_map_t *map);
+
+/**
+ * @brief Open the decoder on a mapped asset
+ *
+ * @param map Mapping descriptor
+ * @param anim Decoder state
+ * @return `ESP_OK` on success, see `ledanim_open()`
+ */
+static inline esp_err_t ledanim_map_anim(const ledanim_map_t *map, ledanim_t *anim)
+{
+    return ledanim_open(anim, map->data, map->size);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __LEDANIM_MAP_H__ */
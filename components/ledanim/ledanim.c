@@ -0,0 +1,211 @@
+/**
+ * @file ledanim.c
+ *
+ * Streaming decoder for the ledanim palette animation format.
+ */
+#include <string.h>
+#include "ledanim.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define OP_LITERAL 0
+#define OP_RUN     1
+#define OP_SKIP    2
+
+/* Write position inside the sink, kept incrementally to avoid divisions */
+typedef struct
+{
+    uint32_t px;
+    uint16_t x;
+    uint16_t y;
+} cursor_t;
+
+static inline uint16_t rd16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline void advance(const ledanim_t *anim, cursor_t *c, uint32_t n)
+{
+    c->px += n;
+    c->x += n;
+    while (c->x >= anim->hdr.width)
+    {
+        c->x -= anim->hdr.width;
+        c->y++;
+    }
+}
+
+static inline void put(const ledanim_t *anim, const ledanim_sink_t *sink, const cursor_t *c, uint8_t idx)
+{
+    if (idx >= anim->hdr.palette_size)
+        idx = 0;
+
+    if (sink->type == LEDANIM_SINK_RGB)
+    {
+        uint8_t *d = (uint8_t *)sink->buf + c->px * 3;
+        const uint8_t *rgb = anim->palette + idx * 3;
+        d[0] = rgb[0];
+        d[1] = rgb[1];
+        d[2] = rgb[2];
+    }
+    else
+    {
+        uint16_t blocks_per_row = (anim->hdr.width + 7) >> 3;
+        uint32_t block = (c->y >> 3) * blocks_per_row + (c->x >> 3);
+        uint8_t *d = (uint8_t *)sink->buf + block * 8 + (c->y & 7);
+        uint8_t bit = 1 << (c->x & 7);
+        if (idx)
+            *d |= bit;
+        else
+            *d &= ~bit;
+    }
+}
+
+// Pixels a frame takes in the sink layout
+static uint32_t sink_pixels(const ledanim_t *anim, ledanim_sink_type_t type)
+{
+    if (type == LEDANIM_SINK_RGB)
+        return (uint32_t)anim->hdr.width * anim->hdr.height;
+
+    return (uint32_t)((anim->hdr.width + 7) >> 3) * ((anim->hdr.height + 7) >> 3) * 64;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t ledanim_open(ledanim_t *anim, const void *data, size_t size)
+{
+    CHECK_ARG(anim && data);
+
+    const uint8_t *p = data;
+    if (size < LEDANIM_HEADER_SIZE || memcmp(p, LEDANIM_MAGIC, 4))
+        return ESP_ERR_INVALID_SIZE;
+
+    memset(anim, 0, sizeof(*anim));
+    anim->hdr.version = p[4];
+    anim->hdr.bpp = p[5];
+    anim->hdr.width = rd16(p + 6);
+    anim->hdr.height = rd16(p + 8);
+    anim->hdr.frame_count = rd16(p + 10);
+    anim->hdr.palette_size = p[12];
+    anim->hdr.delay_ms = rd16(p + 14);
+
+    if (anim->hdr.version != LEDANIM_VERSION)
+        return ESP_ERR_INVALID_VERSION;
+    if ((anim->hdr.bpp != 1 && anim->hdr.bpp != 2 && anim->hdr.bpp != 4)
+        || !anim->hdr.width || !anim->hdr.height || !anim->hdr.frame_count
+        || !anim->hdr.palette_size || anim->hdr.palette_size > (1 << anim->hdr.bpp))
+        return ESP_ERR_INVALID_SIZE;
+
+    size_t first = LEDANIM_HEADER_SIZE + anim->hdr.palette_size * 3;
+    if (size < first)
+        return ESP_ERR_INVALID_SIZE;
+
+    anim->data = p;
+    anim->size = size;
+    anim->palette = p + LEDANIM_HEADER_SIZE;
+    anim->first_frame = first;
+    anim->pos = first;
+
+    return ESP_OK;
+}
+
+void ledanim_rewind(ledanim_t *anim)
+{
+    anim->pos = anim->first_frame;
+    anim->frame = 0;
+}
+
+esp_err_t ledanim_next(ledanim_t *anim, const ledanim_sink_t *sink, uint16_t *delay_ms)
+{
+    CHECK_ARG(anim && anim->data && sink && sink->buf);
+
+    if (sink_pixels(anim, sink->type) > sink->pixels)
+        return ESP_ERR_INVALID_SIZE;
+
+    if (anim->frame >= anim->hdr.frame_count)
+        ledanim_rewind(anim);
+
+    if (anim->pos + 3 > anim->size)
+        return ESP_ERR_INVALID_SIZE;
+
+    const uint8_t *p = anim->data + anim->pos;
+    uint8_t flags = p[0];
+    uint16_t len = rd16(p + 1);
+    uint16_t delay = anim->hdr.delay_ms;
+    p += 3;
+    if (flags & LEDANIM_FRAME_HAS_DELAY)
+    {
+        if (anim->pos + 5 > anim->size)
+            return ESP_ERR_INVALID_SIZE;
+        delay = rd16(p);
+        p += 2;
+    }
+    const uint8_t *end = p + len;
+    if ((size_t)(end - anim->data) > anim->size)
+        return ESP_ERR_INVALID_SIZE;
+
+    uint32_t total = (uint32_t)anim->hdr.width * anim->hdr.height;
+    uint8_t bpp = anim->hdr.bpp;
+    uint8_t mask = (1 << bpp) - 1;
+    uint8_t per_byte = 8 / bpp;
+    cursor_t c = { 0 };
+
+    while (p < end && c.px < total)
+    {
+        uint8_t op = *p >> 6;
+        uint32_t n = (*p & 0x3f) + 1;
+        p++;
+        if (n > total - c.px)
+            n = total - c.px;
+
+        switch (op)
+        {
+            case OP_LITERAL:
+            {
+                size_t bytes = (n + per_byte - 1) / per_byte;
+                if (p + bytes > end)
+                    return ESP_ERR_INVALID_SIZE;
+                uint8_t shift = 8;
+                for (uint32_t i = 0; i < n; i++)
+                {
+                    shift -= bpp;
+                    put(anim, sink, &c, (*p >> shift) & mask);
+                    advance(anim, &c, 1);
+                    if (!shift)
+                    {
+                        shift = 8;
+                        p++;
+                    }
+                }
+                if (shift != 8)
+                    p++;
+                break;
+            }
+            case OP_RUN:
+            {
+                if (p >= end)
+                    return ESP_ERR_INVALID_SIZE;
+                uint8_t idx = *p++;
+                for (uint32_t i = 0; i < n; i++)
+                {
+                    put(anim, sink, &c, idx);
+                    advance(anim, &c, 1);
+                }
+                break;
+            }
+            case OP_SKIP:
+                advance(anim, &c, n);
+                break;
+            default:
+                return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    if (delay_ms)
+        *delay_ms = delay;
+    anim->pos = end - anim->data;
+    anim->frame++;
+
+    return ESP_OK;
+}
@@ -0,0 +1,50 @@
+/**
+ * @file ledanim_map.c
+ *
+ * Partition backed ledanim assets, mapped through the flash cache.
+ */
+#include <string.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+#include "ledanim_map.h"
+
+static const char *TAG = "ledanim_map";
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+esp_err_t ledanim_map_open(ledanim_map_t *map, const char *name)
+{
+    CHECK_ARG(map && name);
+
+    memset(map, 0, sizeof(*map));
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           (esp_partition_subtype_t)LEDANIM_PARTITION_SUBTYPE, name);
+    if (!part)
+    {
+        ESP_LOGE(TAG, "No animation partition '%s'", name);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_partition_mmap_handle_t handle;
+    esp_err_t err = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &map->data, &handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to map partition '%s': %s", name, esp_err_to_name(err));
+        return err;
+    }
+    map->size = part->size;
+    map->handle = handle;
+
+    ESP_LOGI(TAG, "Mapped '%s', %d bytes at %p", name, (int)map->size, map->data);
+
+    return ESP_OK;
+}
+
+void ledanim_map_close(ledanim_map_t *map)
+{
+    if (!map || !map->data)
+        return;
+
+    esp_partition_munmap(map->handle);
+    memset(map, 0, sizeof(*map));
+}
@@ -0,0 +1,59 @@
+/**
+ * @file ledanim_map_linux.c
+ *
+ * File backed ledanim assets for the linux target, mapped with mmap().
+ */
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <esp_log.h>
+#include "ledanim_map.h"
+
+static const char *TAG = "ledanim_map";
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+esp_err_t ledanim_map_open(ledanim_map_t *map, const char *name)
+{
+    CHECK_ARG(map && name);
+
+    memset(map, 0, sizeof(*map));
+    int fd = open(name, O_RDONLY);
+    if (fd < 0)
+    {
+        ESP_LOGE(TAG, "No animation file '%s'", name);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) || !st.st_size)
+    {
+        close(fd);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        ESP_LOGE(TAG, "Failed to map '%s'", name);
+        return ESP_FAIL;
+    }
+    map->data = data;
+    map->size = st.st_size;
+
+    ESP_LOGI(TAG, "Mapped '%s', %d bytes at %p", name, (int)map->size, map->data);
+
+    return ESP_OK;
+}
+
+void ledanim_map_close(ledanim_map_t *map)
+{
+    if (!map || !map->data)
+        return;
+
+    munmap((void *)map->data, map->size);
+    memset(map, 0, sizeof(*map));
+}
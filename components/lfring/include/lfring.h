@@ -0,0 +1,443 @@
+/**
+ * @file lfring.h
+ * @defgroup lfring lfring
+ * @{
+ *
+ * Lock-free rings of fixed-size messages, header only.
+ *
+ * A FreeRTOS queue takes a critical section on every send and receive, and
+ * the receiver is woken through the scheduler each time. These rings copy
+ * the message into a slot and publish it with one atomic store, and only
+ * notify the consumer task when it actually sleeps in `*_pop_wait()`.
+ *
+ * - `lfring_spsc_t`: one producer, one consumer. The producer and consumer
+ *   counters live on their own cache lines, and each side keeps a copy of
+ *   the other side's counter, so neither reads the other's line while the
+ *   ring is neither full nor empty.
+ * - `lfring_mpsc_t`: any number of producers, tasks or ISRs, one consumer.
+ *   Producers claim a slot with a CAS on the head, every slot carries a
+ *   sequence number that publishes it (Vyukov's bounded queue).
+ *
+ * Buffers come from the caller (`LFRING_SPSC_BUF_SIZE()`,
+ * `LFRING_MPSC_BUF_SIZE()`) and must be in internal RAM, the CPU has no
+ * atomic operations on PSRAM. Only the consumer task may call
+ * `*_pop_wait()`, it blocks on the task notification of index 0.
+ */
+#ifndef __LFRING_H__
+#define __LFRING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <esp_err.h>
+#include <sdkconfig.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The ESP32 and its Xtensa and RISC-V successors do not cache internal RAM,
+// so there is no false sharing to avoid; the P4 and the host do cache it
+#ifndef LFRING_CACHE_LINE
+#if defined(CONFIG_IDF_TARGET_LINUX) || defined(CONFIG_IDF_TARGET_ESP32P4)
+#define LFRING_CACHE_LINE 64
+#else
+#define LFRING_CACHE_LINE 4
+#endif
+#endif
+
+#define LFRING_ALIGNED __attribute__((aligned(LFRING_CACHE_LINE)))
+
+/**
+ * Buffer bytes of an SPSC ring of `capacity` messages of `size` bytes
+ */
+#define LFRING_SPSC_BUF_SIZE(capacity, size) ((capacity) * (size))
+
+/**
+ * Buffer bytes of an MPSC ring, every slot has a 32 bit sequence number
+ */
+#define LFRING_MPSC_BUF_SIZE(capacity, size) ((capacity) * (sizeof(uint32_t) + (((size) + 3) & ~(size_t)3)))
+
+/**
+ * Consumer task sleeping in `*_pop_wait()`
+ */
+typedef struct
+{
+    TaskHandle_t task;
+    uint32_t waiting;
+} lfring_waiter_t;
+
+/**
+ * Single-producer/single-consumer ring
+ */
+typedef struct
+{
+    struct
+    {
+        uint32_t head;           //!< Messages pushed
+        uint32_t tail_cache;     //!< Last tail seen
+    } LFRING_ALIGNED prod;
+    struct
+    {
+        uint32_t tail;           //!< Messages popped
+        uint32_t head_cache;     //!< Last head seen
+    } LFRING_ALIGNED cons;
+    lfring_waiter_t waiter LFRING_ALIGNED;
+    uint8_t *buf LFRING_ALIGNED;
+    uint32_t mask;
+    uint32_t size;
+} lfring_spsc_t;
+
+/**
+ * Multi-producer/single-consumer ring
+ */
+typedef struct
+{
+    uint32_t head LFRING_ALIGNED; //!< Slots claimed by producers
+    uint32_t tail LFRING_ALIGNED; //!< Messages popped
+    lfring_waiter_t waiter LFRING_ALIGNED;
+    uint8_t *buf LFRING_ALIGNED;
+    uint32_t mask;
+    uint32_t size;
+    uint32_t stride;             //!< Sequence number and message, rounded to words
+} lfring_mpsc_t;
+
+/* Consumer side of a wakeup: announce the sleep, check, then sleep */
+static inline void lfring_wait_begin_(lfring_waiter_t *w)
+{
+    w->task = xTaskGetCurrentTaskHandle();
+    __atomic_store_n(&w->waiting, 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void lfring_wait_end_(lfring_waiter_t *w)
+{
+    __atomic_store_n(&w->waiting, 0, __ATOMIC_RELAXED);
+}
+
+/* Producer side: the fence orders the publish before the check */
+static inline bool lfring_wake_needed_(lfring_waiter_t *w)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&w->waiting, __ATOMIC_RELAXED)
+           && __atomic_exchange_n(&w->waiting, 0, __ATOMIC_ACQUIRE);
+}
+
+static inline void lfring_wake_(lfring_waiter_t *w)
+{
+    if (lfring_wake_needed_(w))
+        xTaskNotifyGive(w->task);
+}
+
+static inline void lfring_wake_from_isr_(lfring_waiter_t *w, BaseType_t *woken)
+{
+    if (lfring_wake_needed_(w))
+        vTaskNotifyGiveFromISR(w->task, woken);
+}
+
+/* Ticks left of a timeout, 0 once it expired */
+static inline TickType_t lfring_left_(TickType_t start, TickType_t timeout)
+{
+    if (timeout == portMAX_DELAY)
+        return portMAX_DELAY;
+    TickType_t waited = xTaskGetTickCount() - start;
+    return waited < timeout ? timeout - waited : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Initialize an empty SPSC ring
+ *
+ * @param r Ring
+ * @param buf Buffer of `LFRING_SPSC_BUF_SIZE(capacity, size)` bytes
+ * @param capacity Number of messages, a power of two
+ * @param size Bytes per message
+ * @return `ESP_OK` on success
+ */
+static inline esp_err_t lfring_spsc_init(lfring_spsc_t *r, void *buf, uint32_t capacity, uint32_t size)
+{
+    if (!r || !buf || !size || !capacity || (capacity & (capacity - 1)))
+        return ESP_ERR_INVALID_ARG;
+
+    memset(r, 0, sizeof(lfring_spsc_t));
+    r->buf = buf;
+    r->mask = capacity - 1;
+    r->size = size;
+
+    return ESP_OK;
+}
+
+/* Copies and publishes, false if full */
+static inline bool lfring_spsc_put_(lfring_spsc_t *r, const void *msg)
+{
+    uint32_t head = r->prod.head;
+    if (head - r->prod.tail_cache > r->mask)
+    {
+        r->prod.tail_cache = __atomic_load_n(&r->cons.tail, __ATOMIC_ACQUIRE);
+        if (head - r->prod.tail_cache > r->mask)
+            return false;
+    }
+    memcpy(r->buf + (head & r->mask) * r->size, msg, r->size);
+    __atomic_store_n(&r->prod.head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/**
+ * @brief Push a message, producer only
+ *
+ * @param r Ring
+ * @param msg Message, copied
+ * @return false if the ring is full
+ */
+static inline bool lfring_spsc_push(lfring_spsc_t *r, const void *msg)
+{
+    if (!lfring_spsc_put_(r, msg))
+        return false;
+    lfring_wake_(&r->waiter);
+    return true;
+}
+
+/**
+ * @brief Push a message from an ISR, producer only
+ *
+ * @param r Ring
+ * @param msg Message, copied
+ * @param[out] woken Set if the consumer task was woken, for `portYIELD_FROM_ISR()`
+ * @return false if the ring is full
+ */
+static inline bool lfring_spsc_push_from_isr(lfring_spsc_t *r, const void *msg, BaseType_t *woken)
+{
+    if (!lfring_spsc_put_(r, msg))
+        return false;
+    lfring_wake_from_isr_(&r->waiter, woken);
+    return true;
+}
+
+/**
+ * @brief Pop the oldest message, consumer only
+ *
+ * @param r Ring
+ * @param[out] msg Message
+ * @return false if the ring is empty
+ */
+static inline bool lfring_spsc_pop(lfring_spsc_t *r, void *msg)
+{
+    uint32_t tail = r->cons.tail;
+    if (tail == r->cons.head_cache)
+    {
+        r->cons.head_cache = __atomic_load_n(&r->prod.head, __ATOMIC_ACQUIRE);
+        if (tail == r->cons.head_cache)
+            return false;
+    }
+    memcpy(msg, r->buf + (tail & r->mask) * r->size, r->size);
+    __atomic_store_n(&r->cons.tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/**
+ * @brief Pop the oldest message, sleeping until one arrives
+ *
+ * @param r Ring
+ * @param[out] msg Message
+ * @param timeout Ticks to wait, `portMAX_DELAY` for ever
+ * @return false on timeout
+ */
+static inline bool lfring_spsc_pop_wait(lfring_spsc_t *r, void *msg, TickType_t timeout)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (!lfring_spsc_pop(r, msg))
+    {
+        TickType_t left = lfring_left_(start, timeout);
+        if (!left)
+            return false;
+
+        lfring_wait_begin_(&r->waiter);
+        if (__atomic_load_n(&r->prod.head, __ATOMIC_RELAXED) == r->cons.tail)
+            ulTaskNotifyTake(pdTRUE, left);
+        lfring_wait_end_(&r->waiter);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Messages in the ring
+ *
+ * @param r Ring
+ * @return Number of messages, exact from the producer or the consumer
+ */
+static inline uint32_t lfring_spsc_count(const lfring_spsc_t *r)
+{
+    uint32_t tail = __atomic_load_n(&r->cons.tail, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&r->prod.head, __ATOMIC_ACQUIRE) - tail;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Initialize an empty MPSC ring
+ *
+ * @param r Ring
+ * @param buf Buffer of `LFRING_MPSC_BUF_SIZE(capacity, size)` bytes, word aligned
+ * @param capacity Number of messages, a power of two
+ * @param size Bytes per message
+ * @return `ESP_OK` on success
+ */
+static inline esp_err_t lfring_mpsc_init(lfring_mpsc_t *r, void *buf, uint32_t capacity, uint32_t size)
+{
+    if (!r || !buf || !size || !capacity || (capacity & (capacity - 1)) || ((uintptr_t)buf & 3))
+        return ESP_ERR_INVALID_ARG;
+
+    memset(r, 0, sizeof(lfring_mpsc_t));
+    r->buf = buf;
+    r->mask = capacity - 1;
+    r->size = size;
+    r->stride = LFRING_MPSC_BUF_SIZE(1, size);
+
+    // A slot is free for the producer of position seq, full for the consumer at seq - 1
+    for (uint32_t i = 0; i < capacity; i++)
+        *(uint32_t *)(r->buf + i * r->stride) = i;
+
+    return ESP_OK;
+}
+
+/* Claims a slot, copies and publishes, false if full */
+static inline bool lfring_mpsc_put_(lfring_mpsc_t *r, const void *msg)
+{
+    uint32_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    uint8_t *slot;
+
+    while (1)
+    {
+        slot = r->buf + (pos & r->mask) * r->stride;
+        int32_t diff = (int32_t)(__atomic_load_n((uint32_t *)slot, __ATOMIC_ACQUIRE) - pos);
+        if (diff < 0)
+            return false;
+        // On failure pos is reloaded with the current head
+        if (diff == 0 && __atomic_compare_exchange_n(&r->head, &pos, pos + 1, true,
+                                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+        if (diff > 0)
+            pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    }
+
+    memcpy(slot + sizeof(uint32_t), msg, r->size);
+    __atomic_store_n((uint32_t *)slot, pos + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/**
+ * @brief Push a message, any task
+ *
+ * @param r Ring
+ * @param msg Message, copied
+ * @return false if the ring is full
+ */
+static inline bool lfring_mpsc_push(lfring_mpsc_t *r, const void *msg)
+{
+    if (!lfring_mpsc_put_(r, msg))
+        return false;
+    lfring_wake_(&r->waiter);
+    return true;
+}
+
+/**
+ * @brief Push a message from an ISR
+ *
+ * @param r Ring
+ * @param msg Message, copied
+ * @param[out] woken Set if the consumer task was woken, for `portYIELD_FROM_ISR()`
+ * @return false if the ring is full
+ */
+static inline bool lfring_mpsc_push_from_isr(lfring_mpsc_t *r, const void *msg, BaseType_t *woken)
+{
+    if (!lfring_mpsc_put_(r, msg))
+        return false;
+    lfring_wake_from_isr_(&r->waiter, woken);
+    return true;
+}
+
+/* Whether the slot at the tail is published */
+static inline bool lfring_mpsc_ready_(const lfring_mpsc_t *r, uint32_t order)
+{
+    const uint8_t *slot = r->buf + (r->tail & r->mask) * r->stride;
+    return __atomic_load_n((const uint32_t *)slot, order) == r->tail + 1;
+}
+
+/**
+ * @brief Pop the oldest message, consumer only
+ *
+ * A producer that claimed a slot but has not published it yet holds back
+ * the messages behind it.
+ *
+ * @param r Ring
+ * @param[out] msg Message
+ * @return false if the ring is empty
+ */
+static inline bool lfring_mpsc_pop(lfring_mpsc_t *r, void *msg)
+{
+    if (!lfring_mpsc_ready_(r, __ATOMIC_ACQUIRE))
+        return false;
+
+    uint8_t *slot = r->buf + (r->tail & r->mask) * r->stride;
+    memcpy(msg, slot + sizeof(uint32_t), r->size);
+    __atomic_store_n((uint32_t *)slot, r->tail + r->mask + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+/**
+ * @brief Pop the oldest message, sleeping until one arrives
+ *
+ * @param r Ring
+ * @param[out] msg Message
+ * @param timeout Ticks to wait, `portMAX_DELAY` for ever
+ * @return false on timeout
+ */
+static inline bool lfring_mpsc_pop_wait(lfring_mpsc_t *r, void *msg, TickType_t timeout)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (!lfring_mpsc_pop(r, msg))
+    {
+        TickType_t left = lfring_left_(start, timeout);
+        if (!left)
+            return false;
+
+        lfring_wait_begin_(&r->waiter);
+        if (!lfring_mpsc_ready_(r, __ATOMIC_RELAXED))
+            ulTaskNotifyTake(pdTRUE, left);
+        lfring_wait_end_(&r->waiter);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Messages in the ring, claimed slots included
+ *
+ * @param r Ring
+ * @return Number of messages
+ */
+static inline uint32_t lfring_mpsc_count(const lfring_mpsc_t *r)
+{
+    uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+    return __atomic_load_n(&r->head, __ATOMIC_RELAXED) - tail;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __LFRING_H__ */
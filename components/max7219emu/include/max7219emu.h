@@ -0,0 +1,164 @@
+/**
+ * @file max7219emu.h
+ * @defgroup max7219emu max7219emu
+ * @{
+ *
+ * Emulator of a MAX7219/MAX7221 cascade, fed with the SPI stream.
+ *
+ * Every chip has a 16 bit shift register. Bits enter the chip nearest to
+ * the MCU, MSB first, and what a chip shifts out enters the next one. When
+ * CS goes up at the end of a transaction every chip latches the word in its
+ * shift register. So the first word of a transaction ends in the farthest
+ * chip, chips are numbered here as in the driver: chip `n` latches word `n`
+ * of a transaction of one word per chip. Shift registers keep their
+ * content between transactions, a short transaction latches stale words in
+ * the far chips as the hardware does.
+ *
+ * Latched words are decoded into the registers of the chip (digits, decode
+ * mode, intensity, scan limit, shutdown, display test) and the segments or
+ * matrix rows shown are derived from them. Statistics count the bytes that
+ * changed nothing, to measure batching and dirty tracking.
+ *
+ * No platform dependencies. On linux max7219emu_attach() feeds it from the
+ * SPI fake of halfake.
+ */
+#ifndef __MAX7219EMU_H__
+#define __MAX7219EMU_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <sdkconfig.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX7219EMU_MAX_CHIPS 16
+#define MAX7219EMU_DIGITS    8
+
+/**
+ * Registers of one chip, as at power-up after max7219emu_init()
+ */
+typedef struct
+{
+    uint8_t digit[MAX7219EMU_DIGITS]; //!< Digit registers, blank at power-up
+    uint8_t decode;              //!< Code B decode, one bit per digit
+    uint8_t intensity;           //!< 0..15
+    uint8_t scan_limit;          //!< Last digit scanned, 0..7
+    bool shutdown;               //!< Display blanked, true at power-up
+    bool test;                   //!< All segments on
+} max7219emu_chip_t;
+
+/**
+ * Totals since the last max7219emu_take_stats()
+ */
+typedef struct
+{
+    uint32_t transactions;       //!< CS pulses
+    uint32_t bytes;              //!< Bytes clocked in
+    uint32_t words;              //!< Words latched, one per chip and transaction
+    uint32_t changes;            //!< Words that changed a register
+    uint32_t redundant;          //!< Words that wrote the value a register held
+    uint32_t noops;              //!< No-op words
+    uint32_t overflow_bits;      //!< Bits shifted out of the farthest chip
+    uint32_t misaligned;         //!< Transactions not made of whole words
+} max7219emu_stats_t;
+
+typedef struct
+{
+    uint8_t chips;
+    int cs;                      //!< CS pin listened to, see max7219emu_attach()
+    uint16_t shift[MAX7219EMU_MAX_CHIPS]; //!< Shift registers, in driver order
+    max7219emu_chip_t chip[MAX7219EMU_MAX_CHIPS];
+    max7219emu_stats_t stats;
+} max7219emu_t;
+
+/**
+ * @brief Bytes that changed no register
+ *
+ * @param stats Statistics
+ * @return Bytes of redundant and no-op words and of shifted out bits
+ */
+static inline uint32_t max7219emu_wasted_bytes(const max7219emu_stats_t *stats)
+{
+    return (stats->redundant + stats->noops) * 2 + stats->overflow_bits / 8;
+}
+
+/**
+ * @brief Power up a cascade
+ *
+ * @param emu Emulator
+ * @param chips Chips in the cascade, up to `MAX7219EMU_MAX_CHIPS`
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219emu_init(max7219emu_t *emu, uint8_t chips);
+
+/**
+ * @brief Clock in one transaction and latch it
+ *
+ * @param emu Emulator
+ * @param data Bytes, MSB first
+ * @param bits Bits clocked in
+ */
+void max7219emu_feed(max7219emu_t *emu, const uint8_t *data, size_t bits);
+
+/**
+ * @brief Segments lit for a digit, or the LEDs of a matrix row
+ *
+ * Applies shutdown, scan limit, display test and Code B decoding. Bit 7 is
+ * the decimal point, bits 6..0 are segments A..G.
+ *
+ * @param emu Emulator
+ * @param chip Chip, in driver order
+ * @param digit Digit 0..7
+ * @return Lit segments
+ */
+uint8_t max7219emu_segments(const max7219emu_t *emu, uint8_t chip, uint8_t digit);
+
+/**
+ * @brief Lit segments of the whole cascade
+ *
+ * @param emu Emulator
+ * @param[out] rows One byte per digit, 8 per chip in driver order
+ * @param max Size of `rows`
+ * @return Bytes written
+ */
+size_t max7219emu_render(const max7219emu_t *emu, uint8_t *rows, size_t max);
+
+/**
+ * @brief Get and clear the statistics, e.g. once per frame
+ *
+ * @param emu Emulator
+ * @param[out] stats Statistics since the last call
+ */
+void max7219emu_take_stats(max7219emu_t *emu, max7219emu_stats_t *stats);
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+
+/**
+ * @brief Feed the emulator from the halfake SPI fake
+ *
+ * Uses the SPI listener of halfake, only one emulator can be attached.
+ *
+ * @param emu Emulator
+ * @param cs CS pin of the SPI device to listen to
+ * @return `ESP_OK` on success
+ */
+esp_err_t max7219emu_attach(max7219emu_t *emu, int cs);
+
+/**
+ * @brief Stop feeding the attached emulator
+ */
+void max7219emu_detach(void);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __MAX7219EMU_H__ */
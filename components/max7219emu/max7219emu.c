@@ -0,0 +1,158 @@
+/**
+ * @file max7219emu.c
+ *
+ * Emulator of a MAX7219/MAX7221 cascade.
+ */
+#include <string.h>
+#include "max7219emu.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define REG_NOOP         0x0
+#define REG_DIGIT_0      0x1
+#define REG_DIGIT_7      0x8
+#define REG_DECODE_MODE  0x9
+#define REG_INTENSITY    0xa
+#define REG_SCAN_LIMIT   0xb
+#define REG_SHUTDOWN     0xc
+#define REG_DISPLAY_TEST 0xf
+
+#define SEG_DP 0x80
+
+// Code B font, segments A..G in bits 6..0
+static const uint8_t code_b[16] = {
+    0x7e, 0x30, 0x6d, 0x79, 0x33, 0x5b, 0x5f, 0x70, // 0..7
+    0x7f, 0x7b, 0x01, 0x4f, 0x37, 0x0e, 0x67, 0x00, // 8, 9, -, E, H, L, P, blank
+};
+
+// Writes a register, returns false if it held the value already
+static bool set(uint8_t *reg, uint8_t val)
+{
+    if (*reg == val)
+        return false;
+    *reg = val;
+    return true;
+}
+
+static void latch(max7219emu_t *emu, max7219emu_chip_t *chip, uint16_t word)
+{
+    uint8_t addr = (word >> 8) & 0x0f;
+    uint8_t val = word & 0xff;
+    bool changed;
+
+    switch (addr)
+    {
+        case REG_NOOP:
+            emu->stats.noops++;
+            return;
+        case REG_DECODE_MODE:
+            changed = set(&chip->decode, val);
+            break;
+        case REG_INTENSITY:
+            changed = set(&chip->intensity, val & 0x0f);
+            break;
+        case REG_SCAN_LIMIT:
+            changed = set(&chip->scan_limit, val & 0x07);
+            break;
+        case REG_SHUTDOWN:
+            changed = chip->shutdown != !(val & 1);
+            chip->shutdown = !(val & 1);
+            break;
+        case REG_DISPLAY_TEST:
+            changed = chip->test != (val & 1);
+            chip->test = val & 1;
+            break;
+        default:
+            if (addr > REG_DIGIT_7)
+            {
+                // 0xd and 0xe are not decoded by the chip
+                emu->stats.noops++;
+                return;
+            }
+            changed = set(&chip->digit[addr - REG_DIGIT_0], val);
+            break;
+    }
+
+    if (changed)
+        emu->stats.changes++;
+    else
+        emu->stats.redundant++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t max7219emu_init(max7219emu_t *emu, uint8_t chips)
+{
+    CHECK_ARG(emu && chips && chips <= MAX7219EMU_MAX_CHIPS);
+
+    memset(emu, 0, sizeof(max7219emu_t));
+    emu->chips = chips;
+    emu->cs = -1;
+    for (uint8_t i = 0; i < chips; i++)
+        emu->chip[i].shutdown = true;
+
+    return ESP_OK;
+}
+
+void max7219emu_feed(max7219emu_t *emu, const uint8_t *data, size_t bits)
+{
+    emu->stats.transactions++;
+    emu->stats.bytes += (bits + 7) / 8;
+    if (bits % 16)
+        emu->stats.misaligned++;
+
+    // Bits enter the last chip in driver order and leave from chip 0
+    for (size_t b = 0; b < bits; b++)
+    {
+        uint16_t carry = (data[b / 8] >> (7 - b % 8)) & 1;
+        for (int i = emu->chips - 1; i >= 0; i--)
+        {
+            uint16_t out = emu->shift[i] >> 15;
+            emu->shift[i] = (emu->shift[i] << 1) | carry;
+            carry = out;
+        }
+        if (b >= emu->chips * 16u)
+            emu->stats.overflow_bits++;
+    }
+
+    for (uint8_t i = 0; i < emu->chips; i++)
+    {
+        emu->stats.words++;
+        latch(emu, &emu->chip[i], emu->shift[i]);
+    }
+}
+
+uint8_t max7219emu_segments(const max7219emu_t *emu, uint8_t chip, uint8_t digit)
+{
+    if (chip >= emu->chips || digit >= MAX7219EMU_DIGITS)
+        return 0;
+
+    const max7219emu_chip_t *c = &emu->chip[chip];
+    if (c->test)
+        return 0xff;
+    if (c->shutdown || digit > c->scan_limit)
+        return 0;
+
+    uint8_t val = c->digit[digit];
+    if (c->decode & (1 << digit))
+        return (val & SEG_DP) | code_b[val & 0x0f];
+
+    return val;
+}
+
+size_t max7219emu_render(const max7219emu_t *emu, uint8_t *rows, size_t max)
+{
+    size_t n = 0;
+
+    for (uint8_t c = 0; c < emu->chips; c++)
+        for (uint8_t d = 0; d < MAX7219EMU_DIGITS && n < max; d++)
+            rows[n++] = max7219emu_segments(emu, c, d);
+
+    return n;
+}
+
+void max7219emu_take_stats(max7219emu_t *emu, max7219emu_stats_t *stats)
+{
+    *stats = emu->stats;
+    memset(&emu->stats, 0, sizeof(emu->stats));
+}
@@ -0,0 +1,34 @@
+/**
+ * @file max7219emu_halfake.c
+ *
+ * Feeds an emulator from the SPI fake on linux.
+ */
+#include "max7219emu.h"
+#include "halfake.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+static void on_spi(void *ctx, spi_device_handle_t dev, const uint8_t *data, size_t bits)
+{
+    max7219emu_t *emu = ctx;
+
+    if (halfake_spi_cs(dev) == emu->cs)
+        max7219emu_feed(emu, data, bits);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t max7219emu_attach(max7219emu_t *emu, int cs)
+{
+    CHECK_ARG(emu && emu->chips);
+
+    emu->cs = cs;
+    halfake_spi_listen(on_spi, emu);
+
+    return ESP_OK;
+}
+
+void max7219emu_detach(void)
+{
+    halfake_spi_listen(NULL, NULL);
+}
@@ -0,0 +1,108 @@
+/**
+ * @file taglog.h
+ * @defgroup taglog taglog
+ * @{
+ *
+ * Per-tag log levels without string compares on the logging path.
+ *
+ * A log call passes two filters:
+ *  - a compile-time ceiling, `TAGLOG_CEILING`, set per component or per
+ *    file. Calls above it are removed by the compiler and cost nothing.
+ *    Defaults to `LOG_LOCAL_LEVEL`.
+ *  - the runtime level of the tag. A tag is declared once per file with
+ *    TAGLOG_DEFINE(). Its first log call hashes the name into a small table
+ *    and keeps a pointer to its level, later calls only load and compare it.
+ *
+ * Levels set with taglog_level_set() are passed on to esp_log_level_set(),
+ * so that `esp_log_write()` lets the enabled calls through.
+ */
+#ifndef __TAGLOG_H__
+#define __TAGLOG_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <esp_err.h>
+#include <esp_log.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TAGLOG_CEILING
+#define TAGLOG_CEILING LOG_LOCAL_LEVEL
+#endif
+
+#define TAGLOG_TABLE_SIZE 32     //!< Tags with their own level, a power of two
+#define TAGLOG_MAX_TAG    16     //!< Significant characters of a tag
+
+/**
+ * Log tag, declare it with TAGLOG_DEFINE()
+ */
+typedef struct
+{
+    const char *name;            //!< Tag printed in the log
+    const volatile uint8_t *level; //!< Runtime level, resolved on first use
+} taglog_tag_t;
+
+#define TAGLOG_DEFINE(var, tag) static taglog_tag_t var = { .name = tag, .level = NULL }
+
+/**
+ * @brief Find or add the table slot of a tag, used by taglog_enabled()
+ *
+ * @param tag Log tag
+ * @return Level of the tag
+ */
+const volatile uint8_t *taglog_resolve(taglog_tag_t *tag);
+
+/**
+ * @brief Check the runtime level of a tag
+ *
+ * @param tag Log tag
+ * @param level Level of the call
+ * @return true if the call should be logged
+ */
+static inline bool taglog_enabled(taglog_tag_t *tag, esp_log_level_t level)
+{
+    const volatile uint8_t *l = tag->level;
+    if (!l)
+        l = taglog_resolve(tag);
+    return level <= *l;
+}
+
+/**
+ * @brief Set the runtime level of a tag
+ *
+ * "*" sets the level of all tags without a level of their own.
+ *
+ * @param tag Tag name
+ * @param level Log level
+ * @return `ESP_OK` on success, `ESP_ERR_NO_MEM` if the table is full
+ */
+esp_err_t taglog_level_set(const char *tag, esp_log_level_t level);
+
+/**
+ * @brief Get the runtime level of a tag
+ *
+ * @param tag Tag name
+ * @return Log level
+ */
+esp_log_level_t taglog_level_get(const char *tag);
+
+#define TAGLOG_LEVEL(tag, level, letter, fmt, ...) do { \
+        if (TAGLOG_CEILING >= (level) && taglog_enabled(tag, level)) \
+            esp_log_write(level, (tag)->name, LOG_FORMAT(letter, fmt), esp_log_timestamp(), (tag)->name, ##__VA_ARGS__); \
+    } while (0)
+
+#define TAGLOG_LOGE(tag, fmt, ...) TAGLOG_LEVEL(tag, ESP_LOG_ERROR, E, fmt, ##__VA_ARGS__)
+#define TAGLOG_LOGW(tag, fmt, ...) TAGLOG_LEVEL(tag, ESP_LOG_WARN, W, fmt, ##__VA_ARGS__)
+#define TAGLOG_LOGI(tag, fmt, ...) TAGLOG_LEVEL(tag, ESP_LOG_INFO, I, fmt, ##__VA_ARGS__)
+#define TAGLOG_LOGD(tag, fmt, ...) TAGLOG_LEVEL(tag, ESP_LOG_DEBUG, D, fmt, ##__VA_ARGS__)
+#define TAGLOG_LOGV(tag, fmt, ...) TAGLOG_LEVEL(tag, ESP_LOG_VERBOSE, V, fmt, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __TAGLOG_H__ */
@@ -0,0 +1,126 @@
+/**
+ * @file taglog.c
+ *
+ * Runtime levels of log tags in an open addressing hash table.
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "taglog.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#ifdef CONFIG_LOG_DEFAULT_LEVEL
+#define DEFAULT_LEVEL CONFIG_LOG_DEFAULT_LEVEL
+#else
+#define DEFAULT_LEVEL ESP_LOG_INFO
+#endif
+
+typedef struct
+{
+    uint32_t hash;               // 0 marks a free slot
+    char name[TAGLOG_MAX_TAG];   // not terminated when full
+    volatile uint8_t level;
+    bool own;                    // set with taglog_level_set(), "*" leaves it alone
+} slot_t;
+
+static slot_t s_table[TAGLOG_TABLE_SIZE];
+static volatile uint8_t s_default = DEFAULT_LEVEL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* FNV-1a of the significant characters, never 0 */
+static uint32_t hash(const char *name)
+{
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < TAGLOG_MAX_TAG && name[i]; i++)
+    {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+
+    return h ? h : 1;
+}
+
+/* Slot of a tag, a new one if `add` is set. Call with the lock held */
+static slot_t *find(const char *name, bool add)
+{
+    uint32_t h = hash(name);
+
+    for (uint32_t i = 0; i < TAGLOG_TABLE_SIZE; i++)
+    {
+        slot_t *s = &s_table[(h + i) & (TAGLOG_TABLE_SIZE - 1)];
+        if (!s->hash)
+        {
+            if (!add)
+                return NULL;
+            s->hash = h;
+            memcpy(s->name, name, strnlen(name, TAGLOG_MAX_TAG));
+            s->level = s_default;
+            s->own = false;
+            return s;
+        }
+        if (s->hash == h && !strncmp(s->name, name, TAGLOG_MAX_TAG))
+            return s;
+    }
+
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+const volatile uint8_t *taglog_resolve(taglog_tag_t *tag)
+{
+    portENTER_CRITICAL(&s_lock);
+    slot_t *s = find(tag->name, true);
+    portEXIT_CRITICAL(&s_lock);
+
+    // With the table full the tag follows the default level
+    tag->level = s ? &s->level : &s_default;
+
+    return tag->level;
+}
+
+esp_err_t taglog_level_set(const char *tag, esp_log_level_t level)
+{
+    CHECK_ARG(tag && level <= ESP_LOG_VERBOSE);
+
+    esp_err_t res = ESP_OK;
+    portENTER_CRITICAL(&s_lock);
+    if (!strcmp(tag, "*"))
+    {
+        s_default = level;
+        for (int i = 0; i < TAGLOG_TABLE_SIZE; i++)
+            if (s_table[i].hash && !s_table[i].own)
+                s_table[i].level = level;
+    }
+    else
+    {
+        slot_t *s = find(tag, true);
+        if (s)
+        {
+            s->level = level;
+            s->own = true;
+        }
+        else
+            res = ESP_ERR_NO_MEM;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (res == ESP_OK)
+        esp_log_level_set(tag, level);
+
+    return res;
+}
+
+esp_log_level_t taglog_level_get(const char *tag)
+{
+    if (!tag)
+        return s_default;
+
+    portENTER_CRITICAL(&s_lock);
+    slot_t *s = find(tag, false);
+    esp_log_level_t level = s ? s->level : s_default;
+    portEXIT_CRITICAL(&s_lock);
+
+    return level;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file taskprof.h
+ * @defgroup taskprof taskprof
+ * @{
+ *
+ * Periodic per-task CPU and stack profiler.
+ *
+ * A low priority task takes a sample of all tasks with
+ * `uxTaskGetSystemState()` every period and logs one report line with the
+ * share of a core each task ran for and its stack high-water mark (see
+ * taskprof_report.h). Lines with tasks near stack exhaustion or hogging a
+ * core are logged as warnings.
+ *
+ * Needs `CONFIG_FREERTOS_USE_TRACE_FACILITY` and
+ * `CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS`, cores are shown with
+ * `CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID`.
+ */
+#ifndef __TASKPROF_H__
+#define __TASKPROF_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+#include "freertos/FreeRTOS.h"
+#include "taskprof_report.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TASKPROF_MAX_LINE   256  //!< Longest report line
+
+/**
+ * Profiler configuration
+ */
+typedef struct
+{
+    uint32_t period_ms;          //!< Time between reports
+    size_t max_tasks;            //!< Tasks shown besides the flagged ones
+    taskprof_limits_t limits;    //!< Limits of the flags
+    UBaseType_t task_priority;   //!< Priority of the profiler task, keep it low
+    BaseType_t task_core;        //!< Core of the profiler task, or `tskNO_AFFINITY`
+} taskprof_config_t;
+
+#define TASKPROF_DEFAULT_CONFIG() { \
+    .period_ms = 5000, \
+    .max_tasks = 5, \
+    .limits = { .stack_free_min = 256, .hog_permille = 900 }, \
+    .task_priority = 1, \
+    .task_core = tskNO_AFFINITY, \
+}
+
+/**
+ * @brief Start the profiler task
+ *
+ * @param config Profiler configuration
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_STATE` if already started,
+ *         `ESP_ERR_NOT_SUPPORTED` without run time stats in the FreeRTOS configuration
+ */
+esp_err_t taskprof_start(const taskprof_config_t *config);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __TASKPROF_H__ */
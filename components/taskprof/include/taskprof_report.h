@@ -0,0 +1,106 @@
+/**
+ * @file taskprof_report.h
+ * @defgroup taskprof_report taskprof_report
+ * @{
+ *
+ * Usage and report lines of the task profiler.
+ *
+ * Two samples of all tasks, taken an interval apart, give the share of a
+ * core each task ran for and the least stack it had left. Tasks are
+ * flagged when their free stack drops below a limit or when they take more
+ * than a limit of a core. Idle tasks are never flagged as hogs.
+ *
+ * A report is one line, the busiest tasks first:
+ *
+ *     9 tasks, 87.5% idle: game/1 10.2% 412B, keypad/- 1.1% 188B !stack
+ *
+ * with the name, the core or `-` for unpinned tasks, the share of a core
+ * and the free stack in bytes.
+ *
+ * No platform dependencies, so reports can be checked on the host.
+ */
+#ifndef __TASKPROF_REPORT_H__
+#define __TASKPROF_REPORT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TASKPROF_NAME_LEN   16   //!< Name bytes kept, terminator included
+
+#define TASKPROF_FLAG_STACK 0x01 //!< Free stack below the limit
+#define TASKPROF_FLAG_HOG   0x02 //!< Share of a core above the limit
+#define TASKPROF_FLAG_NEW   0x04 //!< Not in the previous sample, share since its start
+
+/**
+ * State of one task at a sample
+ */
+typedef struct
+{
+    char name[TASKPROF_NAME_LEN];
+    uint32_t id;                 //!< Task number, unique while the task lives
+    uint32_t runtime;            //!< Run time counter, wraps
+    uint32_t stack_free;         //!< Least free stack since the task started, bytes
+    int8_t core;                 //!< Core the task is pinned to, -1 if not
+    uint8_t priority;
+} taskprof_sample_t;
+
+/**
+ * Usage of one task over an interval
+ */
+typedef struct
+{
+    char name[TASKPROF_NAME_LEN];
+    uint32_t permille;           //!< Share of a core, 1/1000
+    uint32_t stack_free;         //!< Bytes
+    int8_t core;
+    uint8_t flags;               //!< `TASKPROF_FLAG_*`
+} taskprof_usage_t;
+
+typedef struct
+{
+    uint32_t stack_free_min;     //!< Flag tasks with less free stack, bytes
+    uint32_t hog_permille;       //!< Flag tasks taking more of a core, 1/1000
+} taskprof_limits_t;
+
+/**
+ * @brief Usage of the tasks between two samples
+ *
+ * @param prev Previous sample, NULL for the first one
+ * @param prev_count Tasks in it
+ * @param cur Current sample
+ * @param count Tasks in it
+ * @param elapsed Run time counter ticks between the samples
+ * @param limits Limits of the flags
+ * @param[out] usage One entry per task of the current sample, busiest first
+ * @return Number of flagged tasks
+ */
+size_t taskprof_usage(const taskprof_sample_t *prev, size_t prev_count, const taskprof_sample_t *cur, size_t count,
+                      uint32_t elapsed, const taskprof_limits_t *limits, taskprof_usage_t *usage);
+
+/**
+ * @brief Format a report line
+ *
+ * Shows the busiest `max_tasks` tasks and all flagged ones. A line that
+ * does not fit is cut at the last complete task and ends with `...`.
+ *
+ * @param usage Usage of all tasks, busiest first
+ * @param count Number of tasks
+ * @param max_tasks Tasks shown besides the flagged ones
+ * @param[out] buf Line, terminated
+ * @param size Size of `buf`
+ * @return Length of the line
+ */
+size_t taskprof_format(const taskprof_usage_t *usage, size_t count, size_t max_tasks, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __TASKPROF_REPORT_H__ */
@@ -0,0 +1,150 @@
+/**
+ * @file taskprof.c
+ *
+ * Periodic per-task CPU and stack profiler: the sampling task.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <sdkconfig.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "taskprof.h"
+
+static const char *TAG = "taskprof";
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+
+#define TASK_STACK   3072
+#define SLACK        4           // tasks created between counting and sampling
+
+// Before IDF 5 the counters are always 32 bits
+#ifndef configRUN_TIME_COUNTER_TYPE
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+#endif
+
+static struct
+{
+    taskprof_config_t config;
+    TaskHandle_t task;
+    TaskStatus_t *status;
+    taskprof_sample_t *prev;
+    taskprof_sample_t *cur;
+    taskprof_usage_t *usage;
+    size_t capacity;
+} s_prof;
+
+static bool reserve(size_t count)
+{
+    if (count <= s_prof.capacity)
+        return true;
+
+    // prev keeps its entries, the others are refilled every sample
+    TaskStatus_t *status = realloc(s_prof.status, count * sizeof(TaskStatus_t));
+    if (status)
+        s_prof.status = status;
+    taskprof_sample_t *prev = realloc(s_prof.prev, count * sizeof(taskprof_sample_t));
+    if (prev)
+        s_prof.prev = prev;
+    taskprof_sample_t *cur = realloc(s_prof.cur, count * sizeof(taskprof_sample_t));
+    if (cur)
+        s_prof.cur = cur;
+    taskprof_usage_t *usage = realloc(s_prof.usage, count * sizeof(taskprof_usage_t));
+    if (usage)
+        s_prof.usage = usage;
+    if (!status || !prev || !cur || !usage)
+        return false;
+
+    s_prof.capacity = count;
+    return true;
+}
+
+static void to_sample(const TaskStatus_t *status, taskprof_sample_t *s)
+{
+    strncpy(s->name, status->pcTaskName, TASKPROF_NAME_LEN - 1);
+    s->name[TASKPROF_NAME_LEN - 1] = '\0';
+    s->id = status->xTaskNumber;
+    s->runtime = (uint32_t)status->ulRunTimeCounter;
+    s->stack_free = status->usStackHighWaterMark * sizeof(StackType_t);
+    s->priority = status->uxCurrentPriority;
+#if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+    s->core = status->xCoreID == tskNO_AFFINITY ? -1 : status->xCoreID;
+#else
+    s->core = -1;
+#endif
+}
+
+static void taskprof_task(void *arg)
+{
+    static char line[TASKPROF_MAX_LINE];
+    size_t prev_count = 0;
+    uint32_t prev_total = 0;
+    TickType_t wake = xTaskGetTickCount();
+
+    while (1)
+    {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(s_prof.config.period_ms));
+
+        if (!reserve(uxTaskGetNumberOfTasks() + SLACK))
+        {
+            ESP_LOGE(TAG, "No memory for %" PRIu32 " tasks", (uint32_t)uxTaskGetNumberOfTasks());
+            continue;
+        }
+
+        // Zero when tasks were created since counting, retry next period
+        configRUN_TIME_COUNTER_TYPE total;
+        UBaseType_t count = uxTaskGetSystemState(s_prof.status, s_prof.capacity, &total);
+        if (!count)
+            continue;
+        for (UBaseType_t i = 0; i < count; i++)
+            to_sample(&s_prof.status[i], &s_prof.cur[i]);
+
+        size_t flagged = taskprof_usage(prev_count ? s_prof.prev : NULL, prev_count, s_prof.cur, count,
+                                        (uint32_t)total - prev_total, &s_prof.config.limits, s_prof.usage);
+        taskprof_format(s_prof.usage, count, s_prof.config.max_tasks, line, sizeof(line));
+        if (flagged)
+            ESP_LOGW(TAG, "%s", line);
+        else
+            ESP_LOGI(TAG, "%s", line);
+
+        taskprof_sample_t *tmp = s_prof.prev;
+        s_prof.prev = s_prof.cur;
+        s_prof.cur = tmp;
+        prev_count = count;
+        prev_total = (uint32_t)total;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t taskprof_start(const taskprof_config_t *config)
+{
+    CHECK_ARG(config && config->period_ms);
+    if (s_prof.task)
+        return ESP_ERR_INVALID_STATE;
+
+    s_prof.config = *config;
+    if (xTaskCreatePinnedToCore(taskprof_task, "taskprof", TASK_STACK, NULL,
+                                config->task_priority, &s_prof.task, config->task_core) != pdPASS)
+        return ESP_ERR_NO_MEM;
+
+    ESP_LOGI(TAG, "Started, report every %" PRIu32 " ms", config->period_ms);
+
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t taskprof_start(const taskprof_config_t *config)
+{
+    CHECK_ARG(config && config->period_ms);
+
+    ESP_LOGW(TAG, "Enable CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS");
+
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * @file taskprof_report.c
+ *
+ * Usage and report lines of the task profiler.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "taskprof_report.h"
+
+#define IDLE_PREFIX "IDLE"
+#define MORE        " ..."
+
+static bool is_idle(const char *name)
+{
+    return strncmp(name, IDLE_PREFIX, sizeof(IDLE_PREFIX) - 1) == 0;
+}
+
+static const taskprof_sample_t *find(const taskprof_sample_t *samples, size_t count, uint32_t id)
+{
+    for (size_t i = 0; i < count; i++)
+        if (samples[i].id == id)
+            return &samples[i];
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+size_t taskprof_usage(const taskprof_sample_t *prev, size_t prev_count, const taskprof_sample_t *cur, size_t count,
+                      uint32_t elapsed, const taskprof_limits_t *limits, taskprof_usage_t *usage)
+{
+    size_t flagged = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const taskprof_sample_t *s = &cur[i];
+        const taskprof_sample_t *p = prev ? find(prev, prev_count, s->id) : NULL;
+        uint32_t ran = p ? s->runtime - p->runtime : s->runtime;
+
+        taskprof_usage_t u = {
+            .permille = elapsed ? (uint32_t)((uint64_t)ran * 1000 / elapsed) : 0,
+            .stack_free = s->stack_free,
+            .core = s->core,
+            .flags = p ? 0 : TASKPROF_FLAG_NEW,
+        };
+        memcpy(u.name, s->name, TASKPROF_NAME_LEN);
+        u.name[TASKPROF_NAME_LEN - 1] = '\0';
+        if (u.stack_free < limits->stack_free_min)
+            u.flags |= TASKPROF_FLAG_STACK;
+        if (u.permille > limits->hog_permille && !is_idle(u.name))
+            u.flags |= TASKPROF_FLAG_HOG;
+        if (u.flags & (TASKPROF_FLAG_STACK | TASKPROF_FLAG_HOG))
+            flagged++;
+
+        // Insertion sort, busiest first, ties keep the sample order
+        size_t j = i;
+        for (; j > 0 && usage[j - 1].permille < u.permille; j--)
+            usage[j] = usage[j - 1];
+        usage[j] = u;
+    }
+
+    return flagged;
+}
+
+size_t taskprof_format(const taskprof_usage_t *usage, size_t count, size_t max_tasks, char *buf, size_t size)
+{
+    if (!size)
+        return 0;
+
+    uint32_t idle = 0, idle_tasks = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (is_idle(usage[i].name))
+        {
+            idle += usage[i].permille;
+            idle_tasks++;
+        }
+    }
+    if (idle_tasks)
+        idle /= idle_tasks;
+
+    int len = snprintf(buf, size, "%u tasks, %u.%u%% idle:", (unsigned)count, (unsigned)(idle / 10),
+                       (unsigned)(idle % 10));
+    if (len < 0 || (size_t)len >= size)
+        return strlen(buf);
+
+    size_t shown = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const taskprof_usage_t *u = &usage[i];
+        bool flagged = u->flags & (TASKPROF_FLAG_STACK | TASKPROF_FLAG_HOG);
+        if (shown >= max_tasks && !flagged)
+            continue;
+
+        char core[4] = "-";
+        if (u->core >= 0)
+            snprintf(core, sizeof(core), "%d", u->core);
+
+        char entry[TASKPROF_NAME_LEN + 48];
+        int n = snprintf(entry, sizeof(entry), "%s %s/%s %u.%u%% %uB%s%s", shown ? "," : "", u->name, core,
+                         (unsigned)(u->permille / 10), (unsigned)(u->permille % 10), (unsigned)u->stack_free,
+                         (u->flags & TASKPROF_FLAG_STACK) ? " !stack" : "",
+                         (u->flags & TASKPROF_FLAG_HOG) ? " !hog" : "");
+
+        // Keep room to mark the cut
+        if ((size_t)(len + n) + sizeof(MORE) > size)
+        {
+            if ((size_t)len + sizeof(MORE) <= size)
+            {
+                memcpy(buf + len, MORE, sizeof(MORE));
+                len += sizeof(MORE) - 1;
+            }
+            break;
+        }
+        memcpy(buf + len, entry, n + 1);
+        len += n;
+        shown++;
+    }
+
+    return len;
+}
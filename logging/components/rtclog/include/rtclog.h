@@ -0,0 +1,46 @@
+/**
+ * @file rtclog.h
+ * @defgroup rtclog rtclog
+ * @{
+ *
+ * Log sink that survives resets.
+ *
+ * Installed with `esp_log_set_vprintf()`, it keeps a copy of the recent log
+ * lines in a ring in RTC memory that is not initialised at boot (see
+ * rtclog_ring.h). Nothing is written to flash. After a panic, watchdog or
+ * software reset the next boot finds the ring intact, prints the lines of
+ * the previous run and starts a new ring. Power loss clears the memory,
+ * which the CRCs detect.
+ *
+ * Install it before asynclog: asynclog then chains to it and the lines are
+ * copied from its output task, off the caller's path.
+ */
+#ifndef __RTCLOG_H__
+#define __RTCLOG_H__
+
+#include <esp_err.h>
+#include "rtclog_ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef RTCLOG_SIZE
+#define RTCLOG_SIZE     2048     //!< Bytes of the data area in RTC memory, a power of two
+#endif
+#define RTCLOG_MAX_LINE 160      //!< Longest line kept, longer ones are cut
+
+/**
+ * @brief Print the lines of the previous run, if any, and install the sink
+ *
+ * @return `ESP_OK` on success, `ESP_ERR_INVALID_STATE` if already installed
+ */
+esp_err_t rtclog_install(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __RTCLOG_H__ */
@@ -0,0 +1,139 @@
+/**
+ * @file rtclog_ring.h
+ * @defgroup rtclog_ring rtclog_ring
+ * @{
+ *
+ * Log ring that can be trusted after a reset.
+ *
+ * The ring is a header followed by a data area of a power of two bytes.
+ * Records are a sequence number, a length and a CRC-16, followed by the
+ * text, and wrap around the end of the data area. The header keeps the
+ * offsets of the oldest record and of the end of the newest one in two
+ * copies, each with a generation count and its own CRC. An update always
+ * rewrites the older copy, so a reset in the middle of it leaves the newer
+ * one intact, and the ring is read through the newest intact copy.
+ *
+ * An append first moves the tail past the records it is going to
+ * overwrite, then writes the record and only then moves the head. As the
+ * copy that is rewritten is never the one in use, a reset at any point
+ * leaves an intact copy that describes complete records only. Recovery
+ * still checks every record and stops at the first bad one.
+ *
+ * No platform dependencies, so the layout can be exercised on the host.
+ */
+#ifndef __RTCLOG_RING_H__
+#define __RTCLOG_RING_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RTCLOG_RING_MAGIC 0x52544c47 //!< "RTLG"
+
+/**
+ * One copy of the ring state
+ */
+typedef struct
+{
+    uint32_t head;               //!< End of the newest record, runs freely
+    uint32_t tail;               //!< Start of the oldest record, runs freely
+    uint32_t seq;                //!< Sequence number of the next record
+    uint32_t gen;                //!< Updates so far, the higher one of the copies is current
+    uint32_t crc;                //!< CRC-16 of magic, size and the fields above
+} rtclog_state_t;
+
+/**
+ * Ring header, the data area follows it
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;               //!< Bytes in the data area, a power of two
+    rtclog_state_t state[2];     //!< Written alternately
+    uint8_t data[];
+} rtclog_ring_t;
+
+/**
+ * Record header, the text follows it
+ */
+typedef struct
+{
+    uint32_t seq;
+    uint16_t len;                //!< Bytes of text
+    uint16_t crc;                //!< CRC-16 of seq, len and text
+} rtclog_rec_t;
+
+/**
+ * Called for every recovered record, oldest first. `text` is not terminated.
+ */
+typedef void (*rtclog_visit_t)(uint32_t seq, const char *text, size_t len, void *ctx);
+
+/**
+ * @brief CRC-16/CCITT-FALSE
+ *
+ * @param crc Initial value, 0xffff or the result of the previous part
+ * @param data Data
+ * @param len Bytes of data
+ * @return CRC
+ */
+uint16_t rtclog_crc16(uint16_t crc, const void *data, size_t len);
+
+/**
+ * @brief Start an empty ring
+ *
+ * @param ring Ring
+ * @param size Bytes in the data area, a power of two
+ * @param seq Sequence number of the first record
+ */
+void rtclog_ring_init(rtclog_ring_t *ring, uint32_t size, uint32_t seq);
+
+/**
+ * @brief Check the header of a ring found in memory
+ *
+ * @param ring Ring
+ * @param size Expected bytes in the data area
+ * @return true if one copy of the state at least is intact
+ */
+bool rtclog_ring_valid(const rtclog_ring_t *ring, uint32_t size);
+
+/**
+ * @brief Sequence number of the next record
+ *
+ * @param ring Ring, checked with rtclog_ring_valid() before
+ * @return Sequence number
+ */
+uint32_t rtclog_ring_seq(const rtclog_ring_t *ring);
+
+/**
+ * @brief Append a record, dropping the oldest ones to make room
+ *
+ * @param ring Ring
+ * @param text Text
+ * @param len Bytes of text, cut to a quarter of the data area
+ * @return Bytes of text stored
+ */
+size_t rtclog_ring_append(rtclog_ring_t *ring, const char *text, size_t len);
+
+/**
+ * @brief Walk the intact records of a ring, oldest first
+ *
+ * @param ring Ring, checked with rtclog_ring_valid() before
+ * @param buf Buffer for the text of one record
+ * @param max Size of the buffer, longer texts are cut
+ * @param visit Callback
+ * @param ctx Callback context
+ * @return Number of records visited
+ */
+size_t rtclog_ring_recover(const rtclog_ring_t *ring, char *buf, size_t max, rtclog_visit_t visit, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**@}*/
+
+#endif /* __RTCLOG_RING_H__ */
@@ -0,0 +1,105 @@
+/**
+ * @file rtclog.c
+ *
+ * Log sink that survives resets.
+ */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <esp_system.h>
+#include "freertos/FreeRTOS.h"
+#include "rtclog.h"
+
+static const char *TAG = "rtclog";
+
+_Static_assert((RTCLOG_SIZE & (RTCLOG_SIZE - 1)) == 0, "RTCLOG_SIZE must be a power of two");
+
+typedef struct
+{
+    rtclog_ring_t ring;
+    uint8_t data[RTCLOG_SIZE];
+} rtc_ring_t;
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+static rtc_ring_t s_rtc;
+#else
+static RTC_NOINIT_ATTR rtc_ring_t s_rtc;
+#endif
+
+static vprintf_like_t s_prev;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int emit(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int res = s_prev(fmt, args);
+    va_end(args);
+
+    return res;
+}
+
+static int rtclog_vprintf(const char *fmt, va_list args)
+{
+    char line[RTCLOG_MAX_LINE];
+    va_list copy;
+
+    va_copy(copy, args);
+    int len = vsnprintf(line, sizeof(line), fmt, copy);
+    va_end(copy);
+    if (len <= 0)
+        return s_prev(fmt, args);
+
+    // Frames of asynclog start with a zero byte and are not kept
+    size_t kept = (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1;
+    if (line[0])
+    {
+        portENTER_CRITICAL(&s_lock);
+        rtclog_ring_append(&s_rtc.ring, line, kept);
+        portEXIT_CRITICAL(&s_lock);
+    }
+
+    // Format once where the whole line fitted and is plain text
+    if (kept == (size_t)len && !memchr(line, 0, kept))
+        return emit("%s", line);
+
+    return s_prev(fmt, args);
+}
+
+static void dump(uint32_t seq, const char *text, size_t len, void *ctx)
+{
+    while (len && text[len - 1] == '\n')
+        len--;
+    printf("%6" PRIu32 " | %.*s\n", seq, (int)len, text);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+esp_err_t rtclog_install(void)
+{
+    if (s_prev)
+        return ESP_ERR_INVALID_STATE;
+
+    uint32_t seq = 0;
+    if (rtclog_ring_valid(&s_rtc.ring, RTCLOG_SIZE))
+    {
+#ifdef CONFIG_IDF_TARGET_LINUX
+        ESP_LOGW(TAG, "Log of the previous run:");
+#else
+        ESP_LOGW(TAG, "Log of the previous run, reset reason %d:", esp_reset_reason());
+#endif
+        static char line[RTCLOG_MAX_LINE];
+        size_t count = rtclog_ring_recover(&s_rtc.ring, line, sizeof(line), dump, NULL);
+        ESP_LOGW(TAG, "End of the previous run, %u lines", (unsigned)count);
+        // Numbering goes on, so lines of different runs do not mix up
+        seq = rtclog_ring_seq(&s_rtc.ring);
+    }
+    rtclog_ring_init(&s_rtc.ring, RTCLOG_SIZE, seq);
+
+    s_prev = esp_log_set_vprintf(rtclog_vprintf);
+
+    return ESP_OK;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file rtclog_ring.c
+ *
+ * Log ring that can be trusted after a reset.
+ */
+#include <string.h>
+#include "rtclog_ring.h"
+
+#define RING_LEN offsetof(rtclog_ring_t, state)
+#define STATE_LEN offsetof(rtclog_state_t, crc)
+#define REC_HEADER_LEN offsetof(rtclog_rec_t, crc)
+
+static const uint16_t crc_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+static void put(rtclog_ring_t *ring, uint32_t pos, const void *src, size_t len)
+{
+    uint32_t off = pos & (ring->size - 1);
+    size_t first = ring->size - off < len ? ring->size - off : len;
+
+    memcpy(ring->data + off, src, first);
+    memcpy(ring->data, (const uint8_t *)src + first, len - first);
+}
+
+static void get(const rtclog_ring_t *ring, uint32_t pos, void *dst, size_t len)
+{
+    uint32_t off = pos & (ring->size - 1);
+    size_t first = ring->size - off < len ? ring->size - off : len;
+
+    memcpy(dst, ring->data + off, first);
+    memcpy((uint8_t *)dst + first, ring->data, len - first);
+}
+
+static uint16_t crc_span(const rtclog_ring_t *ring, uint16_t crc, uint32_t pos, size_t len)
+{
+    uint32_t off = pos & (ring->size - 1);
+    size_t first = ring->size - off < len ? ring->size - off : len;
+
+    crc = rtclog_crc16(crc, ring->data + off, first);
+    return rtclog_crc16(crc, ring->data, len - first);
+}
+
+static uint32_t state_crc(const rtclog_ring_t *ring, const rtclog_state_t *state)
+{
+    return rtclog_crc16(rtclog_crc16(0xffff, ring, RING_LEN), state, STATE_LEN);
+}
+
+static bool intact(const rtclog_ring_t *ring, const rtclog_state_t *state)
+{
+    return state->crc == state_crc(ring, state) && state->head - state->tail <= ring->size;
+}
+
+// Copy written last, as the writer knows it
+static const rtclog_state_t *current(const rtclog_ring_t *ring)
+{
+    return (int32_t)(ring->state[1].gen - ring->state[0].gen) > 0 ? &ring->state[1] : &ring->state[0];
+}
+
+// Newest copy that survived, NULL if none did
+static const rtclog_state_t *recovered(const rtclog_ring_t *ring)
+{
+    const rtclog_state_t *newer = current(ring);
+    const rtclog_state_t *older = newer == &ring->state[0] ? &ring->state[1] : &ring->state[0];
+
+    if (intact(ring, newer))
+        return newer;
+    if (intact(ring, older))
+        return older;
+
+    return NULL;
+}
+
+/*
+ * Write the new state over the older copy, which then becomes current. The
+ * fences keep the compiler from moving record stores across it, a reset
+ * sees memory in program order as a signal handler would.
+ */
+static const rtclog_state_t *seal(rtclog_ring_t *ring, const rtclog_state_t *cur,
+                                  uint32_t head, uint32_t tail, uint32_t seq)
+{
+    rtclog_state_t *next = cur == &ring->state[0] ? &ring->state[1] : &ring->state[0];
+
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    next->head = head;
+    next->tail = tail;
+    next->seq = seq;
+    next->gen = cur->gen + 1;
+    next->crc = state_crc(ring, next);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+    return next;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+uint16_t rtclog_crc16(uint16_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    while (len--)
+    {
+        crc = (crc << 4) ^ crc_nibble[(crc >> 12) ^ (*p >> 4)];
+        crc = (crc << 4) ^ crc_nibble[(crc >> 12) ^ (*p++ & 0x0f)];
+    }
+
+    return crc;
+}
+
+void rtclog_ring_init(rtclog_ring_t *ring, uint32_t size, uint32_t seq)
+{
+    ring->magic = RTCLOG_RING_MAGIC;
+    ring->size = size;
+    // Both copies hold the empty ring, the second one is current
+    ring->state[1].gen = 0;
+    seal(ring, &ring->state[1], 0, 0, seq);
+    seal(ring, &ring->state[0], 0, 0, seq);
+}
+
+bool rtclog_ring_valid(const rtclog_ring_t *ring, uint32_t size)
+{
+    return ring->magic == RTCLOG_RING_MAGIC
+        && ring->size == size
+        && recovered(ring);
+}
+
+uint32_t rtclog_ring_seq(const rtclog_ring_t *ring)
+{
+    return recovered(ring)->seq;
+}
+
+size_t rtclog_ring_append(rtclog_ring_t *ring, const char *text, size_t len)
+{
+    const rtclog_state_t *cur = current(ring);
+
+    if (len > ring->size / 4)
+        len = ring->size / 4;
+    uint32_t need = sizeof(rtclog_rec_t) + len;
+
+    // Drop the oldest records, and note it in the header before their
+    // space is reused
+    uint32_t tail = cur->tail;
+    while (cur->head + need - tail > ring->size)
+    {
+        rtclog_rec_t old;
+        get(ring, tail, &old, sizeof(old));
+        tail += sizeof(old) + old.len;
+        if ((int32_t)(cur->head - tail) <= 0)
+        {
+            tail = cur->head;
+            break;
+        }
+    }
+    if (tail != cur->tail)
+        cur = seal(ring, cur, cur->head, tail, cur->seq);
+
+    rtclog_rec_t rec = { .seq = cur->seq, .len = len };
+    rec.crc = rtclog_crc16(rtclog_crc16(0xffff, &rec, REC_HEADER_LEN), text, len);
+    put(ring, cur->head, &rec, sizeof(rec));
+    put(ring, cur->head + sizeof(rec), text, len);
+
+    seal(ring, cur, cur->head + need, cur->tail, cur->seq + 1);
+
+    return len;
+}
+
+size_t rtclog_ring_recover(const rtclog_ring_t *ring, char *buf, size_t max, rtclog_visit_t visit, void *ctx)
+{
+    const rtclog_state_t *state = recovered(ring);
+    size_t count = 0;
+
+    for (uint32_t pos = state->tail; state->head - pos >= sizeof(rtclog_rec_t);)
+    {
+        rtclog_rec_t rec;
+        get(ring, pos, &rec, sizeof(rec));
+        if (rec.len > ring->size / 4 || state->head - pos < sizeof(rec) + rec.len)
+            break;
+        uint16_t crc = crc_span(ring, rtclog_crc16(0xffff, &rec, REC_HEADER_LEN), pos + sizeof(rec), rec.len);
+        if (crc != rec.crc)
+            break;
+
+        size_t len = rec.len < max ? rec.len : max;
+        get(ring, pos + sizeof(rec), buf, len);
+        visit(rec.seq, buf, len, ctx);
+        count++;
+        pos += sizeof(rec) + rec.len;
+    }
+
+    return count;
+}
@@ -1,12 +1,122 @@
 #include <stdio.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "asynclog.h"
+#include "rtclog.h"
+
+// Compile everything in, so taglog filters at runtime only
+#define TAGLOG_CEILING ESP_LOG_VERBOSE
+#include "taglog.h"
 
 static const char *TAG = "LoggingExample";
 
+TAGLOG_DEFINE(tag, "LoggingExample");
+
+#define BENCH_CALLS    200
+#define DISABLED_CALLS 100000
+
+typedef enum
+{
+    BENCH_TEXT = 0,
+    BENCH_BINARY,
+} bench_mode_t;
+
+typedef struct
+{
+    int64_t total_us;
+    int64_t max_us;
+    uint32_t bytes;
+} bench_t;
+
+// Caller side cost of a log call, formatting and output included when synchronous
+static bench_t bench(const char *name, bench_mode_t mode)
+{
+    bench_t b = { 0 };
+    asynclog_stats_t before, after;
+
+    asynclog_get_stats(&before);
+    for (int i = 0; i < BENCH_CALLS; i++) {
+        int64_t start = esp_timer_get_time();
+        if (mode == BENCH_BINARY)
+            ASYNCLOG_LOGI(TAG, "%s call %d of %d, value 0x%08x", name, i, BENCH_CALLS, i * 2654435761u);
+        else
+            ESP_LOGI(TAG, "%s call %d of %d, value 0x%08x", name, i, BENCH_CALLS, i * 2654435761u);
+        int64_t us = esp_timer_get_time() - start;
+        b.total_us += us;
+        if (us > b.max_us)
+            b.max_us = us;
+    }
+    asynclog_flush(portMAX_DELAY);
+    asynclog_get_stats(&after);
+    b.bytes = after.bytes - before.bytes;
+
+    return b;
+}
+
+static void report(const char *name, bench_t b)
+{
+    ESP_LOGI(TAG, "%s: %" PRId64 " calls/s, %" PRId64 " us average, %" PRId64 " us max per call", name,
+             b.total_us ? (int64_t)BENCH_CALLS * 1000000 / b.total_us : 0, b.total_us / BENCH_CALLS, b.max_us);
+    // Only output of the asynclog task is counted
+    if (b.bytes)
+        ESP_LOGI(TAG, "%s: %" PRIu32 " bytes per call on the console", name, b.bytes / BENCH_CALLS);
+}
+
+// Cost of a call below the level, the loop runs empty without a filter
+static void bench_disabled(void)
+{
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < DISABLED_CALLS; i++)
+        ESP_LOGV(TAG, "compiled out %d", i);
+    int64_t compiled_out = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < DISABLED_CALLS; i++)
+        ESP_LOG_LEVEL(ESP_LOG_DEBUG, TAG, "esp_log filter %d", i);
+    int64_t esp_log = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < DISABLED_CALLS; i++)
+        TAGLOG_LOGD(&tag, "taglog filter %d", i);
+    int64_t taglog = esp_timer_get_time() - start;
+
+    ESP_LOGI(TAG, "Disabled call: %" PRId64 " ns compiled out, %" PRId64 " ns esp_log filter, %" PRId64 " ns taglog filter",
+             compiled_out * 1000 / DISABLED_CALLS, esp_log * 1000 / DISABLED_CALLS, taglog * 1000 / DISABLED_CALLS);
+}
 
 void app_main(void)
 {
+    // First, so the previous run is printed before anything else and
+    // asynclog chains to it later
+    ESP_ERROR_CHECK(rtclog_install());
+
     ESP_LOGI(TAG, "This is an info log");
     ESP_LOGW(TAG, "This is a warning log");
     ESP_LOGE(TAG, "This is an error log");
+
+    ESP_ERROR_CHECK(taglog_level_set(TAG, ESP_LOG_INFO));
+    bench_disabled();
+
+    bench_t sync = bench("sync", BENCH_TEXT);
+
+    // Binary records are written as frames, pass the console output
+    // through tools/asynclog_decode.py to read them
+    asynclog_config_t config = ASYNCLOG_DEFAULT_CONFIG();
+    config.ring_size = 16384;
+    config.binary = true;
+    ESP_ERROR_CHECK(asynclog_install(&config));
+    bench_t async = bench("async", BENCH_TEXT);
+    bench_t binary = bench("binary", BENCH_BINARY);
+
+    report("sync", sync);
+    report("async", async);
+    report("binary", binary);
+
+    asynclog_stats_t stats;
+    ESP_ERROR_CHECK(asynclog_get_stats(&stats));
+    ESP_LOGI(TAG, "Logged %" PRIu32 ", dropped %" PRIu32 ", truncated %" PRIu32,
+             stats.logged, stats.dropped, stats.truncated);
 }
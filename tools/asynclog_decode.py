@@ -0,0 +1,281 @@
+#!/usr/bin/env python3
+"""
+Decode the binary records of the asynclog component.
+
+With `binary` set in asynclog_config_t, ASYNCLOG_LOGx() records leave the
+target as frames: 0, COBS(format address, argument words, CRC-8), 0. The
+format strings stay in the ELF file, this tool looks them up and prints the
+lines as ESP_LOGx() would. Text between the frames is passed through.
+Examples:
+
+    # live, from the serial port (needs pyserial)
+    asynclog_decode.py build/logging.elf -p /dev/ttyUSB0
+
+    # from a capture file, or stdin without -i
+    asynclog_decode.py build/logging.elf -i capture.bin
+
+    # check the decoder against frames it encodes itself
+    asynclog_decode.py --self-test
+
+Only strings in flash or initialised data can be shown for %s, others are
+printed as their address.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+CONVERSION = re.compile(
+    r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t|q|L)?([diuxXoceEfFgGaAps%])')
+
+
+class Image:
+    """Loadable sections of an ELF file, by address"""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            elf = f.read()
+        if elf[:4] != b'\x7fELF':
+            raise ValueError('%s is not an ELF file' % path)
+        self.word = 4 if elf[4] == 1 else 8
+        self.endian = '<' if elf[5] == 1 else '>'
+        e = self.endian
+        if self.word == 4:
+            shoff, = struct.unpack_from(e + 'I', elf, 0x20)
+            shentsize, shnum = struct.unpack_from(e + 'HH', elf, 0x2e)
+            header = e + 'IIIIIIIIII'
+        else:
+            shoff, = struct.unpack_from(e + 'Q', elf, 0x28)
+            shentsize, shnum = struct.unpack_from(e + 'HH', elf, 0x3a)
+            header = e + 'IIQQQQIIQQ'
+
+        self.sections = []
+        for i in range(shnum):
+            _, kind, flags, addr, offset, size = struct.unpack_from(header, elf, shoff + i * shentsize)[:6]
+            if flags & SHF_ALLOC and kind != SHT_NOBITS and addr and size:
+                self.sections.append((addr, elf[offset:offset + size]))
+
+    def string(self, addr):
+        for start, data in self.sections:
+            if start <= addr < start + len(data):
+                end = data.find(b'\0', addr - start)
+                if end < 0:
+                    return None
+                return data[addr - start:end].decode('utf-8', 'replace')
+        return None
+
+
+class Memory(Image):
+    """Sections given as (address, bytes), for the self-test"""
+
+    def __init__(self, sections, word=4, endian='<'):
+        self.sections = sections
+        self.word = word
+        self.endian = endian
+
+
+def crc8(data):
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xff if crc & 0x80 else (crc << 1) & 0xff
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xff and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos = 0
+    for b in data:
+        if b:
+            out.append(b)
+        if not b or len(out) - code_pos == 0xff:
+            out[code_pos] = len(out) - code_pos
+            code_pos = len(out)
+            out.append(0)
+    out[code_pos] = len(out) - code_pos
+    return bytes(out)
+
+
+def render(image, fmt, words):
+    words = list(words)
+    mask = (1 << 32) - 1
+
+    def word():
+        return words.pop(0) if words else None
+
+    def signed(w):
+        w &= mask
+        return w - (1 << 32) if w & (1 << 31) else w
+
+    def conversion(m):
+        flags, width, precision, _, conv = m.groups()
+        if conv == '%':
+            return '%'
+        if width == '*':
+            w = word()
+            width = '' if w is None else str(signed(w))
+        if precision == '*':
+            w = word()
+            precision = '' if w is None else str(signed(w))
+        spec = '%' + flags + (width or '') + ('' if precision is None else '.' + precision)
+
+        w = word()
+        if w is None:
+            return m.group(0)
+        if conv in 'di':
+            return (spec + 'd') % signed(w)
+        if conv in 'uxXo':
+            return (spec + conv.replace('u', 'd')) % (w & mask)
+        if conv == 'c':
+            return (spec + 'c') % (w & 0xff)
+        if conv in 'eEfFgG':
+            return (spec + conv) % struct.unpack('<f', struct.pack('<I', w & mask))[0]
+        if conv in 'aA':
+            return struct.unpack('<f', struct.pack('<I', w & mask))[0].hex()
+        if conv == 'p':
+            return (spec + 's') % hex(w)
+        s = image.string(w) if w else '(null)'
+        return (spec + 's') % (s if s is not None else '<%#x>' % w)
+
+    return CONVERSION.sub(conversion, fmt)
+
+
+def decode_frame(image, chunk):
+    """Returns the line of a frame, or None if the chunk is not one"""
+    raw = cobs_decode(chunk)
+    if raw is None or len(raw) < image.word + 1 or (len(raw) - 1) % image.word:
+        return None
+    if crc8(raw[:-1]) != raw[-1]:
+        return None
+    count = (len(raw) - 1) // image.word
+    words = struct.unpack(image.endian + ('I' if image.word == 4 else 'Q') * count, raw[:-1])
+    fmt = image.string(words[0])
+    if fmt is None:
+        return None
+    return render(image, fmt, words[1:])
+
+
+def decode(image, read, write):
+    """Frames are delimited by zero bytes, which never appear in text"""
+    pending = b''
+    while True:
+        data = read()
+        if not data:
+            break
+        chunks = (pending + data).split(b'\0')
+        pending = chunks.pop()
+        for chunk in chunks:
+            if not chunk:
+                continue
+            line = decode_frame(image, chunk)
+            write(line if line is not None else chunk.decode('utf-8', 'replace'))
+    if pending:
+        write(pending.decode('utf-8', 'replace'))
+
+
+def self_test():
+    """Frames as the target writes them, in a stream split in every way"""
+    image = Memory([
+        (0x3f400000, b'I (%u) %s: frame %d of %u, %s %.2f %c%% %*d|%s|%s\n\0'),
+        (0x3f400100, b'app\0ok\0'),
+    ])
+
+    def frame(words, crc_of=None):
+        raw = struct.pack('<%dI' % len(words), *words)
+        crc = crc8(struct.pack('<%dI' % len(words), *(crc_of or words)))
+        return b'\0' + cobs_encode(raw + bytes([crc])) + b'\0'
+
+    float_word, = struct.unpack('<I', struct.pack('<f', 2.5))
+    # Zero words put zero bytes in the payload, 0x100 a zero byte inside a word
+    words = [0x3f400000, 1234, 0x3f400100, (-5) & 0xffffffff, 0x100, 0x3f400104,
+             float_word, ord('x'), 4, 7, 0, 0x1234]
+    good = frame(words)
+    bad = frame([words[0], 1235] + words[2:], crc_of=words)
+    short = frame(words[:4])
+    unknown = frame([0x3f400200, 1])
+
+    def passed(f):
+        return f[1:-1].decode('utf-8', 'replace')
+
+    line = 'I (1234) app: frame -5 of 256, ok 2.50 x%    7|(null)|<0x1234>\n'
+    cases = [
+        # text around and between frames
+        (b'boot text\n' + good + b'more text\n', 'boot text\n' + line + 'more text\n'),
+        (good + good, line + line),
+        # a bad CRC or an unknown format is passed through, not decoded
+        (bad, passed(bad)),
+        (unknown, passed(unknown)),
+        # missing arguments show their conversions
+        (short + b'tail', 'I (1234) app: frame -5 of %u, %s %.2f %c% %*d|%s|%s\n' + 'tail'),
+    ]
+    assert cobs_decode(cobs_encode(bytes(300))) == bytes(300)
+    assert cobs_decode(cobs_encode(bytes(range(1, 256)) * 2)) == bytes(range(1, 256)) * 2
+
+    failures = 0
+    for stream, expected in cases:
+        for size in (1, 2, 3, 7, len(stream)):
+            chunks = [stream[i:i + size] for i in range(0, len(stream), size)]
+            out = []
+            decode(image, lambda: chunks.pop(0) if chunks else b'', out.append)
+            if ''.join(out) != expected:
+                print('%r in chunks of %d: %r, expected %r' % (stream, size, ''.join(out), expected))
+                failures += 1
+    print('self-test %s' % ('failed' if failures else 'passed'))
+    return 1 if failures else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0].strip())
+    parser.add_argument('elf', nargs='?', help='ELF file of the running application')
+    parser.add_argument('--self-test', action='store_true', help='check the decoder and exit')
+    parser.add_argument('-i', '--input', help='capture file, default stdin')
+    parser.add_argument('-p', '--port', help='serial port')
+    parser.add_argument('-b', '--baud', type=int, default=115200, help='serial baud rate')
+    args = parser.parse_args()
+
+    if args.self_test:
+        sys.exit(self_test())
+    if not args.elf:
+        parser.error('the ELF file is required')
+    image = Image(args.elf)
+    out = sys.stdout
+
+    def write(text):
+        out.write(text)
+        out.flush()
+
+    if args.port:
+        import serial
+        port = serial.Serial(args.port, args.baud)
+        try:
+            decode(image, lambda: port.read(max(1, port.in_waiting)), write)
+        except KeyboardInterrupt:
+            pass
+    elif args.input:
+        with open(args.input, 'rb') as f:
+            decode(image, lambda: f.read(4096), write)
+    else:
+        decode(image, lambda: sys.stdin.buffer.read1(4096), write)
+
+
+if __name__ == '__main__':
+    main()
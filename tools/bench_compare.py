@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""
+Compare the results of two runs of the Benchmarks project.
+
+Reads the `BENCH` lines from two console logs, other lines are skipped.
+Examples:
+
+    # one line per benchmark, time per iteration and change
+    bench_compare.py old.log new.log
+
+    # exit status 1 if a benchmark got more than 5% slower
+    bench_compare.py --threshold 5 old.log new.log
+
+Benchmarks are matched by name and target. Times are the medians, in cycles
+when both runs have them, else in ns. Extra fields such as `spi_bytes` are
+counts of the work done and are reported when they differ.
+"""
+
+import argparse
+import json
+import sys
+
+FIXED = ('name', 'target', 'iters', 'runs', 'ns', 'ns_min', 'cycles', 'rate', 'unit')
+
+
+def read(path):
+    results = {}
+    with open(path, errors='replace') as f:
+        for line in f:
+            at = line.find('BENCH {')
+            if at < 0:
+                continue
+            try:
+                r = json.loads(line[at + len('BENCH '):])
+            except ValueError:
+                print('%s: bad line: %s' % (path, line.rstrip()), file=sys.stderr)
+                continue
+            results[(r['name'], r['target'])] = r
+    return results
+
+
+def compare(old, new, threshold):
+    ok = True
+    for key in sorted(set(old) | set(new)):
+        name = '%s (%s)' % key
+        if key not in new:
+            print('%-40s gone' % name)
+            continue
+        if key not in old:
+            print('%-40s new' % name)
+            continue
+        a, b = old[key], new[key]
+        unit = 'cycles' if a['cycles'] and b['cycles'] else 'ns'
+        before, after = a[unit], b[unit]
+        change = (after - before) * 100.0 / before if before else 0.0
+        slower = change > threshold
+        print('%-40s %12d -> %12d %-6s %+7.1f%%%s' % (name, before, after, unit, change, '  SLOWER' if slower else ''))
+        ok = ok and not slower
+
+        for field in sorted(set(a) | set(b)):
+            if field not in FIXED and a.get(field) != b.get(field):
+                print('%-40s %12s -> %12s %s' % ('', a.get(field, '-'), b.get(field, '-'), field))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('old', help='Log of the reference run')
+    parser.add_argument('new', help='Log of the run to check')
+    parser.add_argument('--threshold', type=float, default=float('inf'),
+                        help='Percent slower that fails the comparison')
+    args = parser.parse_args()
+
+    sys.exit(0 if compare(read(args.old), read(args.new), args.threshold) else 1)
+
+
+if __name__ == '__main__':
+    main()
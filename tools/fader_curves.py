@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""
+Generate and check the easing tables of the fader component.
+
+The tables in Fade/components/fader/fader_curves.c are sampled from the
+reference curves below. Examples:
+
+    # regenerate the C source
+    fader_curves.py -o Fade/components/fader/fader_curves.c
+
+    # compare the C source with the reference, exit status 1 on mismatch
+    fader_curves.py --check Fade/components/fader/fader_curves.c
+
+Every curve maps progress 0..1 to a fraction of the duty change 0..1 and is
+stored as FADER_CURVE_POINTS values in 1/65535.
+"""
+
+import argparse
+import math
+import re
+import sys
+
+POINTS = 33
+SCALE = 65535
+GAMMA = 2.2
+EXP_BASE = 1024.0
+
+# name in C, reference curve, description
+CURVES = [
+    ('in', lambda t: t * t, 'Quadratic, slow start'),
+    ('out', lambda t: 1 - (1 - t) ** 2, 'Quadratic, slow end'),
+    ('in_out', lambda t: 2 * t * t if t < 0.5 else 1 - 2 * (1 - t) ** 2, 'Quadratic, slow start and end'),
+    ('gamma', lambda t: t ** GAMMA, 'Perceived brightness, gamma %.1f' % GAMMA),
+    ('exp', lambda t: (EXP_BASE ** t - 1) / (EXP_BASE - 1), 'Exponential, base %d' % EXP_BASE),
+    ('sine', lambda t: (1 - math.cos(math.pi * t)) / 2, 'Raised cosine, half a sine period'),
+]
+
+
+def sample(curve):
+    return [round(curve(i / (POINTS - 1)) * SCALE) for i in range(POINTS)]
+
+
+def generate():
+    out = [
+        '/**',
+        ' * @file fader_curves.c',
+        ' *',
+        ' * Easing tables of the fade orchestrator.',
+        ' * Generated by tools/fader_curves.py, do not edit.',
+        ' */',
+        '#include "fader_curves.h"',
+        '',
+    ]
+    for name, curve, desc in CURVES:
+        values = sample(curve)
+        out.append('/* %s */' % desc)
+        out.append('const uint16_t fader_curve_%s[FADER_CURVE_POINTS] = {' % name)
+        for i in range(0, POINTS, 8):
+            out.append('    ' + ' '.join('%5d,' % v for v in values[i:i + 8]))
+        out.append('};')
+        out.append('')
+    return '\n'.join(out)
+
+
+def check(path):
+    """Compare the tables of a C source with the reference, 1 LSB tolerance."""
+    src = open(path).read()
+    ok = True
+    for name, curve, _ in CURVES:
+        m = re.search(r'fader_curve_%s\[[^]]*\]\s*=\s*\{([^}]*)\}' % name, src)
+        if not m:
+            print('%s: fader_curve_%s missing' % (path, name))
+            ok = False
+            continue
+        values = [int(v) for v in re.findall(r'\d+', m.group(1))]
+        ref = sample(curve)
+        if len(values) != POINTS:
+            print('fader_curve_%s: %d points, expected %d' % (name, len(values), POINTS))
+            ok = False
+            continue
+        worst = max(abs(a - b) for a, b in zip(values, ref))
+        monotonic = all(a <= b for a, b in zip(values, values[1:]))
+        endpoints = values[0] == 0 and values[-1] == SCALE
+        print('fader_curve_%-7s max error %d LSB%s%s' % (name, worst,
+              '' if monotonic else ', not monotonic', '' if endpoints else ', bad endpoints'))
+        ok = ok and worst <= 1 and monotonic and endpoints
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    group = parser.add_mutually_exclusive_group(required=True)
+    group.add_argument('-o', '--output', help='C source to write')
+    group.add_argument('--check', metavar='FILE', help='C source to compare with the reference')
+    args = parser.parse_args()
+
+    if args.check:
+        sys.exit(0 if check(args.check) else 1)
+
+    with open(args.output, 'w') as f:
+        f.write(generate())
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,281 @@
+#!/usr/bin/env python3
+"""
+Encode PNG/GIF sequences or 64 bit masks into the ledanim format.
+
+The format is described in components/ledanim/include/ledanim.h. Examples:
+
+    # animated GIF for an 8x8 WS2812B matrix, 4 bit palette
+    ledanim_encode.py --bpp 4 -o anim.lan anim.gif
+
+    # the IMAGES[] masks of the MAX7219 example, 1 bit
+    ledanim_encode.py --masks images.txt --mask-layout max7219 -o images.lan
+
+Prints bytes per frame next to the raw RGB and raw mask sizes. Pillow is
+only needed for image input.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = b'LANM'
+VERSION = 1
+FRAME_KEY = 0
+FRAME_DELTA = 1
+FRAME_HAS_DELAY = 0x80
+
+OP_LITERAL = 0
+OP_RUN = 1
+OP_SKIP = 2
+MAX_COUNT = 64
+
+
+def token(op, n):
+    return bytes([(op << 6) | (n - 1)])
+
+
+def pack(indices, bpp):
+    out = bytearray()
+    acc, bits = 0, 0
+    for idx in indices:
+        acc = (acc << bpp) | idx
+        bits += bpp
+        if bits == 8:
+            out.append(acc)
+            acc, bits = 0, 0
+    if bits:
+        out.append(acc << (8 - bits))
+    return bytes(out)
+
+
+def encode_span(indices, bpp):
+    """Literals and runs for a list of indices."""
+    # A run costs two bytes, only worth it once a literal would be longer
+    min_run = max(3, 16 // bpp + 1)
+    out = bytearray()
+    literal = []
+
+    def flush():
+        while literal:
+            chunk = literal[:MAX_COUNT]
+            del literal[:MAX_COUNT]
+            out.extend(token(OP_LITERAL, len(chunk)) + pack(chunk, bpp))
+
+    i = 0
+    while i < len(indices):
+        j = i
+        while j < len(indices) and indices[j] == indices[i] and j - i < MAX_COUNT:
+            j += 1
+        if j - i >= min_run:
+            flush()
+            out.extend(token(OP_RUN, j - i) + bytes([indices[i]]))
+            i = j
+        else:
+            literal.append(indices[i])
+            i += 1
+    flush()
+    return bytes(out)
+
+
+def encode_delta(prev, cur, bpp):
+    out = bytearray()
+    i = 0
+    while i < len(cur):
+        j = i
+        if cur[i] == prev[i]:
+            while j < len(cur) and cur[j] == prev[j]:
+                j += 1
+            # Trailing skips are implicit
+            if j == len(cur):
+                break
+            n = j - i
+            while n:
+                step = min(n, MAX_COUNT)
+                out.extend(token(OP_SKIP, step))
+                n -= step
+        else:
+            while j < len(cur) and cur[j] != prev[j]:
+                j += 1
+            out.extend(encode_span(cur[i:j], bpp))
+        i = j
+    return bytes(out)
+
+
+def encode(frames, palette, width, height, bpp, delays):
+    # Most common duration goes into the header, frames only carry exceptions
+    default_delay = max(set(delays), key=delays.count)
+    out = bytearray(MAGIC)
+    out += struct.pack('<BBHHHBBH', VERSION, bpp, width, height, len(frames), len(palette), 0, default_delay)
+    for r, g, b in palette:
+        out += bytes([r, g, b])
+
+    sizes = []
+    prev = None
+    for frame, delay in zip(frames, delays):
+        payload = encode_span(frame, bpp)
+        kind = FRAME_KEY
+        if prev is not None:
+            delta = encode_delta(prev, frame, bpp)
+            if len(delta) < len(payload):
+                payload, kind = delta, FRAME_DELTA
+        if len(payload) > 0xffff:
+            sys.exit('frame too large')
+        header = struct.pack('<BH', kind, len(payload))
+        if delay != default_delay:
+            header = struct.pack('<BHH', kind | FRAME_HAS_DELAY, len(payload), delay)
+        out += header + payload
+        sizes.append(len(header) + len(payload))
+        prev = frame
+    return bytes(out), sizes
+
+
+def decode(data):
+    """Reference decoder, mirrors ledanim_next() on a list of indices."""
+    version, bpp, width, height, count, psize = struct.unpack_from('<BBHHHB', data, 4)
+    pos = 16 + psize * 3
+    total = width * height
+    canvas = [0] * total
+    frames = []
+    for _ in range(count):
+        flags, length = struct.unpack_from('<BH', data, pos)
+        p = pos + (5 if flags & FRAME_HAS_DELAY else 3)
+        end = p + length
+        px = 0
+        while p < end and px < total:
+            op, n = data[p] >> 6, (data[p] & 0x3f) + 1
+            p += 1
+            if op == OP_LITERAL:
+                shift = 8
+                for _ in range(n):
+                    shift -= bpp
+                    canvas[px] = (data[p] >> shift) & ((1 << bpp) - 1)
+                    px += 1
+                    if not shift:
+                        shift, p = 8, p + 1
+                if shift != 8:
+                    p += 1
+            elif op == OP_RUN:
+                canvas[px:px + n] = [data[p]] * n
+                p += 1
+                px += n
+            else:
+                px += n
+        frames.append(list(canvas))
+        pos = end
+    return frames
+
+
+def parse_masks(path):
+    with open(path) as f:
+        text = f.read()
+    return [int(v, 16) for v in re.findall(r'0x([0-9a-fA-F]+)', text)]
+
+
+def masks_to_frames(masks, layout):
+    frames = []
+    for m in masks:
+        if layout == 'max7219':
+            # byte y of the little endian mask is row y, bit x is column x
+            frames.append([(m >> (8 * y + x)) & 1 for y in range(8) for x in range(8)])
+        else:
+            # uint64ToRGBArray(): pixel i is bit 63 - i
+            frames.append([(m >> (63 - i)) & 1 for i in range(64)])
+    return frames
+
+
+def load_images(paths, max_colors):
+    try:
+        from PIL import Image, ImageSequence
+    except ImportError:
+        sys.exit('Pillow is required for image input: pip install pillow')
+
+    rgb_frames, delays = [], []
+    for path in paths:
+        img = Image.open(path)
+        for frame in ImageSequence.Iterator(img):
+            rgb_frames.append(frame.convert('RGB'))
+            delays.append(frame.info.get('duration'))
+
+    width, height = rgb_frames[0].size
+    colors = set()
+    for f in rgb_frames:
+        colors.update(f.getdata())
+    if len(colors) > max_colors:
+        # Quantize all frames against one shared palette
+        strip = Image.new('RGB', (width, height * len(rgb_frames)))
+        for i, f in enumerate(rgb_frames):
+            strip.paste(f, (0, i * height))
+        strip = strip.quantize(max_colors).convert('RGB')
+        rgb_frames = [strip.crop((0, i * height, width, (i + 1) * height)) for i in range(len(rgb_frames))]
+        colors = set()
+        for f in rgb_frames:
+            colors.update(f.getdata())
+
+    # Darkest color first, a mono sink treats index 0 as off
+    palette = sorted(colors, key=lambda c: (c[0] * 3 + c[1] * 6 + c[2], c))
+    lookup = {c: i for i, c in enumerate(palette)}
+    frames = [[lookup[c] for c in f.getdata()] for f in rgb_frames]
+    return frames, palette, width, height, delays
+
+
+def write_c_array(path, name, data):
+    with open(path, 'w') as f:
+        f.write('// Generated by tools/ledanim_encode.py\n#include <stdint.h>\n\n')
+        f.write('const uint8_t %s[%d] = {\n' % (name, len(data)))
+        for i in range(0, len(data), 12):
+            f.write('    ' + ', '.join('0x%02x' % b for b in data[i:i + 12]) + ',\n')
+        f.write('};\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('images', nargs='*', help='PNG/GIF files, frames in order')
+    parser.add_argument('--masks', help='text file with 0x... 64 bit masks, e.g. a pasted C array')
+    parser.add_argument('--mask-layout', choices=['max7219', 'ws2812b'], default='max7219')
+    parser.add_argument('--color', default='ffffff', help='lit color for mask input')
+    parser.add_argument('--bpp', type=int, choices=[1, 2, 4], help='bits per pixel, default smallest that fits')
+    parser.add_argument('--delay', type=int, default=100, help='frame duration in ms if the input has none')
+    parser.add_argument('--c-array', metavar='NAME', help='write a C array instead of a binary file')
+    parser.add_argument('--verify', action='store_true', help='decode the result and compare')
+    parser.add_argument('-o', '--output', required=True)
+    args = parser.parse_args()
+
+    if args.masks:
+        frames = masks_to_frames(parse_masks(args.masks), args.mask_layout)
+        color = int(args.color, 16)
+        palette = [(0, 0, 0), ((color >> 16) & 0xff, (color >> 8) & 0xff, color & 0xff)]
+        width = height = 8
+        delays = [args.delay] * len(frames)
+    elif args.images:
+        frames, palette, width, height, delays = load_images(args.images, 1 << (args.bpp or 4))
+        delays = [d if d else args.delay for d in delays]
+    else:
+        parser.error('no input')
+
+    if not frames:
+        parser.error('no frames')
+    bpp = args.bpp or next(b for b in (1, 2, 4) if len(palette) <= 1 << b)
+    if len(palette) > 1 << bpp:
+        parser.error('%d colors do not fit %d bpp' % (len(palette), bpp))
+
+    data, sizes = encode(frames, palette, width, height, bpp, delays)
+
+    if args.verify and decode(data) != frames:
+        sys.exit('verification failed')
+
+    if args.c_array:
+        write_c_array(args.output, args.c_array, data)
+    else:
+        with open(args.output, 'wb') as f:
+            f.write(data)
+
+    pixels = width * height
+    print('%dx%d, %d frames, %d colors, %d bpp' % (width, height, len(frames), len(palette), bpp))
+    print('total %d bytes, %.1f bytes/frame (min %d, max %d)' %
+          (len(data), sum(sizes) / len(sizes), min(sizes), max(sizes)))
+    print('raw: %d bytes/frame RGB, %d bytes/frame mask' % (pixels * 3, (pixels + 7) // 8))
+
+
+if __name__ == '__main__':
+    main()